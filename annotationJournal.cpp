@@ -0,0 +1,474 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "annotationJournal.h"
+
+#include "tracer.h"
+
+#include "cudaMappedMemory.h"
+
+#include <map>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+
+
+#define JOURNAL_MAGIC   "CCAJ"
+#define JOURNAL_VERSION 1
+
+
+// (defined here because wait_for() binds it to a reference)
+const int AnnotationJournal::FlushInterval;
+
+
+// journalChecksum (FNV-1a)
+static uint32_t journalChecksum( const void* data, size_t size )
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	uint32_t hash = 2166136261u;
+
+	for( size_t n=0; n < size; n++ )
+	{
+		hash ^= bytes[n];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+
+// writeAll
+static bool writeAll( int fd, const void* data, size_t size )
+{
+	const uint8_t* ptr = (const uint8_t*)data;
+
+	while( size > 0 )
+	{
+		const ssize_t written = write(fd, ptr, size);
+
+		if( written < 0 )
+		{
+			if( errno == EINTR )
+				continue;
+
+			return false;
+		}
+
+		ptr  += written;
+		size -= written;
+	}
+
+	return true;
+}
+
+
+// constructor
+AnnotationJournal::AnnotationJournal()
+{
+	model    = NULL;
+	discard  = false;
+	stopping = false;
+	thread   = std::thread(&AnnotationJournal::run, this);
+}
+
+
+// destructor
+AnnotationJournal::~AnnotationJournal()
+{
+	if( model != NULL )
+		model->RemoveEventHandler(AnnotationJournal::onAnnotationEvent, this);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	// the journal is kept, the pending records are written before exiting
+	condition.notify_all();
+	thread.join();
+}
+
+
+// Open
+void AnnotationJournal::Open( const std::string& path )
+{
+	// the journal of the previous file is left on disk to be restored
+	if( model != NULL )
+	{
+		model->RemoveEventHandler(AnnotationJournal::onAnnotationEvent, this);
+		model = NULL;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	filename = path;
+	discard  = false;
+
+	pending.clear();
+	frame.clear();
+}
+
+
+// Begin
+void AnnotationJournal::Begin( AnnotationModel* annotations, const uchar3* image, int width, int height, const std::string& sample )
+{
+	if( model != NULL )
+		model->RemoveEventHandler(AnnotationJournal::onAnnotationEvent, this);
+
+	model = NULL;
+
+	if( filename.size() == 0 || !annotations || !image || width <= 0 || height <= 0 )
+		return;
+
+	JournalHeader header;
+	memset(&header, 0, sizeof(header));
+
+	memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+	strncpy(header.sample, sample.c_str(), sizeof(header.sample) - 1);
+
+	header.version  = JOURNAL_VERSION;
+	header.width    = width;
+	header.height   = height;
+	header.checksum = journalChecksum(&header, offsetof(JournalHeader, checksum));
+
+	const size_t imageSize = width * height * sizeof(uchar3);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		// the frame is copied here and written to disk by the writer thread
+		frame.resize(sizeof(JournalHeader) + imageSize);
+
+		memcpy(frame.data(), &header, sizeof(JournalHeader));
+		memcpy(frame.data() + sizeof(JournalHeader), image, imageSize);
+
+		pending.clear();
+	}
+
+	model = annotations;
+	model->AddEventHandler(AnnotationJournal::onAnnotationEvent, this);
+
+	// the boxes already in the frame (i.e. carried by the tracker)
+	queue(JournalRecord::Clear, NULL);
+
+	for( int n=0; n < model->GetCount(); n++ )
+		queue(JournalRecord::Create, &model->GetAt(n));
+
+	condition.notify_one();
+}
+
+
+// End
+void AnnotationJournal::End()
+{
+	if( model != NULL )
+	{
+		model->RemoveEventHandler(AnnotationJournal::onAnnotationEvent, this);
+		model = NULL;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		discard = true;
+
+		pending.clear();
+		frame.clear();
+	}
+
+	condition.notify_one();
+}
+
+
+// onAnnotationEvent
+void AnnotationJournal::onAnnotationEvent( uint16_t event, uint32_t id, int row, void* user )
+{
+	AnnotationJournal* journal = (AnnotationJournal*)user;
+
+	if( !journal || !journal->model )
+		return;
+
+	AnnotationModel* model = journal->model;
+
+	if( event == ANNOTATION_INSERTED )
+	{
+		journal->queue(JournalRecord::Create, &model->GetAt(row));
+	}
+	else if( event == ANNOTATION_CHANGED )
+	{
+		journal->queue(JournalRecord::Modify, &model->GetAt(row));
+	}
+	else if( event == ANNOTATION_REMOVING )
+	{
+		journal->queue(JournalRecord::Remove, &model->GetAt(row));
+	}
+	else if( event == ANNOTATION_RESET )
+	{
+		journal->queue(JournalRecord::Clear, NULL);
+
+		for( int n=0; n < model->GetCount(); n++ )
+			journal->queue(JournalRecord::Create, &model->GetAt(n));
+	}
+}
+
+
+// queue
+void AnnotationJournal::queue( uint8_t type, const BoundingBox* box )
+{
+	JournalRecord record;
+	memset(&record, 0, sizeof(record));
+
+	record.type = type;
+
+	if( box != NULL )
+	{
+		record.flags   = box->flags;
+		record.id      = box->id;
+		record.classID = box->classID;
+		record.x       = box->x;
+		record.y       = box->y;
+		record.width   = box->width;
+		record.height  = box->height;
+	}
+
+	record.checksum = journalChecksum(&record, offsetof(JournalRecord, checksum));
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// a drag modifies the same box many times between syncs, only the last one is needed
+	if( type == JournalRecord::Modify && pending.size() > 0 )
+	{
+		JournalRecord& last = pending.back();
+
+		if( last.id == record.id && (last.type == JournalRecord::Modify || last.type == JournalRecord::Create) )
+		{
+			record.type     = last.type;
+			record.checksum = journalChecksum(&record, offsetof(JournalRecord, checksum));
+			last = record;
+			return;
+		}
+	}
+
+	pending.push_back(record);
+}
+
+
+// run
+void AnnotationJournal::run()
+{
+	Tracer::SetThreadName("journal");
+
+	std::vector<JournalRecord> records;
+	std::vector<uint8_t> newFrame;
+
+	std::string path;
+	int fd = -1;
+
+	while( true )
+	{
+		bool remove = false;
+		bool exit   = false;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+
+			// batch up the records between syncs
+			condition.wait_for(lock, std::chrono::milliseconds(FlushInterval), [this]{ return stopping || discard || frame.size() > 0; });
+
+			if( fd >= 0 && path != filename )
+			{
+				close(fd);
+				fd = -1;
+			}
+
+			path   = filename;
+			remove = discard;
+			exit   = stopping;
+
+			discard = false;
+
+			newFrame.swap(frame);
+			records.swap(pending);
+
+			frame.clear();
+			pending.clear();
+		}
+
+		if( remove )
+		{
+			if( fd >= 0 )
+			{
+				close(fd);
+				fd = -1;
+			}
+
+			if( path.size() > 0 )
+				unlink(path.c_str());
+		}
+
+		if( newFrame.size() > 0 )
+		{
+			if( fd >= 0 )
+				close(fd);
+
+			fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+			if( fd < 0 )
+				printf("camera-capture:  failed to create annotation journal %s\n", path.c_str());
+			else if( !writeAll(fd, newFrame.data(), newFrame.size()) )
+				printf("camera-capture:  failed to write annotation journal %s\n", path.c_str());
+
+			newFrame.clear();
+		}
+
+		if( fd >= 0 && records.size() > 0 )
+		{
+			TRACE_SCOPE("journal_sync");
+
+			if( !writeAll(fd, records.data(), records.size() * sizeof(JournalRecord)) )
+				printf("camera-capture:  failed to write annotation journal %s\n", path.c_str());
+
+			fdatasync(fd);
+		}
+
+		records.clear();
+
+		if( exit )
+			break;
+	}
+
+	if( fd >= 0 )
+		close(fd);
+}
+
+
+// Replay
+bool AnnotationJournal::Replay( const std::string& filename, JournalHeader& header, std::vector<BoundingBox>& boxes, uchar3** image )
+{
+	boxes.clear();
+
+	if( image != NULL )
+		*image = NULL;
+
+	FILE* file = fopen(filename.c_str(), "rb");
+
+	if( !file )
+		return false;
+
+	if( fread(&header, sizeof(JournalHeader), 1, file) != 1
+	 || memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) != 0
+	 || header.version != JOURNAL_VERSION
+	 || header.checksum != journalChecksum(&header, offsetof(JournalHeader, checksum)) )
+	{
+		printf("camera-capture:  invalid annotation journal %s\n", filename.c_str());
+		fclose(file);
+		return false;
+	}
+
+	header.sample[sizeof(header.sample) - 1] = '\0';
+
+	const size_t imageSize = header.width * header.height * sizeof(uchar3);
+
+	// read the frame, or skip over it
+	if( image != NULL )
+	{
+		if( !cudaAllocMapped((void**)image, imageSize) )
+		{
+			fclose(file);
+			return false;
+		}
+
+		if( fread(*image, imageSize, 1, file) != 1 )
+		{
+			printf("camera-capture:  annotation journal %s is missing its frame\n", filename.c_str());
+			CUDA(cudaFreeHost(*image));
+			*image = NULL;
+			fclose(file);
+			return false;
+		}
+	}
+	else if( fseek(file, imageSize, SEEK_CUR) != 0 )
+	{
+		fclose(file);
+		return false;
+	}
+
+	// apply the records in order, up to the first one that wasn't completely written
+	std::map<uint32_t, BoundingBox> state;
+
+	JournalRecord records[256];
+	size_t numRecords = 0;
+	size_t numApplied = 0;
+	bool torn = false;
+
+	while( !torn && (numRecords = fread(records, sizeof(JournalRecord), 256, file)) > 0 )
+	{
+		for( size_t n=0; n < numRecords; n++ )
+		{
+			const JournalRecord& record = records[n];
+
+			if( record.checksum != journalChecksum(&record, offsetof(JournalRecord, checksum)) )
+			{
+				torn = true;
+				break;
+			}
+
+			if( record.type == JournalRecord::Clear )
+			{
+				state.clear();
+			}
+			else if( record.type == JournalRecord::Remove )
+			{
+				state.erase(record.id);
+			}
+			else
+			{
+				BoundingBox& box = state[record.id];
+
+				box.id      = record.id;
+				box.classID = record.classID;
+				box.flags   = record.flags;
+				box.x       = record.x;
+				box.y       = record.y;
+				box.width   = record.width;
+				box.height  = record.height;
+			}
+
+			numApplied++;
+		}
+	}
+
+	fclose(file);
+
+	// the map is ordered by ID, the same as the annotation model
+	boxes.reserve(state.size());
+
+	for( std::map<uint32_t, BoundingBox>::const_iterator iter = state.begin(); iter != state.end(); iter++ )
+		boxes.push_back(iter->second);
+
+	printf("camera-capture:  replayed %zu records from %s (%zu boxes)\n", numApplied, filename.c_str(), boxes.size());
+	return true;
+}
+
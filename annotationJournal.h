@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_ANNOTATION_JOURNAL__
+#define __CAMERA_ANNOTATION_JOURNAL__
+
+#include "cudaUtility.h"
+#include "annotationModel.h"
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+/*
+ * Journal file header, followed by the frame (RGB8) and then the records
+ */
+struct JournalHeader
+{
+	char     magic[4];		// JOURNAL_MAGIC
+	uint32_t version;
+	uint32_t width;		// frame dimensions
+	uint32_t height;
+	char     sample[64];		// name of the saved sample being edited (empty for a new frame)
+	uint32_t reserved;
+	uint32_t checksum;		// of the preceding bytes
+};
+
+
+/*
+ * Journal record (fixed size, one per box edit)
+ */
+struct JournalRecord
+{
+	// record types
+	enum Type
+	{
+		Create = 0,	// a box was added
+		Modify,		// a box was moved, resized, or its class/flags changed
+		Remove,		// a box was deleted
+		Clear		// all the boxes were replaced (followed by a Create for each box)
+	};
+
+	uint8_t  type;
+	uint8_t  reserved;
+	uint16_t flags;
+	uint32_t id;
+	uint16_t classID;
+	uint16_t reserved2;
+
+	float x;
+	float y;
+	float width;
+	float height;
+
+	uint32_t checksum;		// of the preceding bytes, so a torn write at the tail is detected
+};
+
+
+/*
+ * Append-only journal of the edits to the boxes of the frozen frame, so that
+ * the editing session can be restored if the tool crashes or loses power.
+ *
+ * The journal attaches to the AnnotationModel as an event handler, and the
+ * records are only queued on the UI thread.  A background thread appends
+ * them to the file and syncs it every FlushInterval milliseconds, so that
+ * dragging a box doesn't wait on the disk.  Consecutive edits of the same
+ * box are merged in the queue, so a drag only writes its latest position.
+ */
+class AnnotationJournal
+{
+public:
+	// constructor
+	AnnotationJournal();
+
+	// destructor
+	~AnnotationJournal();
+
+	// set the journal file (an empty filename disables journaling)
+	void Open( const std::string& filename );
+
+	// start journaling the edits of a frozen frame (replaces the previous journal)
+	void Begin( AnnotationModel* model, const uchar3* image, int width, int height, const std::string& sample="" );
+
+	// stop journaling and delete the journal (i.e. after the frame was saved or discarded)
+	void End();
+
+	// is a frame being journaled?
+	inline bool IsActive() const				{ return model != NULL; }
+
+	// read a journal back into the final state of the boxes
+	// (the frame is allocated in mapped memory if image is non-NULL)
+	static bool Replay( const std::string& filename, JournalHeader& header, std::vector<BoundingBox>& boxes, uchar3** image=NULL );
+
+	// interval between syncs of the journal to disk (in milliseconds)
+	static const int FlushInterval = 200;
+
+protected:
+	static void onAnnotationEvent( uint16_t event, uint32_t id, int row, void* user );
+
+	void queue( uint8_t type, const BoundingBox* box );
+	void run();
+
+	std::string filename;
+	AnnotationModel* model;
+
+	// shared with the writer thread
+	std::vector<JournalRecord> pending;
+	std::vector<uint8_t> frame;	// header + pixels of a new journal
+
+	bool discard;
+	bool stopping;
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable condition;
+};
+
+#endif
+
@@ -0,0 +1,931 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "annotationModel.h"
+#include "sessionLog.h"
+
+#include "xml.h"
+
+#include <algorithm>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace tinyxml2;
+
+
+// constructor
+AnnotationModel::AnnotationModel()
+{
+	nextID   = 0;
+	nextStep = 0;
+	sealed   = true;
+	grouping = 0;
+	recorder = NULL;
+}
+
+
+// destructor
+AnnotationModel::~AnnotationModel()
+{
+
+}
+
+
+// Create
+uint32_t AnnotationModel::Create( float x, float y, float width, float height, int classID, uint16_t flags )
+{
+	BoundingBox box;
+
+	box.id      = nextID++;
+	box.classID = classID;
+	box.flags   = flags;
+	box.x       = x;
+	box.y       = y;
+	box.width   = width;
+	box.height  = height;
+
+	insertBox(box);
+	record(AnnotationEdit::Create, NULL, &box);
+
+	if( recorder != NULL )
+		recorder->Record("create %u %.9g %.9g %.9g %.9g %i %u", box.id, x, y, width, height, classID, (uint32_t)flags);
+
+	return box.id;
+}
+
+
+// Remove
+bool AnnotationModel::Remove( uint32_t id )
+{
+	if( recorder != NULL )
+		recorder->Record("remove %u", id);
+
+	const int row = Find(id);
+
+	if( row < 0 )
+		return false;
+
+	const BoundingBox before = boxes[row];
+
+	removeBox(row);
+	record(AnnotationEdit::Remove, &before, NULL);
+
+	return true;
+}
+
+
+// Clear
+void AnnotationModel::Clear()
+{
+	if( boxes.size() == 0 )
+		return;
+
+	if( recorder != NULL )
+		recorder->Record("clear");
+
+	// the removes are replayed by Clear(), so they aren't recorded themselves
+	SessionRecorder* session = recorder;
+	recorder = NULL;
+
+	BeginStep();
+
+	while( boxes.size() > 0 )
+		Remove(boxes.back().id);
+
+	EndStep();
+
+	recorder = session;
+}
+
+
+// Reset
+void AnnotationModel::Reset()
+{
+	if( recorder != NULL )
+		recorder->Record("reset");
+
+	dispatchEvent(ANNOTATION_RESETTING, 0, -1);
+
+	boxes.clear();
+	undoLog.clear();
+	redoLog.clear();
+
+	sealed = true;
+
+	dispatchEvent(ANNOTATION_RESET, 0, -1);
+}
+
+
+// ClearHistory
+void AnnotationModel::ClearHistory()
+{
+	if( recorder != NULL )
+		recorder->Record("clear_history");
+
+	undoLog.clear();
+	redoLog.clear();
+
+	sealed = true;
+}
+
+
+// SetCoords
+bool AnnotationModel::SetCoords( uint32_t id, float x, float y, float width, float height )
+{
+	if( recorder != NULL )
+		recorder->Record("coords %u %.9g %.9g %.9g %.9g", id, x, y, width, height);
+
+	const BoundingBox* box = Get(id);
+
+	if( !box )
+		return false;
+
+	BoundingBox after = *box;
+
+	after.x      = x;
+	after.y      = y;
+	after.width  = width;
+	after.height = height;
+
+	return modify(id, after);
+}
+
+
+// SetClass
+bool AnnotationModel::SetClass( uint32_t id, int classID )
+{
+	if( recorder != NULL )
+		recorder->Record("class %u %i", id, classID);
+
+	const BoundingBox* box = Get(id);
+
+	if( !box || classID < 0 )
+		return false;
+
+	BoundingBox after = *box;
+	after.classID = classID;
+
+	return modify(id, after);
+}
+
+
+// SetFlags
+bool AnnotationModel::SetFlags( uint32_t id, uint16_t flags )
+{
+	if( recorder != NULL )
+		recorder->Record("flags %u %u", id, (uint32_t)flags);
+
+	const BoundingBox* box = Get(id);
+
+	if( !box )
+		return false;
+
+	BoundingBox after = *box;
+	after.flags = flags;
+
+	return modify(id, after);
+}
+
+
+// modify
+bool AnnotationModel::modify( uint32_t id, const BoundingBox& after )
+{
+	const int row = Find(id);
+
+	if( row < 0 )
+		return false;
+
+	const BoundingBox before = boxes[row];
+
+	// ignore edits that don't change anything (i.e. views echoing
+	// back a change they were just notified about)
+	if( before.classID == after.classID && before.flags == after.flags &&
+	    before.x == after.x && before.y == after.y &&
+	    before.width == after.width && before.height == after.height )
+	{
+		return true;
+	}
+
+	changeBox(row, after);
+	record(AnnotationEdit::Modify, &before, &after);
+
+	return true;
+}
+
+
+// Undo
+bool AnnotationModel::Undo()
+{
+	if( recorder != NULL )
+		recorder->Record("undo");
+
+	if( undoLog.size() == 0 )
+		return false;
+
+	const uint32_t step = undoLog.back().step;
+
+	while( undoLog.size() > 0 && undoLog.back().step == step )
+	{
+		const AnnotationEdit edit = undoLog.back();
+		undoLog.pop_back();
+
+		apply(edit, true);
+		redoLog.push_back(edit);
+	}
+
+	sealed = true;
+	return true;
+}
+
+
+// Redo
+bool AnnotationModel::Redo()
+{
+	if( recorder != NULL )
+		recorder->Record("redo");
+
+	if( redoLog.size() == 0 )
+		return false;
+
+	const uint32_t step = redoLog.back().step;
+
+	while( redoLog.size() > 0 && redoLog.back().step == step )
+	{
+		const AnnotationEdit edit = redoLog.back();
+		redoLog.pop_back();
+
+		apply(edit, false);
+		undoLog.push_back(edit);
+	}
+
+	sealed = true;
+	return true;
+}
+
+
+// BeginStep
+void AnnotationModel::BeginStep()
+{
+	if( recorder != NULL )
+		recorder->Record("begin_step");
+
+	if( grouping == 0 )
+		sealed = true;
+
+	grouping++;
+}
+
+
+// EndStep
+void AnnotationModel::EndStep()
+{
+	if( recorder != NULL )
+		recorder->Record("end_step");
+
+	if( grouping <= 0 )
+		return;
+
+	if( --grouping == 0 )
+	{
+		nextStep++;
+		sealed = true;
+	}
+}
+
+
+// Seal
+void AnnotationModel::Seal()
+{
+	if( recorder != NULL )
+		recorder->Record("seal");
+
+	sealed = true;
+}
+
+
+// record
+void AnnotationModel::record( uint8_t type, const BoundingBox* before, const BoundingBox* after )
+{
+	redoLog.clear();
+
+	// merge consecutive edits of the same box (i.e. while it's being dragged)
+	if( type == AnnotationEdit::Modify && !sealed && undoLog.size() > 0 )
+	{
+		AnnotationEdit& last = undoLog.back();
+
+		if( last.type != AnnotationEdit::Remove && last.after.id == after->id )
+		{
+			last.after = *after;
+			return;
+		}
+	}
+
+	AnnotationEdit edit;
+	memset(&edit, 0, sizeof(AnnotationEdit));
+
+	edit.type = type;
+	edit.step = nextStep;
+
+	if( before != NULL )
+		edit.before = *before;
+
+	if( after != NULL )
+		edit.after = *after;
+
+	undoLog.push_back(edit);
+
+	if( grouping == 0 )
+		nextStep++;
+
+	sealed = (type == AnnotationEdit::Remove);
+
+	// drop the oldest steps when the log is full
+	while( undoLog.size() > MaxUndoRecords )
+	{
+		const uint32_t oldest = undoLog.front().step;
+
+		while( undoLog.size() > 0 && undoLog.front().step == oldest )
+			undoLog.pop_front();
+	}
+}
+
+
+// apply
+void AnnotationModel::apply( const AnnotationEdit& edit, bool undo )
+{
+	if( edit.type == AnnotationEdit::Create )
+	{
+		if( undo )
+			removeBox(Find(edit.after.id));
+		else
+			insertBox(edit.after);
+	}
+	else if( edit.type == AnnotationEdit::Remove )
+	{
+		if( undo )
+			insertBox(edit.before);
+		else
+			removeBox(Find(edit.before.id));
+	}
+	else if( edit.type == AnnotationEdit::Modify )
+	{
+		changeBox(Find(edit.after.id), undo ? edit.before : edit.after);
+	}
+}
+
+
+// insertBox
+void AnnotationModel::insertBox( const BoundingBox& box )
+{
+	// keep the array sorted by ID (boxes restored by undo go back where they were)
+	int row = boxes.size();
+
+	while( row > 0 && boxes[row-1].id > box.id )
+		row--;
+
+	dispatchEvent(ANNOTATION_INSERTING, box.id, row);
+	boxes.insert(boxes.begin() + row, box);
+	dispatchEvent(ANNOTATION_INSERTED, box.id, row);
+}
+
+
+// removeBox
+void AnnotationModel::removeBox( int row )
+{
+	if( row < 0 || row >= (int)boxes.size() )
+		return;
+
+	const uint32_t id = boxes[row].id;
+
+	dispatchEvent(ANNOTATION_REMOVING, id, row);
+	boxes.erase(boxes.begin() + row);
+	dispatchEvent(ANNOTATION_REMOVED, id, row);
+}
+
+
+// changeBox
+void AnnotationModel::changeBox( int row, const BoundingBox& box )
+{
+	if( row < 0 || row >= (int)boxes.size() )
+		return;
+
+	boxes[row] = box;
+	dispatchEvent(ANNOTATION_CHANGED, box.id, row);
+}
+
+
+// Find
+int AnnotationModel::Find( uint32_t id ) const
+{
+	// the array is sorted by ID, so the row can be bisected
+	int lower = 0;
+	int upper = boxes.size() - 1;
+
+	while( lower <= upper )
+	{
+		const int middle = (lower + upper) / 2;
+
+		if( boxes[middle].id == id )
+			return middle;
+		else if( boxes[middle].id < id )
+			lower = middle + 1;
+		else
+			upper = middle - 1;
+	}
+
+	return -1;
+}
+
+
+// Get
+const BoundingBox* AnnotationModel::Get( uint32_t id ) const
+{
+	const int row = Find(id);
+
+	if( row < 0 )
+		return NULL;
+
+	return &boxes[row];
+}
+
+
+// AddEventHandler
+void AnnotationModel::AddEventHandler( AnnotationHandler callback, void* user )
+{
+	if( !callback )
+		return;
+
+	EventHandler handler;
+
+	handler.callback = callback;
+	handler.user     = user;
+
+	eventHandlers.push_back(handler);
+}
+
+
+// RemoveEventHandler
+void AnnotationModel::RemoveEventHandler( AnnotationHandler callback, void* user )
+{
+	for( size_t n=0; n < eventHandlers.size(); n++ )
+	{
+		if( eventHandlers[n].callback == callback && eventHandlers[n].user == user )
+		{
+			eventHandlers.erase(eventHandlers.begin() + n);
+			return;
+		}
+	}
+}
+
+
+// dispatchEvent
+void AnnotationModel::dispatchEvent( uint16_t event, uint32_t id, int row )
+{
+	const size_t numHandlers = eventHandlers.size();
+
+	for( size_t n=0; n < numHandlers; n++ )
+		eventHandlers[n].callback(event, id, row, eventHandlers[n].user);
+}
+
+
+// xmlAddElement
+inline XMLElement* xmlAddElement( XMLDocument& doc, XMLNode* parent, const char* elementName )
+{
+	XMLElement* element = doc.NewElement(elementName);
+	parent->InsertEndChild(element);
+	return element;
+}
+
+
+// xmlAddElement
+template<typename T> XMLElement* xmlAddElement( XMLDocument& doc, XMLNode* parent, const char* elementName, T elementValue )
+{
+	XMLElement* element = xmlAddElement(doc, parent, elementName);
+	element->SetText(elementValue);
+	return element;
+}
+
+
+// FormatVOC
+bool AnnotationModel::FormatVOC( std::string& xml, const char* imgFilename, const char* folder,
+						   int imgWidth, int imgHeight, const std::vector<std::string>& classLabels ) const
+{
+	if( !imgFilename || !folder )
+		return false;
+
+	XMLDocument doc;
+
+	XMLNode* root = doc.NewElement("annotation");
+	doc.InsertFirstChild(root);
+
+	xmlAddElement(doc, root, "filename", imgFilename);
+	xmlAddElement(doc, root, "folder", folder);
+	
+	XMLElement* source = xmlAddElement(doc, root, "source");
+	
+	xmlAddElement(doc, source, "database", folder);
+	xmlAddElement(doc, source, "annotation", "custom");
+	xmlAddElement(doc, source, "image", "custom");
+
+	XMLElement* size = xmlAddElement(doc, root, "size");
+
+	xmlAddElement(doc, size, "width", imgWidth);
+	xmlAddElement(doc, size, "height", imgHeight);
+	xmlAddElement(doc, size, "depth", 3);
+	xmlAddElement(doc, root, "segmented", 0);
+
+	// add bounding boxes to XML
+	const size_t numBoxes = boxes.size();
+
+	for( size_t n=0; n < numBoxes; n++ )
+	{
+		const BoundingBox& box = boxes[n];
+
+		if( box.flags & BOX_PROPOSED )
+			continue;
+
+		const char* className = (box.classID < classLabels.size()) ? classLabels[box.classID].c_str() : "";
+
+		XMLElement* object = xmlAddElement(doc, root, "object");
+
+		xmlAddElement(doc, object, "name", className);
+		xmlAddElement(doc, object, "pose", "unspecified");
+		xmlAddElement(doc, object, "truncated", (box.flags & BOX_TRUNCATED) ? "1" : "0");
+		xmlAddElement(doc, object, "difficult", (box.flags & BOX_DIFFICULT) ? "1" : "0");
+
+		XMLElement* bbox = xmlAddElement(doc, object, "bndbox");
+		
+		xmlAddElement(doc, bbox, "xmin", (int)box.x);
+		xmlAddElement(doc, bbox, "ymin", (int)box.y);
+		xmlAddElement(doc, bbox, "xmax", (int)(box.x + box.width));
+		xmlAddElement(doc, bbox, "ymax", (int)(box.y + box.height));
+	}
+
+	XMLPrinter printer;
+	doc.Print(&printer);
+
+	xml.assign(printer.CStr(), printer.CStrSize() - 1);
+	return true;
+}
+
+
+// SaveVOC
+bool AnnotationModel::SaveVOC( const char* filename, const char* imgFilename, const char* folder,
+						 int imgWidth, int imgHeight, const std::vector<std::string>& classLabels ) const
+{
+	if( !filename )
+		return false;
+
+	std::string xml;
+
+	if( !FormatVOC(xml, imgFilename, folder, imgWidth, imgHeight, classLabels) )
+		return false;
+
+	// save XML to a temporary file first, so the annotations are
+	// never left half-written if the tool is stopped while saving
+	const std::string tmpFilename = std::string(filename) + ".tmp";
+
+	FILE* file = fopen(tmpFilename.c_str(), "w");
+
+	if( !file )
+	{
+		printf("camera-capture:  failed to open %s\n", tmpFilename.c_str());
+		return false;
+	}
+
+	const bool saved = (fwrite(xml.data(), 1, xml.size(), file) == xml.size()) && (fflush(file) == 0) && (fsync(fileno(file)) == 0);
+
+	fclose(file);
+
+	if( !saved || rename(tmpFilename.c_str(), filename) != 0 )
+	{
+		printf("camera-capture:  failed to save %s\n", filename);
+		remove(tmpFilename.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+
+// Load
+void AnnotationModel::Load( const std::vector<BoundingBox>& newBoxes )
+{
+	if( recorder != NULL )
+	{
+		recorder->Record("load %zu", newBoxes.size());
+
+		for( size_t n=0; n < newBoxes.size(); n++ )
+		{
+			const BoundingBox& box = newBoxes[n];
+			recorder->Record("box %u %u %u %.9g %.9g %.9g %.9g", box.id, (uint32_t)box.classID, (uint32_t)box.flags, box.x, box.y, box.width, box.height);
+		}
+	}
+
+	dispatchEvent(ANNOTATION_RESETTING, 0, -1);
+
+	boxes = newBoxes;
+
+	std::sort(boxes.begin(), boxes.end(), [](const BoundingBox& a, const BoundingBox& b) { return a.id < b.id; });
+
+	// new boxes get IDs after the ones that were loaded
+	if( boxes.size() > 0 && boxes.back().id >= nextID )
+		nextID = boxes.back().id + 1;
+
+	undoLog.clear();
+	redoLog.clear();
+
+	sealed = true;
+
+	dispatchEvent(ANNOTATION_RESET, 0, -1);
+}
+
+
+// LoadVOC
+void AnnotationModel::LoadVOC( const VOCAnnotation& annotation, std::vector<std::string>& classLabels )
+{
+	const size_t numObjects = annotation.objects.size();
+
+	std::vector<BoundingBox> newBoxes;
+	newBoxes.reserve(numObjects);
+
+	for( size_t n=0; n < numObjects; n++ )
+	{
+		const VOCObject& object = annotation.objects[n];
+
+		// lookup the class
+		size_t classID = 0;
+
+		while( classID < classLabels.size() && classLabels[classID] != object.name )
+			classID++;
+
+		if( classID == classLabels.size() )
+		{
+			printf("camera-capture:  adding class '%s' from %s\n", object.name.c_str(), annotation.filename.c_str());
+			classLabels.push_back(object.name);
+		}
+
+		BoundingBox box;
+
+		box.id      = nextID++;
+		box.classID = classID;
+		box.flags   = object.flags;
+		box.x       = object.x;
+		box.y       = object.y;
+		box.width   = object.width;
+		box.height  = object.height;
+
+		newBoxes.push_back(box);
+	}
+
+	Load(newBoxes);
+}
+
+
+// vocDecodeText
+static std::string vocDecodeText( const char* text, size_t length )
+{
+	std::string str;
+	str.reserve(length);
+
+	for( size_t n=0; n < length; n++ )
+	{
+		if( text[n] != '&' )
+		{
+			str += text[n];
+			continue;
+		}
+
+		// the predefined XML entities
+		static const char* entities[] = { "&amp;", "&lt;", "&gt;", "&quot;", "&apos;" };
+		static const char  chars[]    = { '&', '<', '>', '"', '\'' };
+
+		size_t e = 0;
+
+		for( ; e < sizeof(chars); e++ )
+		{
+			const size_t entityLength = strlen(entities[e]);
+
+			if( n + entityLength <= length && strncmp(text + n, entities[e], entityLength) == 0 )
+			{
+				str += chars[e];
+				n += entityLength - 1;
+				break;
+			}
+		}
+
+		if( e == sizeof(chars) )
+			str += text[n];
+	}
+
+	// trim whitespace
+	const size_t first = str.find_first_not_of(" \t\r\n");
+
+	if( first == std::string::npos )
+		return std::string();
+
+	return str.substr(first, str.find_last_not_of(" \t\r\n") - first + 1);
+}
+
+
+// ParseVOC
+bool AnnotationModel::ParseVOC( const char* filename, VOCAnnotation& annotation )
+{
+	annotation.filename.clear();
+	annotation.folder.clear();
+	annotation.objects.clear();
+
+	annotation.width  = 0;
+	annotation.height = 0;
+
+	// read the whole file (they're small)
+	FILE* file = fopen(filename, "rb");
+
+	if( !file )
+	{
+		printf("camera-capture:  failed to open %s\n", filename);
+		return false;
+	}
+
+	std::string buffer;
+	char chunk[8192];
+	size_t count = 0;
+
+	while( (count = fread(chunk, 1, sizeof(chunk), file)) > 0 )
+		buffer.append(chunk, count);
+
+	fclose(file);
+
+	// single pass over the tags, without building a document tree:
+	// the text of each element is handled when its end tag is reached
+	static const int maxDepth = 8;
+
+	const char* tags[maxDepth];		// names of the open elements
+	size_t      tagLengths[maxDepth];
+
+	const char* ptr   = buffer.c_str();
+	const char* end   = ptr + buffer.size();
+	const char* text  = NULL;		// start of the current element's text
+	int         depth = 0;
+	bool        root  = false;
+
+	float xmin = 0, ymin = 0, xmax = 0, ymax = 0;
+
+	#define TAG_IS(level, name)  (depth > level && tagLengths[level] == sizeof(name) - 1 && strncmp(tags[level], name, sizeof(name) - 1) == 0)
+
+	while( ptr < end )
+	{
+		const char* open = (const char*)memchr(ptr, '<', end - ptr);
+
+		if( !open )
+			break;
+
+		const char* close = (const char*)memchr(open, '>', end - open);
+
+		if( !close )
+			break;
+
+		const char* contentEnd = open;
+
+		ptr = close + 1;
+
+		// skip the declaration, comments and processing instructions
+		if( open[1] == '?' || open[1] == '!' )
+			continue;
+
+		if( open[1] == '/' )
+		{
+			// end tag
+			if( depth == 0 )
+				break;
+
+			const std::string value = text ? vocDecodeText(text, contentEnd - text) : std::string();
+
+			if( depth == 2 && TAG_IS(0, "annotation") )
+			{
+				if( TAG_IS(1, "filename") )
+					annotation.filename = value;
+				else if( TAG_IS(1, "folder") )
+					annotation.folder = value;
+				else if( TAG_IS(1, "object") )
+				{
+					// the object is complete
+					VOCObject& object = annotation.objects.back();
+
+					object.x      = xmin;
+					object.y      = ymin;
+					object.width  = xmax - xmin;
+					object.height = ymax - ymin;
+				}
+			}
+			else if( depth == 3 && TAG_IS(1, "size") )
+			{
+				if( TAG_IS(2, "width") )
+					annotation.width = atoi(value.c_str());
+				else if( TAG_IS(2, "height") )
+					annotation.height = atoi(value.c_str());
+			}
+			else if( depth == 3 && TAG_IS(0, "annotation") && TAG_IS(1, "object") )
+			{
+				// (the objects are only started under an <annotation> root)
+				VOCObject& object = annotation.objects.back();
+
+				if( TAG_IS(2, "name") )
+					object.name = value;
+				else if( TAG_IS(2, "truncated") && atoi(value.c_str()) != 0 )
+					object.flags |= BOX_TRUNCATED;
+				else if( TAG_IS(2, "difficult") && atoi(value.c_str()) != 0 )
+					object.flags |= BOX_DIFFICULT;
+			}
+			else if( depth == 4 && TAG_IS(0, "annotation") && TAG_IS(1, "object") && TAG_IS(2, "bndbox") )
+			{
+				const float coord = atof(value.c_str());
+
+				if( TAG_IS(3, "xmin") )
+					xmin = coord;
+				else if( TAG_IS(3, "ymin") )
+					ymin = coord;
+				else if( TAG_IS(3, "xmax") )
+					xmax = coord;
+				else if( TAG_IS(3, "ymax") )
+					ymax = coord;
+			}
+
+			depth--;
+			text = NULL;
+			continue;
+		}
+
+		// start tag
+		const char* name = open + 1;
+		size_t nameLength = 0;
+
+		while( name + nameLength < close && !strchr(" \t\r\n/", name[nameLength]) )
+			nameLength++;
+
+		if( close[-1] == '/' )
+			continue;	// empty element
+
+		if( depth >= maxDepth )
+		{
+			printf("camera-capture:  %s is nested too deeply\n", filename);
+			return false;
+		}
+
+		tags[depth]       = name;
+		tagLengths[depth] = nameLength;
+
+		depth++;
+		text = ptr;
+
+		if( depth == 1 && TAG_IS(0, "annotation") )
+			root = true;
+
+		if( depth == 2 && TAG_IS(0, "annotation") && TAG_IS(1, "object") )
+		{
+			VOCObject object;
+
+			object.flags  = 0;
+			object.x      = 0;
+			object.y      = 0;
+			object.width  = 0;
+			object.height = 0;
+
+			annotation.objects.push_back(object);
+
+			xmin = ymin = xmax = ymax = 0;
+		}
+	}
+
+	#undef TAG_IS
+
+	if( depth != 0 || !root )
+	{
+		printf("camera-capture:  failed to parse %s\n", filename);
+		return false;
+	}
+
+	return true;
+}
+
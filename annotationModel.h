@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_ANNOTATION_MODEL__
+#define __CAMERA_ANNOTATION_MODEL__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+
+// forward declarations
+class SessionRecorder;
+
+
+/*
+ * Bounding box entry
+ */
+struct BoundingBox
+{
+	uint32_t id;		// stable ID, doesn't change when other boxes are removed
+	uint16_t classID;
+	uint16_t flags;	// BoundingBoxFlags
+
+	float x;
+	float y;
+	float width;
+	float height;
+};
+
+
+/*
+ * Bounding box flags
+ */
+enum BoundingBoxFlags
+{
+	BOX_TRUNCATED = (1 << 0),
+	BOX_DIFFICULT = (1 << 1),
+	BOX_PROPOSED  = (1 << 2)	// proposed automatically and not accepted yet (isn't saved)
+};
+
+
+/*
+ * Pascal VOC annotation file contents
+ */
+struct VOCObject
+{
+	std::string name;	// class label
+	uint16_t    flags;	// BOX_TRUNCATED, BOX_DIFFICULT
+
+	float x;
+	float y;
+	float width;
+	float height;
+};
+
+struct VOCAnnotation
+{
+	std::string filename;	// image filename
+	std::string folder;
+
+	int width;
+	int height;
+
+	std::vector<VOCObject> objects;
+};
+
+
+/*
+ * Annotation edit record (one delta in the undo/redo log)
+ */
+struct AnnotationEdit
+{
+	// edit types
+	enum Type
+	{
+		Create = 0,
+		Remove,
+		Modify
+	};
+
+	uint8_t  type;
+	uint8_t  reserved[3];
+	uint32_t step;		// edits with the same step are undone together
+
+	BoundingBox before;	// unused for Create
+	BoundingBox after;	// unused for Remove
+};
+
+
+/*
+ * Annotation events (passed to AnnotationHandler)
+ */
+enum AnnotationEvent
+{
+	ANNOTATION_INSERTING = 0,	// a box is about to be inserted at row
+	ANNOTATION_INSERTED,		// a box was inserted at row
+	ANNOTATION_REMOVING,		// the box at row is about to be removed
+	ANNOTATION_REMOVED,			// the box that was at row was removed
+	ANNOTATION_CHANGED,			// the box at row was modified
+	ANNOTATION_RESETTING,		// all the boxes are about to be replaced
+	ANNOTATION_RESET			// all the boxes were replaced
+};
+
+
+/*
+ * Annotation event handler
+ */
+typedef void (*AnnotationHandler)( uint16_t event, uint32_t id, int row, void* user );
+
+
+/*
+ * Annotation model of the boxes in the current frame, with undo/redo.
+ * The boxes are kept in a compact array sorted by ID, and every edit
+ * is recorded in the undo log as an AnnotationEdit.
+ */
+class AnnotationModel
+{
+public:
+	// constructor
+	AnnotationModel();
+
+	// destructor
+	~AnnotationModel();
+
+	// add a new box, returns its ID
+	uint32_t Create( float x, float y, float width, float height, int classID=0, uint16_t flags=0 );
+
+	// remove a box
+	bool Remove( uint32_t id );
+
+	// remove all the boxes (as one undo step)
+	void Clear();
+
+	// remove all the boxes and the undo/redo history (i.e. for a new frame)
+	void Reset();
+
+	// discard the undo/redo history but keep the boxes (i.e. for boxes carried to a new frame)
+	void ClearHistory();
+
+	// modify a box
+	bool SetCoords( uint32_t id, float x, float y, float width, float height );
+	bool SetClass( uint32_t id, int classID );
+	bool SetFlags( uint32_t id, uint16_t flags );
+
+	// undo/redo
+	bool Undo();
+	bool Redo();
+
+	inline bool CanUndo() const	{ return undoLog.size() > 0; }
+	inline bool CanRedo() const	{ return redoLog.size() > 0; }
+
+	// group the edits between BeginStep() and EndStep() into one undo step
+	void BeginStep();
+	void EndStep();
+
+	// end the current undo step, so the next edit isn't merged with it
+	// (consecutive edits of the same box are merged, i.e. during a drag)
+	void Seal();
+
+	// lookup boxes
+	int Find( uint32_t id ) const;
+	const BoundingBox* Get( uint32_t id ) const;
+
+	inline const BoundingBox& GetAt( int row ) const	{ return boxes[row]; }
+	inline int GetCount() const					{ return boxes.size(); }
+
+	// event handlers
+	void AddEventHandler( AnnotationHandler callback, void* user=NULL );
+	void RemoveEventHandler( AnnotationHandler callback, void* user=NULL );
+
+	// record the calls that modify the boxes to a session log (NULL stops recording)
+	inline void SetRecorder( SessionRecorder* session )	{ recorder = session; }
+	inline SessionRecorder* GetRecorder() const		{ return recorder; }
+
+	// generate the Pascal VOC XML of the boxes
+	bool FormatVOC( std::string& xml, const char* imgFilename, const char* folder,
+				 int imgWidth, int imgHeight, const std::vector<std::string>& classLabels ) const;
+
+	// save in Pascal VOC format (the file is replaced atomically)
+	bool SaveVOC( const char* filename, const char* imgFilename, const char* folder,
+			    int imgWidth, int imgHeight, const std::vector<std::string>& classLabels ) const;
+
+	// replace the boxes (keeping their IDs), and discard the undo/redo history
+	void Load( const std::vector<BoundingBox>& boxes );
+
+	// replace the boxes with the objects from a VOC annotation, and discard the undo/redo history
+	// (labels that aren't in classLabels are appended to it, so that no boxes are lost)
+	void LoadVOC( const VOCAnnotation& annotation, std::vector<std::string>& classLabels );
+
+	// parse a Pascal VOC annotation file
+	static bool ParseVOC( const char* filename, VOCAnnotation& annotation );
+
+	// maximum number of records kept in the undo log
+	static const size_t MaxUndoRecords = 4096;
+
+protected:
+	bool modify( uint32_t id, const BoundingBox& box );
+	void record( uint8_t type, const BoundingBox* before, const BoundingBox* after );
+	void apply( const AnnotationEdit& edit, bool undo );
+
+	void insertBox( const BoundingBox& box );
+	void removeBox( int row );
+	void changeBox( int row, const BoundingBox& box );
+
+	void dispatchEvent( uint16_t event, uint32_t id, int row );
+
+	struct EventHandler
+	{
+		AnnotationHandler callback;
+		void* user;
+	};
+
+	std::vector<BoundingBox>  boxes;
+	std::vector<EventHandler> eventHandlers;
+
+	std::deque<AnnotationEdit> undoLog;
+	std::deque<AnnotationEdit> redoLog;
+
+	uint32_t nextID;
+	uint32_t nextStep;
+
+	bool sealed;
+	int  grouping;
+
+	SessionRecorder* recorder;
+};
+
+#endif
+
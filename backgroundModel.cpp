@@ -0,0 +1,341 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "backgroundModel.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define BACKGROUND_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define BACKGROUND_SSE2
+#endif
+
+
+// fixed-point fraction bits of the background
+#define BACKGROUND_FRAC_BITS 7
+
+
+// constructor
+BackgroundModel::BackgroundModel()
+{
+	width     = 0;
+	height    = 0;
+	scale     = 1;
+	numFrames = 0;
+
+	learningShift = DefaultShift;
+	threshold     = DefaultThreshold;
+}
+
+
+// Reset
+void BackgroundModel::Reset()
+{
+	numFrames = 0;
+}
+
+
+// downsample
+void BackgroundModel::downsample( const uchar3* image, int imgWidth, int imgHeight )
+{
+	scale  = (imgWidth > DownsampleWidth) ? (imgWidth / DownsampleWidth) : 1;
+	width  = imgWidth / scale;
+	height = imgHeight / scale;
+
+	// pad the rows to the SIMD width
+	const size_t size = ((width * height) + 15) & ~15;
+
+	if( gray.size() != size )
+	{
+		gray.assign(size, 0);
+		background.assign(size, 0);
+		foreground.assign(size, 0);
+		numFrames = 0;
+	}
+
+	// one sample per pixel (the moving average smooths out the noise)
+	for( int y=0; y < height; y++ )
+	{
+		const uchar3* row = image + (y * scale) * imgWidth;
+		uint8_t* out = &gray[y * width];
+
+		for( int x=0; x < width; x++ )
+		{
+			const uchar3& px = row[x * scale];
+			out[x] = (px.x * 77 + px.y * 150 + px.z * 29) >> 8;
+		}
+	}
+}
+
+
+// Process
+void BackgroundModel::Process( const uchar3* image, int imgWidth, int imgHeight )
+{
+	if( !image || imgWidth <= 0 || imgHeight <= 0 )
+		return;
+
+	downsample(image, imgWidth, imgHeight);
+
+	const int size = gray.size();
+
+	// the first frame initializes the background
+	if( numFrames == 0 )
+	{
+		for( int n=0; n < size; n++ )
+			background[n] = gray[n] << BACKGROUND_FRAC_BITS;
+	}
+
+	const uint8_t* cur = &gray[0];
+	int16_t* bg = &background[0];
+	uint8_t* fg = &foreground[0];
+
+	// the foreground is found before the update, so the frozen
+	// frame isn't compared against a background containing it
+	int n = 0;
+
+#if defined(BACKGROUND_NEON)
+	const int16x8_t  shift = vdupq_n_s16(-learningShift);
+	const uint8x16_t thresh = vdupq_n_u8(threshold);
+
+	for( ; n < size; n += 16 )
+	{
+		const uint8x16_t c = vld1q_u8(cur + n);
+
+		int16x8_t bgLow  = vld1q_s16(bg + n);
+		int16x8_t bgHigh = vld1q_s16(bg + n + 8);
+
+		// foreground mask
+		const uint8x16_t mean = vcombine_u8(vqshrun_n_s16(bgLow, BACKGROUND_FRAC_BITS), vqshrun_n_s16(bgHigh, BACKGROUND_FRAC_BITS));
+		vst1q_u8(fg + n, vcgtq_u8(vabdq_u8(c, mean), thresh));
+
+		// bg += (cur - bg) >> shift
+		const int16x8_t cLow  = vreinterpretq_s16_u16(vshll_n_u8(vget_low_u8(c), BACKGROUND_FRAC_BITS));
+		const int16x8_t cHigh = vreinterpretq_s16_u16(vshll_n_u8(vget_high_u8(c), BACKGROUND_FRAC_BITS));
+
+		bgLow  = vaddq_s16(bgLow, vshlq_s16(vsubq_s16(cLow, bgLow), shift));
+		bgHigh = vaddq_s16(bgHigh, vshlq_s16(vsubq_s16(cHigh, bgHigh), shift));
+
+		vst1q_s16(bg + n, bgLow);
+		vst1q_s16(bg + n + 8, bgHigh);
+	}
+
+#elif defined(BACKGROUND_SSE2)
+	const __m128i zero   = _mm_setzero_si128();
+	const __m128i shift  = _mm_cvtsi32_si128(learningShift);
+	const __m128i thresh = _mm_set1_epi8((char)threshold);
+
+	for( ; n < size; n += 16 )
+	{
+		const __m128i c = _mm_loadu_si128((const __m128i*)(cur + n));
+
+		__m128i bgLow  = _mm_loadu_si128((const __m128i*)(bg + n));
+		__m128i bgHigh = _mm_loadu_si128((const __m128i*)(bg + n + 8));
+
+		// foreground mask (|cur - mean| > threshold)
+		const __m128i mean = _mm_packus_epi16(_mm_srai_epi16(bgLow, BACKGROUND_FRAC_BITS), _mm_srai_epi16(bgHigh, BACKGROUND_FRAC_BITS));
+		const __m128i diff = _mm_or_si128(_mm_subs_epu8(c, mean), _mm_subs_epu8(mean, c));
+
+		_mm_storeu_si128((__m128i*)(fg + n), _mm_xor_si128(_mm_cmpeq_epi8(_mm_subs_epu8(diff, thresh), zero), _mm_set1_epi8(-1)));
+
+		// bg += (cur - bg) >> shift
+		const __m128i cLow  = _mm_slli_epi16(_mm_unpacklo_epi8(c, zero), BACKGROUND_FRAC_BITS);
+		const __m128i cHigh = _mm_slli_epi16(_mm_unpackhi_epi8(c, zero), BACKGROUND_FRAC_BITS);
+
+		bgLow  = _mm_add_epi16(bgLow, _mm_sra_epi16(_mm_sub_epi16(cLow, bgLow), shift));
+		bgHigh = _mm_add_epi16(bgHigh, _mm_sra_epi16(_mm_sub_epi16(cHigh, bgHigh), shift));
+
+		_mm_storeu_si128((__m128i*)(bg + n), bgLow);
+		_mm_storeu_si128((__m128i*)(bg + n + 8), bgHigh);
+	}
+#endif
+
+	for( ; n < size; n++ )
+	{
+		const int c    = cur[n];
+		const int mean = bg[n] >> BACKGROUND_FRAC_BITS;
+		const int diff = (c > mean) ? (c - mean) : (mean - c);
+
+		fg[n] = (diff > threshold) ? 255 : 0;
+		bg[n] += ((c << BACKGROUND_FRAC_BITS) - bg[n]) >> learningShift;
+	}
+
+	numFrames++;
+}
+
+
+// findRoot
+static inline int findRoot( std::vector<int>& parents, int n )
+{
+	while( parents[n] != n )
+	{
+		parents[n] = parents[parents[n]];	// path halving
+		n = parents[n];
+	}
+
+	return n;
+}
+
+
+// Propose
+bool BackgroundModel::Propose( std::vector<BackgroundProposal>& proposals ) const
+{
+	proposals.clear();
+
+	if( !IsReady() )
+		return false;
+
+	// close small gaps in the mask with a 3x3 dilation
+	std::vector<uint8_t> rows(width * height);
+	std::vector<uint8_t> mask(width * height);
+
+	for( int y=0; y < height; y++ )
+	{
+		const uint8_t* in = &foreground[y * width];
+		uint8_t* out = &rows[y * width];
+
+		for( int x=0; x < width; x++ )
+			out[x] = in[x] | ((x > 0) ? in[x-1] : 0) | ((x < width - 1) ? in[x+1] : 0);
+	}
+
+	for( int y=0; y < height; y++ )
+	{
+		const uint8_t* in = &rows[y * width];
+		uint8_t* out = &mask[y * width];
+
+		for( int x=0; x < width; x++ )
+			out[x] = in[x] | ((y > 0) ? in[x-width] : 0) | ((y < height - 1) ? in[x+width] : 0);
+	}
+
+	// label the connected components (8-connected, two passes with union-find)
+	std::vector<int> labels(width * height, -1);
+	std::vector<int> parents;
+
+	for( int y=0; y < height; y++ )
+	{
+		for( int x=0; x < width; x++ )
+		{
+			const int n = y * width + x;
+
+			if( !mask[n] )
+				continue;
+
+			int label = -1;
+
+			const int neighbors[4] = { (x > 0) ? n - 1 : -1,
+								  (y > 0 && x > 0) ? n - width - 1 : -1,
+								  (y > 0) ? n - width : -1,
+								  (y > 0 && x < width - 1) ? n - width + 1 : -1 };
+
+			for( int k=0; k < 4; k++ )
+			{
+				if( neighbors[k] < 0 || labels[neighbors[k]] < 0 )
+					continue;
+
+				const int root = findRoot(parents, labels[neighbors[k]]);
+
+				if( label < 0 )
+					label = root;
+				else if( root < label )
+				{
+					// merge into the lower label
+					parents[label] = root;
+					label = root;
+				}
+				else if( root > label )
+				{
+					parents[root] = label;
+				}
+			}
+
+			if( label < 0 )
+			{
+				label = parents.size();
+				parents.push_back(label);
+			}
+
+			labels[n] = label;
+		}
+	}
+
+	if( parents.size() == 0 )
+		return true;
+
+	// accumulate the bounds of each component
+	struct Bounds
+	{
+		int left, top, right, bottom, area;
+	};
+
+	std::vector<Bounds> bounds(parents.size());
+
+	for( size_t n=0; n < bounds.size(); n++ )
+	{
+		bounds[n].left   = width;
+		bounds[n].top    = height;
+		bounds[n].right  = -1;
+		bounds[n].bottom = -1;
+		bounds[n].area   = 0;
+	}
+
+	for( int y=0; y < height; y++ )
+	{
+		for( int x=0; x < width; x++ )
+		{
+			const int n = y * width + x;
+
+			// the pixels added by the dilation only join the components
+			if( labels[n] < 0 || !foreground[n] )
+				continue;
+
+			Bounds& b = bounds[findRoot(parents, labels[n])];
+
+			if( x < b.left )   b.left = x;
+			if( x > b.right )  b.right = x;
+			if( y < b.top )    b.top = y;
+			if( y > b.bottom ) b.bottom = y;
+
+			b.area++;
+		}
+	}
+
+	for( size_t n=0; n < bounds.size(); n++ )
+	{
+		const Bounds& b = bounds[n];
+
+		if( b.area < MinArea )
+			continue;
+
+		BackgroundProposal proposal;
+
+		proposal.x      = b.left * scale;
+		proposal.y      = b.top * scale;
+		proposal.width  = (b.right - b.left + 1) * scale;
+		proposal.height = (b.bottom - b.top + 1) * scale;
+		proposal.area   = b.area;
+
+		proposals.push_back(proposal);
+	}
+
+	return true;
+}
+
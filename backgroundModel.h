@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_BACKGROUND_MODEL__
+#define __CAMERA_BACKGROUND_MODEL__
+
+#include "cudaUtility.h"
+
+#include <stdint.h>
+#include <vector>
+
+
+/*
+ * Foreground blob found by the background model (in camera coordinates)
+ */
+struct BackgroundProposal
+{
+	float x;
+	float y;
+	float width;
+	float height;
+	int   area;		// number of foreground pixels (in the downsampled image)
+};
+
+
+/*
+ * Background model of a static scene, used to propose boxes around the
+ * objects that aren't part of the background.
+ *
+ * Each frame is downsampled to a small grayscale image, and the background
+ * is kept as a per-pixel exponential moving average in 9.7 fixed-point,
+ * which is updated with SIMD kernels (SSE2/NEON) so that it can run on
+ * every camera frame on the CPU. The foreground mask of the latest frame
+ * is split into connected components when the proposals are requested.
+ */
+class BackgroundModel
+{
+public:
+	// constructor
+	BackgroundModel();
+
+	// update the background with a new frame
+	void Process( const uchar3* image, int width, int height );
+
+	// get boxes around the foreground of the last frame (returns false if the model isn't ready)
+	bool Propose( std::vector<BackgroundProposal>& proposals ) const;
+
+	// discard the background (i.e. after the camera was moved)
+	void Reset();
+
+	// returns true once enough frames have been seen
+	inline bool IsReady() const			{ return numFrames >= WarmupFrames; }
+
+	// the background adapts at a rate of 1/2^shift per frame
+	inline void SetLearningRate( int shift )	{ learningShift = (shift < 1) ? 1 : (shift > 8) ? 8 : shift; }
+
+	// minimum difference from the background for a pixel to be foreground
+	inline void SetThreshold( int threshold )	{ this->threshold = (threshold < 1) ? 1 : (threshold > 254) ? 254 : threshold; }
+
+	// model settings
+	static const int DownsampleWidth = 320;	// approx width of the downsampled image
+	static const int DefaultShift    = 5;		// learning rate (1/32 per frame)
+	static const int DefaultThreshold = 25;
+	static const int WarmupFrames    = 30;
+	static const int MinArea         = 12;	// minimum blob size (in downsampled pixels)
+
+protected:
+	void downsample( const uchar3* image, int width, int height );
+
+	int width;		// downsampled dimensions
+	int height;
+	int scale;		// downsampling of the camera image
+	int numFrames;
+
+	int learningShift;
+	int threshold;
+
+	std::vector<uint8_t> gray;		// latest downsampled frame
+	std::vector<int16_t> background;	// 9.7 fixed-point
+	std::vector<uint8_t> foreground;	// mask of the latest frame (0 or 255)
+};
+
+#endif
+
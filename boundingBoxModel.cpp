@@ -0,0 +1,406 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "boundingBoxModel.h"
+#include "sessionLog.h"
+
+#include "detectNet.h"
+
+
+// constructor
+BoundingBoxModel::BoundingBoxModel( AnnotationModel* model, QStringListModel* classes, QObject* parent ) : QAbstractTableModel(parent)
+{
+	annotations  = model;
+	classModel   = classes;
+	changedFirst = -1;
+	changedLast  = -1;
+	editColumn   = -1;
+	editBox      = 0;
+
+	changedTimer = new QTimer(this);
+
+	changedTimer->setSingleShot(true);
+	changedTimer->setInterval(0);
+
+	connect(changedTimer, SIGNAL(timeout()), this, SLOT(flushChanges()));
+
+	if( classModel != NULL )
+		connect(classModel, SIGNAL(modelReset()), this, SLOT(onClassesReset()));
+
+	annotations->AddEventHandler(BoundingBoxModel::onAnnotationEvent, this);
+}
+
+
+// destructor
+BoundingBoxModel::~BoundingBoxModel()
+{
+	annotations->RemoveEventHandler(BoundingBoxModel::onAnnotationEvent, this);
+}
+
+
+// onAnnotationEvent
+void BoundingBoxModel::onAnnotationEvent( uint16_t event, uint32_t id, int row, void* user )
+{
+	BoundingBoxModel* model = (BoundingBoxModel*)user;
+
+	if( !model )
+		return;
+
+	if( event == ANNOTATION_INSERTING )
+		model->beginInsertRows(QModelIndex(), row, row);
+	else if( event == ANNOTATION_INSERTED )
+		model->endInsertRows();
+	else if( event == ANNOTATION_REMOVING )
+		model->beginRemoveRows(QModelIndex(), row, row);
+	else if( event == ANNOTATION_REMOVED )
+		model->endRemoveRows();
+	else if( event == ANNOTATION_RESETTING )
+		model->beginResetModel();
+	else if( event == ANNOTATION_RESET )
+		model->endResetModel();
+	else if( event == ANNOTATION_CHANGED )
+		model->markChanged(row);	// the table refreshes once per event loop pass
+}
+
+
+// GetClassLabel
+QString BoundingBoxModel::GetClassLabel( int classID ) const
+{
+	if( !classModel || classID < 0 || classID >= classModel->rowCount() )
+		return QString();
+
+	return classModel->index(classID).data().toString();
+}
+
+
+// markChanged
+void BoundingBoxModel::markChanged( int row )
+{
+	if( changedFirst < 0 || row < changedFirst )
+		changedFirst = row;
+
+	if( changedLast < 0 || row > changedLast )
+		changedLast = row;
+
+	if( !changedTimer->isActive() )
+		changedTimer->start();
+}
+
+
+// flushChanges
+void BoundingBoxModel::flushChanges()
+{
+	const int numBoxes = annotations->GetCount();
+
+	if( changedFirst >= 0 && numBoxes > 0 )
+	{
+		// rows may have been removed since they were marked
+		const int first = qMin(changedFirst, numBoxes - 1);
+		const int last  = qMin(changedLast, numBoxes - 1);
+
+		emit dataChanged(index(first, 0), index(last, NumColumns - 1));
+	}
+
+	changedFirst = -1;
+	changedLast  = -1;
+}
+
+
+// onClassesReset
+void BoundingBoxModel::onClassesReset()
+{
+	const int numBoxes = annotations->GetCount();
+
+	if( numBoxes > 0 )
+		emit dataChanged(index(0, ClassColumn), index(numBoxes - 1, ClassColumn));
+}
+
+
+// rowCount
+int BoundingBoxModel::rowCount( const QModelIndex& parent ) const
+{
+	if( parent.isValid() )
+		return 0;
+
+	return annotations->GetCount();
+}
+
+
+// columnCount
+int BoundingBoxModel::columnCount( const QModelIndex& parent ) const
+{
+	if( parent.isValid() )
+		return 0;
+
+	return NumColumns;
+}
+
+
+// data
+QVariant BoundingBoxModel::data( const QModelIndex& index, int role ) const
+{
+	if( !index.isValid() || index.row() >= annotations->GetCount() )
+		return QVariant();
+
+	const BoundingBox& box = annotations->GetAt(index.row());
+	const int column = index.column();
+
+	if( role == Qt::DisplayRole || role == Qt::EditRole )
+	{
+		if( column == ClassColumn )
+			return (role == Qt::EditRole) ? QVariant(box.classID) : QVariant(GetClassLabel(box.classID));
+		else if( column == DeleteColumn )
+			return (role == Qt::DisplayRole) ? QVariant(QString("X")) : QVariant();
+
+		float value = 0.0f;
+
+		if( column == XColumn )
+			value = box.x;
+		else if( column == YColumn )
+			value = box.y;
+		else if( column == WidthColumn )
+			value = box.width;
+		else if( column == HeightColumn )
+			value = box.height;
+
+		return (role == Qt::EditRole) ? QVariant(value) : QVariant(QString::number(value, 'f', 1));
+	}
+	else if( role == Qt::DecorationRole && column == ClassColumn )
+	{
+		const float4 color = detectNet::GenerateColor(box.classID);
+		return QColor((int)color.x, (int)color.y, (int)color.z);
+	}
+	else if( role == Qt::TextAlignmentRole && column != ClassColumn )
+	{
+		return (int)Qt::AlignCenter;
+	}
+	else if( role == Qt::FontRole && (box.flags & BOX_PROPOSED) )
+	{
+		// proposals that haven't been accepted yet
+		QFont font;
+		font.setItalic(true);
+		return font;
+	}
+
+	return QVariant();
+}
+
+
+// headerData
+QVariant BoundingBoxModel::headerData( int section, Qt::Orientation orientation, int role ) const
+{
+	static const char* columnNames[] = { "Class", "x", "y", "Width", "Height", "Delete" };
+
+	if( role != Qt::DisplayRole || orientation != Qt::Horizontal )
+		return QAbstractTableModel::headerData(section, orientation, role);
+
+	if( section < 0 || section >= NumColumns )
+		return QVariant();
+
+	return tr(columnNames[section]);
+}
+
+
+// setData
+bool BoundingBoxModel::setData( const QModelIndex& index, const QVariant& value, int role )
+{
+	if( !index.isValid() || role != Qt::EditRole || index.row() >= annotations->GetCount() )
+		return false;
+
+	const BoundingBox box = annotations->GetAt(index.row());
+	const int column = index.column();
+
+	if( annotations->GetRecorder() != NULL )
+		annotations->GetRecorder()->Input("table");
+
+	// the ticks of one spin box are merged into one undo step, but
+	// an edit of another cell of the same box starts a new one
+	if( column != editColumn || box.id != editBox )
+		annotations->Seal();
+
+	editColumn = column;
+	editBox    = box.id;
+
+	// the annotation model notifies the views (including this one) of the change
+	if( column == ClassColumn )
+		return annotations->SetClass(box.id, value.toInt());
+	else if( column == XColumn )
+		return annotations->SetCoords(box.id, value.toFloat(), box.y, box.width, box.height);
+	else if( column == YColumn )
+		return annotations->SetCoords(box.id, box.x, value.toFloat(), box.width, box.height);
+	else if( column == WidthColumn )
+		return annotations->SetCoords(box.id, box.x, box.y, value.toFloat(), box.height);
+	else if( column == HeightColumn )
+		return annotations->SetCoords(box.id, box.x, box.y, box.width, value.toFloat());
+
+	return false;
+}
+
+
+// BeginEdit
+void BoundingBoxModel::BeginEdit()
+{
+	editColumn = -1;
+}
+
+
+// flags
+Qt::ItemFlags BoundingBoxModel::flags( const QModelIndex& index ) const
+{
+	if( !index.isValid() )
+		return Qt::NoItemFlags;
+
+	if( index.column() == DeleteColumn )
+		return Qt::ItemIsEnabled;
+
+	return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsEditable;
+}
+
+
+//-----------------------------------------------------------------------------------------
+// constructor
+BoundingBoxDelegate::BoundingBoxDelegate( QStringListModel* classes, QObject* parent ) : QStyledItemDelegate(parent)
+{
+	classModel = classes;
+}
+
+
+// CreateClassDropdown
+QComboBox* BoundingBoxDelegate::CreateClassDropdown( QStringListModel* classModel, QWidget* parent )
+{
+	// the drop-downs all share the same label model, so creating one
+	// doesn't copy the labels and reloading them updates every row
+	QComboBox* dropdown = new QComboBox(parent);
+
+	dropdown->setEditable(true);
+	dropdown->setInsertPolicy(QComboBox::NoInsert);
+	dropdown->setModel(classModel);
+
+	// type-ahead filtering of the labels
+	QCompleter* completer = dropdown->completer();
+
+	if( completer != NULL )
+	{
+		completer->setCompletionMode(QCompleter::PopupCompletion);
+		completer->setCaseSensitivity(Qt::CaseInsensitive);
+		completer->setFilterMode(Qt::MatchContains);
+	}
+
+	return dropdown;
+}
+
+
+// createEditor
+QWidget* BoundingBoxDelegate::createEditor( QWidget* parent, const QStyleOptionViewItem& option, const QModelIndex& index ) const
+{
+	const int column = index.column();
+
+	if( column == BoundingBoxModel::ClassColumn )
+	{
+		QComboBox* dropdown = CreateClassDropdown(classModel, parent);
+		connect(dropdown, SIGNAL(activated(int)), this, SLOT(onEditorChanged()));
+		return dropdown;
+	}
+	else if( column >= BoundingBoxModel::XColumn && column <= BoundingBoxModel::HeightColumn )
+	{
+		QDoubleSpinBox* spinBox = new QDoubleSpinBox(parent);
+
+		spinBox->setDecimals(1);
+		spinBox->setRange(column <= BoundingBoxModel::YColumn ? -9999.0 : 0.0, 9999.0);
+		spinBox->setFrame(false);
+
+		connect(spinBox, SIGNAL(valueChanged(double)), this, SLOT(onEditorChanged()));
+		return spinBox;
+	}
+
+	return NULL;
+}
+
+
+// setEditorData
+void BoundingBoxDelegate::setEditorData( QWidget* editor, const QModelIndex& index ) const
+{
+	QComboBox* dropdown = qobject_cast<QComboBox*>(editor);
+
+	if( dropdown != NULL )
+	{
+		dropdown->setCurrentIndex(index.data(Qt::EditRole).toInt());
+		return;
+	}
+
+	QDoubleSpinBox* spinBox = qobject_cast<QDoubleSpinBox*>(editor);
+
+	if( spinBox != NULL )
+	{
+		spinBox->blockSignals(true);
+		spinBox->setValue(index.data(Qt::EditRole).toDouble());
+		spinBox->blockSignals(false);
+	}
+}
+
+
+// setModelData
+void BoundingBoxDelegate::setModelData( QWidget* editor, QAbstractItemModel* model, const QModelIndex& index ) const
+{
+	// reopening the same cell is a separate undo step too
+	if( editor != lastEditor )
+	{
+		BoundingBoxModel* boxModel = qobject_cast<BoundingBoxModel*>(model);
+
+		if( boxModel != NULL )
+			boxModel->BeginEdit();
+
+		lastEditor = editor;
+	}
+
+	QComboBox* dropdown = qobject_cast<QComboBox*>(editor);
+
+	if( dropdown != NULL )
+	{
+		// the drop-down is editable for type-ahead, so use the
+		// selected label instead of whatever text is in the editor
+		if( dropdown->currentIndex() >= 0 )
+			model->setData(index, dropdown->currentIndex());
+
+		return;
+	}
+
+	QDoubleSpinBox* spinBox = qobject_cast<QDoubleSpinBox*>(editor);
+
+	if( spinBox != NULL )
+	{
+		spinBox->interpretText();
+		model->setData(index, spinBox->value());
+	}
+}
+
+
+// onEditorChanged
+void BoundingBoxDelegate::onEditorChanged()
+{
+	// apply edits to the boxes while the editor is still open
+	QWidget* editor = qobject_cast<QWidget*>(sender());
+
+	if( editor != NULL )
+		emit commitData(editor);
+}
+
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_BOUNDING_BOX_MODEL__
+#define __CAMERA_BOUNDING_BOX_MODEL__
+
+#include <QtWidgets>
+
+#include "annotationModel.h"
+
+
+/*
+ * Table model view of the bounding boxes in an AnnotationModel
+ */
+class BoundingBoxModel : public QAbstractTableModel
+{
+	Q_OBJECT
+
+public:
+	// table columns
+	enum Column
+	{
+		ClassColumn = 0,
+		XColumn,
+		YColumn,
+		WidthColumn,
+		HeightColumn,
+		DeleteColumn,
+		NumColumns
+	};
+
+	// constructor
+	BoundingBoxModel( AnnotationModel* annotations, QStringListModel* classModel, QObject* parent=NULL );
+
+	// destructor
+	~BoundingBoxModel();
+
+	// class labels
+	QString GetClassLabel( int classID ) const;
+
+	// the next edit starts a new undo step (i.e. another editor was opened)
+	void BeginEdit();
+
+	// QAbstractTableModel
+	virtual int rowCount( const QModelIndex& parent=QModelIndex() ) const;
+	virtual int columnCount( const QModelIndex& parent=QModelIndex() ) const;
+
+	virtual QVariant data( const QModelIndex& index, int role=Qt::DisplayRole ) const;
+	virtual QVariant headerData( int section, Qt::Orientation orientation, int role=Qt::DisplayRole ) const;
+
+	virtual bool setData( const QModelIndex& index, const QVariant& value, int role=Qt::EditRole );
+	virtual Qt::ItemFlags flags( const QModelIndex& index ) const;
+
+protected slots:
+	void onClassesReset();
+	void flushChanges();
+
+protected:
+	static void onAnnotationEvent( uint16_t event, uint32_t id, int row, void* user );
+
+	void markChanged( int row );
+
+	AnnotationModel*  annotations;
+	QStringListModel* classModel;
+
+	// pending dataChanged() rows, flushed once per event loop pass
+	int     changedFirst;
+	int     changedLast;
+	QTimer* changedTimer;
+
+	// the cell of the last edit, whose editor merges its changes into one undo step
+	int      editColumn;
+	uint32_t editBox;
+};
+
+
+/*
+ * Item delegate that creates the class/coordinate editors while a cell is being edited
+ */
+class BoundingBoxDelegate : public QStyledItemDelegate
+{
+	Q_OBJECT
+
+public:
+	// constructor
+	BoundingBoxDelegate( QStringListModel* classModel, QObject* parent=NULL );
+
+	// create a class drop-down that views the shared label model
+	static QComboBox* CreateClassDropdown( QStringListModel* classModel, QWidget* parent=NULL );
+
+	// QStyledItemDelegate
+	virtual QWidget* createEditor( QWidget* parent, const QStyleOptionViewItem& option, const QModelIndex& index ) const;
+
+	virtual void setEditorData( QWidget* editor, const QModelIndex& index ) const;
+	virtual void setModelData( QWidget* editor, QAbstractItemModel* model, const QModelIndex& index ) const;
+
+protected slots:
+	void onEditorChanged();
+
+protected:
+	QStringListModel* classModel;
+
+	mutable QPointer<QWidget> lastEditor;	// the editor that last committed data
+};
+
+#endif
+
@@ -24,11 +24,25 @@
 #include "controlWindow.h"
 
 #include "videoSource.h"
+#include "prelabelProvider.h"
+#include "offlineSource.h"
+#include "syntheticSource.h"
+#include "datasetWriter.h"
+#include "datasetStaging.h"
+#include "ioBatch.h"
+#include "saveQueue.h"
+#include "outputGeometry.h"
+#include "metrics.h"
+#include "tracer.h"
+#include "sessionLog.h"
 
+#include <algorithm>
 #include <signal.h>
 
 
 bool signal_recieved = false;
+volatile sig_atomic_t metrics_requested = 0;
+volatile sig_atomic_t trace_requested = 0;
 
 void sig_handler(int signo)
 {
@@ -37,15 +51,44 @@ void sig_handler(int signo)
 		printf("received SIGINT\n");
 		signal_recieved = true;
 	}
+	else if( signo == SIGUSR1 )
+	{
+		// the summary is printed from the main loop
+		metrics_requested = 1;
+	}
+	else if( signo == SIGUSR2 )
+	{
+		// the trace is written from the main loop
+		trace_requested = 1;
+	}
 }
 
 int usage()
 {
 	printf("usage: camera-capture [-h] input_URI\n\n");
-	printf("GUI tool for collecting & labeling data from live camera feed\n\n");
+	printf("GUI tool for collecting & labeling data from live camera feed\n");
+	printf("(or from recorded footage, see --offline)\n\n");
 	printf("optional arguments:\n");
-	printf("  --help           show this help message and exit\n");
+	printf("  --help                     show this help message and exit\n");
+	printf("  --review-cache=MB          memory budget of the review thumbnails (default 64MB)\n");
+	printf("  --review-disk-cache=MB     disk budget of the review thumbnails (default 256MB)\n");
+	printf("  --novelty=DIST             min distance to the dataset for auto-captures (default 0.1)\n");
+	printf("  --auto-interval=MS         min time between auto-captures (default 500ms)\n");
+	printf("  --burst-frames=N           frames compared in a burst (default 15)\n");
+	printf("  --burst-count=N            max frames saved from a burst (default 3)\n");
+	printf("  --multi-writer             share the dataset with other camera-capture processes\n");
+	printf("  --writer-id=ID             name of this process in the samples (default p<pid>)\n");
 	printf("%s", videoSource::Usage());
+	printf("%s", OfflineSource::Usage());
+	printf("%s", SyntheticSource::Usage());
+	printf("%s", PrelabelProvider::Usage());
+	printf("%s", SaveController::Usage());
+	printf("%s", OutputGeometry::Usage());
+	printf("%s", DatasetStaging::Usage());
+	printf("%s", IOBatch::Usage());
+	printf("%s", Metrics::Usage());
+	printf("%s", Tracer::Usage());
+	printf("%s", SessionRecorder::Usage());
 
 	return 0;
 }
@@ -60,6 +103,24 @@ int main( int argc, char** argv )
 	if( cmdLine.GetFlag("help") )
 		return usage();
 
+	// several processes can save to the same dataset
+	if( cmdLine.GetFlag("multi-writer") || cmdLine.GetString("writer-id") != NULL )
+		DatasetWriter::SetWriterID(cmdLine.GetString("writer-id", ""));
+
+	// the backend that writes the files of the samples (io_uring by default, where it's available)
+	if( cmdLine.GetString("io-backend") != NULL || cmdLine.GetString("io-threads") != NULL )
+		IOBatch::SetBackend(cmdLine.GetString("io-backend", "io_uring"), cmdLine.GetInt("io-threads", IOBatch::DefaultThreads));
+
+	// stage the samples on faster storage, and move them to the dataset in the background
+	const char* stagingPath = cmdLine.GetString("staging");
+
+	if( stagingPath != NULL && !DatasetStaging::Open(stagingPath, cmdLine.GetFloat("staging-rate", 0.0f) * 1024 * 1024,
+										 (uint64_t)std::max(cmdLine.GetInt("staging-size", 256), 1) * 1024 * 1024) )
+	{
+		printf("camera-capture:  failed to open the staging area %s\n", stagingPath);
+		return 0;
+	}
+
 
 	/*
 	 * attach signal handler
@@ -68,6 +129,38 @@ int main( int argc, char** argv )
 		printf("\ncan't catch SIGINT\n");
 
 
+	/*
+	 * enable the latency metrics
+	 */
+	const char* metricsFile = cmdLine.GetString("metrics-file");
+
+	if( cmdLine.GetFlag("metrics") || metricsFile != NULL )
+	{
+		Metrics::Enable();
+
+		if( signal(SIGUSR1, sig_handler) == SIG_ERR )
+			printf("\ncan't catch SIGUSR1\n");
+
+		if( metricsFile != NULL )
+			Metrics::StartWriter(metricsFile, cmdLine.GetInt("metrics-interval", Metrics::DefaultInterval));
+	}
+
+
+	/*
+	 * enable the timeline trace
+	 */
+	const char* traceFile = cmdLine.GetString("trace");
+
+	if( traceFile != NULL )
+	{
+		Tracer::Enable(cmdLine.GetInt("trace-events", Tracer::DefaultCapacity));
+		Tracer::SetThreadName("main");
+
+		if( signal(SIGUSR2, sig_handler) == SIG_ERR )
+			printf("\ncan't catch SIGUSR2\n");
+	}
+
+
 	/*
 	 * create capture window
 	 */
@@ -97,15 +190,34 @@ int main( int argc, char** argv )
 	 */
 	while( !signal_recieved )
 	{
+		TRACE_SCOPE("frame");
+
 		// capture & render latest camera frame
 		captureWindow->Render();
 
 		// update the control window
-		controlWindow->ProcessEvents();
+		{
+			TRACE_SCOPE("process_events");
+			controlWindow->ProcessEvents();
+		}
 
 		// check if the user quit
 		if( captureWindow->IsClosed() || controlWindow->IsClosed() )
 			signal_recieved = true;
+
+		// print the metrics on demand (SIGUSR1)
+		if( metrics_requested )
+		{
+			metrics_requested = 0;
+			Metrics::Dump();
+		}
+
+		// write the trace on demand (SIGUSR2)
+		if( trace_requested )
+		{
+			trace_requested = 0;
+			Tracer::Write(traceFile);
+		}
 	}
 	
 
@@ -120,6 +232,28 @@ int main( int argc, char** argv )
 	if( captureWindow != NULL )
 		delete captureWindow;
 
+	// move the samples that are still staged to the dataset
+	if( DatasetStaging::IsEnabled() )
+	{
+		printf("camera-capture:  migrating %i staged samples...\n", DatasetStaging::GetPendingCount());
+		DatasetStaging::Close();
+	}
+
+	IOBatch::Shutdown();
+
+	if( Metrics::IsEnabled() )
+	{
+		Metrics::StopWriter();
+
+		if( metricsFile != NULL )
+			Metrics::Write(metricsFile);
+
+		Metrics::Dump();
+	}
+
+	if( traceFile != NULL )
+		Tracer::Write(traceFile);
+
 	printf("camera-capture:  shutdown complete.\n");
 	return 0;
 }
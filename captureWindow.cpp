@@ -22,27 +22,61 @@
 
 #include "captureWindow.h"
 
+#include "offlineSource.h"
+#include "frameRecorder.h"
+#include "syntheticSource.h"
+#include "outputGeometry.h"
+#include "metrics.h"
+
 #include "videoSource.h"
 #include "glDisplay.h"
 #include "imageIO.h"
 
 #include <X11/cursorfont.h>
+#include <string.h>
+#include <chrono>
+
+
+// currentTime (in seconds)
+static double currentTime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
 
 // constructor
 CaptureWindow::CaptureWindow()
 {
 	mode    = Live;
+	drawing = false;
 	camera  = NULL;
 	display = NULL;
+	synthetic = NULL;
 	imgRGB  = NULL;
+	offline = NULL;
+
+	offlineRate = 0.0f;
+	offlineTime = 0.0;
+
+	imgOverride    = NULL;
+	overrideWidth  = 0;
+	overrideHeight = 0;
+
+	roiWidget  = NULL;
+	roiEnabled = false;
+
+	memset(roi, 0, sizeof(roi));
 }
 
 
 // destructor
 CaptureWindow::~CaptureWindow()
 {
+	offlineFrame.reset();
+
 	SAFE_DELETE(camera);
+	SAFE_DELETE(synthetic);
+	SAFE_DELETE(offline);
 	SAFE_DELETE(display);
 }
 
@@ -66,25 +100,67 @@ CaptureWindow* CaptureWindow::Create( commandLine& cmdLine )
 bool CaptureWindow::init( commandLine& cmdLine )
 {
 	/*
-	 * create the camera device
+	 * create the camera device, or open the recorded footage
 	 */
-	camera = videoSource::Create(cmdLine, ARG_POSITION(0));
+	const char* input = cmdLine.GetPosition(0);
 
-	if( !camera )
+	if( cmdLine.GetFlag("offline") || OfflineSource::IsDirectory(input) || RecordingReader::IsRecording(input) )
 	{
-		printf("\ncamera-capture:  failed to initialize video device\n");
-		return false;
+		offline = OfflineSource::Create(input, cmdLine.GetInt("stride", 1), cmdLine.GetInt("read-ahead", OfflineSource::DefaultReadAhead));
+
+		if( !offline )
+			return false;
+
+		offlineRate  = cmdLine.GetFloat("rate", 0.0f);
+		offlineFrame = offline->Capture();
+
+		if( !offlineFrame )
+		{
+			printf("\ncamera-capture:  failed to read the first frame of %s\n", input);
+			return false;
+		}
+
+		imgRGB      = offlineFrame->image;
+		offlineTime = currentTime();
+	}
+	else if( SyntheticSource::IsSynthetic(input) )
+	{
+		SyntheticSource::Format format = SyntheticSource::RGB8;
+
+		if( cmdLine.GetString("synthetic-format") != NULL && !SyntheticSource::ParseFormat(cmdLine.GetString("synthetic-format"), format) )
+		{
+			printf("\ncamera-capture:  invalid --synthetic-format=%s (should be rgb8 or i420)\n", cmdLine.GetString("synthetic-format"));
+			return false;
+		}
+
+		synthetic = SyntheticSource::Create(input, format, cmdLine.GetInt("synthetic-shapes", SyntheticSource::DefaultShapes), cmdLine.GetInt("synthetic-seed", 0));
+
+		if( !synthetic )
+			return false;
+
+		printf("\ncamera-capture:  generating synthetic frames (%ix%i, %s, %.0f FPS)\n", synthetic->GetWidth(), synthetic->GetHeight(),
+			  SyntheticSource::FormatToStr(synthetic->GetFormat()), synthetic->GetFrameRate());
 	}
+	else
+	{
+		camera = videoSource::Create(cmdLine, ARG_POSITION(0));
+
+		if( !camera )
+		{
+			printf("\ncamera-capture:  failed to initialize video device\n");
+			return false;
+		}
 	
-	printf("\ncamera-capture:  successfully initialized video device (%ux%u)\n", camera->GetWidth(), camera->GetHeight());
+		printf("\ncamera-capture:  successfully initialized video device (%ux%u)\n", camera->GetWidth(), camera->GetHeight());
+	}
 	
 
 	/*
 	 * create openGL window
 	 */
 	display = glDisplay::Create("Data Collection Tool",
-						   camera->GetWidth() + cameraOffsetX + 5,
-						   camera->GetHeight() + cameraOffsetY + 5);
+						   GetCameraWidth() + cameraOffsetX + 5,
+						   GetCameraHeight() + cameraOffsetY + 5);
 
 	if( !display ) 
 	{
@@ -107,19 +183,84 @@ bool CaptureWindow::init( commandLine& cmdLine )
 // Render
 void CaptureWindow::Render()
 {
+	// get the next frame of the recorded footage
+	if( mode == Live && offline != NULL )
+	{
+		// play the frames at the requested rate
+		if( offlineRate > 0.0f && currentTime() - offlineTime >= 1.0 / offlineRate )
+			offline->Step(1);
+
+		std::shared_ptr<OfflineFrame> frame;
+
+		{
+			METRICS_SCOPE("offline_capture", "time waiting for the next frame of the recorded footage");
+			frame = offline->Capture();
+		}
+
+		if( !frame && offline->GetCount() > 0 && offline->GetIndex() >= offline->GetCount() )
+		{
+			// stepped past the end of a video whose length wasn't known yet
+			offline->Seek(offline->GetCount() - 1);
+			frame = offline->Capture();
+		}
+
+		if( frame != NULL && frame != offlineFrame )
+		{
+			offlineFrame = frame;
+			offlineTime  = currentTime();
+			imgRGB       = frame->image;
+
+			for( size_t n=0; n < frameHandlers.size(); n++ )
+				frameHandlers[n].callback(imgRGB, frame->width, frame->height, frameHandlers[n].user);
+		}
+	}
+
 	// capture RGBA image
-	if( mode == Live )
+	else if( mode == Live )
 	{
-		if( !camera->Capture(&imgRGB, 1000) )
+		static MetricsValue* framesCaptured = Metrics::GetCounter("frames_captured", "camera frames captured");
+		static MetricsValue* captureFailures = Metrics::GetCounter("capture_failures", "camera frames that failed or timed out");
+
+		bool captured = false;
+
+		{
+			METRICS_SCOPE("capture", "time to capture a camera frame (including the color conversion)");
+			captured = (synthetic != NULL) ? synthetic->Capture(&imgRGB) : camera->Capture(&imgRGB, 1000);
+		}
+
+		if( !captured )
+		{
 			printf("camera-capture:  failed to capture RGBA image from camera\n");
+			captureFailures->Add();
+		}
+		else if( frameHandlers.size() > 0 )
+		{
+			framesCaptured->Add();
+
+			METRICS_SCOPE("frame_handlers", "time spent in the frame handlers (recording, auto-capture, pre-labeling)");
+
+			// the handlers read the frame from the CPU
+			CUDA(cudaDeviceSynchronize());
+
+			for( size_t n=0; n < frameHandlers.size(); n++ )
+				frameHandlers[n].callback(imgRGB, GetCameraWidth(), GetCameraHeight(), frameHandlers[n].user);
+		}
+		else
+		{
+			framesCaptured->Add();
+		}
 	}
 
 	// update display
 	if( display != NULL )
 	{
+		METRICS_SCOPE("render", "time to render the frame and the widgets");
+
 		// render the image
-		if( imgRGB != NULL )
-			display->RenderOnce(imgRGB, camera->GetWidth(), camera->GetHeight(), IMAGE_RGB8, cameraOffsetX, cameraOffsetY);
+		if( imgOverride != NULL )
+			display->RenderOnce(imgOverride, overrideWidth, overrideHeight, IMAGE_RGB8, cameraOffsetX, cameraOffsetY);
+		else if( imgRGB != NULL )
+			display->RenderOnce(imgRGB, GetCameraWidth(), GetCameraHeight(), IMAGE_RGB8, cameraOffsetX, cameraOffsetY);
 
 		// update the status bar
 		char str[256];
@@ -130,14 +271,43 @@ void CaptureWindow::Render()
 
 
 // Save
-bool CaptureWindow::Save( const char* filename, int quality )
+bool CaptureWindow::Save( const char* filename, int quality, OutputTransform* transform )
 {
 	if( !filename || !imgRGB )
 		return false;
 
-	CUDA(cudaDeviceSynchronize());
+	{
+		METRICS_SCOPE("save_sync", "time waiting for the GPU before saving a frame");
+		CUDA(cudaDeviceSynchronize());
+	}
+
+	// save the image being shown (the override from SetImage() or the camera frame)
+	const bool overridden = (imgOverride != NULL);
+
+	const uchar3* image = overridden ? imgOverride : imgRGB;
 
-	if( !saveImage(filename, imgRGB, camera->GetWidth(), camera->GetHeight(), quality) )
+	int width  = overridden ? overrideWidth : GetCameraWidth();
+	int height = overridden ? overrideHeight : GetCameraHeight();
+
+	// resample it to the output geometry
+	if( transform != NULL && !transform->IsIdentity() )
+	{
+		METRICS_SCOPE("save_transform", "time to crop and resize a frame to the output geometry");
+
+		image  = transform->Apply(image);
+		width  = transform->GetWidth();
+		height = transform->GetHeight();
+
+		if( !image )
+		{
+			printf("camera-capture:  failed to transform %s to the output geometry\n", filename);
+			return false;
+		}
+	}
+
+	METRICS_SCOPE("save_image", "time to encode and write an image");
+
+	if( !saveImage(filename, const_cast<uchar3*>(image), width, height, quality) )
 	{
 		printf("camera-capture:  failed to save %s\n", filename);
 		return false;
@@ -148,17 +318,59 @@ bool CaptureWindow::Save( const char* filename, int quality )
 }
 
 
+// GetImage
+uchar3* CaptureWindow::GetImage() const
+{
+	if( !imgRGB )
+		return NULL;
+
+	CUDA(cudaDeviceSynchronize());
+	return imgRGB;
+}
+
+
+// SetImage
+void CaptureWindow::SetImage( uchar3* image, int width, int height )
+{
+	imgOverride    = image;
+	overrideWidth  = width;
+	overrideHeight = height;
+}
+
+
 // SetMode
 void CaptureWindow::SetMode( CaptureMode _mode )
 {
 	mode = _mode;
 
-	if( mode == Edit )
+	// go back to the camera
+	if( mode == Live )
+		imgOverride = NULL;
+
+	updateDragMode();
+
+	// the region would get in the way of drawing the boxes
+	updateROI();
+}
+
+
+// SetDrawing
+void CaptureWindow::SetDrawing( bool _drawing )
+{
+	drawing = _drawing;
+	updateDragMode();
+}
+
+
+// updateDragMode
+void CaptureWindow::updateDragMode()
+{
+	if( mode == Edit || drawing )
 	{
 		display->SetDefaultCursor(XC_tcross);
 		display->SetDragMode(glDisplay::DragCreate);
 	}
-	else if( mode == Live )
+	else
 	{
 		display->ResetDefaultCursor();
 		display->SetDragMode(glDisplay::DragDefault);
@@ -166,6 +378,89 @@ void CaptureWindow::SetMode( CaptureMode _mode )
 }
 
 
+// ShowROI
+void CaptureWindow::ShowROI( bool show )
+{
+	roiEnabled = show;
+	updateROI();
+}
+
+
+// SetROI
+void CaptureWindow::SetROI( float x, float y, float width, float height )
+{
+	roi[0] = x;
+	roi[1] = y;
+	roi[2] = width;
+	roi[3] = height;
+
+	if( roiWidget != NULL )
+	{
+		roiWidget->SetX(x);
+		roiWidget->SetY(y);
+		roiWidget->SetWidth(width);
+		roiWidget->SetHeight(height);
+	}
+}
+
+
+// GetROI
+bool CaptureWindow::GetROI( float _roi[4] ) const
+{
+	if( !roiEnabled )
+		return false;
+
+	if( roiWidget != NULL )
+	{
+		_roi[0] = roiWidget->X();
+		_roi[1] = roiWidget->Y();
+		_roi[2] = roiWidget->Width();
+		_roi[3] = roiWidget->Height();
+	}
+	else
+	{
+		memcpy(_roi, roi, sizeof(roi));
+	}
+
+	return true;
+}
+
+
+// updateROI
+void CaptureWindow::updateROI()
+{
+	const bool visible = roiEnabled && mode == Live && display != NULL;
+
+	if( visible && !roiWidget )
+	{
+		// start with the middle of the frame
+		if( roi[2] <= 0.0f || roi[3] <= 0.0f )
+		{
+			roi[2] = GetCameraWidth() / 2;
+			roi[3] = GetCameraHeight() / 2;
+			roi[0] = GetCameraWidth() / 4;
+			roi[1] = GetCameraHeight() / 4;
+		}
+
+		// (assigned before it's added, so the handlers of WIDGET_CREATED can tell it apart)
+		roiWidget = new glWidget(roi[0], roi[1], roi[2], roi[3]);
+
+		roiWidget->SetMoveable(true);
+		roiWidget->SetResizeable(true);
+		roiWidget->SetLineColor(1.0f, 1.0f, 0.0f);
+		roiWidget->SetLineWidth(2.0f);
+
+		display->AddWidget(roiWidget);
+	}
+	else if( !visible && roiWidget != NULL )
+	{
+		GetROI(roi);
+		display->RemoveWidget(roiWidget);
+		roiWidget = NULL;
+	}
+}
+
+
 // IsOpen
 bool CaptureWindow::IsOpen() const
 {
@@ -183,6 +478,9 @@ bool CaptureWindow::IsClosed() const
 // IsStreaming
 bool CaptureWindow::IsStreaming() const
 {
+	if( offline != NULL || synthetic != NULL )
+		return true;
+
 	return camera->IsStreaming();
 }
 
@@ -190,6 +488,13 @@ bool CaptureWindow::IsStreaming() const
 // GetCameraWidth
 int CaptureWindow::GetCameraWidth() const
 {
+	// the images of an offline source can vary in size
+	if( offline != NULL )
+		return offlineFrame->width;
+
+	if( synthetic != NULL )
+		return synthetic->GetWidth();
+
 	return camera->GetWidth();
 }
 
@@ -197,10 +502,57 @@ int CaptureWindow::GetCameraWidth() const
 // GetCameraHeight
 int CaptureWindow::GetCameraHeight() const
 {
+	if( offline != NULL )
+		return offlineFrame->height;
+
+	if( synthetic != NULL )
+		return synthetic->GetHeight();
+
 	return camera->GetHeight();
 }
 
 
+// GetFrameIndex
+int CaptureWindow::GetFrameIndex() const
+{
+	if( !offline )
+		return -1;
+
+	return offlineFrame->index;
+}
+
+
+// GetFrameCount
+int CaptureWindow::GetFrameCount() const
+{
+	if( !offline )
+		return -1;
+
+	return offline->GetCount();
+}
+
+
+// Seek
+bool CaptureWindow::Seek( int index )
+{
+	// the frame can't change under the boxes being edited
+	if( !offline || mode != Live )
+		return false;
+
+	return offline->Seek(index);
+}
+
+
+// Step
+bool CaptureWindow::Step( int count )
+{
+	if( !offline || mode != Live )
+		return false;
+
+	return offline->Step(count);
+}
+
+
 // GetWindowWidth
 int CaptureWindow::GetWindowWidth() const
 {
@@ -218,7 +570,14 @@ int CaptureWindow::GetWindowHeight() const
 // GetWidget
 glWidget* CaptureWindow::GetWidget( int index ) const
 {
-	display->GetWidget(index);
+	return display->GetWidget(index);
+}
+
+
+// AddWidget
+glWidget* CaptureWindow::AddWidget( glWidget* widget ) const
+{
+	return display->AddWidget(widget);
 }
 
 
@@ -229,14 +588,55 @@ void CaptureWindow::RemoveWidget( int index ) const
 }
 
 
+// RemoveWidget
+void CaptureWindow::RemoveWidget( glWidget* widget ) const
+{
+	display->RemoveWidget(widget);
+}
+
+
 // RemoveAllWidgets
 void CaptureWindow::RemoveAllWidgets() const
 {
-	display->RemoveAllWidgets();
+	if( !roiWidget )
+	{
+		display->RemoveAllWidgets();
+		return;
+	}
+
+	for( int n=display->GetNumWidgets() - 1; n >= 0; n-- )
+	{
+		if( display->GetWidget(n) != roiWidget )
+			display->RemoveWidget(n);
+	}
 }
 
 
+// AddFrameHandler
+void CaptureWindow::AddFrameHandler( FrameHandler callback, void* user )
+{
+	if( !callback )
+		return;
+
+	FrameHandlerEntry entry;
 
+	entry.callback = callback;
+	entry.user     = user;
+
+	frameHandlers.push_back(entry);
+}
 
 
+// RemoveFrameHandler
+void CaptureWindow::RemoveFrameHandler( FrameHandler callback, void* user )
+{
+	for( size_t n=0; n < frameHandlers.size(); n++ )
+	{
+		if( frameHandlers[n].callback == callback && frameHandlers[n].user == user )
+		{
+			frameHandlers.erase(frameHandlers.begin() + n);
+			return;
+		}
+	}
+}
 
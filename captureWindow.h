@@ -26,10 +26,23 @@
 #include "commandLine.h"
 #include "cudaUtility.h"
 
+#include <vector>
+#include <memory>
+
 // forward declarations
 class videoSource;
+class OfflineSource;
+struct OfflineFrame;
+class SyntheticSource;
 class glDisplay;
 class glWidget;
+class OutputTransform;
+
+
+/*
+ * Frame handler (called with each new camera frame in Live mode)
+ */
+typedef void (*FrameHandler)( uchar3* image, int width, int height, void* user );
 
 
 /*
@@ -54,12 +67,23 @@ public:
 	// capture & render next camera frame
 	void Render();
 
-	// save the latest frame to disk
-	bool Save( const char* filename, int quality=95 );
+	// save the frame being shown to disk (optionally resampled by an OutputTransform
+	// that was configured for the size of the frame)
+	bool Save( const char* filename, int quality=95, OutputTransform* transform=NULL );
+
+	// get the latest frame (synchronized for CPU access)
+	uchar3* GetImage() const;
+
+	// show an image instead of the camera until the mode is set to Live
+	// (the image isn't copied, so it must stay valid while it's shown)
+	void SetImage( uchar3* image, int width, int height );
 
 	// set the current capture mode
 	void SetMode( CaptureMode mode );
 
+	// let widgets be drawn on the camera feed while Live (they're always drawn in Edit mode)
+	void SetDrawing( bool drawing );
+
 	// window open/closed status
 	bool IsOpen() const;
 	bool IsClosed() const;
@@ -67,6 +91,19 @@ public:
 	// camera streaming status
 	bool IsStreaming() const;
 
+	// offline sources (recorded footage that's stepped through, see --offline)
+	inline bool IsOffline() const				{ return offline != NULL; }
+
+	int GetFrameIndex() const;
+	int GetFrameCount() const;	// -1 if it isn't known yet
+
+	// step through the frames of an offline source (only while Live)
+	bool Seek( int index );
+	bool Step( int count );
+
+	// the synthetic source (NULL for a camera or an offline source)
+	inline SyntheticSource* GetSynthetic() const		{ return synthetic; }
+
 	// camera dimensions
 	int GetCameraWidth() const;
 	int GetCameraHeight() const;
@@ -75,25 +112,69 @@ public:
 	int GetWindowWidth() const;
 	int GetWindowHeight() const;
 
+	// the region of interest that's saved (a rectangle that's moved and resized on
+	// the camera feed, it's only shown while Live)
+	void ShowROI( bool show );
+	void SetROI( float x, float y, float width, float height );
+
+	// the region in camera pixels (returns false if it isn't being shown)
+	bool GetROI( float roi[4] ) const;
+
+	// the widget of the region isn't one of the boxes
+	inline bool IsROI( const glWidget* widget ) const	{ return widget != NULL && widget == roiWidget; }
+
 	// widget operations
 	glWidget* GetWidget( int index ) const;
+	glWidget* AddWidget( glWidget* widget ) const;
 
 	void RemoveWidget( int index ) const;
-	void RemoveAllWidgets() const;
+	void RemoveWidget( glWidget* widget ) const;
+	void RemoveAllWidgets() const;	// (except the region of interest)
+
+	// frame handlers
+	void AddFrameHandler( FrameHandler callback, void* user=NULL );
+	void RemoveFrameHandler( FrameHandler callback, void* user=NULL );
 
 protected:
 	CaptureWindow();
 	bool init( commandLine& cmdLine );
+	void updateROI();
+	void updateDragMode();
 
 	static const int cameraOffsetX = 5;
 	static const int cameraOffsetY = 5;
 
 	CaptureMode mode;
+	bool drawing;
 
 	videoSource* camera;
 	glDisplay* display;
 
+	SyntheticSource* synthetic;	// used instead of the camera for synthetic:// inputs
+
+	OfflineSource* offline;
+	std::shared_ptr<OfflineFrame> offlineFrame;	// the frame being shown
+
+	float  offlineRate;	// frames per second while Live (0 to only step)
+	double offlineTime;	// when the current frame was shown
+
 	uchar3* imgRGB;
+
+	uchar3* imgOverride;	// set with SetImage()
+	int     overrideWidth;
+	int     overrideHeight;
+
+	struct FrameHandlerEntry
+	{
+		FrameHandler callback;
+		void* user;
+	};
+
+	std::vector<FrameHandlerEntry> frameHandlers;
+
+	glWidget* roiWidget;	// NULL while the region isn't shown
+	float     roi[4];
+	bool      roiEnabled;
 };
 
 #endif
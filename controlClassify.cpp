@@ -21,7 +21,16 @@
  */
 
 #include "controlClassify.h"
+#include "datasetWriter.h"
 #include "imageNet.h"
+#include "imageIO.h"
+#include "cudaMappedMemory.h"
+#include "metrics.h"
+
+#include "glEvents.h"
+#include "glWidget.h"
+
+#include <chrono>
 
 
 #define STATUS_MSG "Status - "
@@ -29,11 +38,39 @@
 
 #define DEFAULT_JPEG_QUALITY 95
 
+#define REGION_LINE_WIDTH 3.0f
+#define REGION_MIN_SIZE   8	// smaller regions are left out (i.e. from a click)
+
+
+// currentTime (in seconds)
+static double currentTime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 
 // constructor
 ControlClassifyWidget::ControlClassifyWidget( commandLine* cmdLine, CaptureWindow* capture )
 {
 	captureWindow = capture;
+	prelabel      = NULL;
+	addingRegion  = false;
+
+	autoInterval   = cmdLine->GetInt("auto-interval", 500) * 0.001;
+	autoTime       = 0.0;
+	burstWidth     = 0;
+	burstHeight    = 0;
+	burstFrames    = std::max(cmdLine->GetInt("burst-frames", 15), 1);
+	burstCount     = std::max(cmdLine->GetInt("burst-count", 3), 1);
+	burstRemaining = 0;
+
+	saveQueue       = new SaveQueue(cmdLine->GetInt("save-queue", SaveQueue::DefaultCapacity), cmdLine->GetInt("save-threads", SaveQueue::DefaultThreads));
+	minQuality      = cmdLine->GetInt("min-quality", SaveController::DefaultMinQuality);
+	maxAutoInterval = cmdLine->GetInt("max-auto-interval", cmdLine->GetInt("auto-interval", 500) * 4) * 0.001;
+	minFreeSpace    = (uint64_t)std::max(cmdLine->GetInt("min-free-space", 512), 0) * 1024 * 1024;
+	diskFull        = false;
+
+	saveController.Enable(!cmdLine->GetFlag("fixed-quality"));
 
 	/*
 	 * create layout
@@ -105,8 +142,12 @@ ControlClassifyWidget::ControlClassifyWidget( commandLine* cmdLine, CaptureWindo
 
 	labelDropdown->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
 
+	suggestCheckbox = new QCheckBox("Suggest");
+	suggestCheckbox->setToolTip(tr("Pre-select the class of the camera feed with the pre-label provider (--prelabel-classify)"));
+
 	classLayout->addWidget(new QLabel(tr("Current Class   ")));
 	classLayout->addWidget(labelDropdown);
+	classLayout->addWidget(suggestCheckbox);
 
 	layout->addItem(classLayout);
 
@@ -129,6 +170,72 @@ ControlClassifyWidget::ControlClassifyWidget( commandLine* cmdLine, CaptureWindo
 
 	layout->addLayout(qualityLayout);
 
+	saveController.Configure(DEFAULT_JPEG_QUALITY, minQuality, autoInterval, maxAutoInterval);
+
+
+	// output geometry
+	geometryWidget = new ControlGeometryWidget(cmdLine, captureWindow);
+	layout->addWidget(geometryWidget);
+
+
+	// capture regions
+	QHBoxLayout* regionsLayout = new QHBoxLayout();
+
+	regionsButton = new QPushButton("Draw (R)");
+	regionsButton->setCheckable(true);
+	regionsButton->setShortcut(QKeySequence(Qt::Key_R));
+	regionsButton->setToolTip(tr("Draw regions on the camera feed, each capture saves a crop of every region (instead of the frame or the ROI)"));
+
+	connect(regionsButton, SIGNAL(toggled(bool)), this, SLOT(onDrawRegions(bool)));
+
+	QPushButton* clearRegionsButton = new QPushButton("Clear");
+	clearRegionsButton->setToolTip(tr("Remove the regions, so the whole frame is captured again"));
+
+	connect(clearRegionsButton, SIGNAL(clicked()), this, SLOT(onClearRegions()));
+
+	regionsLabel = new QLabel();
+	regionsLabel->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
+
+	regionsLayout->addWidget(new QLabel(tr("Regions            ")));
+	regionsLayout->addWidget(regionsLabel);
+	regionsLayout->addWidget(regionsButton);
+	regionsLayout->addWidget(clearRegionsButton);
+
+	layout->addLayout(regionsLayout);
+	updateRegions();
+
+
+	// novelty threshold for auto-capture and bursts
+	QHBoxLayout* noveltyLayout = new QHBoxLayout();
+
+	noveltySpinbox = new QDoubleSpinBox();
+
+	noveltySpinbox->setRange(0.0, 1.0);
+	noveltySpinbox->setSingleStep(0.01);
+	noveltySpinbox->setValue(cmdLine->GetFloat("novelty", DiversityIndex::DefaultThreshold));
+	noveltySpinbox->setToolTip(tr("Minimum distance of a frame to the images in the dataset for it to be auto-captured"));
+
+	noveltyLabel = new QLabel();
+	noveltyLabel->setMinimumWidth(40);
+	noveltyLabel->setToolTip(tr("Distance of the last frame to the nearest image in the dataset"));
+
+	autoCheckbox = new QCheckBox("Auto");
+	autoCheckbox->setToolTip(tr("Capture the frames that are farther than the minimum novelty from the dataset"));
+
+	burstButton = new QPushButton("Burst (B)");
+	burstButton->setShortcut(QKeySequence(Qt::Key_B));
+	burstButton->setToolTip(tr("Capture the next few frames, and save the ones that add the most coverage to the dataset"));
+
+	connect(burstButton, SIGNAL(clicked()), this, SLOT(onBurst()));
+
+	noveltyLayout->addWidget(new QLabel(tr("Min Novelty      ")));
+	noveltyLayout->addWidget(noveltySpinbox);
+	noveltyLayout->addWidget(noveltyLabel);
+	noveltyLayout->addWidget(autoCheckbox);
+	noveltyLayout->addWidget(burstButton);
+
+	layout->addLayout(noveltyLayout);
+
 
 	// capture button
 	captureButton = new QPushButton("Capture (space)");
@@ -150,6 +257,24 @@ ControlClassifyWidget::ControlClassifyWidget( commandLine* cmdLine, CaptureWindo
 	layout->addWidget(statusBar);
 
 	
+	/*
+	 * pre-label provider
+	 */
+	PrelabelProvider* provider = PrelabelProvider::Create(cmdLine->GetString("prelabel-classify"));
+
+	if( provider != NULL )
+	{
+		prelabel = new PrelabelWorker(provider, cmdLine->GetInt("prelabel-timeout", PrelabelWorker::DefaultTimeout));
+		suggestCheckbox->setCheckState(Qt::Checked);
+	}
+
+	suggestCheckbox->setEnabled(prelabel != NULL);
+	captureWindow->AddFrameHandler(ControlClassifyWidget::onCaptureFrame, this);
+
+	// the regions are drawn with the canvas
+	glRegisterEvents(ControlClassifyWidget::onCaptureEvent, this);
+
+	
 	/*
 	 * configure options
  	 */
@@ -160,8 +285,167 @@ ControlClassifyWidget::ControlClassifyWidget( commandLine* cmdLine, CaptureWindo
 // destructor
 ControlClassifyWidget::~ControlClassifyWidget()
 {
+	captureWindow->RemoveFrameHandler(ControlClassifyWidget::onCaptureFrame, this);
+	SAFE_DELETE(prelabel);
+	SAFE_DELETE(saveQueue);	// writes the frames that are still queued
+	freeBurst();
+}
+
+
+// onCaptureFrame
+void ControlClassifyWidget::onCaptureFrame( uchar3* image, int width, int height, void* user )
+{
+	ControlClassifyWidget* control = (ControlClassifyWidget*)user;
+
+	if( !control || !control->isVisible() )
+		return;
+
+	control->updateSaveSettings();
+
+	if( control->burstRemaining > 0 )
+		control->burstCapture(image, width, height);
+	else if( control->autoCheckbox->isChecked() && control->captureButton->isEnabled() )
+		control->autoCapture(image, width, height);
+
+	if( !control->prelabel || control->suggestCheckbox->checkState() != Qt::Checked )
+		return;
+
+	PrelabelResult result;
+
+	if( control->prelabel->GetResult(result) )
+		control->suggestClass(result);
+
+	// the next frame is sent when the provider is done with the last one
+	if( !control->prelabel->IsBusy() )
+		control->prelabel->Submit(image, width, height);
+}
+
+
+// suggestClass
+void ControlClassifyWidget::suggestClass( const PrelabelResult& result )
+{
+	if( !result.completed || (result.classID < 0 && result.classLabel.size() == 0) )
+		return;
+
+	int index = -1;
 
+	if( result.classLabel.size() > 0 )
+		index = labelDropdown->findText(QString::fromStdString(result.classLabel), Qt::MatchFixedString);
+	else if( result.classID < labelDropdown->count() )
+		index = result.classID;
 
+	if( index < 0 || index == labelDropdown->currentIndex() )
+		return;
+
+	labelDropdown->setCurrentIndex(index);
+	statusBar->showMessage(QString(STATUS_MSG "suggested '%1' (%2%)").arg(labelDropdown->itemText(index)).arg(result.classScore * 100.0f, 0, 'f', 1));
+}
+
+
+// autoCapture
+void ControlClassifyWidget::autoCapture( uchar3* image, int width, int height )
+{
+	// the interval is lengthened while the disk can't keep up
+	if( currentTime() - autoTime < saveController.GetSettings().interval )
+		return;
+
+	// the images that aren't indexed yet would look new
+	const int pending = diversity.GetPending();
+
+	if( pending > 0 )
+	{
+		statusBar->showMessage(QString(STATUS_MSG "indexing the dataset (%1 images left)").arg(pending));
+		return;
+	}
+
+	FrameSignature signature;
+	signature.Compute(image, width, height);
+
+	// pick up the images saved by other processes (in multi-writer mode)
+	diversity.Refresh();
+
+	const float novelty = diversity.Nearest(signature);
+	noveltyLabel->setText(QString::number(novelty, 'f', 2));
+
+	if( novelty < noveltySpinbox->value() )
+		return;
+
+	if( saveFrame(image, width, height, signature) )
+		autoTime = currentTime();
+}
+
+
+// onBurst
+void ControlClassifyWidget::onBurst()
+{
+	if( !captureButton->isEnabled() || burstRemaining > 0 )
+		return;
+
+	freeBurst();
+
+	burstRemaining = burstFrames;
+	burstButton->setEnabled(false);
+}
+
+
+// burstCapture
+void ControlClassifyWidget::burstCapture( uchar3* image, int width, int height )
+{
+	// the frames are copied, because the camera reuses its buffers
+	const size_t size = width * height * sizeof(uchar3);
+	uchar3* copy = NULL;
+
+	if( (burstImages.size() > 0 && (width != burstWidth || height != burstHeight)) || !cudaAllocMapped((void**)&copy, size) )
+	{
+		statusBar->showMessage(QString(STATUS_MSG "failed to capture the burst"));
+		freeBurst();
+		burstRemaining = 0;
+		burstButton->setEnabled(true);
+		return;
+	}
+
+	memcpy(copy, image, size);
+
+	FrameSignature signature;
+	signature.Compute(copy, width, height);
+
+	burstImages.push_back(copy);
+	burstSignatures.push_back(signature);
+
+	burstWidth  = width;
+	burstHeight = height;
+
+	if( --burstRemaining > 0 )
+		return;
+
+	// pick the frames that are farthest from the dataset and from each other
+	diversity.Refresh();
+
+	const std::vector<int> selected = diversity.SelectKCenter(burstSignatures, burstCount, noveltySpinbox->value());
+
+	int numSaved = 0;
+
+	for( size_t n=0; n < selected.size(); n++ )
+	{
+		if( saveFrame(burstImages[selected[n]], burstWidth, burstHeight, burstSignatures[selected[n]]) )
+			numSaved++;
+	}
+
+	statusBar->showMessage(QString(STATUS_MSG "saved %1 of %2 burst frames").arg(numSaved).arg(burstImages.size()));
+
+	freeBurst();
+	burstButton->setEnabled(true);
+}
+
+
+// freeBurst
+void ControlClassifyWidget::freeBurst()
+{
+	for( size_t n=0; n < burstImages.size(); n++ )
+		CUDA(cudaFreeHost(burstImages[n]));
+
+	burstImages.clear();
+	burstSignatures.clear();
 }
 
 
@@ -178,53 +462,22 @@ void ControlClassifyWidget::createDatasetDirectories()
 	if( numClasses == 0 )
 		return;
 
-	// check that each subdirectory exists
-	QDir dir(QString::fromStdString(datasetPath));
-
 	// create directories for each training set and class
-	const int numSets = setDropdown->count();
+	std::vector<std::string> sets;
+	std::vector<std::string> classLabels;
 
-	for( int s=0; s < numSets; s++ )
-	{
-		const QString setName = setDropdown->itemText(s);
+	for( int s=0; s < setDropdown->count(); s++ )
+		sets.push_back(setDropdown->itemText(s).toStdString());
 
-		if( !dir.exists(setName) )
-		{
-			if( !dir.mkdir(setName) )
-			{
-				const QString msg = QString("Failed to create dataset subdirectory '%1/'").arg(setName);
-				QMessageBox::critical(this, tr("Error Creating Dataset Directories"), msg);
-				statusBar->showMessage(QString(STATUS_MSG) + msg);
-				continue;
-			}
-		}
-	
-		QDir setDir = dir;
-		
-		if( !setDir.cd(setName) )
-		{
-			const QString msg = QString("Failed to cd to dataset subdirectory '%1/'").arg(setName);
-			QMessageBox::critical(this, tr("Error Creating Dataset Directories"), msg);
-			statusBar->showMessage(QString(STATUS_MSG) + msg);
-			continue;
-		}
+	for( int n=0; n < numClasses; n++ )
+		classLabels.push_back(labelDropdown->itemText(n).toStdString());
 
-		for( int n=0; n < numClasses; n++ )
-		{
-			const QString subdir = labelDropdown->itemText(n);
-
-			if( !setDir.exists(subdir) )
-			{
-				if( !setDir.mkdir(subdir) )
-				{
-					const QString msg = QString("Failed to create dataset subdirectory '%1/%2/'").arg(setName, subdir);
-					QMessageBox::critical(this, tr("Error Creating Dataset Directories"), msg);
-					statusBar->showMessage(QString(STATUS_MSG) + msg);
-					continue;
-				}
-			}
-		}
-	}		
+	if( !DatasetWriter::CreateClassifyDirectories(datasetPath, sets, classLabels) )
+	{
+		const QString msg = QString("Failed to create dataset subdirectories in '%1/'").arg(QString::fromStdString(datasetPath));
+		QMessageBox::critical(this, tr("Error Creating Dataset Directories"), msg);
+		statusBar->showMessage(QString(STATUS_MSG) + msg);
+	}
 }
 
 // selectDatasetPath
@@ -241,6 +494,16 @@ void ControlClassifyWidget::selectDatasetPath()
 	// make sure the directories exist
 	createDatasetDirectories();
 
+	// the size the frames are saved at
+	geometryWidget->Open(datasetPath);
+
+	// load the signatures of the images already in the dataset
+	diversity.Open(datasetPath);
+
+	// the frames that are still queued are written to the previous dataset
+	saveQueue->Open(datasetPath);
+	diskFull = false;
+
 	// enable capture button
 	if( datasetPath.size() > 0 && labelPath.size() > 0 )
 		captureButton->setEnabled(true);
@@ -303,21 +566,300 @@ void ControlClassifyWidget::selectLabelFile()
 // onCapture
 void ControlClassifyWidget::onCapture()
 {
+	uchar3* image = captureWindow->GetImage();
+
+	if( !image )
+		return;
+
+	const int width  = captureWindow->GetCameraWidth();
+	const int height = captureWindow->GetCameraHeight();
+
+	FrameSignature signature;
+	signature.Compute(image, width, height);
+
+	saveFrame(image, width, height, signature);
+}
+
+
+// saveFrame
+bool ControlClassifyWidget::saveFrame( uchar3* image, int width, int height, const FrameSignature& signature )
+{
+	METRICS_SCOPE("save_frame", "time to queue a sample to be saved");
+
+	if( !checkFreeSpace() )
+		return false;
+
 	const std::string subsetLabel = setDropdown->currentText().toUtf8().constData();
 	const std::string classLabel  = labelDropdown->currentText().toUtf8().constData();
-	const std::string timestamp   = QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss").toUtf8().constData();
 	const std::string subdirPath  = subsetLabel + "/" + classLabel;
-	const std::string directory   = datasetPath + "/" + subdirPath;
-	const std::string filename    = directory + "/" + timestamp + ".jpg";
+	const std::string directory   = DatasetWriter::ClassifyDirectory(datasetPath, subsetLabel, classLabel);
+
+	// one sample of the frame (or the region of the output geometry), or one of each region drawn on the canvas
+	const OutputGeometry& geometry = geometryWidget->GetGeometry();
+	const std::vector<float4> drawn = getRegions();
+
+	std::vector<OutputGeometry> samples;
+
+	if( drawn.size() == 0 )
+		samples.push_back(geometry);
+
+	for( size_t n=0; n < drawn.size(); n++ )
+	{
+		OutputGeometry sample = geometry;
+
+		sample.roi[0] = drawn[n].x;
+		sample.roi[1] = drawn[n].y;
+		sample.roi[2] = drawn[n].z;
+		sample.roi[3] = drawn[n].w;
+
+		samples.push_back(sample);
+	}
+
+	if( (int)samples.size() > saveQueue->GetCapacity() )
+	{
+		statusBar->showMessage(QString(STATUS_MSG "there are more regions than the save queue holds (see --save-queue)"));
+		return false;
+	}
+
+	// the samples of a frame are saved together or not at all
+	if( saveQueue->GetDepth() + (int)samples.size() > saveQueue->GetCapacity() )
+	{
+		static MetricsValue* dropped = Metrics::GetCounter("save_dropped", "frames dropped because the save queue was full");
+		dropped->Add();
+
+		statusBar->showMessage(QString(STATUS_MSG "the disk can't keep up, dropped a frame (%1 queued)").arg(saveQueue->GetDepth()));
+		return false;
+	}
+
+	// the settings the frame was saved with, and the state of the queue that they were chosen from
+	const SaveSettings& settings = saveController.GetSettings();
+
+	std::string firstName;
+	int numQueued = 0;
+
+	for( size_t n=0; n < samples.size(); n++ )
+	{
+		int region[4];
+
+		if( !samples[n].GetRegion(width, height, region) )
+		{
+			printf("camera-capture:  the region %s is outside of the %ix%i frame\n", samples[n].Format().c_str(), width, height);
+			continue;
+		}
+
+		// the crops are encoded in parallel by the writers of the queue
+		const std::string name = DatasetWriter::SampleName();
+		const std::string filename = directory + "/" + name + ".jpg";
+
+		char metadata[320];
+
+		snprintf(metadata, sizeof(metadata), "quality=%i\tchroma=%s\tlevel=%i\tauto_interval_ms=%.0f\tqueue=%i/%i\twrite_mbps=%.2f\tregion=%i,%i,%i,%i\tsize=%ix%i",
+			    settings.quality, SaveController::Chroma(settings.quality), settings.level, settings.interval * 1000.0,
+			    saveQueue->GetDepth(), saveQueue->GetCapacity(), saveQueue->GetThroughput() / (1024.0 * 1024.0),
+			    region[0], region[1], region[2], region[3], samples[n].width, samples[n].height);
+
+		if( !saveQueue->Submit(image, width, height, samples[n], filename, settings.quality, metadata) )
+		{
+			printf("camera-capture:  failed to queue %s\n", filename.c_str());
+			continue;
+		}
+
+		if( firstName.size() == 0 )
+			firstName = name;
+
+		numQueued++;
+	}
+
+	if( numQueued == 0 )
+	{
+		statusBar->showMessage(QString(STATUS_MSG "failed to queue the frame"));
+		return false;
+	}
+
+	// keep the full-resolution frame too (it's only a copy, so it's dropped first when the queue is full)
+	if( geometry.keepOriginal && (drawn.size() > 0 || !geometry.IsFullFrame()) )
+	{
+		const std::string originals = DatasetWriter::ClassifyDirectory(DatasetWriter::OriginalsDirectory(datasetPath), subsetLabel, classLabel);
+
+		if( !DatasetWriter::MakeDirectory(originals) || !saveQueue->Submit(image, width, height, originals + "/" + firstName + ".jpg", settings.quality) )
+			printf("camera-capture:  couldn't keep the original of %s\n", firstName.c_str());
+	}
+
+	// the next frames are compared to this one too
+	diversity.Add(directory + "/" + firstName + ".jpg", signature);
+
+	const int numFiles = DatasetWriter::CountFiles(directory);
+	statusBar->showMessage(QString(STATUS_MSG "%1 images in %2 (%3 queued)").arg(QString::number(numFiles), QString::fromStdString(subdirPath)).arg(saveQueue->GetDepth()));
+
+	return true;
+}
+
+
+// onCaptureEvent
+bool ControlClassifyWidget::onCaptureEvent( uint16_t event, int a, int b, void* user )
+{
+	ControlClassifyWidget* control = (ControlClassifyWidget*)user;
+
+	if( !control || !control->isVisible() || event != WIDGET_CREATED )
+		return false;
+
+	if( control->addingRegion || !control->regionsButton->isChecked() )
+		return false;
+
+	// the region drawn on the canvas
+	glWidget* widget = control->captureWindow->GetWidget(a);
+
+	if( !widget || control->captureWindow->IsROI(widget) )
+		return false;
+
+	control->addRegion(widget);
+	return true;
+}
+
+
+// addRegion
+void ControlClassifyWidget::addRegion( glWidget* widget )
+{
+	widget->SetMoveable(true);
+	widget->SetResizeable(true);
+	widget->SetLineColor(0.0f, 1.0f, 1.0f);
+	widget->SetLineWidth(REGION_LINE_WIDTH);
+
+	regionWidgets.push_back(widget);
+	updateRegions();
+}
+
+
+// getRegions
+std::vector<float4> ControlClassifyWidget::getRegions() const
+{
+	// the regions are kept as rectangles while they aren't on the canvas
+	if( regionWidgets.size() == 0 )
+		return regions;
+
+	std::vector<float4> current;
 
-	if( !captureWindow->Save(filename.c_str()) )
+	for( size_t n=0; n < regionWidgets.size(); n++ )
 	{
-		statusBar->showMessage(QString(STATUS_MSG "failed to save ") + QString::fromStdString(timestamp) + QString(".jpg"));
+		const glWidget* widget = regionWidgets[n];
+
+		if( widget->Width() >= REGION_MIN_SIZE && widget->Height() >= REGION_MIN_SIZE )
+			current.push_back(make_float4(widget->X(), widget->Y(), widget->Width(), widget->Height()));
+	}
+
+	return current;
+}
+
+
+// updateRegions
+void ControlClassifyWidget::updateRegions()
+{
+	const size_t count = regionWidgets.size() + regions.size();
+
+	if( count == 0 )
+		regionsLabel->setText(tr("whole frame"));
+	else
+		regionsLabel->setText(QString("%1 per capture").arg(count));
+}
+
+
+// onDrawRegions
+void ControlClassifyWidget::onDrawRegions( bool toggled )
+{
+	captureWindow->SetDrawing(toggled);
+}
+
+
+// onClearRegions
+void ControlClassifyWidget::onClearRegions()
+{
+	for( size_t n=0; n < regionWidgets.size(); n++ )
+		captureWindow->RemoveWidget(regionWidgets[n]);
+
+	regionWidgets.clear();
+	regions.clear();
+
+	updateRegions();
+}
+
+
+// hideEvent
+void ControlClassifyWidget::hideEvent( QHideEvent* event )
+{
+	// the regions are only on the canvas while the widget is shown
+	regions = getRegions();
+
+	for( size_t n=0; n < regionWidgets.size(); n++ )
+		captureWindow->RemoveWidget(regionWidgets[n]);
+
+	regionWidgets.clear();
+	captureWindow->SetDrawing(false);
+}
+
+
+// showEvent
+void ControlClassifyWidget::showEvent( QShowEvent* event )
+{
+	addingRegion = true;
+
+	for( size_t n=0; n < regions.size(); n++ )
+	{
+		glWidget* widget = captureWindow->AddWidget(new glWidget(regions[n].x, regions[n].y, regions[n].z, regions[n].w));
+
+		if( widget != NULL )
+			addRegion(widget);
+	}
+
+	addingRegion = false;
+
+	regions.clear();
+	captureWindow->SetDrawing(regionsButton->isChecked());
+}
+
+
+// updateSaveSettings
+void ControlClassifyWidget::updateSaveSettings()
+{
+	if( !saveController.Update(saveQueue->GetDepth(), saveQueue->GetCapacity(), currentTime()) )
 		return;
+
+	const SaveSettings& settings = saveController.GetSettings();
+	const QString msg = QString("%1, JPEG quality %2 (%3), auto-capture every %4 ms").arg((settings.level > 0) ? "the disk can't keep up" : "the disk is keeping up")
+					.arg(settings.quality).arg(SaveController::Chroma(settings.quality)).arg(settings.interval * 1000.0, 0, 'f', 0);
+
+	printf("camera-capture:  %s (%.1f MB/s written)\n", msg.toUtf8().constData(), saveQueue->GetThroughput() / (1024.0 * 1024.0));
+
+	qualityLabel->setText((settings.level > 0) ? QString("%1 (%2)").arg(qualitySlider->value()).arg(settings.quality) : QString::number(qualitySlider->value()));
+	statusBar->showMessage(QString(STATUS_MSG) + msg);
+}
+
+
+// checkFreeSpace
+bool ControlClassifyWidget::checkFreeSpace()
+{
+	// the frames that are still queued (or staged) will take up space too
+	uint64_t freeSpace = saveQueue->GetFreeSpace();
+
+	if( diskFull )
+		freeSpace = SaveQueue::FreeSpace(datasetPath);	// the space may have been freed since
+
+	if( freeSpace == UINT64_MAX || freeSpace >= minFreeSpace + saveQueue->GetPendingBytes() + DatasetStaging::GetPendingBytes() )
+	{
+		diskFull = false;
+		return true;
 	}
 
-	const int numFiles = QDir(directory.c_str()).count() - 2;
-	statusBar->showMessage(QString(STATUS_MSG "%1 images in %2").arg(QString::number(numFiles), QString::fromStdString(subdirPath)));
+	if( !diskFull )
+	{
+		printf("camera-capture:  %s is almost full (%llu MB free), stopped capturing\n", datasetPath.c_str(), (unsigned long long)(freeSpace / (1024 * 1024)));
+
+		// stop capturing on its own, the operator can still capture manually once space is freed
+		autoCheckbox->setChecked(false);
+		diskFull = true;
+	}
+
+	statusBar->showMessage(QString(STATUS_MSG "the disk is almost full (%1 MB free), free up space to keep capturing").arg(freeSpace / (1024 * 1024)));
+	return false;
 }
 
 
@@ -325,6 +867,9 @@ void ControlClassifyWidget::onCapture()
 void ControlClassifyWidget::onQualityChanged( int value )
 {
 	qualityLabel->setText(QString::number(value));
+
+	// the quality is only lowered from the one that's selected
+	saveController.Configure(value, minQuality, autoInterval, maxAutoInterval);
 }
 
 
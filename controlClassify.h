@@ -27,6 +27,10 @@
 
 #include "commandLine.h"
 #include "captureWindow.h"
+#include "controlGeometry.h"
+#include "prelabelProvider.h"
+#include "diversityIndex.h"
+#include "saveQueue.h"
 
 
 /*
@@ -45,13 +49,35 @@ public:
 
 public slots:
 	void onCapture();
+	void onBurst();
 	void onQualityChanged( int value );
+	void onDrawRegions( bool toggled );
+	void onClearRegions();
 
 	void selectDatasetPath();
 	void selectLabelFile();
 
 protected:
 	void createDatasetDirectories();
+	void suggestClass( const PrelabelResult& result );
+	void autoCapture( uchar3* image, int width, int height );
+	void burstCapture( uchar3* image, int width, int height );
+	void freeBurst();
+
+	void updateSaveSettings();
+	bool checkFreeSpace();
+
+	bool saveFrame( uchar3* image, int width, int height, const FrameSignature& signature );
+
+	void hideEvent( QHideEvent* event );
+	void showEvent( QShowEvent* event );
+
+	void addRegion( glWidget* widget );
+	void updateRegions();
+	std::vector<float4> getRegions() const;
+
+	static void onCaptureFrame( uchar3* image, int width, int height, void* user );
+	static bool onCaptureEvent( uint16_t event, int a, int b, void* user );
 
 	CaptureWindow* captureWindow;
 	QStatusBar*    statusBar;
@@ -67,7 +93,51 @@ protected:
 	QLabel*     qualityLabel;
 	QSlider*    qualitySlider;
 
+	// the frames are saved at the output geometry
+	ControlGeometryWidget* geometryWidget;
+
+	// regions drawn on the camera feed, each capture saves a crop of every region (optional)
+	QPushButton* regionsButton;
+	QLabel*      regionsLabel;
+
+	std::vector<glWidget*> regionWidgets;	// while the widget is shown
+	std::vector<float4>    regions;		// (x, y, width, height) while it's hidden
+	bool                   addingRegion;
+
 	QPushButton* captureButton;
+
+	// pre-selects the class of the live frame (optional)
+	PrelabelWorker* prelabel;
+	QCheckBox*      suggestCheckbox;
+
+	// only captures the frames that add coverage to the dataset
+	DiversityIndex  diversity;
+	QCheckBox*      autoCheckbox;
+	QDoubleSpinBox* noveltySpinbox;
+	QPushButton*    burstButton;
+	QLabel*         noveltyLabel;
+
+	double autoInterval;	// minimum seconds between auto-captures
+	double autoTime;	// time of the last auto-capture
+
+	// frames of a burst, the most novel of them are saved
+	std::vector<uchar3*>        burstImages;
+	std::vector<FrameSignature> burstSignatures;
+
+	int burstWidth;
+	int burstHeight;
+	int burstFrames;	// frames in a burst
+	int burstCount;	// maximum frames saved from a burst
+	int burstRemaining;
+
+	// writes the frames in the background, and lowers the quality/rate when the disk can't keep up
+	SaveQueue*     saveQueue;
+	SaveController saveController;
+
+	int      minQuality;		// bounds of the adjustments
+	double   maxAutoInterval;
+	uint64_t minFreeSpace;		// the capture stops when the free space drops below this (in bytes)
+	bool     diskFull;
 };
 
 
@@ -21,29 +21,44 @@
  */
 
 #include "controlDetection.h"
+#include "datasetWriter.h"
+#include "syntheticSource.h"
+#include "sessionLog.h"
+#include "metrics.h"
 
 #include "detectNet.h"
 
 #include "glEvents.h"
 #include "glWidget.h"
 
-#include "xml.h"
-
-using namespace tinyxml2;
-
 
 #define STATUS_MSG "Status - "
 #define SELECT_LABEL_FILE_MSG STATUS_MSG "select output dataset path and label file"
 #define DEFAULT_JPEG_QUALITY 95
 
-#define BBOX_PROPERTY  "bboxIndex"
-#define COORD_PROPERTY "coordIndex"
+#define BOX_LINE_WIDTH          4.0f
+#define BOX_SELECTED_LINE_WIDTH 7.0f
+#define BOX_PROPOSED_COLOR      0.85f
 
 
 // constructor
 ControlDetectionWidget::ControlDetectionWidget( commandLine* cmdLine, CaptureWindow* capture )
 {
-	captureWindow = capture;
+	captureWindow  = capture;
+	classModel     = new QStringListModel(this);
+	annotations    = new AnnotationModel();
+	createdWidget  = NULL;
+	addingWidget   = false;
+	updatingWidget = false;
+	hoveredBox     = 0;
+	hovering       = false;
+	rubberBand     = NULL;
+	tracker        = new ObjectTracker();
+	prelabel       = NULL;
+	session        = NULL;
+	lastInputTime  = 0;
+
+	annotations->AddEventHandler(ControlDetectionWidget::onAnnotationEvent, this);
 
 	/*
 	 * create layout
@@ -126,23 +141,61 @@ ControlDetectionWidget::ControlDetectionWidget( commandLine* cmdLine, CaptureWin
 
 	layout->addLayout(qualityLayout);
 
+
+	// output geometry
+	geometryWidget = new ControlGeometryWidget(cmdLine, captureWindow);
+	layout->addWidget(geometryWidget);
+
 	
 	// object list
-	bboxTable = new QTableWidget();
+	bboxModel = new BoundingBoxModel(annotations, classModel, this);
+	bboxTable = new QTableView();
 
-	const int numColumns = 6;
 	const int coordColumnWidth = 65;
 
+	bboxTable->setModel(bboxModel);
+	bboxTable->setItemDelegate(new BoundingBoxDelegate(classModel, bboxTable));
+	bboxTable->setEditTriggers(QAbstractItemView::CurrentChanged | QAbstractItemView::SelectedClicked | QAbstractItemView::DoubleClicked);
+	bboxTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+	bboxTable->setSelectionMode(QAbstractItemView::ExtendedSelection);
 	bboxTable->setMinimumHeight(125);
-	bboxTable->setColumnCount(numColumns);
-	bboxTable->setHorizontalHeaderLabels( { "Class", "x", "y", "Width", "Height", "Delete" } );
 
-	for( int n=1; n < numColumns; n++ )
+	for( int n=BoundingBoxModel::XColumn; n < BoundingBoxModel::NumColumns; n++ )
 		bboxTable->setColumnWidth(n, coordColumnWidth);
 
+	connect(bboxTable, SIGNAL(clicked(const QModelIndex&)), this, SLOT(onBoxClicked(const QModelIndex&)));
+	connect(bboxTable->selectionModel(), SIGNAL(selectionChanged(const QItemSelection&, const QItemSelection&)),
+		   this, SLOT(onSelectionChanged(const QItemSelection&, const QItemSelection&)));
+
 	layout->addWidget(bboxTable);
 
 
+	// selection tools
+	QHBoxLayout* selectionLayout = new QHBoxLayout();
+
+	selectButton = new QPushButton("Select (B)");
+
+	selectButton->setCheckable(true);
+	selectButton->setShortcut(QKeySequence(Qt::Key_B));
+	selectButton->setToolTip(tr("While checked, dragging on the camera feed selects the boxes inside the drag rectangle"));
+
+	selectionClass = BoundingBoxDelegate::CreateClassDropdown(classModel);
+	selectionClass->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
+
+	QPushButton* selectionClassButton = new QPushButton("Set Class");
+	QPushButton* selectionRemoveButton = new QPushButton("Delete");
+
+	connect(selectionClassButton, SIGNAL(clicked()), this, SLOT(onSelectionClass()));
+	connect(selectionRemoveButton, SIGNAL(clicked()), this, SLOT(onSelectionRemove()));
+
+	selectionLayout->addWidget(selectButton);
+	selectionLayout->addWidget(selectionClass);
+	selectionLayout->addWidget(selectionClassButton);
+	selectionLayout->addWidget(selectionRemoveButton);
+
+	layout->addLayout(selectionLayout);
+
+
 	// option checkboxes
 	saveOnUnfreeze = new QCheckBox("Save on Unfreeze");
 	clearOnUnfreeze = new QCheckBox("Clear on Unfreeze");
@@ -159,6 +212,33 @@ ControlDetectionWidget::ControlDetectionWidget( commandLine* cmdLine, CaptureWin
 
 	layout->addLayout(optionsLayout);
 
+	// pre-labeling options
+	trackOnUnfreeze = new QCheckBox("Track Boxes");
+	proposeOnFreeze = new QCheckBox("Propose Boxes");
+
+	trackOnUnfreeze->setToolTip(tr("Keep the boxes on unfreeze and track them in the camera feed until the next freeze"));
+	proposeOnFreeze->setToolTip(tr("On freeze, propose boxes around the objects that differ from the background"));
+
+	connect(proposeOnFreeze, SIGNAL(toggled(bool)), this, SLOT(onProposalsToggled(bool)));
+
+	QPushButton* proposalsAcceptButton = new QPushButton("Accept");
+	QPushButton* proposalsRejectButton = new QPushButton("Reject");
+
+	proposalsAcceptButton->setToolTip(tr("Accept the selected proposals (or all of them if none are selected)"));
+	proposalsRejectButton->setToolTip(tr("Reject the selected proposals (or all of them if none are selected)"));
+
+	connect(proposalsAcceptButton, SIGNAL(clicked()), this, SLOT(onProposalsAccept()));
+	connect(proposalsRejectButton, SIGNAL(clicked()), this, SLOT(onProposalsReject()));
+
+	QHBoxLayout* prelabelLayout = new QHBoxLayout();
+
+	prelabelLayout->addWidget(trackOnUnfreeze);
+	prelabelLayout->addWidget(proposeOnFreeze);
+	prelabelLayout->addWidget(proposalsAcceptButton);
+	prelabelLayout->addWidget(proposalsRejectButton);
+
+	layout->addLayout(prelabelLayout);
+
 	// freeze button
 	freezeButton = new QPushButton("Freeze/Edit (space)");
 
@@ -184,6 +264,30 @@ ControlDetectionWidget::ControlDetectionWidget( commandLine* cmdLine, CaptureWin
 	layout->addLayout(buttonLayout);
 
 
+	// saved samples
+	QHBoxLayout* samplesLayout = new QHBoxLayout();
+
+	QPushButton* prevSampleButton = new QPushButton("< Prev Saved");
+	QPushButton* nextSampleButton = new QPushButton("Next Saved >");
+	QPushButton* openSampleButton = new QPushButton("Open Saved...");
+
+	prevSampleButton->setShortcut(QKeySequence(Qt::Key_PageUp));
+	nextSampleButton->setShortcut(QKeySequence(Qt::Key_PageDown));
+
+	prevSampleButton->setToolTip(tr("Edit the previous saved sample (PgUp)"));
+	nextSampleButton->setToolTip(tr("Edit the next saved sample (PgDn)"));
+
+	connect(prevSampleButton, SIGNAL(clicked()), this, SLOT(onPrevSample()));
+	connect(nextSampleButton, SIGNAL(clicked()), this, SLOT(onNextSample()));
+	connect(openSampleButton, SIGNAL(clicked()), this, SLOT(onOpenSample()));
+
+	samplesLayout->addWidget(prevSampleButton);
+	samplesLayout->addWidget(nextSampleButton);
+	samplesLayout->addWidget(openSampleButton);
+
+	layout->addLayout(samplesLayout);
+
+
 	// status bar
 	statusBar = new QStatusBar();
 
@@ -192,20 +296,64 @@ ControlDetectionWidget::ControlDetectionWidget( commandLine* cmdLine, CaptureWin
 
 	layout->addWidget(statusBar);
 
+
+	// undo/redo
+	new QShortcut(QKeySequence::Undo, this, SLOT(onUndo()));
+	new QShortcut(QKeySequence::Redo, this, SLOT(onRedo()));
+
 	
 	// finish configuration
 	setLayout(layout);
 
 	glRegisterEvents(ControlDetectionWidget::onCaptureEvent, this);
+	captureWindow->AddFrameHandler(ControlDetectionWidget::onCaptureFrame, this);
+
+	// pre-label provider
+	PrelabelProvider* provider = PrelabelProvider::Create(cmdLine->GetString("prelabel-detection"));
+
+	if( provider != NULL )
+		prelabel = new PrelabelWorker(provider, cmdLine->GetInt("prelabel-timeout", PrelabelWorker::DefaultTimeout));
+
+	prelabelTimer = new QTimer(this);
+	prelabelTimer->setInterval(20);
+
+	connect(prelabelTimer, SIGNAL(timeout()), this, SLOT(onPrelabelTimer()));
+
+
+	// session recording (optional)
+	session = SessionRecorder::Create(cmdLine->GetString("session-record"));
+
+	if( session != NULL )
+	{
+		SyntheticSource* synthetic = captureWindow->GetSynthetic();
+
+		if( synthetic != NULL )
+			session->Record("source synthetic %i %i %s %i %i", synthetic->GetWidth(), synthetic->GetHeight(), SyntheticSource::FormatToStr(synthetic->GetFormat()),
+						 cmdLine->GetInt("synthetic-shapes", SyntheticSource::DefaultShapes), cmdLine->GetInt("synthetic-seed", 0));
+		else
+			session->Record("source frames");
 
+		// the model records its own calls, the key presses and clicks are recorded from every widget
+		annotations->SetRecorder(session);
+		qApp->installEventFilter(this);
+	}
 }
 
 
 // destructor
 ControlDetectionWidget::~ControlDetectionWidget()
 {
+	captureWindow->RemoveFrameHandler(ControlDetectionWidget::onCaptureFrame, this);
+	SAFE_DELETE(tracker);
+	SAFE_DELETE(prelabel);
 
+	if( session != NULL )
+		qApp->removeEventFilter(this);
 
+	// the table model is a view of the annotations, so release it first
+	SAFE_DELETE(bboxModel);
+	SAFE_DELETE(annotations);
+	SAFE_DELETE(session);
 }
 
 
@@ -223,217 +371,657 @@ void ControlDetectionWidget::showEvent( QShowEvent* event )
 }
 
 
+// eventFilter
+bool ControlDetectionWidget::eventFilter( QObject* object, QEvent* event )
+{
+	const QEvent::Type type = event->type();
+
+	if( type != QEvent::KeyPress && type != QEvent::ShortcutOverride && type != QEvent::MouseButtonPress )
+		return false;
+
+	// an input is passed through several objects (and shortcuts see it first), so
+	// it's only recorded once
+	QInputEvent* input = static_cast<QInputEvent*>(event);
+
+	if( input->timestamp() == lastInputTime )
+		return false;
+
+	lastInputTime = input->timestamp();
+
+	if( type == QEvent::MouseButtonPress )
+	{
+		QAbstractButton* button = qobject_cast<QAbstractButton*>(object);
+		session->Input("click", (button != NULL) ? button->text().toStdString() : object->metaObject()->className());
+	}
+	else
+	{
+		QKeyEvent* key = static_cast<QKeyEvent*>(event);
+
+		if( !key->isAutoRepeat() )
+			session->Input("key", QKeySequence(key->modifiers() | key->key()).toString().toStdString());
+	}
+
+	return false;
+}
+
+
 // onWidgetEvent
 bool ControlDetectionWidget::onWidgetEvent( glWidget* widget, uint16_t event, int a, int b, void* user )
 {
 	ControlDetectionWidget* control = (ControlDetectionWidget*)user;
 
+	if( !control || !control->widgetBoxes.contains(widget) )
+		return false;
+
+	if( control->updatingWidget )
+		return true;
+
 	if( event == WIDGET_MOVED || event == WIDGET_RESIZED )
-		control->updateBoxCoords(widget->GetIndex());
+	{
+		if( control->session != NULL )
+			control->session->Input("drag");
+
+		control->annotations->SetCoords(control->widgetBoxes.value(widget), widget->X(), widget->Y(), widget->Width(), widget->Height());
+	}
 
 	return true;
 }
 
 
+// onCaptureFrame
+void ControlDetectionWidget::onCaptureFrame( uchar3* image, int width, int height, void* user )
+{
+	ControlDetectionWidget* control = (ControlDetectionWidget*)user;
+
+	if( !control )
+		return;
+
+	// keep the background up-to-date with every frame
+	if( control->proposeOnFreeze->checkState() == Qt::Checked )
+		control->background.Process(image, width, height);
+
+	if( !control->tracker->IsTracking() )
+		return;
+
+	// move the boxes to where they were found in the last frame
+	if( control->tracker->GetResults(control->trackerResults) )
+	{
+		if( control->session != NULL )
+			control->session->Input("track");
+
+		control->annotations->BeginStep();
+
+		for( size_t n=0; n < control->trackerResults.size(); n++ )
+		{
+			const TrackerResult& result = control->trackerResults[n];
+			const BoundingBox* box = control->annotations->Get(result.id);
+
+			if( !result.found || !box )
+				continue;
+
+			control->annotations->SetCoords(result.id, result.x, result.y, box->width, box->height);
+		}
+
+		control->annotations->EndStep();
+	}
+
+	// queue the new frame for tracking
+	control->tracker->Process(image, width, height);
+}
+
+
 // onCaptureEvent
 bool ControlDetectionWidget::onCaptureEvent( uint16_t event, int a, int b, void* user )
 {
 	ControlDetectionWidget* control = (ControlDetectionWidget*)user;
 
-	if( !control )
+	// the other dataset widgets draw on the canvas too
+	if( !control || !control->isVisible() )
 		return false;
 
 	if( event == WIDGET_CREATED )
 	{
-		// object class drop-down
-		QComboBox* itemClass = new QComboBox();
+		if( control->addingWidget )
+			return true;
 
-		for( size_t n=0; n < control->classLabels.size(); n++ )
-			itemClass->addItem(QString::fromStdString(control->classLabels[n]));	
-
-		connect(itemClass, SIGNAL(currentIndexChanged(int)), control, SLOT(onBoxClass(int)));
-
-		control->bboxTable->setRowCount(a+1);
-		control->bboxTable->setCellWidget(a, 0, itemClass);
+		glWidget* widget = control->captureWindow->GetWidget(a);
 
-		// coordinate spinners
-		QDoubleSpinBox* spinBox[4];
+		if( !widget || control->widgetBoxes.contains(widget) || control->captureWindow->IsROI(widget) )
+			return false;
 
-		for( int n=0; n < 4; n++ )
+		// in select mode, the box being drawn is a rubber band
+		if( control->selectButton->isChecked() )
 		{
-			spinBox[n] = new QDoubleSpinBox();		
+			if( control->rubberBand != NULL )
+				return true;
 
-			spinBox[n]->setDecimals(1);	
-			spinBox[n]->setRange(n < 2 ? -9999.0 : 0.0, 9999.0);
-			spinBox[n]->setProperty(COORD_PROPERTY, n);
+			widget->SetLineColor(1.0f, 1.0f, 1.0f);
+			widget->SetLineWidth(1.0f);
 
-			connect(spinBox[n], SIGNAL(valueChanged(double)), control, SLOT(onBoxCoord(double)));
-			control->bboxTable->setCellWidget(a, n+1, spinBox[n]);
+			control->rubberBand = widget;
+			return true;
 		}
 
-		// remove button
-		QPushButton* removeButton = new QPushButton("X");
-		connect(removeButton, SIGNAL(pressed()), control, SLOT(onBoxRemove()));
-		control->bboxTable->setCellWidget(a, 5, removeButton);
+		// add the box drawn on the canvas to the model
+		if( control->session != NULL )
+			control->session->Input("draw");
 
-		// update properties
-		control->updateBoxIndices();
-		control->updateBoxCoords(a);
-		control->updateBoxColor(a,0);
+		control->createdWidget = widget;
+		control->annotations->Create(widget->X(), widget->Y(), widget->Width(), widget->Height(), 0);
+		control->createdWidget = NULL;
+	}
+	else if( event == MOUSE_BUTTON )
+	{
+		if( control->session != NULL )
+			control->session->Input("button", b ? "down" : "up");
 
-		// subscribe to widget events
-		glWidget* widget = control->captureWindow->GetWidget(a);
+		// a drag is one undo step
+		control->annotations->Seal();
 
-		widget->AddEventHandler(ControlDetectionWidget::onWidgetEvent, control);
-		widget->SetLineWidth(4.0f);
+		// finish the rubber band when the button is released (after the
+		// canvas is done dispatching events, since it removes the widget)
+		if( b == 0 && control->rubberBand != NULL )
+			QTimer::singleShot(0, control, SLOT(onRubberBand()));
+	}
+	else if( event == MOUSE_MOVE )
+	{
+		control->hoverBox(a, b);
 	}
 		
 	return true;
 }
 
 
-// clearBoxes
-bool ControlDetectionWidget::clearBoxes()
+// onAnnotationEvent
+void ControlDetectionWidget::onAnnotationEvent( uint16_t event, uint32_t id, int row, void* user )
 {
-	if( !bboxTable || !captureWindow )
-		return false;
+	ControlDetectionWidget* control = (ControlDetectionWidget*)user;
+
+	if( !control )
+		return;
 
-	bboxTable->setRowCount(0);
-	captureWindow->RemoveAllWidgets();
+	if( event == ANNOTATION_INSERTED )
+	{
+		const BoundingBox& box = control->annotations->GetAt(row);
 
-	return true;
+		control->boxIndex.Insert(box.id, box.x, box.y, box.width, box.height);
+		control->addBoxWidget(box, control->createdWidget);
+	}
+	else if( event == ANNOTATION_REMOVING )
+	{
+		control->boxIndex.Remove(id);
+		control->removeBoxWidget(id);
+	}
+	else if( event == ANNOTATION_CHANGED )
+	{
+		const BoundingBox& box = control->annotations->GetAt(row);
+
+		control->boxIndex.Insert(box.id, box.x, box.y, box.width, box.height);
+		control->updateBoxWidget(box);
+	}
+	else if( event == ANNOTATION_RESET )
+	{
+		control->captureWindow->RemoveAllWidgets();
+
+		control->boxWidgets.clear();
+		control->widgetBoxes.clear();
+		control->boxIndex.Clear();
+
+		control->rubberBand = NULL;
+		control->hovering   = false;
+
+		const int numBoxes = control->annotations->GetCount();
+
+		for( int n=0; n < numBoxes; n++ )
+		{
+			const BoundingBox& box = control->annotations->GetAt(n);
+
+			control->boxIndex.Insert(box.id, box.x, box.y, box.width, box.height);
+			control->addBoxWidget(box);
+		}
+	}
 }
 
 
-// onBoxRemove
-void ControlDetectionWidget::onBoxRemove()
+// addBoxWidget
+void ControlDetectionWidget::addBoxWidget( const BoundingBox& box, glWidget* widget )
 {
-	QPushButton* senderWidget = qobject_cast<QPushButton*>(sender());
+	if( !widget )
+	{
+		addingWidget = true;
+		widget = captureWindow->AddWidget(new glWidget(box.x, box.y, box.width, box.height));
+		addingWidget = false;
 
-	if( !senderWidget )
-		return;
+		if( !widget )
+			return;
 
-	const int bboxIndex = senderWidget->property(BBOX_PROPERTY).toInt();
+		widget->SetMoveable(true);
+		widget->SetResizeable(true);
+	}
+
+	boxWidgets.insert(box.id, widget);
+	widgetBoxes.insert(widget, box.id);
 
-	//printf("camera-capture:  on box removed => box %i\n", bboxIndex);
+	// subscribe to widget events
+	widget->AddEventHandler(ControlDetectionWidget::onWidgetEvent, this);
+	widget->SetLineWidth(BOX_LINE_WIDTH);
 
-	captureWindow->RemoveWidget(bboxIndex);
-	bboxTable->removeRow(bboxIndex);
-	updateBoxIndices();
+	updateBoxColor(widget, box);
 }
 
 
-// onBoxClass
-void ControlDetectionWidget::onBoxClass( int index )
+// removeBoxWidget
+void ControlDetectionWidget::removeBoxWidget( uint32_t id )
 {
-	QComboBox* senderWidget = qobject_cast<QComboBox*>(sender());
+	glWidget* widget = boxWidgets.value(id, NULL);
 
-	if( !senderWidget )
+	if( !widget )
 		return;
 
-	const int bboxIndex = senderWidget->property(BBOX_PROPERTY).toInt();
-	//printf("camera-capture:  on class changed => box %i, class %i\n", bboxIndex, index);
-	updateBoxColor(bboxIndex, index);
+	boxWidgets.remove(id);
+	widgetBoxes.remove(widget);
+
+	captureWindow->RemoveWidget(widget);
 }
 
 
-// onBoxCoord
-void ControlDetectionWidget::onBoxCoord( double value )
+// updateBoxWidget
+void ControlDetectionWidget::updateBoxWidget( const BoundingBox& box )
 {
-	QDoubleSpinBox* senderWidget = qobject_cast<QDoubleSpinBox*>(sender());
+	glWidget* widget = boxWidgets.value(box.id, NULL);
 
-	if( !senderWidget )
+	if( !widget )
 		return;
 
-	const int bboxIndex = senderWidget->property(BBOX_PROPERTY).toInt();
-	const int coordIndex = senderWidget->property(COORD_PROPERTY).toInt();
+	// skip the coordinates if the change came from this widget
+	if( widget->X() != box.x || widget->Y() != box.y || widget->Width() != box.width || widget->Height() != box.height )
+	{
+		// the widget events aren't edits (and a recorded session replays without them)
+		updatingWidget = true;
 
-	//printf("camera-capture:  on coord changed => box %i, coord %i, %f\n", bboxIndex, coordIndex, (float)value);
+		widget->SetX(box.x);
+		widget->SetY(box.y);
+		widget->SetWidth(box.width);
+		widget->SetHeight(box.height);
 
-	glWidget* widget = captureWindow->GetWidget(bboxIndex);
+		updatingWidget = false;
+	}
 
-	if( coordIndex == 0 )
-		widget->SetX(value);
-	else if( coordIndex == 1 )
-		widget->SetY(value);
-	else if( coordIndex == 2 )
-		widget->SetWidth(value);
-	else if( coordIndex == 3 )
-		widget->SetHeight(value);
+	updateBoxColor(widget, box);
 }
 
 
-// updateBoxColor
-void ControlDetectionWidget::updateBoxColor( uint32_t index, uint32_t classID )
+// clearBoxes
+bool ControlDetectionWidget::clearBoxes()
 {
-	glWidget* widget = captureWindow->GetWidget(index);
-	const float4 color = detectNet::GenerateColor(classID);
-	widget->SetLineColor(color.x/255.0f, color.y/255.0f, color.z/255.0f);
+	if( !annotations || !captureWindow )
+		return false;
+
+	annotations->Reset();
+	return true;
+}
+
+
+// onBoxClicked
+void ControlDetectionWidget::onBoxClicked( const QModelIndex& index )
+{
+	if( !index.isValid() || index.column() != BoundingBoxModel::DeleteColumn )
+		return;
+
+	//printf("camera-capture:  on box removed => row %i\n", index.row());
+	annotations->Remove(annotations->GetAt(index.row()).id);
+}
+
+
+// onUndo
+void ControlDetectionWidget::onUndo()
+{
+	annotations->Undo();
 }
 
 
-// updateBoxCoords
-void ControlDetectionWidget::updateBoxCoords( uint32_t index )
+// onRedo
+void ControlDetectionWidget::onRedo()
 {
-	glWidget* box = captureWindow->GetWidget(index);
+	annotations->Redo();
+}
+
+
+// hoverBox
+void ControlDetectionWidget::hoverBox( float x, float y )
+{
+	uint32_t id = 0;
+
+	if( !boxIndex.Pick(x, y, &id) )
+	{
+		hovering = false;
+		return;
+	}
+
+	if( hovering && id == hoveredBox )
+		return;
+
+	const BoundingBox* box = annotations->Get(id);
 
 	if( !box )
 		return;
 
-	QDoubleSpinBox* x = qobject_cast<QDoubleSpinBox*>(bboxTable->cellWidget(index,1));
-	QDoubleSpinBox* y = qobject_cast<QDoubleSpinBox*>(bboxTable->cellWidget(index,2));
-	QDoubleSpinBox* w = qobject_cast<QDoubleSpinBox*>(bboxTable->cellWidget(index,3));
-	QDoubleSpinBox* h = qobject_cast<QDoubleSpinBox*>(bboxTable->cellWidget(index,4));
+	hoveredBox = id;
+	hovering   = true;
+
+	statusBar->showMessage(QString(STATUS_MSG "box %1 '%2' (%3, %4, %5, %6)").arg(annotations->Find(id)).arg(bboxModel->GetClassLabel(box->classID))
+					   .arg(box->x, 0, 'f', 1).arg(box->y, 0, 'f', 1).arg(box->width, 0, 'f', 1).arg(box->height, 0, 'f', 1));
+}
+
 
-	if( !x || !y || !w || !h )
+// onRubberBand
+void ControlDetectionWidget::onRubberBand()
+{
+	if( !rubberBand )
 		return;
 
-	x->setValue( box->X() );
-	y->setValue( box->Y() );
-	w->setValue( box->Width() );
-	h->setValue( box->Height() );
+	const float x = rubberBand->X();
+	const float y = rubberBand->Y();
+	const float w = rubberBand->Width();
+	const float h = rubberBand->Height();
+
+	captureWindow->RemoveWidget(rubberBand);
+	rubberBand = NULL;
+
+	selectBoxes(x, y, w, h);
 }
 
 
-// updateBoxIndices
-void ControlDetectionWidget::updateBoxIndices()
+// selectBoxes
+void ControlDetectionWidget::selectBoxes( float x, float y, float width, float height )
 {
-	const int numRows = bboxTable->rowCount();
-	const int numColumns = bboxTable->columnCount();
+	std::vector<uint32_t> ids;
+	boxIndex.Query(x, y, width, height, ids, true);
 
-	for( int y=0; y < numRows; y++ )
+	// build the whole selection before applying it, so the views update once
+	QItemSelection selection;
+
+	for( size_t n=0; n < ids.size(); n++ )
 	{
-		for( int x=0; x < numColumns; x++ )
-		{
-			QWidget* widget = bboxTable->cellWidget(y,x);
+		const int row = annotations->Find(ids[n]);
 
-			if( !widget )
-				continue;
+		if( row >= 0 )
+			selection.select(bboxModel->index(row, 0), bboxModel->index(row, BoundingBoxModel::NumColumns - 1));
+	}
 
-			widget->setProperty(BBOX_PROPERTY, y);
-		}
+	bboxTable->selectionModel()->select(selection, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
+	statusBar->showMessage(QString(STATUS_MSG "selected %1 boxes").arg(ids.size()));
+}
+
+
+// selectedBoxes
+std::vector<uint32_t> ControlDetectionWidget::selectedBoxes() const
+{
+	const QModelIndexList rows = bboxTable->selectionModel()->selectedRows();
+	std::vector<uint32_t> ids;
+
+	ids.reserve(rows.size());
+
+	for( int n=0; n < rows.size(); n++ )
+	{
+		if( rows[n].row() < annotations->GetCount() )
+			ids.push_back(annotations->GetAt(rows[n].row()).id);
 	}
+
+	return ids;
+}
+
+
+// onSelectionChanged
+void ControlDetectionWidget::onSelectionChanged( const QItemSelection& selected, const QItemSelection& deselected )
+{
+	updateBoxSelection(deselected, false);
+	updateBoxSelection(selected, true);
 }
 
 
-// makeDir
-bool ControlDetectionWidget::makeDir( QDir& root, const QString& subdir )
+// updateBoxSelection
+void ControlDetectionWidget::updateBoxSelection( const QItemSelection& selection, bool selected )
 {
-	if( !root.exists(subdir) )
+	const int numRanges = selection.size();
+
+	for( int n=0; n < numRanges; n++ )
 	{
-		if( !root.mkpath(subdir) ) //mkdir(subdir) )
+		const int top    = selection[n].top();
+		const int bottom = qMin(selection[n].bottom(), annotations->GetCount() - 1);
+
+		for( int row=top; row <= bottom; row++ )
 		{
-			const QString msg = QString("Failed to create dataset subdirectory '%1/'").arg(subdir);
-			QMessageBox::critical(this, tr("Error Creating Dataset Directories"), msg);
-			statusBar->showMessage(QString(STATUS_MSG) + msg);
-			return false;
+			glWidget* widget = boxWidgets.value(annotations->GetAt(row).id, NULL);
+
+			if( widget != NULL )
+				widget->SetLineWidth(selected ? BOX_SELECTED_LINE_WIDTH : BOX_LINE_WIDTH);
 		}
 	}
-	
+}
+
+
+// onSelectionClass
+void ControlDetectionWidget::onSelectionClass()
+{
+	const int classID = selectionClass->currentIndex();
+
+	if( classID < 0 )
+		return;
+
+	const std::vector<uint32_t> ids = selectedBoxes();
+
+	annotations->BeginStep();
+
+	for( size_t n=0; n < ids.size(); n++ )
+		annotations->SetClass(ids[n], classID);
+
+	annotations->EndStep();
+}
+
+
+// onSelectionRemove
+void ControlDetectionWidget::onSelectionRemove()
+{
+	const std::vector<uint32_t> ids = selectedBoxes();
+
+	annotations->BeginStep();
+
+	for( size_t n=0; n < ids.size(); n++ )
+		annotations->Remove(ids[n]);
+
+	annotations->EndStep();
+}
+
+
+// onProposalsToggled
+void ControlDetectionWidget::onProposalsToggled( bool checked )
+{
+	// the background is only updated while proposals are enabled
+	background.Reset();
+}
+
+
+// proposeBoxes
+void ControlDetectionWidget::proposeBoxes()
+{
+	std::vector<BackgroundProposal> proposals;
+
+	if( !background.Propose(proposals) )
+	{
+		statusBar->showMessage(tr(STATUS_MSG "the background model is still warming up"));
+		return;
+	}
+
+	annotations->BeginStep();
+
+	int numProposed = 0;
+
+	for( size_t n=0; n < proposals.size(); n++ )
+	{
+		if( addProposal(proposals[n].x, proposals[n].y, proposals[n].width, proposals[n].height, qMax(selectionClass->currentIndex(), 0)) )
+			numProposed++;
+	}
+
+	annotations->EndStep();
+
+	statusBar->showMessage(QString(STATUS_MSG "proposed %1 boxes").arg(numProposed));
+}
+
+
+// addProposal
+bool ControlDetectionWidget::addProposal( float x, float y, float width, float height, int classID )
+{
+	// skip the objects that already have a box (i.e. tracked ones)
+	std::vector<uint32_t> overlaps;
+	boxIndex.Query(x, y, width, height, overlaps);
+
+	for( size_t n=0; n < overlaps.size(); n++ )
+	{
+		const BoundingBox* box = annotations->Get(overlaps[n]);
+
+		if( !box )
+			continue;
+
+		const float ix = qMin(box->x + box->width, x + width) - qMax(box->x, x);
+		const float iy = qMin(box->y + box->height, y + height) - qMax(box->y, y);
+
+		if( ix <= 0.0f || iy <= 0.0f )
+			continue;
+
+		const float intersection = ix * iy;
+		const float areaUnion = box->width * box->height + width * height - intersection;
+
+		if( intersection >= areaUnion * 0.5f )
+			return false;
+	}
+
+	annotations->Create(x, y, width, height, classID, BOX_PROPOSED);
 	return true;
 }
 
 
+// onPrelabelTimer
+void ControlDetectionWidget::onPrelabelTimer()
+{
+	PrelabelResult result;
+
+	if( !prelabel->GetResult(result) )
+	{
+		if( !prelabel->IsBusy() )
+			prelabelTimer->stop();
+
+		return;
+	}
+
+	prelabelTimer->stop();
+
+	if( session != NULL )
+		session->Input("prelabel");
+
+	if( !result.completed )
+	{
+		statusBar->showMessage(tr(STATUS_MSG "pre-labeling failed or missed the deadline"));
+		return;
+	}
+
+	annotations->BeginStep();
+
+	int numProposed = 0;
+
+	for( size_t n=0; n < result.boxes.size(); n++ )
+	{
+		const PrelabelBox& box = result.boxes[n];
+		const int classID = PrelabelProvider::MapClass(box.classID, box.label, classLabels);
+
+		// skip the classes that aren't in the dataset
+		if( classID < 0 && classLabels.size() > 0 )
+			continue;
+
+		if( addProposal(box.x, box.y, box.width, box.height, qMax(classID, 0)) )
+			numProposed++;
+	}
+
+	annotations->EndStep();
+
+	statusBar->showMessage(QString(STATUS_MSG "pre-labeled %1 boxes").arg(numProposed));
+}
+
+
+// selectedProposals
+std::vector<uint32_t> ControlDetectionWidget::selectedProposals() const
+{
+	const std::vector<uint32_t> ids = selectedBoxes();
+	std::vector<uint32_t> proposals;
+
+	for( size_t n=0; n < ids.size(); n++ )
+	{
+		const BoundingBox* box = annotations->Get(ids[n]);
+
+		if( box != NULL && (box->flags & BOX_PROPOSED) )
+			proposals.push_back(ids[n]);
+	}
+
+	if( proposals.size() > 0 )
+		return proposals;
+
+	// use all the proposals if none of them are selected
+	const int numBoxes = annotations->GetCount();
+
+	for( int n=0; n < numBoxes; n++ )
+	{
+		const BoundingBox& box = annotations->GetAt(n);
+
+		if( box.flags & BOX_PROPOSED )
+			proposals.push_back(box.id);
+	}
+
+	return proposals;
+}
+
+
+// onProposalsAccept
+void ControlDetectionWidget::onProposalsAccept()
+{
+	const std::vector<uint32_t> ids = selectedProposals();
+
+	annotations->BeginStep();
+
+	for( size_t n=0; n < ids.size(); n++ )
+		annotations->SetFlags(ids[n], annotations->Get(ids[n])->flags & ~BOX_PROPOSED);
+
+	annotations->EndStep();
+}
+
+
+// onProposalsReject
+void ControlDetectionWidget::onProposalsReject()
+{
+	const std::vector<uint32_t> ids = selectedProposals();
+
+	annotations->BeginStep();
+
+	for( size_t n=0; n < ids.size(); n++ )
+		annotations->Remove(ids[n]);
+
+	annotations->EndStep();
+}
+
+
+// updateBoxColor
+void ControlDetectionWidget::updateBoxColor( glWidget* widget, const BoundingBox& box )
+{
+	if( box.flags & BOX_PROPOSED )
+	{
+		widget->SetLineColor(BOX_PROPOSED_COLOR, BOX_PROPOSED_COLOR, BOX_PROPOSED_COLOR);
+		return;
+	}
+
+	const float4 color = detectNet::GenerateColor(box.classID);
+	widget->SetLineColor(color.x/255.0f, color.y/255.0f, color.z/255.0f);
+}
+
+
 // createDatasetDirectories
 bool ControlDetectionWidget::createDatasetDirectories()
 {
@@ -442,12 +1030,11 @@ bool ControlDetectionWidget::createDatasetDirectories()
 		return false;
 
 	// create root structure
-	QDir root(QString::fromStdString(datasetPath));
-
-	if( !makeDir(root, "Annotations") ||
-	    !makeDir(root, "ImageSets/Main") ||
-	    !makeDir(root, "JPEGImages") )
+	if( !DatasetWriter::CreateDetectionDirectories(datasetPath) )
 	{
+		const QString msg = QString("Failed to create dataset subdirectories in '%1/'").arg(QString::fromStdString(datasetPath));
+		QMessageBox::critical(this, tr("Error Creating Dataset Directories"), msg);
+		statusBar->showMessage(QString(STATUS_MSG) + msg);
 		return false;
 	}
 
@@ -464,11 +1051,39 @@ void ControlDetectionWidget::selectDatasetPath()
 	if( qPath.size() == 0 )
 		return;
 
+	// the saved samples and restored frames belong to the previous dataset
+	if( openSample != NULL || restoredFrame != NULL )
+		freezeButton->setChecked(false);
+
 	datasetPath = qPath.toUtf8().constData();
 
+	// the replay writes to its own directory, so only the name is recorded (it's in the annotations)
+	if( session != NULL )
+		session->Record("dataset %s", SessionRecorder::Escape(QDir(qPath).dirName().toStdString()).c_str());
+
 	// make sure the directories exist
 	createDatasetDirectories();
 
+	// the size the samples are saved at
+	geometryWidget->Open(datasetPath);
+
+	// list the samples that were already saved
+	samples.Open(datasetPath);
+
+	// restore the edits that weren't saved the last time, or
+	// move the journal of the frame being edited to this dataset
+	const bool frozen = freezeButton->isChecked();
+
+	if( frozen )
+		journal.End();
+
+	journal.Open(datasetPath + "/.annotations.journal");
+
+	if( frozen )
+		journal.Begin(annotations, captureWindow->GetImage(), captureWindow->GetCameraWidth(), captureWindow->GetCameraHeight());
+	else
+		restoreJournal();
+
 	// enable capture button
 	//if( datasetPath.size() > 0 && labelPath.size() > 0 )
 	//	freezeButton->setEnabled(true);
@@ -507,7 +1122,8 @@ void ControlDetectionWidget::selectLabelFile()
 		return;
 	}
 
-	// TODO update existing label drop-downs in grid	
+	updateClassLabels();
+
 	statusBar->showMessage(QString(STATUS_MSG "loaded %1 class labels").arg(classLabels.size()));
 
 	// enable capture button
@@ -529,116 +1145,148 @@ void ControlDetectionWidget::selectLabelFile()
 }
 
 
-// xmlAddElement
-inline XMLElement* xmlAddElement( XMLDocument& doc, XMLNode* parent, const char* elementName )
+// updateClassLabels
+void ControlDetectionWidget::updateClassLabels()
 {
-	XMLElement* element = doc.NewElement(elementName);
-	parent->InsertEndChild(element);
-	return element;
-}
+	QStringList classList;
+	classList.reserve(classLabels.size());
 
+	for( size_t n=0; n < classLabels.size(); n++ )
+		classList.append(QString::fromStdString(classLabels[n]));
 
-// xmlAddElement
-template<typename T> XMLElement* xmlAddElement( XMLDocument& doc, XMLNode* parent, const char* elementName, T elementValue )
-{
-	XMLElement* element = xmlAddElement(doc, parent, elementName);
-	element->SetText(elementValue);
-	return element;
+	// the box table and drop-downs all view this model, so they update at once
+	classModel->setStringList(classList);
+
+	if( session != NULL )
+	{
+		std::string labels;
+
+		for( size_t n=0; n < classLabels.size(); n++ )
+			labels += " " + SessionRecorder::Escape(classLabels[n]);
+
+		session->Record("labels %zu%s", classLabels.size(), labels.c_str());
+	}
 }
 
 
 // saveFrame
 bool ControlDetectionWidget::saveFrame()
 {
-	printf("camera-capture:  saving frame...\n");
+	METRICS_SCOPE("save_frame", "time to save a sample (the image, annotations, and image sets)");
 
-	const std::string datasetName = QDir(QString::fromStdString(datasetPath)).dirName().toStdString();
-	const std::string timestamp   = QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss").toUtf8().constData();
-	const std::string imgFilename = timestamp + ".jpg";
-	const std::string imgPath     = datasetPath + "/JPEGImages/" + imgFilename;
-	const std::string xmlPath     = datasetPath + "/Annotations/" + timestamp + ".xml";
-	
-	// save the image
-	if( !captureWindow->Save(imgPath.c_str()) )
+	// saved samples are edited in place
+	if( openSample != NULL )
 	{
-		statusBar->showMessage(QString(STATUS_MSG "failed to save ") + QString::fromStdString(imgFilename));
-		return false;
-	}
+		const std::string datasetName = QDir(QString::fromStdString(datasetPath)).dirName().toStdString();
+		const std::string xmlPath = DatasetWriter::AnnotationPath(datasetPath, openSample->name);
 
-	// create annotation XML
-	XMLDocument doc;
+		printf("camera-capture:  saving %s\n", xmlPath.c_str());
 
-	XMLNode* root = doc.NewElement("annotation");
-	doc.InsertFirstChild(root);
+		// the staged copy would replace the edits once it's migrated
+		if( DatasetStaging::Locate(xmlPath) != xmlPath )
+			DatasetStaging::Flush();
 
-	xmlAddElement(doc, root, "filename", imgFilename.c_str());
-	xmlAddElement(doc, root, "folder", datasetName.c_str());
-	
-	XMLElement* source = xmlAddElement(doc, root, "source");
-	
-	xmlAddElement(doc, source, "database", datasetName.c_str());
-	xmlAddElement(doc, source, "annotation", "custom");
-	xmlAddElement(doc, source, "image", "custom");
+		if( !annotations->SaveVOC(xmlPath.c_str(), openSample->annotation.filename.c_str(), datasetName.c_str(),
+							 openSample->width, openSample->height, classLabels) )
+		{
+			statusBar->showMessage(QString(STATUS_MSG "failed to save ") + QString::fromStdString(xmlPath));
+			return false;
+		}
 
-	XMLElement* size = xmlAddElement(doc, root, "size");
+		samples.Invalidate(openSample->name);
 
-	xmlAddElement(doc, size, "width", captureWindow->GetCameraWidth());
-	xmlAddElement(doc, size, "height", captureWindow->GetCameraHeight());
-	xmlAddElement(doc, size, "depth", 3);
-	xmlAddElement(doc, root, "segmented", 0);
+		if( session != NULL )
+			session->Record("resave %s %s %s %i %i", SessionRecorder::Escape(openSample->name).c_str(), SessionRecorder::Escape(openSample->annotation.filename).c_str(),
+						 SessionRecorder::Escape(datasetName).c_str(), openSample->width, openSample->height);
 
-	// add bounding boxes to XML
-	const int numBoxes = bboxTable->rowCount();
+		return true;
+	}
 
-	for( int n=0; n < numBoxes; n++ )
-	{
-		XMLElement* object = xmlAddElement(doc, root, "object");
+	printf("camera-capture:  saving frame...\n");
 
-		xmlAddElement(doc, object, "name", qPrintable(qobject_cast<QComboBox*>(bboxTable->cellWidget(n,0))->currentText()));
-		xmlAddElement(doc, object, "pose", "unspecified");
-		xmlAddElement(doc, object, "truncated", "0");
-		xmlAddElement(doc, object, "difficult", "0");
+	const std::string name    = DatasetWriter::SampleName();
+	const std::string imgPath = DatasetWriter::ImagePath(datasetPath, name);
 
-		const int bboxIndex = bboxTable->cellWidget(n,0)->property(BBOX_PROPERTY).toInt();
-		glWidget* boxWidget = captureWindow->GetWidget(bboxIndex);
+	const int imgWidth  = (restoredFrame != NULL) ? restoredFrame->width : captureWindow->GetCameraWidth();
+	const int imgHeight = (restoredFrame != NULL) ? restoredFrame->height : captureWindow->GetCameraHeight();
 
-		float x1, y1, x2, y2;
-		boxWidget->GetCoords(&x1, &y1, &x2, &y2);
+	// crop and resize to the output geometry
+	const OutputGeometry& geometry = geometryWidget->GetGeometry();
 
-		XMLElement* bbox = xmlAddElement(doc, object, "bndbox");
-		
-		xmlAddElement(doc, bbox, "xmin", (int)x1);
-		xmlAddElement(doc, bbox, "ymin", (int)y1);
-		xmlAddElement(doc, bbox, "xmax", (int)x2);
-		xmlAddElement(doc, bbox, "ymax", (int)y2);
+	if( !outputTransform.Configure(geometry, imgWidth, imgHeight) )
+	{
+		statusBar->showMessage(QString(STATUS_MSG "the output region is outside of the frame"));
+		return false;
 	}
 
-	// save XML
-	if( doc.SaveFile(xmlPath.c_str()) != XML_SUCCESS )
+	// the files go to the staging area first (if there is one)
+	StagedSample sample = DatasetStaging::Begin();
+
+	// save the image
+	if( !captureWindow->Save(sample.Path(imgPath).c_str(), DEFAULT_JPEG_QUALITY, &outputTransform) )
+	{
+		DatasetStaging::Discard(sample);
+		statusBar->showMessage(QString(STATUS_MSG "failed to save ") + QString::fromStdString(imgPath));
+		return false;
+	}
+
+	// save the annotations (with the boxes mapped to the output)
+	AnnotationModel outputBoxes;
+
+	if( !outputTransform.IsIdentity() )
+		outputTransform.MapBoxes(*annotations, outputBoxes);
+
+	if( !DatasetWriter::SaveAnnotations(datasetPath, name, outputTransform.GetWidth(), outputTransform.GetHeight(),
+								 outputTransform.IsIdentity() ? *annotations : outputBoxes, classLabels, &sample) )
 	{
-		printf("camera-capture:  failed to save %s\n", xmlPath.c_str());
-		statusBar->showMessage(QString(STATUS_MSG "failed to save ") + QString::fromStdString(xmlPath));
+		DatasetStaging::Discard(sample);
+		statusBar->showMessage(QString(STATUS_MSG "failed to save ") + QString::fromStdString(DatasetWriter::AnnotationPath(datasetPath, name)));
 		return false;
 	}
 
+	// keep the full-resolution frame too
+	if( geometry.keepOriginal && !outputTransform.IsIdentity() )
+	{
+		const std::string originals = DatasetWriter::OriginalsDirectory(datasetPath);
+		const std::string originalPath = DatasetWriter::ImagePath(originals, name);
+
+		if( !DatasetWriter::CreateDetectionDirectories(originals) ||
+		    !captureWindow->Save(sample.Path(originalPath).c_str(), DEFAULT_JPEG_QUALITY) ||
+		    !DatasetWriter::SaveAnnotations(originals, name, imgWidth, imgHeight, *annotations, classLabels, &sample) )
+		{
+			DatasetStaging::Discard(sample);
+			statusBar->showMessage(QString(STATUS_MSG "failed to save ") + QString::fromStdString(originalPath));
+			return false;
+		}
+	}
+
 	// append to image list(s)
 	const std::string currentSet = setDropdown->currentText().toLower().toStdString();
 
-	if( mergeDataSubsets->checkState() == Qt::Checked )
+	if( !DatasetWriter::AddToImageSets(datasetPath, currentSet, name, mergeDataSubsets->checkState() == Qt::Checked, &sample) )
+		statusBar->showMessage(QString(STATUS_MSG "failed to update the image sets"));
+
+	if( !DatasetStaging::Commit(sample) )
 	{
-		addToImageSet("train", timestamp);
-		addToImageSet("trainval", timestamp);
-		addToImageSet("test", timestamp);
-		addToImageSet("val", timestamp);
+		statusBar->showMessage(QString(STATUS_MSG "failed to save ") + QString::fromStdString(imgPath));
+		return false;
 	}
-	else
+
+	samples.Append(name);
+
+	// the edits are saved, so they don't need to be restored
+	journal.End();
+
+	if( session != NULL && geometry.Format() != recordedGeometry )
 	{
-		addToImageSet(currentSet, timestamp);
-	
-		if( currentSet == "train" || currentSet == "val" )
-			addToImageSet("trainval", timestamp);
+		recordedGeometry = geometry.Format();
+		session->Record("geometry %s", SessionRecorder::Escape(recordedGeometry).c_str());
 	}
 
+	if( session != NULL )
+		session->Record("save %s %s %i %i %i %i", SessionRecorder::Escape(name).c_str(), SessionRecorder::Escape(currentSet).c_str(),
+					 (int)(mergeDataSubsets->checkState() == Qt::Checked), DEFAULT_JPEG_QUALITY, imgWidth, imgHeight);
+
 	//const int numFiles = QDir(directory.c_str()).count() - 2;
 	//statusBar->showMessage(QString(STATUS_MSG "%1 images in %2").arg(QString::number(numFiles), QString::fromStdString(subdirPath)));
 
@@ -653,53 +1301,228 @@ void ControlDetectionWidget::onSave()
 }
 
 
-// addToImageSet
-bool ControlDetectionWidget::addToImageSet( const std::string& imgSet, const std::string& imgName )
+// openSampleAt
+bool ControlDetectionWidget::openSampleAt( int index )
 {
-	const std::string filename = datasetPath + "/ImageSets/Main/" + imgSet + ".txt";
-	const std::string imgNameNL = imgName + "\n";
+	if( datasetPath.size() == 0 || index < 0 || index >= samples.GetCount() )
+		return false;
 
-	FILE* file = fopen(filename.c_str(), "a");
+	// keep the edits to the sample being closed, like unfreezing does
+	const bool liveBoxes = (openSample == NULL && freezeButton->isChecked() && annotations->GetCount() > 0);
 
-	if( !file )
+	if( saveOnUnfreeze->checkState() == Qt::Checked )
 	{
-		printf("camera-capture:  failed to open %s\n", filename.c_str());
-		statusBar->showMessage(QString(STATUS_MSG "failed to open ") + QString::fromStdString(filename));
-		return false;
+		if( openSample != NULL )
+			saveFrame();
+		else if( liveBoxes && !saveFrame() )
+			return false;
+	}
+	else if( liveBoxes )
+	{
+		// the frozen frame from the camera was never saved, so its boxes would be lost
+		if( QMessageBox::question(this, tr("Discard Unsaved Boxes"), tr("The frozen frame has %1 boxes that weren't saved.  Discard them?").arg(annotations->GetCount())) != QMessageBox::Yes )
+			return false;
 	}
 
-	const int result = fputs(imgNameNL.c_str(), file);
+	std::shared_ptr<Sample> sample = samples.Load(index);
 
-	if( result < 0 )
+	if( !sample )
 	{
-		printf("camera-capture:  failed to save %s\n", filename.c_str());
-		statusBar->showMessage(QString(STATUS_MSG "failed to save ") + QString::fromStdString(filename));
+		statusBar->showMessage(QString(STATUS_MSG "failed to open ") + QString::fromStdString(samples.GetName(index)));
 		return false;
 	}
-	
-	fclose(file);
+
+	// freeze the camera without saving the live frame
+	openSample = sample;
+	restoredFrame.reset();
+
+	if( !freezeButton->isChecked() )
+		freezeButton->setChecked(true);
+
+	captureWindow->SetImage(sample->image, sample->width, sample->height);
+	journal.Begin(annotations, sample->image, sample->width, sample->height, sample->name);
+
+	if( session != NULL )
+		session->Record("open %s", SessionRecorder::Escape(sample->name).c_str());
+
+	const size_t numClasses = classLabels.size();
+
+	annotations->LoadVOC(sample->annotation, classLabels);
+
+	if( classLabels.size() != numClasses )
+		updateClassLabels();
+
+	statusBar->showMessage(QString(STATUS_MSG "editing %1 (%2 of %3)").arg(QString::fromStdString(sample->name)).arg(index + 1).arg(samples.GetCount()));
 	return true;
 }
 
 
+// restoreJournal
+bool ControlDetectionWidget::restoreJournal()
+{
+	JournalHeader header;
+	std::vector<BoundingBox> boxes;
+	uchar3* image = NULL;
+
+	if( !AnnotationJournal::Replay(datasetPath + "/.annotations.journal", header, boxes, &image) )
+		return false;
+
+	if( header.sample[0] != '\0' )
+	{
+		// the edits of a saved sample
+		CUDA(cudaFreeHost(image));
+
+		if( !openSampleAt(samples.Find(header.sample)) )
+			return false;
+	}
+	else
+	{
+		// a frame that wasn't saved yet
+		std::shared_ptr<Sample> frame(new Sample());
+
+		frame->image  = image;
+		frame->width  = header.width;
+		frame->height = header.height;
+
+		restoredFrame = frame;
+
+		if( !freezeButton->isChecked() )
+			freezeButton->setChecked(true);
+
+		captureWindow->SetImage(frame->image, frame->width, frame->height);
+		journal.Begin(annotations, frame->image, frame->width, frame->height);
+
+		if( session != NULL )
+			session->Frame(frame->image, frame->width, frame->height);
+	}
+
+	annotations->Load(boxes);
+
+	statusBar->showMessage(QString(STATUS_MSG "restored %1 unsaved boxes").arg(boxes.size()));
+	return true;
+}
+
+
+// onOpenSample
+void ControlDetectionWidget::onOpenSample()
+{
+	if( datasetPath.size() == 0 )
+		return;
+
+	const QString filename = QFileDialog::getOpenFileName(this, tr("Open Saved Sample"), QString::fromStdString(datasetPath + "/Annotations"), tr("Annotations (*.xml)"));
+
+	if( filename.size() == 0 )
+		return;
+
+	openSampleAt(samples.Find(QFileInfo(filename).completeBaseName().toStdString()));
+}
+
+
+// onPrevSample
+void ControlDetectionWidget::onPrevSample()
+{
+	// from the camera, go to the last sample that was saved
+	if( openSample == NULL )
+		openSampleAt(samples.GetCount() - 1);
+	else
+		openSampleAt(samples.Find(openSample->name) - 1);
+}
+
+
+// onNextSample
+void ControlDetectionWidget::onNextSample()
+{
+	if( openSample != NULL )
+		openSampleAt(samples.Find(openSample->name) + 1);
+}
+
+
 // onFreeze
 void ControlDetectionWidget::onFreeze( bool toggled )
 {
 	printf("camera-capture:  on freeze (%i)\n", (int)toggled);
 
+	if( session != NULL )
+		session->Record(toggled ? "freeze" : "unfreeze");
+
 	if( !toggled )
 	{
 		if( saveOnUnfreeze->checkState() == Qt::Checked )
 			saveFrame();
 
-		if( clearOnUnfreeze->checkState() == Qt::Checked )
+		if( openSample != NULL || restoredFrame != NULL )
+		{
+			// back to the camera from a saved sample
+			openSample.reset();
+			restoredFrame.reset();
 			clearBoxes();
+		}
+		else if( trackOnUnfreeze->checkState() == Qt::Checked && annotations->GetCount() > 0 )
+		{
+			// keep the boxes and follow them from the frozen frame
+			std::vector<BoundingBox> boxes(annotations->GetCount());
+
+			for( int n=0; n < annotations->GetCount(); n++ )
+				boxes[n] = annotations->GetAt(n);
+
+			tracker->SetTargets(captureWindow->GetImage(), captureWindow->GetCameraWidth(), captureWindow->GetCameraHeight(), boxes);
+		}
+		else if( clearOnUnfreeze->checkState() == Qt::Checked )
+		{
+			clearBoxes();
+		}
+
+		if( prelabel != NULL )
+		{
+			prelabel->Cancel();
+			prelabelTimer->stop();
+		}
+
+		journal.End();
+	}
+	else
+	{
+		tracker->ClearTargets();
+
+		// the frozen frame starts a new undo history
+		annotations->ClearHistory();
+
+		// saved samples and restored frames aren't from the camera
+		const bool cameraFrame = (openSample == NULL && restoredFrame == NULL);
+
+		if( session != NULL && cameraFrame )
+			recordFrame();
+
+		if( cameraFrame )
+			journal.Begin(annotations, captureWindow->GetImage(), captureWindow->GetCameraWidth(), captureWindow->GetCameraHeight());
+
+		if( proposeOnFreeze->checkState() == Qt::Checked && cameraFrame )
+			proposeBoxes();
+
+		if( prelabel != NULL && cameraFrame )
+		{
+			prelabel->Submit(captureWindow->GetImage(), captureWindow->GetCameraWidth(), captureWindow->GetCameraHeight());
+			prelabelTimer->start();
+		}
 	}
 
 	captureWindow->SetMode( toggled ? CaptureWindow::Edit : CaptureWindow::Live );
 }
 
 
+// recordFrame
+void ControlDetectionWidget::recordFrame()
+{
+	SyntheticSource* synthetic = captureWindow->GetSynthetic();
+
+	// synthetic frames can be generated again, other frames are copied to the session
+	if( synthetic != NULL )
+		session->Record("synthetic %llu", (unsigned long long)(synthetic->GetFrameCount() - 1));
+	else
+		session->Frame(captureWindow->GetImage(), captureWindow->GetCameraWidth(), captureWindow->GetCameraHeight());
+}
+
+
 // onQualityChanged
 void ControlDetectionWidget::onQualityChanged( int value )
 {
@@ -27,6 +27,15 @@
 
 #include "commandLine.h"
 #include "captureWindow.h"
+#include "controlGeometry.h"
+#include "boundingBoxModel.h"
+#include "spatialIndex.h"
+#include "objectTracker.h"
+#include "backgroundModel.h"
+#include "prelabelProvider.h"
+#include "sampleLoader.h"
+#include "annotationJournal.h"
+#include "sessionLog.h"
 
 
 /*
@@ -47,10 +56,25 @@ public slots:
 	void onSave();
 	void onFreeze( bool toggled );
 
-	void onBoxRemove();
-	void onBoxClass( int value );
-	void onBoxCoord( double value );
+	void onBoxClicked( const QModelIndex& index );
 	void onQualityChanged( int value );
+
+	void onUndo();
+	void onRedo();
+
+	void onSelectionChanged( const QItemSelection& selected, const QItemSelection& deselected );
+	void onSelectionClass();
+	void onSelectionRemove();
+	void onRubberBand();
+
+	void onProposalsToggled( bool checked );
+	void onProposalsAccept();
+	void onProposalsReject();
+	void onPrelabelTimer();
+
+	void onOpenSample();
+	void onPrevSample();
+	void onNextSample();
 	
 	void selectDatasetPath();
 	void selectLabelFile();
@@ -59,22 +83,40 @@ protected:
 	bool saveFrame();
 	bool clearBoxes();
 	bool createDatasetDirectories();
-	bool makeDir( QDir& root, const QString& subdir );
-	bool addToImageSet( const std::string& imgSet, const std::string& imgName );
 
 	void hideEvent( QHideEvent* event );
 	void showEvent( QShowEvent* event );
 
-	void updateBoxColor( uint32_t index, uint32_t classID );
-	void updateBoxCoords( uint32_t index );
-	void updateBoxIndices();
+	bool eventFilter( QObject* object, QEvent* event );
+
+	void addBoxWidget( const BoundingBox& box, glWidget* widget=NULL );
+	void removeBoxWidget( uint32_t id );
+	void updateBoxWidget( const BoundingBox& box );
+	void updateBoxColor( glWidget* widget, const BoundingBox& box );
+	void updateBoxSelection( const QItemSelection& selection, bool selected );
+
+	void hoverBox( float x, float y );
+	void selectBoxes( float x, float y, float width, float height );
+	std::vector<uint32_t> selectedBoxes() const;
+	std::vector<uint32_t> selectedProposals() const;
+
+	void proposeBoxes();
+	bool addProposal( float x, float y, float width, float height, int classID );
+
+	bool openSampleAt( int index );
+	bool restoreJournal();
+	void updateClassLabels();
+	void recordFrame();
 
 	static bool onCaptureEvent( uint16_t event, int a, int b, void* user );
 	static bool onWidgetEvent( glWidget* widget, uint16_t event, int a, int b, void* user );
+	static void onAnnotationEvent( uint16_t event, uint32_t id, int row, void* user );
+	static void onCaptureFrame( uchar3* image, int width, int height, void* user );
 
 	CaptureWindow* captureWindow;
 	QStatusBar*    statusBar;
 
+	QStringListModel* classModel;	// shared by every per-box class drop-down
 	std::vector<std::string> classLabels;
 
 	std::string labelPath;
@@ -87,14 +129,63 @@ protected:
 	QLabel*     qualityLabel;
 	QSlider*    qualitySlider;
 
+	// the images and boxes are saved at the output geometry
+	ControlGeometryWidget* geometryWidget;
+	OutputTransform        outputTransform;
+
 	QCheckBox*  saveOnUnfreeze;
 	QCheckBox*  clearOnUnfreeze;
 	QCheckBox*  mergeDataSubsets;
+	QCheckBox*  trackOnUnfreeze;
+	QCheckBox*  proposeOnFreeze;
 
 	QPushButton* freezeButton;
 	QPushButton* saveButton;
 
-	QTableWidget* bboxTable;
+	QTableView*       bboxTable;
+	BoundingBoxModel* bboxModel;
+	AnnotationModel*  annotations;
+
+	// the canvas widgets are a view of the annotation model
+	QHash<uint32_t, glWidget*> boxWidgets;	// box ID -> canvas widget
+	QHash<glWidget*, uint32_t> widgetBoxes;	// canvas widget -> box ID
+
+	glWidget* createdWidget;	// widget being added to the model from the canvas
+	bool      addingWidget;	// widget being added to the canvas from the model
+	bool      updatingWidget;	// widget being moved to the box from the model
+
+	// hit-testing and selection
+	SpatialIndex boxIndex;
+	uint32_t     hoveredBox;
+	bool         hovering;
+	glWidget*    rubberBand;
+
+	QPushButton* selectButton;
+	QComboBox*   selectionClass;
+
+	// carries the boxes forward to the next frame
+	ObjectTracker* tracker;
+	std::vector<TrackerResult> trackerResults;
+
+	// proposes boxes around the objects that aren't part of the background
+	BackgroundModel background;
+
+	// asynchronous pre-labeling of the frozen frame (optional)
+	PrelabelWorker* prelabel;
+	QTimer*         prelabelTimer;
+
+	// previously saved samples, re-opened for editing
+	SampleLoader            samples;
+	std::shared_ptr<Sample> openSample;	// NULL when editing the camera frame
+
+	// edits of the frozen frame, restored after a crash
+	AnnotationJournal       journal;
+	std::shared_ptr<Sample> restoredFrame;	// unsaved frame from the journal
+
+	// inputs and edits recorded for camera-replay (optional)
+	SessionRecorder* session;
+	ulong lastInputTime;
+	std::string recordedGeometry;	// the output geometry the session last recorded
 };
 
 
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "controlGeometry.h"
+
+#include <string.h>
+
+
+// constructor
+ControlGeometryWidget::ControlGeometryWidget( commandLine* cmdLine, CaptureWindow* capture )
+{
+	captureWindow = capture;
+	updating      = false;
+
+	defaults.Parse(*cmdLine);
+	geometry = defaults;
+
+	/*
+	 * create layout
+ 	 */
+	QHBoxLayout* layout = new QHBoxLayout();
+
+	layout->setContentsMargins(0, 0, 0, 0);
+
+
+	// output size (the common input sizes of the networks)
+	static const int sizes[][2] = { {224, 224}, {299, 299}, {300, 300}, {320, 320}, {416, 416}, {512, 512}, {640, 480} };
+
+	sizeDropdown = new QComboBox();
+	sizeDropdown->addItem(tr("Camera"), QSize(0, 0));
+
+	for( size_t n=0; n < sizeof(sizes) / sizeof(sizes[0]); n++ )
+		sizeDropdown->addItem(QString("%1x%2").arg(sizes[n][0]).arg(sizes[n][1]), QSize(sizes[n][0], sizes[n][1]));
+
+	sizeDropdown->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
+	sizeDropdown->setToolTip(tr("Resolution the images are saved at"));
+
+
+	// fit
+	fitDropdown = new QComboBox();
+
+	fitDropdown->addItem(tr("Letterbox"), (int)OutputGeometry::Letterbox);
+	fitDropdown->addItem(tr("Crop"), (int)OutputGeometry::CenterCrop);
+	fitDropdown->addItem(tr("Stretch"), (int)OutputGeometry::Stretch);
+
+	fitDropdown->setToolTip(tr("How the images are fit to the size when the aspect ratios differ"));
+
+
+	// region of interest
+	roiCheckbox = new QCheckBox("ROI");
+	roiCheckbox->setToolTip(tr("Only save the region in the yellow rectangle (move and resize it on the camera feed)"));
+
+	originalCheckbox = new QCheckBox("Originals");
+	originalCheckbox->setToolTip(tr("Also keep the full-resolution frames (in the originals/ directory of the dataset)"));
+
+	connect(sizeDropdown, SIGNAL(currentIndexChanged(int)), this, SLOT(onChanged()));
+	connect(fitDropdown, SIGNAL(currentIndexChanged(int)), this, SLOT(onChanged()));
+	connect(roiCheckbox, SIGNAL(stateChanged(int)), this, SLOT(onChanged()));
+	connect(originalCheckbox, SIGNAL(stateChanged(int)), this, SLOT(onChanged()));
+
+	layout->addWidget(new QLabel(tr("Output Size      ")));
+	layout->addWidget(sizeDropdown);
+	layout->addWidget(fitDropdown);
+	layout->addWidget(roiCheckbox);
+	layout->addWidget(originalCheckbox);
+
+	setLayout(layout);
+	updateControls();
+}
+
+
+// Open
+void ControlGeometryWidget::Open( const std::string& path )
+{
+	datasetPath = path;
+	geometry    = defaults;
+
+	if( geometry.Load(datasetPath) )
+		printf("camera-capture:  loaded the output geometry of %s (%s)\n", datasetPath.c_str(), geometry.Format().c_str());
+
+	updateControls();
+}
+
+
+// GetGeometry
+const OutputGeometry& ControlGeometryWidget::GetGeometry()
+{
+	float roi[4];
+
+	// pick up where the region was moved to
+	if( geometry.HasROI() && captureWindow->GetROI(roi) && memcmp(roi, geometry.roi, sizeof(roi)) != 0 )
+	{
+		memcpy(geometry.roi, roi, sizeof(roi));
+		save();
+	}
+
+	return geometry;
+}
+
+
+// onChanged
+void ControlGeometryWidget::onChanged()
+{
+	if( updating )
+		return;
+
+	const QSize size = sizeDropdown->currentData().toSize();
+
+	geometry.width  = size.width();
+	geometry.height = size.height();
+	geometry.fit    = (OutputGeometry::Fit)fitDropdown->currentData().toInt();
+
+	geometry.keepOriginal = (originalCheckbox->checkState() == Qt::Checked);
+
+	fitDropdown->setEnabled(geometry.width > 0);
+
+	// the region starts wherever it was last shown
+	const bool roiChecked = (roiCheckbox->checkState() == Qt::Checked);
+
+	if( roiChecked != geometry.HasROI() )
+	{
+		captureWindow->ShowROI(roiChecked);
+
+		if( !roiChecked || !captureWindow->GetROI(geometry.roi) )
+			memset(geometry.roi, 0, sizeof(geometry.roi));
+	}
+
+	save();
+}
+
+
+// updateControls
+void ControlGeometryWidget::updateControls()
+{
+	updating = true;
+
+	const QSize size(geometry.width, geometry.height);
+	int index = sizeDropdown->findData(size);
+
+	if( index < 0 )
+	{
+		sizeDropdown->addItem(QString("%1x%2").arg(size.width()).arg(size.height()), size);
+		index = sizeDropdown->count() - 1;
+	}
+
+	sizeDropdown->setCurrentIndex(index);
+	fitDropdown->setCurrentIndex(fitDropdown->findData((int)geometry.fit));
+	fitDropdown->setEnabled(geometry.width > 0);
+
+	roiCheckbox->setCheckState(geometry.HasROI() ? Qt::Checked : Qt::Unchecked);
+	originalCheckbox->setCheckState(geometry.keepOriginal ? Qt::Checked : Qt::Unchecked);
+
+	updating = false;
+
+	// show the region of this dataset
+	if( isVisible() )
+		showEvent(NULL);
+}
+
+
+// save
+void ControlGeometryWidget::save()
+{
+	if( datasetPath.size() > 0 )
+		geometry.Save(datasetPath);
+}
+
+
+// hideEvent
+void ControlGeometryWidget::hideEvent( QHideEvent* event )
+{
+	// the region belongs to the widget that's shown
+	GetGeometry();
+	captureWindow->ShowROI(false);
+}
+
+
+// showEvent
+void ControlGeometryWidget::showEvent( QShowEvent* event )
+{
+	if( geometry.HasROI() )
+		captureWindow->SetROI(geometry.roi[0], geometry.roi[1], geometry.roi[2], geometry.roi[3]);
+
+	captureWindow->ShowROI(geometry.HasROI());
+}
+
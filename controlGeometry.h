@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_CONTROL_GEOMETRY_WIDGET__
+#define __CAMERA_CONTROL_GEOMETRY_WIDGET__
+
+#include <QtWidgets>
+
+#include "commandLine.h"
+#include "captureWindow.h"
+#include "outputGeometry.h"
+
+
+/*
+ * Output geometry controls (the size, fit, and region of the saved images).
+ *
+ * Each dataset control widget has one, and the geometry is kept with
+ * the dataset that's open (see OutputGeometry).  The region is drawn on
+ * the camera feed while the dataset widget it belongs to is shown.
+ */
+class ControlGeometryWidget : public QWidget
+{
+	Q_OBJECT
+
+public:
+	// create the widget (the command line sets the defaults)
+	ControlGeometryWidget( commandLine* cmdLine, CaptureWindow* captureWindow );
+
+	// load the geometry of a dataset (or the defaults if it doesn't have one)
+	void Open( const std::string& datasetPath );
+
+	// the current geometry (with the region as it was last moved on the camera feed)
+	const OutputGeometry& GetGeometry();
+
+public slots:
+	void onChanged();
+
+protected:
+	void hideEvent( QHideEvent* event );
+	void showEvent( QShowEvent* event );
+
+	void updateControls();
+	void save();
+
+	CaptureWindow* captureWindow;
+
+	OutputGeometry defaults;
+	OutputGeometry geometry;
+
+	std::string datasetPath;
+
+	QComboBox* sizeDropdown;
+	QComboBox* fitDropdown;
+	QCheckBox* roiCheckbox;
+	QCheckBox* originalCheckbox;
+
+	bool updating;
+};
+
+
+#endif
+
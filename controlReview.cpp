@@ -0,0 +1,415 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "controlReview.h"
+
+
+#define STATUS_MSG "Status - "
+#define SELECT_DATASET_MSG STATUS_MSG "select a dataset to review"
+
+
+// constructor
+ReviewListModel::ReviewListModel( ThumbnailCache* thumbnailCache, QObject* parent ) : QAbstractListModel(parent)
+{
+	cache = thumbnailCache;
+
+	const int size = ThumbnailCache::GetLevelSize(ThumbnailCache::Small);
+
+	placeholder = QImage(size, size * 3 / 4, QImage::Format_RGB888);
+	placeholder.fill(QColor(70, 70, 70));
+
+	connect(cache, SIGNAL(thumbnailReady(const QString&, int)), this, SLOT(onThumbnailReady(const QString&, int)));
+}
+
+
+// SetImages
+void ReviewListModel::SetImages( const QString& rootPath, const QStringList& imagePaths )
+{
+	beginResetModel();
+
+	root  = rootPath;
+	paths = imagePaths;
+
+	rows.clear();
+	rows.reserve(paths.size());
+
+	for( int n=0; n < paths.size(); n++ )
+		rows.insert(GetPath(n), n);
+
+	endResetModel();
+}
+
+
+// GetPath
+QString ReviewListModel::GetPath( int row ) const
+{
+	if( row < 0 || row >= paths.size() )
+		return QString();
+
+	return root + "/" + paths[row];
+}
+
+
+// rowCount
+int ReviewListModel::rowCount( const QModelIndex& parent ) const
+{
+	if( parent.isValid() )
+		return 0;
+
+	return paths.size();
+}
+
+
+// data
+QVariant ReviewListModel::data( const QModelIndex& index, int role ) const
+{
+	if( !index.isValid() || index.row() >= paths.size() )
+		return QVariant();
+
+	if( role == Qt::DisplayRole )
+	{
+		return QFileInfo(paths[index.row()]).completeBaseName();
+	}
+	else if( role == Qt::ToolTipRole )
+	{
+		return paths[index.row()];
+	}
+	else if( role == Qt::DecorationRole )
+	{
+		// only the visible rows are requested by the view, and the
+		// thumbnail is decoded in the background if it isn't in memory
+		QImage thumbnail;
+
+		if( !cache->Get(GetPath(index.row()), ThumbnailCache::Small, thumbnail) || thumbnail.isNull() )
+			return placeholder;
+
+		return thumbnail;
+	}
+
+	return QVariant();
+}
+
+
+// onThumbnailReady
+void ReviewListModel::onThumbnailReady( const QString& path, int level )
+{
+	if( level != ThumbnailCache::Small )
+		return;
+
+	const int row = rows.value(path, -1);
+
+	if( row < 0 )
+		return;
+
+	const QModelIndex idx = index(row);
+	emit dataChanged(idx, idx, QVector<int>() << Qt::DecorationRole);
+}
+
+
+//-----------------------------------------------------------------------------------------
+// constructor
+ControlReviewWidget::ControlReviewWidget( commandLine* cmdLine, CaptureWindow* capture )
+{
+	captureWindow = capture;
+	scanCancel    = false;
+
+	cache = new ThumbnailCache(cmdLine->GetInt("review-cache", ThumbnailCache::DefaultMemoryBudget),
+						  cmdLine->GetInt("review-disk-cache", ThumbnailCache::DefaultDiskBudget), this);
+	model = new ReviewListModel(cache, this);
+
+	connect(cache, SIGNAL(thumbnailReady(const QString&, int)), this, SLOT(onThumbnailReady(const QString&, int)));
+
+	/*
+	 * create layout
+ 	 */
+	QVBoxLayout* layout = new QVBoxLayout();
+
+	layout->setAlignment(Qt::AlignTop);
+
+
+	// dataset location
+	QHBoxLayout* datasetLayout = new QHBoxLayout();
+	QPushButton* datasetButton = new QPushButton(tr("..."));
+
+	datasetButton->setMaximumWidth(50);
+	connect(datasetButton, SIGNAL(clicked()), this, SLOT(selectDatasetPath()));
+
+	datasetWidget = new QLabel();
+
+	datasetWidget->setFrameStyle(QFrame::Panel|QFrame::Sunken);
+	datasetWidget->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
+
+	datasetLayout->addWidget(new QLabel(tr("Dataset Path    ")));
+	datasetLayout->addWidget(datasetWidget);
+	datasetLayout->addWidget(datasetButton);
+
+	layout->addItem(datasetLayout);
+
+
+	// preview of the current image
+	preview = new QLabel();
+
+	preview->setAlignment(Qt::AlignCenter);
+	preview->setMinimumHeight(240);
+	preview->setFrameStyle(QFrame::Panel|QFrame::Sunken);
+
+	layout->addWidget(preview);
+
+
+	// navigation
+	QHBoxLayout* navLayout = new QHBoxLayout();
+
+	QPushButton* prevButton = new QPushButton("< Prev");
+	QPushButton* nextButton = new QPushButton("Next >");
+
+	prevButton->setShortcut(QKeySequence(Qt::Key_Left));
+	nextButton->setShortcut(QKeySequence(Qt::Key_Right));
+
+	connect(prevButton, SIGNAL(clicked()), this, SLOT(onPrev()));
+	connect(nextButton, SIGNAL(clicked()), this, SLOT(onNext()));
+
+	positionLabel = new QLabel();
+	positionLabel->setAlignment(Qt::AlignCenter);
+
+	navLayout->addWidget(prevButton);
+	navLayout->addWidget(positionLabel);
+	navLayout->addWidget(nextButton);
+
+	layout->addLayout(navLayout);
+
+
+	// thumbnail grid
+	const int thumbnailSize = ThumbnailCache::GetLevelSize(ThumbnailCache::Small);
+
+	listView = new QListView();
+
+	listView->setModel(model);
+	listView->setViewMode(QListView::IconMode);
+	listView->setIconSize(QSize(thumbnailSize, thumbnailSize));
+	listView->setGridSize(QSize(thumbnailSize + 8, thumbnailSize + 24));
+	listView->setUniformItemSizes(true);
+	listView->setMovement(QListView::Static);
+	listView->setResizeMode(QListView::Adjust);
+	listView->setLayoutMode(QListView::Batched);	// large datasets are laid out incrementally
+	listView->setBatchSize(1000);
+	listView->setSelectionMode(QAbstractItemView::SingleSelection);
+	listView->setMinimumHeight(300);
+
+	connect(listView->selectionModel(), SIGNAL(currentChanged(const QModelIndex&, const QModelIndex&)),
+		   this, SLOT(onCurrentChanged(const QModelIndex&, const QModelIndex&)));
+
+	connect(listView->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(onScrolled()));
+
+	layout->addWidget(listView);
+
+
+	// status bar
+	statusBar = new QStatusBar();
+
+	statusBar->setStyleSheet("QStatusBar{border-top: 1px outset grey; color: rgb(150,150,150);}");
+	statusBar->showMessage(tr(SELECT_DATASET_MSG));
+
+	layout->addWidget(statusBar);
+
+	setLayout(layout);
+}
+
+
+// destructor
+ControlReviewWidget::~ControlReviewWidget()
+{
+	scanCancel = true;
+
+	if( scanThread.joinable() )
+		scanThread.join();
+}
+
+
+// selectDatasetPath
+void ControlReviewWidget::selectDatasetPath()
+{
+	const QString path = QFileDialog::getExistingDirectory(this, tr("Select Dataset Directory"), QString(), QFileDialog::ShowDirsOnly | QFileDialog::DontResolveSymlinks);
+
+	if( path.size() == 0 )
+		return;
+
+	datasetPath = path;
+
+	QFontMetrics metrics(datasetWidget->font());
+	datasetWidget->setText(metrics.elidedText(path, Qt::ElideLeft, datasetWidget->width() - 2));
+
+	scanDataset(path);
+}
+
+
+// scanDataset
+void ControlReviewWidget::scanDataset( const QString& root )
+{
+	// stop the previous scan
+	scanCancel = true;
+
+	if( scanThread.joinable() )
+		scanThread.join();
+
+	scanCancel = false;
+
+	cache->CancelAll();
+	model->SetImages(root, QStringList());
+	preview->clear();
+
+	statusBar->showMessage(tr(STATUS_MSG "scanning dataset..."));
+
+	// listing a large dataset takes a while, so do it in the background
+	scanThread = std::thread([this, root]()
+	{
+		const QDir rootDir(root);
+
+		QStringList paths;
+		QDirIterator iter(root, QStringList() << "*.jpg" << "*.jpeg" << "*.JPG" << "*.JPEG", QDir::Files, QDirIterator::Subdirectories);
+
+		while( iter.hasNext() && !scanCancel )
+			paths.append(rootDir.relativeFilePath(iter.next()));
+
+		if( scanCancel )
+			return;
+
+		paths.sort();
+
+		QMetaObject::invokeMethod(this, "onScanFinished", Qt::QueuedConnection, Q_ARG(QStringList, paths));
+	});
+}
+
+
+// onScanFinished
+void ControlReviewWidget::onScanFinished( const QStringList& paths )
+{
+	model->SetImages(datasetPath, paths);
+
+	statusBar->showMessage(QString(STATUS_MSG "%1 images in dataset").arg(paths.size()));
+
+	if( paths.size() > 0 )
+		listView->setCurrentIndex(model->index(0));
+	else
+		positionLabel->clear();
+}
+
+
+// onPrev
+void ControlReviewWidget::onPrev()
+{
+	const int row = listView->currentIndex().row();
+
+	if( row > 0 )
+		listView->setCurrentIndex(model->index(row - 1));
+}
+
+
+// onNext
+void ControlReviewWidget::onNext()
+{
+	const int row = listView->currentIndex().row();
+
+	if( row + 1 < model->rowCount() )
+		listView->setCurrentIndex(model->index(row + 1));
+}
+
+
+// onCurrentChanged
+void ControlReviewWidget::onCurrentChanged( const QModelIndex& current, const QModelIndex& previous )
+{
+	if( !current.isValid() )
+		return;
+
+	positionLabel->setText(QString("%1 / %2").arg(current.row() + 1).arg(model->rowCount()));
+
+	updatePreview();
+	prefetch();
+}
+
+
+// onScrolled
+void ControlReviewWidget::onScrolled()
+{
+	prefetch();
+}
+
+
+// onThumbnailReady
+void ControlReviewWidget::onThumbnailReady( const QString& path, int level )
+{
+	if( level == ThumbnailCache::Large && path == model->GetPath(listView->currentIndex().row()) )
+		updatePreview();
+}
+
+
+// updatePreview
+void ControlReviewWidget::updatePreview()
+{
+	const QString path = model->GetPath(listView->currentIndex().row());
+
+	if( path.isEmpty() )
+		return;
+
+	QImage image;
+
+	if( !cache->Get(path, ThumbnailCache::Large, image) )
+		return;		// shown when it's loaded
+
+	if( image.isNull() )
+	{
+		preview->setText(tr("failed to load image"));
+		return;
+	}
+
+	preview->setPixmap(QPixmap::fromImage(image).scaled(preview->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+	statusBar->showMessage(QString(STATUS_MSG) + model->data(listView->currentIndex(), Qt::ToolTipRole).toString());
+}
+
+
+// prefetch
+void ControlReviewWidget::prefetch()
+{
+	const int numImages = model->rowCount();
+
+	if( numImages == 0 )
+		return;
+
+	// load the thumbnails past the bottom of the view
+	const QModelIndex last = listView->indexAt(listView->viewport()->rect().bottomRight() - QPoint(1,1));
+	const int lastRow = last.isValid() ? last.row() : listView->currentIndex().row();
+
+	for( int n=1; n <= PrefetchCount && lastRow + n < numImages; n++ )
+		cache->Prefetch(model->GetPath(lastRow + n), ThumbnailCache::Small);
+
+	// and the previews next to the current image
+	const int current = listView->currentIndex().row();
+
+	for( int n=1; n <= 2; n++ )
+	{
+		if( current + n < numImages )
+			cache->Prefetch(model->GetPath(current + n), ThumbnailCache::Large);
+
+		if( current - n >= 0 )
+			cache->Prefetch(model->GetPath(current - n), ThumbnailCache::Large);
+	}
+}
+
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_CONTROL_REVIEW_WIDGET__
+#define __CAMERA_CONTROL_REVIEW_WIDGET__
+
+#include <QtWidgets>
+
+#include "commandLine.h"
+#include "captureWindow.h"
+#include "thumbnailCache.h"
+
+#include <thread>
+#include <atomic>
+
+
+/*
+ * List model of the images in a dataset (thumbnails are loaded on demand)
+ */
+class ReviewListModel : public QAbstractListModel
+{
+	Q_OBJECT
+
+public:
+	// constructor
+	ReviewListModel( ThumbnailCache* cache, QObject* parent=NULL );
+
+	// set the list of images
+	void SetImages( const QString& root, const QStringList& paths );
+
+	// get the absolute path of an image
+	QString GetPath( int row ) const;
+
+	// model interface
+	int rowCount( const QModelIndex& parent=QModelIndex() ) const;
+	QVariant data( const QModelIndex& index, int role=Qt::DisplayRole ) const;
+
+protected slots:
+	void onThumbnailReady( const QString& path, int level );
+
+protected:
+	ThumbnailCache* cache;
+
+	QString     root;
+	QStringList paths;		// relative to the root
+	QHash<QString, int> rows;	// absolute path -> row
+
+	QImage placeholder;
+};
+
+
+/*
+ * Review control widget (pages through the saved images of a dataset)
+ */
+class ControlReviewWidget : public QWidget
+{
+	Q_OBJECT
+
+public:
+	// create window
+	ControlReviewWidget( commandLine* cmdLine, CaptureWindow* captureWindow );
+
+	// destructor
+	~ControlReviewWidget();
+
+public slots:
+	void onPrev();
+	void onNext();
+	void onCurrentChanged( const QModelIndex& current, const QModelIndex& previous );
+	void onScrolled();
+	void onThumbnailReady( const QString& path, int level );
+	void onScanFinished( const QStringList& paths );
+
+	void selectDatasetPath();
+
+protected:
+	void scanDataset( const QString& root );
+	void prefetch();
+	void updatePreview();
+
+	CaptureWindow* captureWindow;
+	QStatusBar*    statusBar;
+
+	QString datasetPath;
+	QLabel* datasetWidget;
+
+	ThumbnailCache*  cache;
+	ReviewListModel* model;
+	QListView*       listView;
+	QLabel*          preview;
+	QLabel*          positionLabel;
+
+	std::thread       scanThread;
+	std::atomic<bool> scanCancel;
+
+	// number of thumbnails loaded ahead of the view
+	static const int PrefetchCount = 96;
+};
+
+
+#endif
+
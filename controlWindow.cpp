@@ -24,6 +24,11 @@
 
 #include "controlClassify.h"
 #include "controlDetection.h"
+#include "controlReview.h"
+
+#include "offlineSource.h"
+#include "frameRecorder.h"
+#include "datasetWriter.h"
 
 
 // constructor
@@ -34,9 +39,19 @@ ControlWindow::ControlWindow( commandLine& commandLine, CaptureWindow* capture )
 
 	datasetTypes[0] = "Classification";
 	datasetTypes[1] = "Detection";
+	datasetTypes[2] = "Review";
 
 	memset(datasetWidgets, 0, sizeof(datasetWidgets));
 
+	frameSlider = NULL;
+	frameLabel  = NULL;
+	frameTimer  = NULL;
+
+	recorder     = NULL;
+	recordButton = NULL;
+	recordLabel  = NULL;
+	recordTimer  = NULL;
+
 
 	/*
 	 * create layout
@@ -64,16 +79,91 @@ ControlWindow::ControlWindow( commandLine& commandLine, CaptureWindow* capture )
 	layout->addItem(datasetLayout);
 
 
+	/*
+	 * frame controls for recorded footage
+	 */
+	if( captureWindow->IsOffline() )
+	{
+		QHBoxLayout* frameLayout = new QHBoxLayout();
+
+		QPushButton* prevButton = new QPushButton("<");
+		QPushButton* nextButton = new QPushButton(">");
+
+		prevButton->setShortcut(QKeySequence(Qt::Key_Comma));
+		nextButton->setShortcut(QKeySequence(Qt::Key_Period));
+
+		prevButton->setToolTip(tr("Previous frame (,)"));
+		nextButton->setToolTip(tr("Next frame (.)"));
+
+		prevButton->setMaximumWidth(40);
+		nextButton->setMaximumWidth(40);
+
+		frameSlider = new QSlider(Qt::Horizontal);
+		frameSlider->setTracking(false);	// only seek when the slider is released
+		frameSlider->setRange(0, std::max(captureWindow->GetFrameCount() - 1, 0));
+
+		frameLabel = new QLabel();
+		frameLabel->setMinimumWidth(100);
+
+		connect(prevButton, SIGNAL(clicked()), this, SLOT(onPrevFrame()));
+		connect(nextButton, SIGNAL(clicked()), this, SLOT(onNextFrame()));
+		connect(frameSlider, SIGNAL(valueChanged(int)), this, SLOT(onFrameSeek(int)));
+
+		frameLayout->addWidget(new QLabel(tr("  Frame")));
+		frameLayout->addWidget(prevButton);
+		frameLayout->addWidget(frameSlider);
+		frameLayout->addWidget(nextButton);
+		frameLayout->addWidget(frameLabel);
+
+		layout->addItem(frameLayout);
+
+		// follow the playback (and the end of a video once it's found)
+		frameTimer = new QTimer(this);
+		connect(frameTimer, SIGNAL(timeout()), this, SLOT(onFrameTimer()));
+		frameTimer->start(100);
+
+		onFrameTimer();
+	}
+	else
+	{
+		/*
+		 * record the camera at full rate, to label later with --offline
+		 */
+		QHBoxLayout* recordLayout = new QHBoxLayout();
+
+		recordButton = new QPushButton(tr("Record"));
+		recordButton->setCheckable(true);
+		recordButton->setToolTip(tr("Record every camera frame to disk, to be labeled later"));
+
+		recordLabel = new QLabel();
+
+		connect(recordButton, SIGNAL(toggled(bool)), this, SLOT(onRecord(bool)));
+
+		recordLayout->addWidget(new QLabel(tr("  Recording       ")));
+		recordLayout->addWidget(recordButton);
+		recordLayout->addWidget(recordLabel);
+		recordLayout->addStretch();
+
+		layout->addItem(recordLayout);
+
+		recordTimer = new QTimer(this);
+		connect(recordTimer, SIGNAL(timeout()), this, SLOT(onRecordTimer()));
+	}
+
+
 	/*
 	 * dataset control widgets
 	 */
 	datasetWidgets[0] = new ControlClassifyWidget(cmdLine, captureWindow);
 	datasetWidgets[1] = new ControlDetectionWidget(cmdLine, captureWindow);
+	datasetWidgets[2] = new ControlReviewWidget(cmdLine, captureWindow);
 
 	layout->addWidget(datasetWidgets[0]);
 	layout->addWidget(datasetWidgets[1]);
+	layout->addWidget(datasetWidgets[2]);
 
 	datasetWidgets[1]->hide();
+	datasetWidgets[2]->hide();
 
 
 	/*
@@ -109,6 +199,103 @@ void ControlWindow::onDatasetType(const QString& text)
 }
  
 
+// onPrevFrame
+void ControlWindow::onPrevFrame()
+{
+	captureWindow->Step(-1);
+}
+
+
+// onNextFrame
+void ControlWindow::onNextFrame()
+{
+	captureWindow->Step(1);
+}
+
+
+// onFrameSeek
+void ControlWindow::onFrameSeek( int index )
+{
+	if( index != captureWindow->GetFrameIndex() )
+		captureWindow->Seek(index);
+}
+
+
+// onFrameTimer
+void ControlWindow::onFrameTimer()
+{
+	const int index = captureWindow->GetFrameIndex();
+	const int count = captureWindow->GetFrameCount();
+
+	if( count > 0 )
+		frameLabel->setText(QString("%1 / %2").arg(index + 1).arg(count));
+	else
+		frameLabel->setText(QString("%1").arg(index + 1));
+
+	if( frameSlider->isSliderDown() )
+		return;
+
+	// the length of a video isn't known until its end, so the slider grows with it
+	frameSlider->blockSignals(true);
+	frameSlider->setMaximum(std::max(count > 0 ? count - 1 : index + OfflineSource::DefaultReadAhead, frameSlider->maximum()));
+	frameSlider->setValue(index);
+	frameSlider->blockSignals(false);
+}
+
+
+// onRecord
+void ControlWindow::onRecord( bool checked )
+{
+	if( !checked )
+	{
+		if( recorder != NULL )
+		{
+			captureWindow->RemoveFrameHandler(FrameRecorder::OnFrame, recorder);
+			recorder->Close();
+		}
+
+		recordTimer->stop();
+		onRecordTimer();
+		return;
+	}
+
+	const QString defaultName = QString::fromStdString("recording-" + DatasetWriter::Timestamp() + ".ccr");
+	const QString filename = QFileDialog::getSaveFileName(this, tr("Record to"), defaultName, tr("Recordings (*.ccr)"));
+
+	if( !recorder )
+		recorder = new FrameRecorder();
+
+	if( filename.size() == 0 || !recorder->Open(filename.toStdString(), captureWindow->GetCameraWidth(), captureWindow->GetCameraHeight()) )
+	{
+		recordButton->blockSignals(true);
+		recordButton->setChecked(false);
+		recordButton->blockSignals(false);
+		return;
+	}
+
+	captureWindow->AddFrameHandler(FrameRecorder::OnFrame, recorder);
+
+	recordTimer->start(250);
+	onRecordTimer();
+}
+
+
+// onRecordTimer
+void ControlWindow::onRecordTimer()
+{
+	if( !recorder )
+		return;
+
+	const QString status = QString("%1 frames, %2 MB").arg(recorder->GetFrameCount()).arg(recorder->GetBytesWritten() / (1024 * 1024));
+
+	// dropped frames are shown in red, so they aren't missed
+	if( recorder->GetDropCount() > 0 )
+		recordLabel->setText(status + QString(", <font color=\"red\">%1 dropped</font>").arg(recorder->GetDropCount()));
+	else
+		recordLabel->setText(status);
+}
+
+
 // sizeHint
 QSize ControlWindow::sizeHint() const
 {
@@ -119,8 +306,11 @@ QSize ControlWindow::sizeHint() const
 // destructor
 ControlWindow::~ControlWindow()
 {
-
-
+	if( recorder != NULL )
+	{
+		captureWindow->RemoveFrameHandler(FrameRecorder::OnFrame, recorder);
+		delete recorder;
+	}
 }
 
 
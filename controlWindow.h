@@ -28,6 +28,9 @@
 #include "commandLine.h"
 #include "captureWindow.h"
 
+// forward declarations
+class FrameRecorder;
+
 
 /*
  * Capture control window
@@ -56,15 +59,34 @@ public:
 public slots:
 	void onDatasetType( const QString& text );
 
+	void onPrevFrame();
+	void onNextFrame();
+	void onFrameSeek( int index );
+	void onFrameTimer();
+
+	void onRecord( bool checked );
+	void onRecordTimer();
+
 protected:
 	ControlWindow( commandLine& cmdLine, CaptureWindow* captureWindow );
 
-	static const int numDatasetTypes = 2;
+	static const int numDatasetTypes = 3;
 
 	const char*    datasetTypes[numDatasetTypes];
 	QWidget*       datasetWidgets[numDatasetTypes];
 	CaptureWindow* captureWindow;
 	commandLine*   cmdLine;	
+
+	// offline frame controls
+	QSlider* frameSlider;
+	QLabel*  frameLabel;
+	QTimer*  frameTimer;
+
+	// raw recording of the camera
+	FrameRecorder* recorder;
+	QPushButton*   recordButton;
+	QLabel*        recordLabel;
+	QTimer*        recordTimer;
 };
 
 
@@ -0,0 +1,719 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "datasetStaging.h"
+#include "datasetWriter.h"
+#include "ioBatch.h"
+#include "metrics.h"
+#include "tracer.h"
+
+#include <map>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+#include <condition_variable>
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+
+// a committed sample waiting to be migrated
+struct PendingSample
+{
+	std::string directory;
+	uint64_t    bytes;
+	bool        recovered;	// left by a previous run
+};
+
+static std::string stagingPath;
+static uint64_t maxStagedSize = DatasetStaging::DefaultMaxSize;
+static std::atomic<uint64_t> rateLimit(0);
+
+static int lockFile = -1;
+static bool overLimit = false;
+
+static std::thread migrator;
+static std::mutex mutex;
+static std::condition_variable condition;	// a sample was committed, or stopping
+static std::condition_variable migrated;	// a sample was migrated (for Flush)
+
+static std::deque<PendingSample> queue;
+static std::map<std::string, std::string> located;	// final path -> staged path
+static uint64_t pendingBytes = 0;
+static uint64_t nextSequence = 0;
+
+static bool migrating = false;	// a sample is being migrated
+static bool stalled   = false;	// the last migration failed, and is retried later
+static bool stopping  = false;
+
+// seconds before a failed migration is retried
+static const int RetryInterval = 5;
+
+
+// sequenceName
+static std::string sequenceName( uint64_t sequence )
+{
+	char str[32];
+	snprintf(str, sizeof(str), "%012llu", (unsigned long long)sequence);
+	return str;
+}
+
+
+// fileSize
+static uint64_t fileSize( const std::string& path )
+{
+	struct stat info;
+
+	if( stat(path.c_str(), &info) != 0 )
+		return 0;
+
+	return info.st_size;
+}
+
+
+// removeDirectory
+static void removeDirectory( const std::string& path )
+{
+	DIR* dir = opendir(path.c_str());
+
+	if( !dir )
+		return;
+
+	struct dirent* entry = NULL;
+
+	while( (entry = readdir(dir)) != NULL )
+	{
+		if( strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0 )
+			unlink((path + "/" + entry->d_name).c_str());
+	}
+
+	closedir(dir);
+	rmdir(path.c_str());
+}
+
+
+// readManifest
+static bool readManifest( const std::string& directory, std::vector<std::pair<std::string, std::string>>& files,
+					 std::vector<std::pair<std::string, std::string>>& records )
+{
+	std::ifstream file(directory + "/manifest");
+
+	if( !file.is_open() )
+		return false;
+
+	// <type> TAB <path> TAB <staged filename or record>
+	std::string line;
+
+	while( std::getline(file, line) )
+	{
+		const size_t first  = line.find('\t');
+		const size_t second = (first != std::string::npos) ? line.find('\t', first + 1) : std::string::npos;
+
+		if( second == std::string::npos )
+			continue;
+
+		const std::string type  = line.substr(0, first);
+		const std::string path  = line.substr(first + 1, second - first - 1);
+		const std::string value = line.substr(second + 1);
+
+		if( type == "file" )
+			files.push_back(std::make_pair(directory + "/" + value, path));
+		else if( type == "record" )
+			records.push_back(std::make_pair(path, value));
+	}
+
+	return true;
+}
+
+
+// hasRecord
+static bool hasRecord( const std::string& filename, const std::string& record )
+{
+	std::ifstream file(filename);
+	std::string line;
+
+	while( std::getline(file, line) )
+	{
+		if( line == record )
+			return true;
+	}
+
+	return false;
+}
+
+
+// throttle
+static void throttle( uint64_t budgetStart, uint64_t budgetBytes )
+{
+	// wait until the bytes migrated so far are within the rate (Close() lifts the limit)
+	while( true )
+	{
+		const uint64_t rate = rateLimit.load();
+
+		if( rate == 0 )
+			return;
+
+		const uint64_t due = budgetStart + (uint64_t)(budgetBytes * 1e9 / rate);
+		const uint64_t now = Metrics::Now();
+
+		if( now >= due )
+			return;
+
+		std::this_thread::sleep_for(std::chrono::nanoseconds(std::min<uint64_t>(due - now, 100 * 1000 * 1000)));
+	}
+}
+
+
+// readFile
+static bool readFile( const std::string& path, std::string& data )
+{
+	const int fd = open(path.c_str(), O_RDONLY);
+
+	if( fd < 0 )
+	{
+		printf("camera-capture:  failed to open %s\n", path.c_str());
+		return false;
+	}
+
+	data.resize(fileSize(path));
+
+	size_t offset = 0;
+
+	while( offset < data.size() )
+	{
+		const ssize_t count = read(fd, &data[offset], data.size() - offset);
+
+		if( count <= 0 )
+			break;
+
+		offset += count;
+	}
+
+	close(fd);
+
+	if( offset != data.size() )
+	{
+		printf("camera-capture:  failed to read %s\n", path.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+
+// migrateSample
+static bool migrateSample( const PendingSample& sample, uint64_t budgetStart, uint64_t& budgetBytes )
+{
+	METRICS_SCOPE("staging_migrate", "time to migrate a staged sample to the dataset");
+
+	std::vector<std::pair<std::string, std::string>> files;
+	std::vector<std::pair<std::string, std::string>> records;
+
+	if( !readManifest(sample.directory, files, records) )
+	{
+		printf("camera-capture:  failed to read the manifest of %s\n", sample.directory.c_str());
+		return false;
+	}
+
+	// the writes of the sample go in one batch:  the files first,
+	// and then the records, so that they only list complete samples
+	IOBatch batch;
+	uint64_t bytes = 0;
+
+	for( size_t n=0; n < files.size(); n++ )
+	{
+		const std::string& staged = files[n].first;
+		const std::string& final  = files[n].second;
+
+		// a recovered sample may have been partly migrated already
+		if( sample.recovered && access(staged.c_str(), F_OK) != 0 )
+		{
+			if( access(final.c_str(), F_OK) != 0 )
+				printf("camera-capture:  %s is missing from the staging area\n", staged.c_str());
+
+			continue;
+		}
+
+		std::string data;
+
+		if( !readFile(staged, data) )
+			return false;
+
+		DatasetWriter::MakeDirectory(final.substr(0, final.find_last_of('/')));
+
+		batch.Write(final, data);
+		bytes += data.size();
+	}
+
+	batch.Barrier();
+
+	for( size_t n=0; n < records.size(); n++ )
+	{
+		// don't append the records twice, if the previous run got that far
+		if( sample.recovered && hasRecord(records[n].first, records[n].second) )
+			continue;
+
+		batch.Append(records[n].first, records[n].second + "\n");
+	}
+
+	throttle(budgetStart, budgetBytes);
+	budgetBytes += bytes;
+
+	if( !batch.Submit() )
+	{
+		printf("camera-capture:  failed to migrate %s\n", sample.directory.c_str());
+		return false;
+	}
+
+	{
+		// the files are read from the dataset from now on
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for( size_t n=0; n < files.size(); n++ )
+			located.erase(files[n].second);
+	}
+
+	removeDirectory(sample.directory);
+	return true;
+}
+
+
+// migratorRun
+static void migratorRun()
+{
+	Tracer::SetThreadName("staging");
+
+	static MetricsValue* pendingGauge = Metrics::GetGauge("staging_pending", "staged samples waiting to be migrated");
+	static MetricsValue* bytesGauge   = Metrics::GetGauge("staging_bytes", "bytes in the staging area");
+
+	uint64_t budgetStart = Metrics::Now();
+	uint64_t budgetBytes = 0;
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while( true )
+	{
+		pendingGauge->Set(queue.size());
+		bytesGauge->Set(pendingBytes);
+
+		if( !stopping && queue.size() == 0 )
+		{
+			while( !stopping && queue.size() == 0 )
+				condition.wait(lock);
+
+			// the rate doesn't accumulate while idle
+			budgetStart = Metrics::Now();
+			budgetBytes = 0;
+		}
+
+		if( queue.size() == 0 )
+			break;	// stopping, and everything was migrated
+
+		const PendingSample sample = queue.front();
+
+		queue.pop_front();
+		migrating = true;
+
+		lock.unlock();
+		const bool result = migrateSample(sample, budgetStart, budgetBytes);
+		lock.lock();
+
+		migrating = false;
+
+		if( result )
+		{
+			pendingBytes -= std::min(sample.bytes, pendingBytes);
+			stalled = false;
+
+			migrated.notify_all();
+			continue;
+		}
+
+		// keep the samples in order, and try again later (i.e. once space is freed)
+		queue.push_front(sample);
+		stalled = true;
+
+		migrated.notify_all();
+
+		if( stopping )
+			break;
+
+		condition.wait_for(lock, std::chrono::seconds(RetryInterval));
+	}
+
+	if( queue.size() > 0 )
+		printf("camera-capture:  %zu samples are left in the staging area %s, they'll be migrated on the next run\n", queue.size(), stagingPath.c_str());
+
+	pendingGauge->Set(queue.size());
+	bytesGauge->Set(pendingBytes);
+}
+
+
+// Open
+bool DatasetStaging::Open( const std::string& path, uint64_t rate, uint64_t maxSize )
+{
+	Close();
+
+	if( path.size() == 0 || !DatasetWriter::MakeDirectory(path) )
+		return false;
+
+	// the staging area belongs to one process at a time (its samples are recovered by the next one)
+	const std::string lockPath = path + "/.lock";
+
+	lockFile = open(lockPath.c_str(), O_RDWR | O_CREAT, 0644);
+
+	if( lockFile < 0 || flock(lockFile, LOCK_EX | LOCK_NB) != 0 )
+	{
+		printf("camera-capture:  the staging area %s is used by another process\n", path.c_str());
+
+		if( lockFile >= 0 )
+			close(lockFile);
+
+		lockFile = -1;
+		return false;
+	}
+
+	// find the samples left by a previous run
+	std::vector<std::string> leftovers;
+	DIR* dir = opendir(path.c_str());
+
+	if( dir != NULL )
+	{
+		struct dirent* entry = NULL;
+
+		while( (entry = readdir(dir)) != NULL )
+		{
+			const size_t length = strlen(entry->d_name);
+
+			if( length > 0 && strspn(entry->d_name, "0123456789") == length )
+				leftovers.push_back(entry->d_name);
+		}
+
+		closedir(dir);
+	}
+
+	std::sort(leftovers.begin(), leftovers.end());
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	stagingPath   = path;
+	rateLimit     = rate;
+	maxStagedSize = maxSize;
+	nextSequence  = 0;
+	overLimit     = false;
+	stalled       = false;
+	stopping      = false;
+
+	int recovered = 0;
+	int discarded = 0;
+
+	for( size_t n=0; n < leftovers.size(); n++ )
+	{
+		const std::string directory = path + "/" + leftovers[n];
+
+		nextSequence = std::max<uint64_t>(nextSequence, strtoull(leftovers[n].c_str(), NULL, 10) + 1);
+
+		std::vector<std::pair<std::string, std::string>> files;
+		std::vector<std::pair<std::string, std::string>> records;
+
+		// the samples without a manifest weren't committed
+		if( !readManifest(directory, files, records) )
+		{
+			removeDirectory(directory);
+			discarded++;
+			continue;
+		}
+
+		PendingSample sample;
+
+		sample.directory = directory;
+		sample.bytes     = 0;
+		sample.recovered = true;
+
+		for( size_t f=0; f < files.size(); f++ )
+		{
+			sample.bytes += fileSize(files[f].first);
+			located[files[f].second] = files[f].first;
+		}
+
+		queue.push_back(sample);
+		pendingBytes += sample.bytes;
+		recovered++;
+	}
+
+	if( recovered > 0 || discarded > 0 )
+		printf("camera-capture:  recovered %i staged samples from %s (%i incomplete samples removed)\n", recovered, path.c_str(), discarded);
+
+	migrator = std::thread(migratorRun);
+
+	printf("camera-capture:  staging the samples in %s", path.c_str());
+
+	if( rate > 0 )
+		printf(" (migrating at up to %.1f MB/s)", rate / (1024.0 * 1024.0));
+
+	printf("\n");
+	return true;
+}
+
+
+// Close
+void DatasetStaging::Close()
+{
+	if( !migrator.joinable() )
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		stopping  = true;
+		rateLimit = 0;	// don't hold up the exit
+	}
+
+	condition.notify_all();
+	migrator.join();
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// the samples that failed are recovered by the next run
+	queue.clear();
+	located.clear();
+	pendingBytes = 0;
+	stagingPath.clear();
+
+	if( lockFile >= 0 )
+	{
+		close(lockFile);
+		lockFile = -1;
+	}
+}
+
+
+// IsEnabled
+bool DatasetStaging::IsEnabled()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stagingPath.size() > 0;
+}
+
+
+// Begin
+StagedSample DatasetStaging::Begin()
+{
+	static MetricsValue* bypassed = Metrics::GetCounter("staging_bypassed", "samples written to the dataset directly because the staging area was full");
+
+	StagedSample sample;
+	sample.sequence = 0;
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	if( stagingPath.size() == 0 )
+		return sample;
+
+	if( pendingBytes >= maxStagedSize )
+	{
+		if( !overLimit )
+			printf("camera-capture:  the staging area is full (%llu MB), writing to the dataset directly\n", (unsigned long long)(pendingBytes / (1024 * 1024)));
+
+		overLimit = true;
+		bypassed->Add();
+		return sample;
+	}
+
+	overLimit = false;
+
+	sample.sequence = nextSequence++;
+	const std::string directory = stagingPath + "/" + sequenceName(sample.sequence);
+
+	lock.unlock();
+
+	if( mkdir(directory.c_str(), 0755) != 0 )
+	{
+		printf("camera-capture:  failed to create directory %s\n", directory.c_str());
+		return sample;
+	}
+
+	sample.directory = directory;
+	return sample;
+}
+
+
+// Commit
+bool DatasetStaging::Commit( StagedSample& sample )
+{
+	IOBatch batch;
+
+	if( !sample.IsStaged() )
+	{
+		// the records are appended once the files are written
+		for( size_t n=0; n < sample.contents.size(); n++ )
+			batch.Write(sample.contents[n].first, sample.contents[n].second);
+
+		batch.Barrier();
+
+		for( size_t n=0; n < sample.records.size(); n++ )
+			batch.Append(sample.records[n].first, sample.records[n].second + "\n");
+
+		sample.contents.clear();
+		sample.records.clear();
+
+		return batch.Submit();
+	}
+
+	METRICS_SCOPE("staging_commit", "time to commit a sample to the staging area");
+
+	uint64_t bytes = 0;
+
+	// the files that were written already only need to be flushed
+	for( size_t n=0; n < sample.files.size(); n++ )
+	{
+		batch.Sync(sample.files[n].first);
+		bytes += fileSize(sample.files[n].first);
+	}
+
+	for( size_t n=0; n < sample.contents.size(); n++ )
+	{
+		batch.Write(sample.Path(sample.contents[n].first), sample.contents[n].second);
+		bytes += sample.contents[n].second.size();
+	}
+
+	sample.contents.clear();
+
+	// the manifest is written after the files (and renamed into place),
+	// so that a sample with a manifest is always complete
+	std::string manifest;
+
+	for( size_t n=0; n < sample.files.size(); n++ )
+		manifest += "file\t" + sample.files[n].second + "\t" + sample.files[n].first.substr(sample.directory.size() + 1) + "\n";
+
+	for( size_t n=0; n < sample.records.size(); n++ )
+		manifest += "record\t" + sample.records[n].first + "\t" + sample.records[n].second + "\n";
+
+	batch.Barrier();
+	batch.Write(sample.directory + "/manifest", manifest);
+
+	if( !batch.Submit() )
+	{
+		printf("camera-capture:  failed to stage %s\n", sample.directory.c_str());
+		Discard(sample);
+		return false;
+	}
+
+	PendingSample pending;
+
+	pending.directory = sample.directory;
+	pending.bytes     = bytes;
+	pending.recovered = false;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for( size_t n=0; n < sample.files.size(); n++ )
+			located[sample.files[n].second] = sample.files[n].first;
+
+		queue.push_back(pending);
+		pendingBytes += bytes;
+	}
+
+	condition.notify_all();
+	return true;
+}
+
+
+// Discard
+void DatasetStaging::Discard( StagedSample& sample )
+{
+	if( sample.IsStaged() )
+		removeDirectory(sample.directory);
+
+	sample.directory.clear();
+	sample.files.clear();
+	sample.contents.clear();
+	sample.records.clear();
+}
+
+
+// Flush
+void DatasetStaging::Flush()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	// a stalled migration is retried later, so it isn't waited for
+	while( migrator.joinable() && !stalled && (queue.size() > 0 || migrating) )
+		migrated.wait(lock);
+}
+
+
+// Locate
+std::string DatasetStaging::Locate( const std::string& finalPath )
+{
+	// the files are renamed into the dataset before they're removed from the staging area
+	if( access(finalPath.c_str(), F_OK) == 0 )
+		return finalPath;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	const std::map<std::string, std::string>::const_iterator iter = located.find(finalPath);
+
+	if( iter == located.end() )
+		return finalPath;
+
+	return iter->second;
+}
+
+
+// GetPendingCount
+int DatasetStaging::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return queue.size() + (migrating ? 1 : 0);
+}
+
+
+// GetPendingBytes
+uint64_t DatasetStaging::GetPendingBytes()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return pendingBytes;
+}
+
+
+// Usage
+const char* DatasetStaging::Usage()
+{
+	return "staging arguments:\n"
+		  "  --staging=DIR              write the samples to DIR first (i.e. on tmpfs or NVMe),\n"
+		  "                             and move them to the dataset in the background\n"
+		  "  --staging-rate=MB          max rate of moving them to the dataset (in MB/s,\n"
+		  "                             default unlimited)\n"
+		  "  --staging-size=MB          size limit of the staging area, past which the samples\n"
+		  "                             are written to the dataset directly (default 256MB)\n\n";
+}
+
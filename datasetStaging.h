@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_DATASET_STAGING__
+#define __CAMERA_DATASET_STAGING__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <utility>
+
+
+/*
+ * Files of a sample being saved, and the records to append once it's in
+ * the dataset (i.e. the image sets).  The writers ask the sample where to
+ * write each file:  the staging area if the sample is staged, or the final
+ * path in the dataset if it isn't (see DatasetStaging::Begin()).
+ */
+class StagedSample
+{
+public:
+	// the path to write a file to, for its final path in the dataset
+	inline std::string Path( const std::string& finalPath )
+	{
+		if( directory.size() == 0 )
+			return finalPath;
+
+		const size_t slash = finalPath.find_last_of('/');
+		const std::string staged = directory + "/" + std::to_string(files.size()) + "-" + ((slash != std::string::npos) ? finalPath.substr(slash + 1) : finalPath);
+
+		files.push_back(std::make_pair(staged, finalPath));
+		return staged;
+	}
+
+	// write a file of the dataset from memory (along with the other files, when the sample is committed)
+	inline void Write( const std::string& finalPath, const std::string& data )	{ contents.push_back(std::make_pair(finalPath, data)); }
+
+	// append a record (one line, without the newline) to a file of the dataset
+	inline void Append( const std::string& finalPath, const std::string& record )	{ records.push_back(std::make_pair(finalPath, record)); }
+
+	// is the sample written to the staging area?
+	inline bool IsStaged() const				{ return directory.size() > 0; }
+
+protected:
+	friend class DatasetStaging;
+
+	std::string directory;	// in the staging area (empty if not staged)
+	uint64_t    sequence;
+
+	std::vector<std::pair<std::string, std::string>> files;	// staged path, final path
+	std::vector<std::pair<std::string, std::string>> contents;	// final path, data
+	std::vector<std::pair<std::string, std::string>> records;	// final path, record
+};
+
+
+/*
+ * Staging area on fast storage (i.e. tmpfs or NVMe) for the samples saved
+ * to a dataset on slow storage (i.e. eMMC), see --staging.
+ *
+ * The samples are written to the staging area, and a background thread
+ * migrates them to the dataset in the order they were committed, at up to
+ * --staging-rate.  Each file is written next to its final path under a hidden
+ * name and renamed into place, so the dataset only ever has complete files,
+ * and the records of a sample are appended once all of its files are in.
+ * The writes of a sample are submitted together as an IOBatch.
+ *
+ * A sample is committed by writing its manifest, so a staged sample without
+ * one is incomplete.  When the staging area is opened, the committed samples
+ * left by a previous run are migrated, and the incomplete ones are removed.
+ * While the staging area is over its size limit, the new samples are written
+ * to the dataset directly.
+ */
+class DatasetStaging
+{
+public:
+	// open the staging area and start migrating (the rate is in bytes per second, 0 = unlimited)
+	static bool Open( const std::string& path, uint64_t rate=0, uint64_t maxSize=DefaultMaxSize );
+
+	// migrate the samples that are left at full speed, and close the staging area
+	static void Close();
+
+	// is the staging area open?
+	static bool IsEnabled();
+
+	// start a new sample (staged if the staging area is open and has room)
+	static StagedSample Begin();
+
+	// commit a sample whose files were written, so that it's migrated
+	// (or write its contents and append its records now, if it isn't staged)
+	static bool Commit( StagedSample& sample );
+
+	// remove the files of a sample that failed to be written
+	static void Discard( StagedSample& sample );
+
+	// wait for the committed samples to be migrated
+	static void Flush();
+
+	// where a file of the dataset can be read from (the staging area if it isn't migrated yet)
+	static std::string Locate( const std::string& finalPath );
+
+	// samples and bytes waiting to be migrated
+	static int GetPendingCount();
+	static uint64_t GetPendingBytes();
+
+	// usage string for the command line arguments
+	static const char* Usage();
+
+	// default size limit of the staging area (in bytes)
+	static const uint64_t DefaultMaxSize = 256 * 1024 * 1024;
+};
+
+#endif
+
@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "datasetWriter.h"
+#include "metrics.h"
+
+#include <mutex>
+#include <stdio.h>
+#include <ctype.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+
+// writer ID of this process (empty unless in multi-writer mode)
+static std::string writerID;
+
+
+// Timestamp
+std::string DatasetWriter::Timestamp()
+{
+	const time_t now = time(NULL);
+
+	struct tm local;
+	localtime_r(&now, &local);
+
+	char str[32];
+	strftime(str, sizeof(str), "%Y%m%d-%H%M%S", &local);
+
+	return str;
+}
+
+
+// SampleName
+std::string DatasetWriter::SampleName()
+{
+	static std::mutex mutex;
+	static std::string lastTimestamp;
+	static int count = 0;
+
+	const std::string timestamp = Timestamp();
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if( timestamp == lastTimestamp )
+		count++;
+	else
+		count = 0;
+
+	lastTimestamp = timestamp;
+
+	// the writer ID keeps the names of different processes apart, and
+	// the counter the names of this process, without checking the disk
+	std::string name = timestamp;
+
+	if( writerID.size() > 0 )
+		name += "-" + writerID;
+
+	if( count > 0 )
+		name += "-" + std::to_string(count);
+
+	return name;
+}
+
+
+// SetWriterID
+void DatasetWriter::SetWriterID( const std::string& id )
+{
+	writerID = (id.size() > 0) ? id : "p" + std::to_string(getpid());
+
+	// the ID is part of the filenames
+	for( size_t n=0; n < writerID.size(); n++ )
+	{
+		if( !isalnum(writerID[n]) && writerID[n] != '_' )
+			writerID[n] = '_';
+	}
+
+	printf("camera-capture:  multi-writer mode, the samples are named with writer ID '%s'\n", writerID.c_str());
+}
+
+
+// IsMultiWriter
+bool DatasetWriter::IsMultiWriter()
+{
+	return writerID.size() > 0;
+}
+
+
+// GetWriterID
+const std::string& DatasetWriter::GetWriterID()
+{
+	return writerID;
+}
+
+
+// MakeDirectory
+bool DatasetWriter::MakeDirectory( const std::string& path )
+{
+	if( path.size() == 0 )
+		return false;
+
+	// create each of the parents in turn
+	for( size_t n=1; n <= path.size(); n++ )
+	{
+		if( n < path.size() && path[n] != '/' )
+			continue;
+
+		const std::string dir = path.substr(0, n);
+
+		// another process may be creating the same directories
+		if( mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST )
+		{
+			printf("camera-capture:  failed to create directory %s\n", dir.c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+// CountFiles
+int DatasetWriter::CountFiles( const std::string& path )
+{
+	DIR* dir = opendir(path.c_str());
+
+	if( !dir )
+		return 0;
+
+	// only the names are read, the files aren't stat'ed
+	int count = 0;
+	struct dirent* entry = NULL;
+
+	while( (entry = readdir(dir)) != NULL )
+	{
+		if( entry->d_name[0] != '.' )
+			count++;
+	}
+
+	closedir(dir);
+	return count;
+}
+
+
+// OriginalsDirectory
+std::string DatasetWriter::OriginalsDirectory( const std::string& root )
+{
+	return root + "/originals";
+}
+
+
+// ClassifyDirectory
+std::string DatasetWriter::ClassifyDirectory( const std::string& root, const std::string& set, const std::string& classLabel )
+{
+	return root + "/" + set + "/" + classLabel;
+}
+
+
+// CreateClassifyDirectories
+bool DatasetWriter::CreateClassifyDirectories( const std::string& root, const std::vector<std::string>& sets, const std::vector<std::string>& classLabels )
+{
+	bool result = true;
+
+	for( size_t s=0; s < sets.size(); s++ )
+	{
+		for( size_t n=0; n < classLabels.size(); n++ )
+		{
+			if( !MakeDirectory(ClassifyDirectory(root, sets[s], classLabels[n])) )
+				result = false;
+		}
+	}
+
+	return result;
+}
+
+
+// ImagePath
+std::string DatasetWriter::ImagePath( const std::string& root, const std::string& name )
+{
+	return root + "/JPEGImages/" + name + ".jpg";
+}
+
+
+// AnnotationPath
+std::string DatasetWriter::AnnotationPath( const std::string& root, const std::string& name )
+{
+	return root + "/Annotations/" + name + ".xml";
+}
+
+
+// CreateDetectionDirectories
+bool DatasetWriter::CreateDetectionDirectories( const std::string& root )
+{
+	return MakeDirectory(root + "/Annotations") &&
+		  MakeDirectory(root + "/ImageSets/Main") &&
+		  MakeDirectory(root + "/JPEGImages");
+}
+
+
+// SaveAnnotations
+bool DatasetWriter::SaveAnnotations( const std::string& root, const std::string& name, int imgWidth, int imgHeight,
+							  const AnnotationModel& annotations, const std::vector<std::string>& classLabels,
+							  StagedSample* sample )
+{
+	METRICS_SCOPE("save_annotations", "time to generate and write the XML annotations");
+
+	const size_t folder = root.find_last_of('/');
+	const std::string datasetName = (folder != std::string::npos) ? root.substr(folder + 1) : root;
+	const std::string imgFilename = name + ".jpg";
+
+	// written with the other files of the sample when it's committed
+	if( sample != NULL )
+	{
+		std::string xml;
+
+		if( !annotations.FormatVOC(xml, imgFilename.c_str(), datasetName.c_str(), imgWidth, imgHeight, classLabels) )
+			return false;
+
+		sample->Write(AnnotationPath(root, name), xml);
+		return true;
+	}
+
+	return annotations.SaveVOC(AnnotationPath(root, name).c_str(), imgFilename.c_str(), datasetName.c_str(),
+						  imgWidth, imgHeight, classLabels);
+}
+
+
+// AddToImageSets
+bool DatasetWriter::AddToImageSets( const std::string& root, const std::string& set, const std::string& name, bool mergeSets, StagedSample* sample )
+{
+	if( mergeSets )
+	{
+		return AddToImageSet(root, "train", name, sample) &&
+			  AddToImageSet(root, "trainval", name, sample) &&
+			  AddToImageSet(root, "test", name, sample) &&
+			  AddToImageSet(root, "val", name, sample);
+	}
+
+	if( !AddToImageSet(root, set, name, sample) )
+		return false;
+
+	if( set == "train" || set == "val" )
+		return AddToImageSet(root, "trainval", name, sample);
+
+	return true;
+}
+
+
+// AddToImageSet
+bool DatasetWriter::AddToImageSet( const std::string& root, const std::string& set, const std::string& name, StagedSample* sample )
+{
+	METRICS_SCOPE("image_set_append", "time to append a sample to an image set");
+
+	const std::string filename = root + "/ImageSets/Main/" + set + ".txt";
+
+	if( name.size() + 1 > MaxRecordSize )
+	{
+		printf("camera-capture:  the sample name %s is too long for %s\n", name.c_str(), filename.c_str());
+		return false;
+	}
+
+	// appended with the other writes of the sample when it's committed (or migrated)
+	if( sample != NULL )
+	{
+		sample->Append(filename, name);
+		return true;
+	}
+
+	return AppendRecord(filename, name + "\n");
+}
+
+
+// AppendRecord
+bool DatasetWriter::AppendRecord( const std::string& filename, const std::string& record )
+{
+	const int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+
+	if( fd < 0 )
+	{
+		printf("camera-capture:  failed to open %s\n", filename.c_str());
+		return false;
+	}
+
+	// the whole record goes in one write, so that it can't interleave with
+	// the records appended by other processes at the same time
+	const ssize_t written = write(fd, record.c_str(), record.size());
+
+	if( close(fd) != 0 || written != (ssize_t)record.size() )
+	{
+		printf("camera-capture:  failed to save %s\n", filename.c_str());
+		return false;
+	}
+
+	return true;
+}
+
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_DATASET_WRITER__
+#define __CAMERA_DATASET_WRITER__
+
+#include "annotationModel.h"
+#include "datasetStaging.h"
+
+#include <string>
+#include <vector>
+
+
+/*
+ * Layout of the datasets written by the capture tool (and the tools/ programs):
+ *
+ *   classification:  <root>/<set>/<class>/<name>.jpg
+ *
+ *   detection:       <root>/JPEGImages/<name>.jpg
+ *                    <root>/Annotations/<name>.xml     (Pascal VOC)
+ *                    <root>/ImageSets/Main/<set>.txt   (list of names)
+ *
+ * The images can be saved at a smaller output geometry than the camera's
+ * (see OutputGeometry), and the full-resolution frames kept under
+ * <root>/originals/ in the same layout.
+ *
+ * These don't depend on Qt, so that the command-line tools can share them.
+ *
+ * Several processes can write to the same dataset (i.e. one per camera) in
+ * multi-writer mode:  the sample names include a writer ID that's unique to
+ * each process, and the image sets are appended with a single O_APPEND write
+ * per record, so the records of different processes don't interleave.
+ *
+ * The samples can go through a staging area on faster storage first (see
+ * DatasetStaging):  the writers take the StagedSample that the files and
+ * records of the sample are written to.
+ */
+class DatasetWriter
+{
+public:
+	// the current time (yyyyMMdd-hhmmss)
+	static std::string Timestamp();
+
+	// unique name for a new sample (the timestamp, the writer ID in multi-writer
+	// mode, and a counter if more than one sample is saved in the same second)
+	static std::string SampleName();
+
+	// enable multi-writer mode with an ID that's unique to this process
+	// (an empty ID uses the process ID)
+	static void SetWriterID( const std::string& id );
+
+	// multi-writer mode status
+	static bool IsMultiWriter();
+	static const std::string& GetWriterID();
+
+	// create a directory and its parents
+	static bool MakeDirectory( const std::string& path );
+
+	// number of files in a directory (not counting hidden files)
+	static int CountFiles( const std::string& path );
+
+	// the full-resolution frames of a dataset (<root>/originals)
+	static std::string OriginalsDirectory( const std::string& root );
+
+	// classification datasets
+	static std::string ClassifyDirectory( const std::string& root, const std::string& set, const std::string& classLabel );
+	static bool CreateClassifyDirectories( const std::string& root, const std::vector<std::string>& sets, const std::vector<std::string>& classLabels );
+
+	// detection datasets
+	static std::string ImagePath( const std::string& root, const std::string& name );
+	static std::string AnnotationPath( const std::string& root, const std::string& name );
+
+	static bool CreateDetectionDirectories( const std::string& root );
+
+	// save the annotations of a detection sample
+	static bool SaveAnnotations( const std::string& root, const std::string& name, int imgWidth, int imgHeight,
+						    const AnnotationModel& annotations, const std::vector<std::string>& classLabels,
+						    StagedSample* sample=NULL );
+
+	// add a detection sample to an image set (train and val are also added to trainval,
+	// and with mergeSets the sample is added to all of the sets)
+	static bool AddToImageSets( const std::string& root, const std::string& set, const std::string& name, bool mergeSets=false, StagedSample* sample=NULL );
+	static bool AddToImageSet( const std::string& root, const std::string& set, const std::string& name, StagedSample* sample=NULL );
+
+	// append a record (ending in a newline) to a file with a single write
+	static bool AppendRecord( const std::string& filename, const std::string& record );
+
+	// maximum length of an image set record (so that it's appended with one write)
+	static const size_t MaxRecordSize = 256;
+};
+
+#endif
+
@@ -0,0 +1,692 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "diversityIndex.h"
+#include "datasetWriter.h"
+#include "metrics.h"
+#include "tracer.h"
+
+#include "cudaMappedMemory.h"
+#include "imageIO.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+
+#define INDEX_MAGIC   "CCDS"
+#define INDEX_VERSION 1
+
+
+/*
+ * Index file header, followed by the records
+ */
+struct DiversityHeader
+{
+	char     magic[4];		// INDEX_MAGIC
+	uint32_t version;
+	uint32_t recordSize;	// sizeof(DiversityRecord)
+	uint32_t reserved;
+};
+
+
+// recordChecksum (FNV-1a)
+static uint32_t recordChecksum( const DiversityRecord& record )
+{
+	uint32_t hash = 2166136261u;
+
+	const uint8_t* name = (const uint8_t*)record.name;
+	const uint8_t* signature = (const uint8_t*)&record.signature;
+
+	for( size_t n=0; n < sizeof(record.name); n++ )
+		hash = (hash ^ name[n]) * 16777619u;
+
+	for( size_t n=0; n < sizeof(record.signature); n++ )
+		hash = (hash ^ signature[n]) * 16777619u;
+
+	return hash;
+}
+
+
+// isImageFile
+static bool isImageFile( const char* filename )
+{
+	const char* ext = strrchr(filename, '.');
+
+	if( !ext )
+		return false;
+
+	return strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".jpeg") == 0 || strcasecmp(ext, ".png") == 0;
+}
+
+
+// listImages (recursively, relative to the dataset)
+static void listImages( const std::string& root, const std::string& subdir, std::vector<std::string>& images )
+{
+	const std::string path = (subdir.size() > 0) ? root + "/" + subdir : root;
+
+	DIR* dir = opendir(path.c_str());
+
+	if( !dir )
+		return;
+
+	struct dirent* entry = NULL;
+
+	while( (entry = readdir(dir)) != NULL )
+	{
+		// skip hidden files, and the . and .. entries
+		if( entry->d_name[0] == '.' )
+			continue;
+
+		const std::string name = (subdir.size() > 0) ? subdir + "/" + entry->d_name : std::string(entry->d_name);
+
+		bool isDir = (entry->d_type == DT_DIR);
+
+		if( entry->d_type == DT_UNKNOWN )
+		{
+			struct stat info;
+			isDir = (stat((root + "/" + name).c_str(), &info) == 0) && S_ISDIR(info.st_mode);
+		}
+
+		if( isDir )
+			listImages(root, name, images);
+		else if( isImageFile(entry->d_name) )
+			images.push_back(name);
+	}
+
+	closedir(dir);
+}
+
+
+// images waiting to be indexed, across the indexes
+static MetricsValue* indexQueue = Metrics::GetGauge("index_queue_depth", "dataset images waiting to be indexed");
+
+
+// constructor
+DiversityIndex::DiversityIndex()
+{
+	fd         = -1;
+	fileOffset = 0;
+	numRemoved = 0;
+	stopping   = false;
+	busy       = false;
+
+	// the hash bits are fixed, so the buckets are the same each time the index is loaded
+	// (only the block means are hashed, most of the histogram bins are empty)
+	std::mt19937 rng(0x5eed);
+
+	for( int t=0; t < NumTables; t++ )
+	{
+		for( int b=0; b < NumBits; b++ )
+		{
+			hashElements[t][b]   = rng() % (FrameSignature::GridSize * FrameSignature::GridSize);
+			hashThresholds[t][b] = 64 + rng() % 128;
+		}
+	}
+
+	thread = std::thread(&DiversityIndex::run, this);
+}
+
+
+// destructor
+DiversityIndex::~DiversityIndex()
+{
+	Close();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	condition.notify_all();
+	thread.join();
+}
+
+
+// Open
+bool DiversityIndex::Open( const std::string& path )
+{
+	Close();
+
+	if( path.size() == 0 )
+		return false;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	datasetPath = path;
+	filename    = path + "/.signatures";
+
+	// load the saved signatures
+	bool valid = false;
+	FILE* file = fopen(filename.c_str(), "rb");
+	const bool exists = (file != NULL);
+
+	if( file != NULL )
+	{
+		DiversityHeader header;
+
+		valid = (fread(&header, sizeof(header), 1, file) == 1)
+			&& memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) == 0
+			&& header.version == INDEX_VERSION
+			&& header.recordSize == sizeof(DiversityRecord);
+
+		fileOffset = sizeof(header);
+
+		if( valid )
+			load(file);
+
+		fclose(file);
+	}
+
+	// compare the index with the images in the dataset
+	std::vector<std::string> images;
+	listImages(datasetPath, "", images);
+
+	std::set<std::string> existing(images.begin(), images.end());
+
+	for( size_t n=0; n < signatures.size(); n++ )
+	{
+		if( !removed[n] && existing.count(entryNames[n]) == 0 )
+		{
+			removed[n] = true;
+			numRemoved++;
+		}
+	}
+
+	for( size_t n=0; n < images.size(); n++ )
+	{
+		if( names.count(images[n]) == 0 )
+			queue.push_back(images[n]);
+	}
+
+	if( DatasetWriter::IsMultiWriter() )
+	{
+		// other processes may be appending to the file, so it's never rewritten
+		if( !exists )
+			create();
+		else if( !valid )
+			printf("camera-capture:  invalid dataset index %s (it isn't rebuilt in multi-writer mode)\n", filename.c_str());
+	}
+	else if( !valid || numRemoved > 0 )
+	{
+		// rewrite the file if it's missing, invalid, or has stale records
+		compact();
+	}
+
+	if( valid || !exists || !DatasetWriter::IsMultiWriter() )
+	{
+		fd = open(filename.c_str(), O_WRONLY | O_APPEND);
+
+		if( fd < 0 )
+			printf("camera-capture:  failed to open dataset index %s (%s)\n", filename.c_str(), strerror(errno));
+	}
+
+	printf("camera-capture:  loaded dataset index %s (%zu images, %zu to index)\n", filename.c_str(), signatures.size() - numRemoved, queue.size());
+
+	condition.notify_all();
+	return true;
+}
+
+
+// Close
+void DiversityIndex::Close()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	queue.clear();
+
+	// wait for the image being indexed
+	while( busy )
+		condition.wait(lock);
+
+	if( fd >= 0 )
+	{
+		close(fd);
+		fd = -1;
+	}
+
+	if( numRemoved > 0 && !DatasetWriter::IsMultiWriter() )
+		compact();
+
+	for( int t=0; t < NumTables; t++ )
+	{
+		for( int b=0; b < (1 << NumBits); b++ )
+			buckets[t][b].clear();
+	}
+
+	signatures.clear();
+	entryNames.clear();
+	removed.clear();
+	names.clear();
+
+	numRemoved = 0;
+	fileOffset = 0;
+
+	datasetPath.clear();
+	filename.clear();
+}
+
+
+// Refresh
+void DiversityIndex::Refresh()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if( filename.size() == 0 )
+		return;
+
+	// only read the file when another process appended to it
+	struct stat info;
+
+	if( stat(filename.c_str(), &info) != 0 || info.st_size < fileOffset + (off_t)sizeof(DiversityRecord) )
+		return;
+
+	FILE* file = fopen(filename.c_str(), "rb");
+
+	if( !file )
+		return;
+
+	if( fseeko(file, fileOffset, SEEK_SET) == 0 )
+		load(file);
+
+	fclose(file);
+}
+
+
+// load
+void DiversityIndex::load( FILE* file )
+{
+	DiversityRecord record;
+
+	// stop at the first record that wasn't completely written (it's read again by the next refresh)
+	while( fread(&record, sizeof(record), 1, file) == 1 )
+	{
+		if( record.checksum != recordChecksum(record) )
+			break;
+
+		record.name[sizeof(record.name) - 1] = '\0';
+		fileOffset += sizeof(record);
+
+		// the records appended by this process are read back too
+		std::map<std::string, int>::const_iterator iter = names.find(record.name);
+
+		if( iter != names.end() && !removed[iter->second] && memcmp(&signatures[iter->second], &record.signature, sizeof(FrameSignature)) == 0 )
+			continue;
+
+		insert(record.name, record.signature);
+	}
+}
+
+
+// GetCount
+int DiversityIndex::GetCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return signatures.size() - numRemoved;
+}
+
+
+// GetPending
+int DiversityIndex::GetPending() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return queue.size() + (busy ? 1 : 0);
+}
+
+
+// Add
+bool DiversityIndex::Add( const std::string& path, const FrameSignature& signature )
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if( datasetPath.size() == 0 )
+		return false;
+
+	std::string name = path;
+
+	if( name.compare(0, datasetPath.size() + 1, datasetPath + "/") == 0 )
+		name = name.substr(datasetPath.size() + 1);
+
+	insert(name, signature);
+	return append(name, signature);
+}
+
+
+// insert
+void DiversityIndex::insert( const std::string& name, const FrameSignature& signature )
+{
+	std::map<std::string, int>::iterator iter = names.find(name);
+
+	// an image that was overwritten replaces its old signature
+	if( iter != names.end() && !removed[iter->second] )
+	{
+		removed[iter->second] = true;
+		numRemoved++;
+	}
+
+	const uint32_t index = signatures.size();
+
+	signatures.push_back(signature);
+	entryNames.push_back(name);
+	removed.push_back(false);
+
+	names[name] = index;
+
+	for( int t=0; t < NumTables; t++ )
+		buckets[t][hash(t, signature)].push_back(index);
+}
+
+
+// append
+bool DiversityIndex::append( const std::string& name, const FrameSignature& signature )
+{
+	if( fd < 0 )
+		return false;
+
+	if( name.size() >= sizeof(DiversityRecord::name) )
+	{
+		printf("camera-capture:  the path %s is too long for the dataset index\n", name.c_str());
+		return false;
+	}
+
+	DiversityRecord record;
+	memset(&record, 0, sizeof(record));
+
+	strncpy(record.name, name.c_str(), sizeof(record.name) - 1);
+
+	record.signature = signature;
+	record.checksum  = recordChecksum(record);
+
+	if( write(fd, &record, sizeof(record)) != sizeof(record) )
+	{
+		printf("camera-capture:  failed to write dataset index %s\n", filename.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+
+// create
+void DiversityIndex::create()
+{
+	// only one of the processes creating the file at the same time succeeds
+	const int fileDesc = open(filename.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+
+	if( fileDesc < 0 )
+	{
+		if( errno != EEXIST )
+			printf("camera-capture:  failed to create dataset index %s\n", filename.c_str());
+
+		return;
+	}
+
+	DiversityHeader header;
+	memset(&header, 0, sizeof(header));
+
+	memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+
+	header.version    = INDEX_VERSION;
+	header.recordSize = sizeof(DiversityRecord);
+
+	if( write(fileDesc, &header, sizeof(header)) != sizeof(header) )
+		printf("camera-capture:  failed to write dataset index %s\n", filename.c_str());
+
+	close(fileDesc);
+	fileOffset = sizeof(header);
+}
+
+
+// compact
+void DiversityIndex::compact()
+{
+	const std::string tmpFilename = filename + ".tmp";
+	FILE* file = fopen(tmpFilename.c_str(), "wb");
+
+	if( !file )
+	{
+		printf("camera-capture:  failed to write dataset index %s\n", tmpFilename.c_str());
+		return;
+	}
+
+	DiversityHeader header;
+	memset(&header, 0, sizeof(header));
+
+	memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+
+	header.version    = INDEX_VERSION;
+	header.recordSize = sizeof(DiversityRecord);
+
+	bool result = (fwrite(&header, sizeof(header), 1, file) == 1);
+	off_t size = sizeof(header);
+
+	for( size_t n=0; n < signatures.size() && result; n++ )
+	{
+		if( removed[n] || entryNames[n].size() >= sizeof(DiversityRecord::name) )
+			continue;
+
+		DiversityRecord record;
+		memset(&record, 0, sizeof(record));
+
+		strncpy(record.name, entryNames[n].c_str(), sizeof(record.name) - 1);
+
+		record.signature = signatures[n];
+		record.checksum  = recordChecksum(record);
+
+		result = (fwrite(&record, sizeof(record), 1, file) == 1);
+		size += sizeof(record);
+	}
+
+	if( fclose(file) != 0 || !result || rename(tmpFilename.c_str(), filename.c_str()) != 0 )
+	{
+		printf("camera-capture:  failed to write dataset index %s\n", filename.c_str());
+		unlink(tmpFilename.c_str());
+		return;
+	}
+
+	fileOffset = size;
+}
+
+
+// hash
+uint32_t DiversityIndex::hash( int table, const FrameSignature& signature ) const
+{
+	uint32_t code = 0;
+
+	for( int b=0; b < NumBits; b++ )
+	{
+		if( signature.blocks[hashElements[table][b]] > hashThresholds[table][b] )
+			code |= (1 << b);
+	}
+
+	return code;
+}
+
+
+// nearest
+float DiversityIndex::nearest( const FrameSignature& signature, int* nearestEntry ) const
+{
+	float minDistance = 1.0f;
+	int minEntry = -1;
+
+	if( signatures.size() <= (size_t)ExhaustiveLimit )
+	{
+		for( size_t n=0; n < signatures.size(); n++ )
+		{
+			if( removed[n] )
+				continue;
+
+			const float distance = signature.Distance(signatures[n]);
+
+			if( distance < minDistance )
+			{
+				minDistance = distance;
+				minEntry = n;
+			}
+		}
+	}
+	else
+	{
+		// the near images share a bucket with the frame in at least one of the tables
+		for( int t=0; t < NumTables; t++ )
+		{
+			const std::vector<uint32_t>& bucket = buckets[t][hash(t, signature)];
+
+			for( size_t n=0; n < bucket.size(); n++ )
+			{
+				if( removed[bucket[n]] )
+					continue;
+
+				const float distance = signature.Distance(signatures[bucket[n]]);
+
+				if( distance < minDistance )
+				{
+					minDistance = distance;
+					minEntry = bucket[n];
+				}
+			}
+		}
+	}
+
+	if( nearestEntry != NULL )
+		*nearestEntry = minEntry;
+
+	return minDistance;
+}
+
+
+// Nearest
+float DiversityIndex::Nearest( const FrameSignature& signature, std::string* nearestFilename ) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	int entry = -1;
+	const float distance = nearest(signature, &entry);
+
+	if( nearestFilename != NULL )
+		*nearestFilename = (entry >= 0) ? entryNames[entry] : std::string();
+
+	return distance;
+}
+
+
+// SelectKCenter
+std::vector<int> DiversityIndex::SelectKCenter( const std::vector<FrameSignature>& candidates, int k, float threshold ) const
+{
+	std::vector<int> selected;
+	std::vector<float> distances(candidates.size());
+
+	// start from the distance of each candidate to the dataset
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for( size_t n=0; n < candidates.size(); n++ )
+			distances[n] = nearest(candidates[n], NULL);
+	}
+
+	while( (int)selected.size() < k )
+	{
+		int farthest = -1;
+
+		for( size_t n=0; n < candidates.size(); n++ )
+		{
+			if( distances[n] >= threshold && (farthest < 0 || distances[n] > distances[farthest]) )
+				farthest = n;
+		}
+
+		if( farthest < 0 )
+			break;
+
+		selected.push_back(farthest);
+
+		// the rest are now also compared to the one that was picked
+		for( size_t n=0; n < candidates.size(); n++ )
+			distances[n] = std::min(distances[n], candidates[n].Distance(candidates[farthest]));
+	}
+
+	return selected;
+}
+
+
+// run
+void DiversityIndex::run()
+{
+	Tracer::SetThreadName("diversity index");
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while( true )
+	{
+		while( !stopping && queue.size() == 0 )
+			condition.wait(lock);
+
+		if( stopping )
+			break;
+
+		const std::string name = queue.front();
+		const std::string path = datasetPath + "/" + name;
+
+		queue.pop_front();
+		busy = true;
+
+		indexQueue->Set(queue.size());
+		lock.unlock();
+
+		uchar3* image = NULL;
+		int width  = 0;
+		int height = 0;
+
+		FrameSignature signature;
+		const bool loaded = loadImage(path.c_str(), &image, &width, &height);
+
+		if( loaded )
+		{
+			signature.Compute(image, width, height);
+			CUDA(cudaFreeHost(image));
+		}
+
+		lock.lock();
+		busy = false;
+
+		// Close() waits for the image being indexed, so the dataset is still the same
+		if( loaded )
+		{
+			insert(name, signature);
+			append(name, signature);
+		}
+		else
+		{
+			printf("camera-capture:  failed to load %s for the dataset index\n", path.c_str());
+		}
+
+		condition.notify_all();
+	}
+}
+
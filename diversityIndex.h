@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_DIVERSITY_INDEX__
+#define __CAMERA_DIVERSITY_INDEX__
+
+#include "frameSignature.h"
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+/*
+ * Signature record of the index file (<dataset>/.signatures)
+ */
+struct DiversityRecord
+{
+	char           name[124];		// image path, relative to the dataset
+	uint32_t       checksum;		// of the name and signature, so a torn write at the tail is detected
+	FrameSignature signature;
+};
+
+
+/*
+ * Index of the signatures of every image in a dataset, to tell how much
+ * a new frame would add to the dataset (the distance to its nearest image).
+ *
+ * The index is saved alongside the dataset, and each new image is appended
+ * to it as it's saved.  When a dataset is opened, the images that aren't in
+ * the index yet (i.e. they were copied in, or saved by another mode) are
+ * indexed by a background thread.  In multi-writer mode, the records that
+ * other processes append to the index are picked up by Refresh().
+ *
+ * The nearest image is found by locality-sensitive hashing once the dataset
+ * is large:  each table hashes a signature by thresholding a few random
+ * block means of it, and only the images in the same bucket of one of the
+ * tables are compared.  Small datasets are searched exhaustively.
+ */
+class DiversityIndex
+{
+public:
+	// constructor
+	DiversityIndex();
+
+	// destructor
+	~DiversityIndex();
+
+	// open the index of a dataset
+	bool Open( const std::string& datasetPath );
+
+	// close the index (drops the images that were removed from the file)
+	void Close();
+
+	// add an image that was just saved (the filename can be absolute or relative to the dataset)
+	bool Add( const std::string& filename, const FrameSignature& signature );
+
+	// read the records that other processes appended to the index file
+	void Refresh();
+
+	// distance to the nearest image in the dataset (1.0 if it's empty)
+	float Nearest( const FrameSignature& signature, std::string* filename=NULL ) const;
+
+	// greedily pick up to k of the candidates that add the most coverage (k-center),
+	// ignoring those closer than the threshold to the dataset or to the ones picked
+	std::vector<int> SelectKCenter( const std::vector<FrameSignature>& candidates, int k, float threshold ) const;
+
+	// number of images indexed
+	int GetCount() const;
+
+	// number of images still being indexed in the background
+	int GetPending() const;
+
+	// is a dataset open?
+	inline bool IsOpen() const				{ return datasetPath.size() > 0; }
+
+	// default distance for a frame to be considered new
+	static constexpr float DefaultThreshold = 0.1f;
+
+	// hashing parameters
+	static const int NumTables = 8;
+	static const int NumBits   = 12;
+
+	// datasets smaller than this are searched exhaustively
+	static const int ExhaustiveLimit = 16384;
+
+protected:
+	void run();
+	void load( FILE* file );
+	void create();
+	void insert( const std::string& name, const FrameSignature& signature );
+	bool append( const std::string& name, const FrameSignature& signature );
+	void compact();
+
+	uint32_t hash( int table, const FrameSignature& signature ) const;
+	float nearest( const FrameSignature& signature, int* entry ) const;
+
+	std::string datasetPath;
+	std::string filename;
+	off_t fileOffset;	// the end of the records read from the file
+	int fd;
+
+	// the signatures are kept together, so they're scanned sequentially
+	std::vector<FrameSignature> signatures;
+	std::vector<std::string>    entryNames;
+	std::vector<uint8_t>        removed;	// the image no longer exists, or was overwritten
+
+	std::map<std::string, int> names;
+	std::vector<uint32_t> buckets[NumTables][1 << NumBits];	// entries in each bucket
+	int numRemoved;
+
+	// elements and thresholds of the hash bits
+	uint8_t hashElements[NumTables][NumBits];
+	uint8_t hashThresholds[NumTables][NumBits];
+
+	// images waiting to be indexed
+	std::deque<std::string> queue;
+
+	std::thread thread;
+	mutable std::mutex mutex;
+	std::condition_variable condition;
+
+	bool stopping;
+	bool busy;
+};
+
+#endif
+
@@ -0,0 +1,589 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "frameRecorder.h"
+#include "metrics.h"
+#include "tracer.h"
+
+#include "cudaMappedMemory.h"
+#include "cudaYUV.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+
+#define RECORDING_VERSION 1
+
+#define RECORDING_HEADER_MAGIC "CCRH"
+#define RECORDING_FRAME_MAGIC  "CCRF"
+#define RECORDING_FOOTER_MAGIC "CCRI"
+
+
+// wallTime (in nanoseconds)
+static uint64_t wallTime()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+// alignSize
+static inline size_t alignSize( size_t size )
+{
+	return (size + RECORDING_ALIGNMENT - 1) / RECORDING_ALIGNMENT * RECORDING_ALIGNMENT;
+}
+
+
+// i420Size
+static inline size_t i420Size( int width, int height )
+{
+	return width * height * 3 / 2;
+}
+
+
+// writeAll
+static bool writeAll( int fd, const void* data, size_t size )
+{
+	const uint8_t* ptr = (const uint8_t*)data;
+
+	while( size > 0 )
+	{
+		const ssize_t written = write(fd, ptr, size);
+
+		if( written < 0 )
+		{
+			if( errno == EINTR )
+				continue;
+
+			return false;
+		}
+
+		ptr  += written;
+		size -= written;
+	}
+
+	return true;
+}
+
+
+// readAll
+static bool readAll( int fd, void* data, size_t size, off_t offset )
+{
+	uint8_t* ptr = (uint8_t*)data;
+
+	while( size > 0 )
+	{
+		const ssize_t count = pread(fd, ptr, size, offset);
+
+		if( count < 0 && errno == EINTR )
+			continue;
+
+		if( count <= 0 )
+			return false;
+
+		ptr    += count;
+		size   -= count;
+		offset += count;
+	}
+
+	return true;
+}
+
+
+// buffers waiting to be written, across the recorders
+static MetricsValue* recorderQueue = Metrics::GetGauge("recorder_queue_depth", "recording buffers waiting to be written to disk");
+
+
+// constructor
+FrameRecorder::FrameRecorder()
+{
+	fd           = -1;
+	bufferFrames = 0;
+	active       = 0;
+	sequence     = 0;
+	dropped      = 0;
+	dropStreak   = 0;
+	bytesWritten = 0;
+	writeFailed  = false;
+	pending      = -1;
+	stopping     = false;
+
+	for( int n=0; n < 2; n++ )
+	{
+		buffers[n]    = NULL;
+		bufferFill[n] = 0;
+		bufferBusy[n] = false;
+	}
+
+	memset(&header, 0, sizeof(header));
+
+	thread = std::thread(&FrameRecorder::run, this);
+}
+
+
+// destructor
+FrameRecorder::~FrameRecorder()
+{
+	Close();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	condition.notify_all();
+	thread.join();
+
+	for( int n=0; n < 2; n++ )
+	{
+		if( buffers[n] != NULL )
+			CUDA(cudaFreeHost(buffers[n]));
+	}
+}
+
+
+// Open
+bool FrameRecorder::Open( const std::string& path, int width, int height )
+{
+	Close();
+
+	if( width <= 0 || height <= 0 || (width % 2) != 0 || (height % 2) != 0 )
+	{
+		printf("camera-capture:  can't record %ix%i frames (the dimensions should be even)\n", width, height);
+		return false;
+	}
+
+	const size_t frameSize = alignSize(sizeof(RecordingFrame) + i420Size(width, height));
+
+	// the buffers are reused by the next recording if the frames fit
+	if( frameSize != header.frameSize )
+	{
+		for( int n=0; n < 2; n++ )
+		{
+			if( buffers[n] != NULL )
+				CUDA(cudaFreeHost(buffers[n]));
+
+			buffers[n] = NULL;
+		}
+
+		bufferFrames = std::max(BufferSize / frameSize, (size_t)1);
+
+		for( int n=0; n < 2; n++ )
+		{
+			if( !cudaAllocMapped((void**)&buffers[n], bufferFrames * frameSize) )
+			{
+				printf("camera-capture:  failed to allocate the recording buffers\n");
+				return false;
+			}
+		}
+	}
+
+	fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+	if( fd < 0 )
+	{
+		printf("camera-capture:  failed to create recording %s\n", path.c_str());
+		return false;
+	}
+
+	filename = path;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, RECORDING_HEADER_MAGIC, sizeof(header.magic));
+
+	header.version   = RECORDING_VERSION;
+	header.width     = width;
+	header.height    = height;
+	header.frameSize = frameSize;
+	header.startTime = wallTime();
+
+	// the header is padded, so the frames stay aligned
+	std::vector<uint8_t> headerBlock(RECORDING_ALIGNMENT, 0);
+	memcpy(headerBlock.data(), &header, sizeof(header));
+
+	if( !writeAll(fd, headerBlock.data(), headerBlock.size()) )
+	{
+		printf("camera-capture:  failed to write recording %s\n", path.c_str());
+		close(fd);
+		fd = -1;
+		return false;
+	}
+
+	index.clear();
+
+	active       = 0;
+	sequence     = 0;
+	dropped      = 0;
+	dropStreak   = 0;
+	bytesWritten = headerBlock.size();
+	writeFailed  = false;
+
+	bufferFill[0] = 0;
+	bufferFill[1] = 0;
+
+	printf("camera-capture:  recording %ix%i frames to %s\n", width, height, path.c_str());
+	return true;
+}
+
+
+// Write
+bool FrameRecorder::Write( uchar3* image, int width, int height )
+{
+	if( fd < 0 || !image )
+		return false;
+
+	const uint32_t frameSequence = sequence++;
+
+	if( (uint32_t)width != header.width || (uint32_t)height != header.height || writeFailed )
+	{
+		dropped++;
+		return false;
+	}
+
+	// both buffers are full when the disk can't keep up
+	bool busy = false;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		busy = bufferBusy[active];
+	}
+
+	if( busy )
+	{
+		static MetricsValue* droppedFrames = Metrics::GetCounter("recorder_frames_dropped", "frames dropped by the recorder because the disk couldn't keep up");
+
+		dropped++;
+		dropStreak++;
+		droppedFrames->Add();
+		return false;
+	}
+
+	if( dropStreak > 0 )
+	{
+		printf("camera-capture:  recording dropped %u frames (the disk is too slow), %u dropped in total\n", dropStreak, dropped);
+		dropStreak = 0;
+	}
+
+	RecordingIndexEntry entry;
+
+	entry.timestamp = wallTime();
+	entry.sequence  = frameSequence;
+	entry.reserved  = 0;
+
+	uint8_t* record = buffers[active] + bufferFill[active] * header.frameSize;
+
+	RecordingFrame frame;
+
+	memcpy(frame.magic, RECORDING_FRAME_MAGIC, sizeof(frame.magic));
+	frame.sequence  = entry.sequence;
+	frame.timestamp = entry.timestamp;
+
+	memcpy(record, &frame, sizeof(frame));
+
+	// the GPU converts the frame straight into the buffer
+	if( CUDA_FAILED(cudaRGBToI420(image, record + sizeof(RecordingFrame), width, height)) )
+	{
+		dropped++;
+		return false;
+	}
+
+	index.push_back(entry);
+
+	if( ++bufferFill[active] >= bufferFrames )
+		submit();
+
+	return true;
+}
+
+
+// OnFrame
+void FrameRecorder::OnFrame( uchar3* image, int width, int height, void* user )
+{
+	if( !user )
+		return;
+
+	((FrameRecorder*)user)->Write(image, width, height);
+}
+
+
+// submit
+void FrameRecorder::submit()
+{
+	if( bufferFill[active] == 0 )
+		return;
+
+	// the conversions have to finish before the buffer is written
+	CUDA(cudaDeviceSynchronize());
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		// the writer only holds one buffer at a time
+		while( pending >= 0 )
+			condition.wait(lock);
+
+		bufferBusy[active] = true;
+		pending = active;
+	}
+
+	recorderQueue->Add(1);
+
+	condition.notify_all();
+	active = 1 - active;
+}
+
+
+// run
+void FrameRecorder::run()
+{
+	Tracer::SetThreadName("recorder");
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while( true )
+	{
+		while( !stopping && pending < 0 )
+			condition.wait(lock);
+
+		if( pending < 0 )
+			break;
+
+		const int n = pending;
+		const int descriptor = fd;
+		const size_t size = bufferFill[n] * header.frameSize;
+
+		pending = -1;
+		lock.unlock();
+
+		// one large sequential write per buffer
+		bool written = false;
+
+		{
+			TRACE_SCOPE("recorder_write");
+			written = writeAll(descriptor, buffers[n], size);
+		}
+
+		if( !written )
+		{
+			printf("camera-capture:  failed to write recording %s (%s)\n", filename.c_str(), strerror(errno));
+			writeFailed = true;
+		}
+		else
+		{
+			// the recording isn't read back soon, so keep it out of the page cache
+			posix_fadvise(descriptor, bytesWritten, size, POSIX_FADV_DONTNEED);
+			bytesWritten += size;
+		}
+
+		lock.lock();
+
+		bufferFill[n] = 0;
+		bufferBusy[n] = false;
+
+		recorderQueue->Add(-1);
+
+		condition.notify_all();
+	}
+}
+
+
+// Close
+bool FrameRecorder::Close()
+{
+	if( fd < 0 )
+		return true;
+
+	submit();
+
+	// wait for the writer
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while( pending >= 0 || bufferBusy[0] || bufferBusy[1] )
+			condition.wait(lock);
+	}
+
+	// the index and footer go at the end
+	RecordingFooter footer;
+
+	memcpy(footer.magic, RECORDING_FOOTER_MAGIC, sizeof(footer.magic));
+
+	footer.count       = index.size();
+	footer.dropped     = dropped;
+	footer.reserved    = 0;
+	footer.indexOffset = RECORDING_ALIGNMENT + (uint64_t)index.size() * header.frameSize;
+
+	bool result = !writeFailed &&
+			    writeAll(fd, index.data(), index.size() * sizeof(RecordingIndexEntry)) &&
+			    writeAll(fd, &footer, sizeof(footer)) &&
+			    fsync(fd) == 0;
+
+	if( close(fd) != 0 )
+		result = false;
+
+	fd = -1;
+
+	if( !result )
+		printf("camera-capture:  failed to finish recording %s\n", filename.c_str());
+
+	printf("camera-capture:  recorded %zu frames to %s (%u dropped)\n", index.size(), filename.c_str(), dropped);
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------
+// constructor
+RecordingReader::RecordingReader()
+{
+	fd = -1;
+	memset(&header, 0, sizeof(header));
+}
+
+
+// destructor
+RecordingReader::~RecordingReader()
+{
+	if( fd >= 0 )
+		close(fd);
+}
+
+
+// IsRecording
+bool RecordingReader::IsRecording( const char* filename )
+{
+	if( !filename )
+		return false;
+
+	FILE* file = fopen(filename, "rb");
+
+	if( !file )
+		return false;
+
+	char magic[4];
+	const bool result = (fread(magic, sizeof(magic), 1, file) == 1) && (memcmp(magic, RECORDING_HEADER_MAGIC, sizeof(magic)) == 0);
+
+	fclose(file);
+	return result;
+}
+
+
+// Open
+RecordingReader* RecordingReader::Open( const std::string& filename )
+{
+	RecordingReader* reader = new RecordingReader();
+
+	if( !reader->init(filename) )
+	{
+		printf("camera-capture:  failed to open recording %s\n", filename.c_str());
+		delete reader;
+		return NULL;
+	}
+
+	return reader;
+}
+
+
+// init
+bool RecordingReader::init( const std::string& filename )
+{
+	fd = open(filename.c_str(), O_RDONLY);
+
+	if( fd < 0 )
+		return false;
+
+	if( !readAll(fd, &header, sizeof(header), 0) || memcmp(header.magic, RECORDING_HEADER_MAGIC, sizeof(header.magic)) != 0 )
+		return false;
+
+	if( header.version != RECORDING_VERSION || header.frameSize < sizeof(RecordingFrame) + i420Size(header.width, header.height) )
+		return false;
+
+	const off_t fileSize = lseek(fd, 0, SEEK_END);
+
+	// read the index from the end of the file
+	RecordingFooter footer;
+
+	if( fileSize >= (off_t)(RECORDING_ALIGNMENT + sizeof(footer))
+	 && readAll(fd, &footer, sizeof(footer), fileSize - sizeof(footer))
+	 && memcmp(footer.magic, RECORDING_FOOTER_MAGIC, sizeof(footer.magic)) == 0
+	 && footer.indexOffset + (uint64_t)footer.count * sizeof(RecordingIndexEntry) + sizeof(footer) == (uint64_t)fileSize )
+	{
+		index.resize(footer.count);
+
+		if( footer.count > 0 && !readAll(fd, index.data(), footer.count * sizeof(RecordingIndexEntry), footer.indexOffset) )
+			return false;
+
+		printf("camera-capture:  opened recording %s (%u frames, %u dropped while recording)\n", filename.c_str(), footer.count, footer.dropped);
+		return true;
+	}
+
+	// the recording wasn't closed, so rebuild the index from the frames that were written
+	const uint64_t numFrames = (fileSize - RECORDING_ALIGNMENT) / header.frameSize;
+
+	for( uint64_t n=0; n < numFrames; n++ )
+	{
+		RecordingFrame frame;
+
+		if( !readAll(fd, &frame, sizeof(frame), RECORDING_ALIGNMENT + n * header.frameSize) || memcmp(frame.magic, RECORDING_FRAME_MAGIC, sizeof(frame.magic)) != 0 )
+			break;
+
+		RecordingIndexEntry entry;
+
+		entry.timestamp = frame.timestamp;
+		entry.sequence  = frame.sequence;
+		entry.reserved  = 0;
+
+		index.push_back(entry);
+	}
+
+	printf("camera-capture:  recording %s wasn't closed, recovered %zu frames\n", filename.c_str(), index.size());
+	return true;
+}
+
+
+// Read
+bool RecordingReader::Read( int n, uchar3* image ) const
+{
+	if( n < 0 || n >= (int)index.size() || !image )
+		return false;
+
+	const size_t size = i420Size(header.width, header.height);
+	void* yuv = NULL;
+
+	if( !cudaAllocMapped(&yuv, size) )
+		return false;
+
+	bool result = readAll(fd, yuv, size, RECORDING_ALIGNMENT + (off_t)n * header.frameSize + sizeof(RecordingFrame));
+
+	if( result )
+	{
+		result = !CUDA_FAILED(cudaI420ToRGB(yuv, image, header.width, header.height));
+		CUDA(cudaDeviceSynchronize());
+	}
+
+	CUDA(cudaFreeHost(yuv));
+	return result;
+}
+
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_FRAME_RECORDER__
+#define __CAMERA_FRAME_RECORDER__
+
+#include "cudaUtility.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+/*
+ * Recording file layout (.ccr):
+ *
+ *   RecordingHeader          padded to RECORDING_ALIGNMENT
+ *   frame records            RecordingFrame + I420 pixels, each padded to RECORDING_ALIGNMENT
+ *   RecordingIndexEntry[]    one per frame, written when the recording is closed
+ *   RecordingFooter
+ *
+ * The frame records are all the same size, so the index can be rebuilt
+ * from them if the recording wasn't closed (i.e. after a crash).
+ */
+#define RECORDING_ALIGNMENT 4096
+
+struct RecordingHeader
+{
+	char     magic[4];		// "CCRH"
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t frameSize;		// size of each frame record (including its RecordingFrame)
+	uint32_t reserved;
+	uint64_t startTime;		// wall-clock time the recording started (in nanoseconds)
+};
+
+struct RecordingFrame
+{
+	char     magic[4];		// "CCRF"
+	uint32_t sequence;		// number of the camera frame (gaps are dropped frames)
+	uint64_t timestamp;		// wall-clock capture time (in nanoseconds)
+};
+
+struct RecordingIndexEntry
+{
+	uint64_t timestamp;
+	uint32_t sequence;
+	uint32_t reserved;
+};
+
+struct RecordingFooter
+{
+	char     magic[4];		// "CCRI"
+	uint32_t count;		// number of frames
+	uint32_t dropped;		// number of frames dropped while recording
+	uint32_t reserved;
+	uint64_t indexOffset;
+};
+
+
+/*
+ * Records every camera frame to disk, to be labeled later (see --offline).
+ *
+ * The frames are converted to I420 on the GPU, straight into one of two
+ * large mapped buffers.  When a buffer is full, a background thread writes
+ * it to the file in one sequential write while the other buffer is filled.
+ * If the disk can't keep up and both buffers are full, the frames are
+ * dropped (and counted) instead of stalling the camera.
+ */
+class FrameRecorder
+{
+public:
+	// constructor
+	FrameRecorder();
+
+	// destructor
+	~FrameRecorder();
+
+	// start a new recording
+	bool Open( const std::string& filename, int width, int height );
+
+	// finish the recording (writes the remaining frames and the index)
+	bool Close();
+
+	// add a frame, returns false if it was dropped
+	bool Write( uchar3* image, int width, int height );
+
+	// frame handler for CaptureWindow::AddFrameHandler() (the user pointer is the recorder)
+	static void OnFrame( uchar3* image, int width, int height, void* user );
+
+	// recording status
+	inline bool IsOpen() const				{ return fd >= 0; }
+
+	inline uint32_t GetFrameCount() const		{ return index.size(); }
+	inline uint32_t GetDropCount() const		{ return dropped; }
+	inline uint64_t GetBytesWritten() const		{ return bytesWritten; }
+
+	inline const std::string& GetFilename() const	{ return filename; }
+
+	// size of each of the two buffers
+	static const size_t BufferSize = 32 * 1024 * 1024;
+
+protected:
+	void run();
+	void submit();
+
+	std::string filename;
+	int fd;
+
+	RecordingHeader header;
+	std::vector<RecordingIndexEntry> index;
+
+	uint8_t* buffers[2];	// mapped memory
+	int      bufferFrames;	// frames per buffer
+	int      bufferFill[2];
+	bool     bufferBusy[2];	// being written to disk
+	int      active;
+
+	uint32_t sequence;
+	uint32_t dropped;
+	uint32_t dropStreak;
+
+	std::atomic<uint64_t> bytesWritten;
+	std::atomic<bool>     writeFailed;
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable condition;
+
+	int  pending;	// buffer waiting for the writer (or -1)
+	bool stopping;
+};
+
+
+/*
+ * Reads the frames of a recording (thread-safe, for OfflineSource)
+ */
+class RecordingReader
+{
+public:
+	// open a recording
+	static RecordingReader* Open( const std::string& filename );
+
+	// destructor
+	~RecordingReader();
+
+	// is the file a recording?
+	static bool IsRecording( const char* filename );
+
+	// dimensions
+	inline int GetWidth() const				{ return header.width; }
+	inline int GetHeight() const				{ return header.height; }
+
+	// frames
+	inline int GetCount() const				{ return index.size(); }
+	inline const RecordingIndexEntry& GetEntry( int n ) const	{ return index[n]; }
+
+	// decode a frame to RGB8 (the image must be mapped memory of GetWidth() x GetHeight())
+	bool Read( int n, uchar3* image ) const;
+
+protected:
+	RecordingReader();
+	bool init( const std::string& filename );
+
+	int fd;
+
+	RecordingHeader header;
+	std::vector<RecordingIndexEntry> index;
+};
+
+#endif
+
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "frameSignature.h"
+
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SIGNATURE_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SIGNATURE_SSE2
+#endif
+
+
+// sumBytes
+static inline uint32_t sumBytes( const uint8_t* data, int size )
+{
+	uint32_t sum = 0;
+	int n = 0;
+
+#if defined(SIGNATURE_NEON)
+	uint32x4_t acc = vdupq_n_u32(0);
+
+	for( ; n + 16 <= size; n += 16 )
+		acc = vpadalq_u16(acc, vpaddlq_u8(vld1q_u8(data + n)));
+
+	const uint64x2_t acc64 = vpaddlq_u32(acc);
+	sum = (uint32_t)(vgetq_lane_u64(acc64, 0) + vgetq_lane_u64(acc64, 1));
+
+#elif defined(SIGNATURE_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	__m128i acc = _mm_setzero_si128();
+
+	for( ; n + 16 <= size; n += 16 )
+		acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128((const __m128i*)(data + n)), zero));
+
+	sum = (uint32_t)(_mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8)));
+#endif
+
+	for( ; n < size; n++ )
+		sum += data[n];
+
+	return sum;
+}
+
+
+// sumAbsDiff
+static inline uint32_t sumAbsDiff( const uint8_t* a, const uint8_t* b, int size )
+{
+	uint32_t sum = 0;
+	int n = 0;
+
+#if defined(SIGNATURE_NEON)
+	uint32x4_t acc = vdupq_n_u32(0);
+
+	for( ; n + 16 <= size; n += 16 )
+		acc = vpadalq_u16(acc, vpaddlq_u8(vabdq_u8(vld1q_u8(a + n), vld1q_u8(b + n))));
+
+	const uint64x2_t acc64 = vpaddlq_u32(acc);
+	sum = (uint32_t)(vgetq_lane_u64(acc64, 0) + vgetq_lane_u64(acc64, 1));
+
+#elif defined(SIGNATURE_SSE2)
+	__m128i acc = _mm_setzero_si128();
+
+	for( ; n + 16 <= size; n += 16 )
+		acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128((const __m128i*)(a + n)), _mm_loadu_si128((const __m128i*)(b + n))));
+
+	sum = (uint32_t)(_mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8)));
+#endif
+
+	for( ; n < size; n++ )
+		sum += (a[n] > b[n]) ? (a[n] - b[n]) : (b[n] - a[n]);
+
+	return sum;
+}
+
+
+// Compute
+void FrameSignature::Compute( const uchar3* image, int width, int height, int rowStep )
+{
+	memset(blocks, 0, sizeof(blocks));
+	memset(histogram, 0, sizeof(histogram));
+
+	if( !image || width < GridSize || height < GridSize )
+		return;
+
+	if( rowStep < 1 )
+		rowStep = 1;
+
+	uint32_t blockSums[GridSize * GridSize];
+	uint32_t blockCounts[GridSize * GridSize];
+	uint32_t colorCounts[HistogramBins];
+
+	memset(blockSums, 0, sizeof(blockSums));
+	memset(blockCounts, 0, sizeof(blockCounts));
+	memset(colorCounts, 0, sizeof(colorCounts));
+
+	int blockX[GridSize + 1];
+
+	for( int n=0; n <= GridSize; n++ )
+		blockX[n] = width * n / GridSize;
+
+	uint32_t numColors = 0;
+
+	for( int y=0; y < height; y += rowStep )
+	{
+		const uchar3* row = image + y * width;
+		const int gy = y * GridSize / height;
+
+		// the brightness is the sum of the channels, so each block is one run of bytes
+		for( int gx=0; gx < GridSize; gx++ )
+		{
+			const int x0 = blockX[gx];
+			const int x1 = blockX[gx+1];
+
+			blockSums[gy * GridSize + gx]   += sumBytes((const uint8_t*)(row + x0), (x1 - x0) * 3);
+			blockCounts[gy * GridSize + gx] += (x1 - x0) * 3;
+		}
+
+		// the colors are sampled more sparsely
+		for( int x=0; x < width; x += 4 )
+		{
+			const uchar3 px = row[x];
+			colorCounts[((px.x >> 6) << 4) | ((px.y >> 6) << 2) | (px.z >> 6)]++;
+		}
+
+		numColors += (width + 3) / 4;
+	}
+
+	for( int n=0; n < GridSize * GridSize; n++ )
+		blocks[n] = (blockCounts[n] > 0) ? blockSums[n] / blockCounts[n] : 0;
+
+	for( int n=0; n < HistogramBins; n++ )
+		histogram[n] = (uint64_t)colorCounts[n] * 255 / numColors;
+}
+
+
+// Distance
+float FrameSignature::Distance( const FrameSignature& other ) const
+{
+	// the brightness layout and the colors are weighted equally
+	const float blockDist = sumAbsDiff(blocks, other.blocks, sizeof(blocks)) / float(GridSize * GridSize * 255);
+	const float colorDist = sumAbsDiff(histogram, other.histogram, sizeof(histogram)) / float(2 * 255);
+
+	return 0.5f * blockDist + 0.5f * colorDist;
+}
+
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_FRAME_SIGNATURE__
+#define __CAMERA_FRAME_SIGNATURE__
+
+#include "cudaUtility.h"
+
+#include <stdint.h>
+
+
+/*
+ * Compact signature of how a frame looks, for comparing frames cheaply.
+ *
+ * The signature is the mean brightness of each block in an 8x8 grid,
+ * plus a coarse 4x4x4 color histogram, 128 bytes in all.  Only every
+ * few rows are sampled, and the block sums use SIMD (SSE2/NEON), so
+ * a 1080p frame takes well under a millisecond.
+ */
+struct FrameSignature
+{
+	static const int GridSize = 8;		// blocks per side
+	static const int HistogramBins = 64;	// 4 levels per channel
+
+	uint8_t blocks[GridSize * GridSize];	// mean brightness of each block
+	uint8_t histogram[HistogramBins];		// normalized to sum to about 255
+
+	// compute the signature of an RGB8 image (sampling every rowStep-th row)
+	void Compute( const uchar3* image, int width, int height, int rowStep=DefaultRowStep );
+
+	// distance to another signature (0 is identical, 1 is completely different)
+	float Distance( const FrameSignature& other ) const;
+
+	// default row sampling
+	static const int DefaultRowStep = 4;
+};
+
+#endif
+
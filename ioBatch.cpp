@@ -0,0 +1,726 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "ioBatch.h"
+#include "metrics.h"
+#include "tracer.h"
+
+#include <deque>
+#include <thread>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef HAS_IO_URING
+#include <liburing.h>
+#endif
+
+
+// IOBackend
+class IOBackend
+{
+public:
+	virtual ~IOBackend()					{}
+
+	// run the operations of a stage, and set their results
+	virtual void Execute( std::vector<IOBatch::Op*>& ops ) = 0;
+
+	// name of the backend
+	virtual const char* GetName() const = 0;
+};
+
+
+// runOp (blocking system calls)
+static int runOp( IOBatch::Op& op )
+{
+	if( op.type == IOBatch::Op::SYNC )
+	{
+		const int fd = open(op.filename.c_str(), O_RDONLY);
+
+		if( fd < 0 )
+			return -errno;
+
+		const int result = (fsync(fd) != 0) ? -errno : 0;
+
+		close(fd);
+		return result;
+	}
+
+	const bool append = (op.type == IOBatch::Op::APPEND);
+	const std::string path = append ? op.filename : IOBatch::TemporaryPath(op.filename);
+
+	const int fd = open(path.c_str(), append ? (O_WRONLY | O_CREAT | O_APPEND) : (O_WRONLY | O_CREAT | O_TRUNC), 0644);
+
+	if( fd < 0 )
+		return -errno;
+
+	int result = 0;
+	const ssize_t written = write(fd, op.data.data(), op.data.size());
+
+	if( written < 0 )
+		result = -errno;
+	else if( written != (ssize_t)op.data.size() )
+		result = -EIO;
+
+	if( result == 0 && !append && fsync(fd) != 0 )
+		result = -errno;
+
+	if( close(fd) != 0 && result == 0 )
+		result = -errno;
+
+	if( append )
+		return result;
+
+	if( result == 0 && rename(path.c_str(), op.filename.c_str()) != 0 )
+		result = -errno;
+
+	if( result != 0 )
+		unlink(path.c_str());
+
+	return result;
+}
+
+
+/*
+ * Thread pool backend
+ */
+class ThreadBackend : public IOBackend
+{
+public:
+	ThreadBackend( int numThreads )
+	{
+		stopping = false;
+
+		for( int n=0; n < numThreads; n++ )
+			threads.push_back(std::thread(&ThreadBackend::run, this));
+	}
+
+	~ThreadBackend()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+
+		condition.notify_all();
+
+		for( size_t n=0; n < threads.size(); n++ )
+			threads[n].join();
+	}
+
+	virtual void Execute( std::vector<IOBatch::Op*>& ops )
+	{
+		int remaining = ops.size();
+
+		std::unique_lock<std::mutex> lock(mutex);
+
+		for( size_t n=0; n < ops.size(); n++ )
+			tasks.push_back(std::make_pair(ops[n], &remaining));
+
+		condition.notify_all();
+
+		while( remaining > 0 )
+			finished.wait(lock);
+	}
+
+	virtual const char* GetName() const			{ return "threads"; }
+
+protected:
+	void run()
+	{
+		Tracer::SetThreadName("io");
+
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while( true )
+		{
+			while( !stopping && tasks.size() == 0 )
+				condition.wait(lock);
+
+			if( tasks.size() == 0 )
+				break;
+
+			const std::pair<IOBatch::Op*, int*> task = tasks.front();
+			tasks.pop_front();
+
+			lock.unlock();
+			task.first->result = runOp(*task.first);
+			lock.lock();
+
+			(*task.second)--;
+			finished.notify_all();
+		}
+	}
+
+	std::vector<std::thread> threads;
+	std::deque<std::pair<IOBatch::Op*, int*>> tasks;	// the operation, and the count of its Execute()
+
+	std::mutex mutex;
+	std::condition_variable condition;	// a task was queued, or stopping
+	std::condition_variable finished;	// a task was completed
+
+	bool stopping;
+};
+
+
+#ifdef HAS_IO_URING
+
+/*
+ * io_uring ring (one per thread that submits at the same time, so that
+ * a batch doesn't wait for another thread's fsyncs)
+ */
+class UringRing
+{
+public:
+	static UringRing* Create()
+	{
+		UringRing* ring = new UringRing();
+
+		if( !ring->init() )
+		{
+			delete ring;
+			return NULL;
+		}
+
+		return ring;
+	}
+
+	~UringRing()
+	{
+		if( initialized )
+			io_uring_queue_exit(&ring);
+
+		free(buffer);
+	}
+
+	void Execute( std::vector<IOBatch::Op*>& ops )
+	{
+		// the operations are submitted in as few rounds as the ring, the file slots,
+		// and the registered buffer allow (normally the whole stage at once)
+		size_t first = 0;
+
+		while( first < ops.size() )
+		{
+			size_t last = first;
+			size_t entries = 0;
+			size_t used = 0;
+
+			while( last < ops.size() && last - first < MaxFiles && entries + MaxChain <= RingEntries )
+			{
+				entries += prepare(*ops[last], last - first, last, used);
+				last++;
+			}
+
+			complete(ops, first, last, entries);
+
+			// the temporary files of the writes that failed
+			for( size_t n=first; n < last; n++ )
+			{
+				if( ops[n]->type == IOBatch::Op::WRITE && ops[n]->result != 0 )
+					unlink(IOBatch::TemporaryPath(ops[n]->filename).c_str());
+			}
+
+			first = last;
+		}
+	}
+
+protected:
+	UringRing()
+	{
+		initialized = false;
+		buffer = NULL;
+	}
+
+	bool init()
+	{
+		if( io_uring_queue_init(RingEntries, &ring, 0) < 0 )
+			return false;
+
+		initialized = true;
+
+		// the operations used by the chains
+		struct io_uring_probe* probe = io_uring_get_probe_ring(&ring);
+
+		if( !probe )
+			return false;
+
+		const int opcodes[] = { IORING_OP_OPENAT, IORING_OP_WRITE, IORING_OP_WRITE_FIXED, IORING_OP_FSYNC, IORING_OP_CLOSE, IORING_OP_RENAMEAT };
+		bool supported = true;
+
+		for( size_t n=0; n < sizeof(opcodes) / sizeof(opcodes[0]); n++ )
+			supported = supported && io_uring_opcode_supported(probe, opcodes[n]);
+
+		io_uring_free_probe(probe);
+
+		if( !supported )
+			return false;
+
+		// the files are opened into slots of the ring, so that the chains don't need their descriptors
+		if( io_uring_register_files_sparse(&ring, MaxFiles) < 0 )
+			return false;
+
+		if( posix_memalign((void**)&buffer, 4096, BufferSize) != 0 )
+		{
+			buffer = NULL;
+			return false;
+		}
+
+		struct iovec iov;
+
+		iov.iov_base = buffer;
+		iov.iov_len  = BufferSize;
+
+		if( io_uring_register_buffers(&ring, &iov, 1) < 0 )
+			return false;
+
+		// direct descriptors need Linux 5.15, older kernels only fail when they're used
+		IOBatch::Op test;
+
+		test.type     = IOBatch::Op::APPEND;
+		test.filename = "/dev/null";
+		test.result   = 0;
+
+		std::vector<IOBatch::Op*> ops(1, &test);
+		Execute(ops);
+
+		return test.result == 0;
+	}
+
+	// queue the chain of an operation, returns the number of entries
+	size_t prepare( IOBatch::Op& op, int slot, size_t index, size_t& used )
+	{
+		op.result = 0;
+
+		const bool append = (op.type == IOBatch::Op::APPEND);
+		const bool sync   = (op.type == IOBatch::Op::SYNC);
+
+		std::string& path = paths[slot];
+
+		path = (append || sync) ? op.filename : IOBatch::TemporaryPath(op.filename);
+
+		const int flags = sync ? O_RDONLY : append ? (O_WRONLY | O_CREAT | O_APPEND) : (O_WRONLY | O_CREAT | O_TRUNC);
+
+		struct io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+		io_uring_prep_openat_direct(sqe, AT_FDCWD, path.c_str(), flags, 0644, slot);
+		link(sqe, index, Open, false);
+
+		if( !sync )
+		{
+			sqe = io_uring_get_sqe(&ring);
+
+			// the data is copied into the registered buffer if there's room left
+			if( used + op.data.size() <= BufferSize )
+			{
+				memcpy(buffer + used, op.data.data(), op.data.size());
+				io_uring_prep_write_fixed(sqe, slot, buffer + used, op.data.size(), 0, 0);
+				used += op.data.size();
+			}
+			else
+			{
+				io_uring_prep_write(sqe, slot, op.data.data(), op.data.size(), 0);
+			}
+
+			link(sqe, index, Write, true);
+		}
+
+		size_t entries = sync ? 1 : 2;
+
+		if( !append )
+		{
+			sqe = io_uring_get_sqe(&ring);
+			io_uring_prep_fsync(sqe, slot, 0);
+			link(sqe, index, Fsync, true);
+			entries++;
+		}
+
+		sqe = io_uring_get_sqe(&ring);
+		io_uring_prep_close_direct(sqe, slot);
+		entries++;
+
+		if( append || sync )
+		{
+			link(sqe, index, Close, false, true);
+			return entries;
+		}
+
+		link(sqe, index, Close, false);
+
+		sqe = io_uring_get_sqe(&ring);
+		io_uring_prep_renameat(sqe, AT_FDCWD, path.c_str(), AT_FDCWD, op.filename.c_str(), 0);
+		link(sqe, index, Rename, false, true);
+
+		return entries + 1;
+	}
+
+	// submit the queued chains and collect their results
+	void complete( std::vector<IOBatch::Op*>& ops, size_t first, size_t last, size_t entries )
+	{
+		const int submitted = io_uring_submit_and_wait(&ring, entries);
+
+		if( submitted < 0 )
+		{
+			for( size_t n=first; n < last; n++ )
+				ops[n]->result = submitted;
+
+			return;
+		}
+
+		for( size_t n=0; n < entries; n++ )
+		{
+			struct io_uring_cqe* cqe = NULL;
+
+			if( io_uring_wait_cqe(&ring, &cqe) < 0 || !cqe )
+				break;
+
+			const uint64_t data = (uint64_t)(uintptr_t)io_uring_cqe_get_data(cqe);
+			IOBatch::Op* op = ops[data >> 8];
+
+			int result = cqe->res;
+
+			if( (data & 0xFF) == Write && result >= 0 )
+				result = (result == (int)op->data.size()) ? 0 : -EIO;
+			else if( result > 0 )
+				result = 0;
+
+			// keep the error of the operation that broke the chain
+			if( result != 0 && (op->result == 0 || op->result == -ECANCELED) )
+				op->result = result;
+
+			io_uring_cqe_seen(&ring, cqe);
+		}
+	}
+
+	// set the user data and flags of a queued entry
+	void link( struct io_uring_sqe* sqe, size_t index, int step, bool fixedFile, bool last=false )
+	{
+		io_uring_sqe_set_data(sqe, (void*)(uintptr_t)((index << 8) | step));
+		io_uring_sqe_set_flags(sqe, (fixedFile ? IOSQE_FIXED_FILE : 0) | (last ? 0 : IOSQE_IO_LINK));
+	}
+
+	enum Step { Open, Write, Fsync, Close, Rename };
+
+	static const size_t RingEntries = 256;
+	static const size_t MaxFiles    = 32;		// file slots, and operations per submission
+	static const size_t MaxChain    = 5;		// entries in the longest chain
+	static const size_t BufferSize  = 4 * 1024 * 1024;
+
+	struct io_uring ring;
+	bool initialized;
+
+	char* buffer;				// registered buffer
+	std::string paths[MaxFiles];		// the paths have to stay valid until the chains complete
+};
+
+
+/*
+ * io_uring backend
+ */
+class UringBackend : public IOBackend
+{
+public:
+	static UringBackend* Create()
+	{
+		// the first ring checks that the kernel supports the chains
+		UringRing* ring = UringRing::Create();
+
+		if( !ring )
+			return NULL;
+
+		UringBackend* backend = new UringBackend();
+
+		backend->rings.push_back(ring);
+		backend->idle.push_back(ring);
+
+		return backend;
+	}
+
+	~UringBackend()
+	{
+		for( size_t n=0; n < rings.size(); n++ )
+			delete rings[n];
+	}
+
+	virtual void Execute( std::vector<IOBatch::Op*>& ops )
+	{
+		// the lock is only held to take a ring that isn't in use (or to add one)
+		UringRing* ring = NULL;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if( idle.size() > 0 )
+			{
+				ring = idle.back();
+				idle.pop_back();
+			}
+		}
+
+		if( !ring )
+		{
+			ring = UringRing::Create();
+
+			if( !ring )
+			{
+				// i.e. out of locked memory for another registered buffer
+				for( size_t n=0; n < ops.size(); n++ )
+					ops[n]->result = runOp(*ops[n]);
+
+				return;
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+			rings.push_back(ring);
+		}
+
+		ring->Execute(ops);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		idle.push_back(ring);
+	}
+
+	virtual const char* GetName() const			{ return "io_uring"; }
+
+protected:
+	std::vector<UringRing*> rings;	// all of the rings
+	std::vector<UringRing*> idle;	// the rings that aren't in use
+
+	std::mutex mutex;
+};
+
+#endif
+
+
+// the backend shared by the batches (created on first use)
+static IOBackend* backend = NULL;
+static std::mutex backendMutex;
+
+
+// createBackend
+static IOBackend* createBackend( const std::string& name, int threads )
+{
+#ifdef HAS_IO_URING
+	if( name != "threads" )
+	{
+		IOBackend* uring = UringBackend::Create();
+
+		if( uring != NULL )
+			return uring;
+
+		printf("camera-capture:  io_uring isn't available, writing the files with a thread pool instead\n");
+	}
+#endif
+
+	return new ThreadBackend(std::max(threads, 1));
+}
+
+
+// getBackend
+static IOBackend* getBackend()
+{
+	std::lock_guard<std::mutex> lock(backendMutex);
+
+	if( !backend )
+		backend = createBackend("", IOBatch::DefaultThreads);
+
+	return backend;
+}
+
+
+// constructor
+IOBatch::IOBatch()
+{
+	stage = 0;
+}
+
+
+// Write
+void IOBatch::Write( const std::string& filename, const std::string& data )
+{
+	Op op;
+
+	op.type     = Op::WRITE;
+	op.filename = filename;
+	op.data     = data;
+	op.stage    = stage;
+	op.result   = 0;
+
+	ops.push_back(op);
+}
+
+
+// Append
+void IOBatch::Append( const std::string& filename, const std::string& record )
+{
+	// one write per file and stage, so that the records stay together
+	for( size_t n=0; n < ops.size(); n++ )
+	{
+		if( ops[n].type == Op::APPEND && ops[n].stage == stage && ops[n].filename == filename )
+		{
+			ops[n].data += record;
+			return;
+		}
+	}
+
+	Op op;
+
+	op.type     = Op::APPEND;
+	op.filename = filename;
+	op.data     = record;
+	op.stage    = stage;
+	op.result   = 0;
+
+	ops.push_back(op);
+}
+
+
+// Sync
+void IOBatch::Sync( const std::string& filename )
+{
+	Op op;
+
+	op.type     = Op::SYNC;
+	op.filename = filename;
+	op.stage    = stage;
+	op.result   = 0;
+
+	ops.push_back(op);
+}
+
+
+// Barrier
+void IOBatch::Barrier()
+{
+	if( ops.size() > 0 && ops.back().stage == stage )
+		stage++;
+}
+
+
+// Submit
+bool IOBatch::Submit()
+{
+	if( ops.size() == 0 )
+		return true;
+
+	METRICS_SCOPE("io_batch", "time to write a batch of files");
+
+	IOBackend* io = getBackend();
+	bool result = true;
+
+	for( size_t first=0; first < ops.size() && result; )
+	{
+		// the operations of the next stage
+		std::vector<Op*> group;
+		size_t last = first;
+
+		while( last < ops.size() && ops[last].stage == ops[first].stage )
+			group.push_back(&ops[last++]);
+
+		io->Execute(group);
+
+		for( size_t n=0; n < group.size(); n++ )
+		{
+			if( group[n]->result == 0 )
+				continue;
+
+			printf("camera-capture:  failed to write %s (%s)\n", group[n]->filename.c_str(), strerror(-group[n]->result));
+			result = false;
+		}
+
+		first = last;
+	}
+
+	ops.clear();
+	stage = 0;
+
+	return result;
+}
+
+
+// TemporaryPath
+std::string IOBatch::TemporaryPath( const std::string& filename )
+{
+	const size_t slash = filename.find_last_of('/');
+
+	if( slash == std::string::npos )
+		return "." + filename + ".tmp";
+
+	return filename.substr(0, slash + 1) + "." + filename.substr(slash + 1) + ".tmp";
+}
+
+
+// SetBackend
+bool IOBatch::SetBackend( const std::string& name, int threads )
+{
+	if( name != "io_uring" && name != "threads" )
+	{
+		printf("camera-capture:  unknown I/O backend '%s' (io_uring or threads)\n", name.c_str());
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(backendMutex);
+
+	if( backend != NULL )
+		delete backend;
+
+	backend = createBackend(name, threads);
+
+	printf("camera-capture:  writing the files with %s\n", backend->GetName());
+	return name == backend->GetName();
+}
+
+
+// GetBackend
+const char* IOBatch::GetBackend()
+{
+	return getBackend()->GetName();
+}
+
+
+// Shutdown
+void IOBatch::Shutdown()
+{
+	std::lock_guard<std::mutex> lock(backendMutex);
+
+	if( backend != NULL )
+		delete backend;
+
+	backend = NULL;
+}
+
+
+// Usage
+const char* IOBatch::Usage()
+{
+	return "file writing arguments:\n"
+		  "  --io-backend=NAME          io_uring or threads (default io_uring, if it's\n"
+		  "                             available)\n"
+		  "  --io-threads=N             threads of the thread pool (default 4)\n\n";
+}
+
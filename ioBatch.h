@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_IO_BATCH__
+#define __CAMERA_IO_BATCH__
+
+#include <string>
+#include <vector>
+
+
+/*
+ * Batch of the file writes of a sample, submitted together.
+ *
+ * With io_uring (HAS_IO_URING), each file is a chain of linked operations
+ * (i.e. open -> write -> fsync -> close -> rename) on a direct descriptor,
+ * the data is copied into a registered buffer, and the chains of the whole
+ * batch are submitted with one system call.  Where io_uring isn't available
+ * (or the kernel doesn't support direct descriptors), the files are written
+ * in parallel by a pool of threads instead.
+ *
+ * The operations are grouped in stages:  the operations of a stage run
+ * concurrently, and those after a Barrier() only run once all of the ones
+ * before it succeeded (i.e. the image sets are appended after the files).
+ */
+class IOBatch
+{
+public:
+	// constructor
+	IOBatch();
+
+	// replace a file (written to a hidden temporary file, fsync'ed, and renamed into place)
+	void Write( const std::string& filename, const std::string& data );
+
+	// append to a file with a single write (the records appended to a file in the same stage are combined)
+	void Append( const std::string& filename, const std::string& record );
+
+	// flush a file that was written some other way to the disk
+	void Sync( const std::string& filename );
+
+	// start the next stage
+	void Barrier();
+
+	// run the operations and wait for them, returns false if any failed (the batch is cleared)
+	bool Submit();
+
+	// number of operations in the batch
+	inline size_t GetCount() const				{ return ops.size(); }
+
+	// select the backend ("io_uring" or "threads"), returns false if it isn't available
+	static bool SetBackend( const std::string& name, int threads=DefaultThreads );
+
+	// name of the backend in use
+	static const char* GetBackend();
+
+	// stop the backend's threads
+	static void Shutdown();
+
+	// usage string for the command line arguments
+	static const char* Usage();
+
+	// default number of threads of the thread pool
+	static const int DefaultThreads = 4;
+
+	// an operation of the batch
+	struct Op
+	{
+		enum Type
+		{
+			WRITE,
+			APPEND,
+			SYNC
+		};
+
+		Type        type;
+		std::string filename;
+		std::string data;
+		int         stage;
+		int         result;	// 0 or -errno
+	};
+
+	// the hidden temporary file that a file is written to before it's renamed
+	static std::string TemporaryPath( const std::string& filename );
+
+protected:
+	std::vector<Op> ops;
+	int stage;
+};
+
+#endif
+
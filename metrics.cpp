@@ -0,0 +1,476 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "metrics.h"
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+
+std::atomic<bool> Metrics::enabled(false);
+
+
+// registry of the metrics (they're never freed)
+struct MetricsRegistry
+{
+	std::mutex mutex;
+	std::vector<MetricsHistogram*> histograms;
+	std::vector<MetricsValue*> values;
+};
+
+// the metrics are registered from static initializers in other files, so the
+// registry is constructed on first use instead of with the other statics
+static MetricsRegistry& registry()
+{
+	static MetricsRegistry* instance = new MetricsRegistry();
+	return *instance;
+}
+
+
+// shardIndex (of the calling thread)
+static int shardIndex()
+{
+	static std::atomic<int> nextShard(0);
+	static thread_local int shard = nextShard.fetch_add(1) % MetricsHistogram::MaxShards;
+
+	return shard;
+}
+
+
+// constructor
+MetricsHistogram::MetricsHistogram( const char* _name, const char* _help )
+{
+	name = _name;
+	help = _help;
+
+	for( int n=0; n < MaxShards; n++ )
+	{
+		shards[n] = new Shard();
+
+		for( int b=0; b < NumBuckets; b++ )
+			shards[n]->counts[b] = 0;
+
+		shards[n]->count = 0;
+		shards[n]->sum   = 0;
+		shards[n]->max   = 0;
+	}
+}
+
+
+// destructor
+MetricsHistogram::~MetricsHistogram()
+{
+	for( int n=0; n < MaxShards; n++ )
+		delete shards[n];
+}
+
+
+// BucketIndex
+int MetricsHistogram::BucketIndex( uint64_t value )
+{
+	if( value < (uint64_t)SubBuckets )
+		return value;
+
+	const int magnitude = 63 - __builtin_clzll(value);
+
+	if( magnitude >= Magnitudes )
+		return NumBuckets - 1;
+
+	// the bits after the leading one pick the linear bucket within the power of two
+	const int subBucket = (value >> (magnitude - SubBucketBits)) & (SubBuckets - 1);
+
+	return (magnitude - SubBucketBits + 1) * SubBuckets + subBucket;
+}
+
+
+// BucketUpperBound
+uint64_t MetricsHistogram::BucketUpperBound( int index )
+{
+	if( index < SubBuckets )
+		return index + 1;
+
+	const int magnitude = index / SubBuckets + SubBucketBits - 1;
+	const int subBucket = index % SubBuckets;
+
+	return (uint64_t)(SubBuckets + subBucket + 1) << (magnitude - SubBucketBits);
+}
+
+
+// Record
+void MetricsHistogram::Record( uint64_t value )
+{
+	Shard* shard = shards[shardIndex()];
+
+	shard->counts[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+	shard->count.fetch_add(1, std::memory_order_relaxed);
+	shard->sum.fetch_add(value, std::memory_order_relaxed);
+
+	uint64_t max = shard->max.load(std::memory_order_relaxed);
+
+	while( value > max && !shard->max.compare_exchange_weak(max, value, std::memory_order_relaxed) );
+}
+
+
+// Read
+void MetricsHistogram::Read( Snapshot& snapshot ) const
+{
+	snapshot.counts.assign(NumBuckets, 0);
+
+	snapshot.count = 0;
+	snapshot.sum   = 0;
+	snapshot.max   = 0;
+
+	for( int n=0; n < MaxShards; n++ )
+	{
+		for( int b=0; b < NumBuckets; b++ )
+			snapshot.counts[b] += shards[n]->counts[b].load(std::memory_order_relaxed);
+
+		snapshot.sum += shards[n]->sum.load(std::memory_order_relaxed);
+		snapshot.max = std::max(snapshot.max, (uint64_t)shards[n]->max.load(std::memory_order_relaxed));
+	}
+
+	// the count is taken from the buckets, so that it matches them
+	for( int b=0; b < NumBuckets; b++ )
+		snapshot.count += snapshot.counts[b];
+}
+
+
+// Quantile
+uint64_t MetricsHistogram::Snapshot::Quantile( double fraction ) const
+{
+	if( count == 0 )
+		return 0;
+
+	const uint64_t rank = std::max((uint64_t)(fraction * count + 0.5), (uint64_t)1);
+	uint64_t total = 0;
+
+	for( size_t b=0; b < counts.size(); b++ )
+	{
+		total += counts[b];
+
+		if( total >= rank )
+			return std::min(BucketUpperBound(b), max);
+	}
+
+	return max;
+}
+
+
+// record
+void MetricsTimer::record()
+{
+	const uint64_t end = Metrics::Now();
+
+	if( Metrics::IsEnabled() )
+		histogram->Record(end - start);
+
+	// the histograms are never freed, so their names stay valid for the trace
+	if( Tracer::IsEnabled() )
+		Tracer::Record(histogram->GetName().c_str(), start, end);
+}
+
+
+//-----------------------------------------------------------------------------------------
+// constructor
+MetricsValue::MetricsValue( const char* _name, const char* _help, bool _gauge )
+{
+	name  = _name;
+	help  = _help;
+	gauge = _gauge;
+	value = 0;
+}
+
+
+//-----------------------------------------------------------------------------------------
+// Enable
+void Metrics::Enable( bool enable )
+{
+	enabled = enable;
+}
+
+
+// Now
+uint64_t Metrics::Now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+// GetHistogram
+MetricsHistogram* Metrics::GetHistogram( const char* name, const char* help )
+{
+	MetricsRegistry& metrics = registry();
+	std::lock_guard<std::mutex> lock(metrics.mutex);
+
+	for( size_t n=0; n < metrics.histograms.size(); n++ )
+	{
+		if( metrics.histograms[n]->GetName() == name )
+			return metrics.histograms[n];
+	}
+
+	metrics.histograms.push_back(new MetricsHistogram(name, help));
+	return metrics.histograms.back();
+}
+
+
+// findValue
+static MetricsValue* findValue( const char* name, const char* help, bool gauge )
+{
+	MetricsRegistry& metrics = registry();
+	std::lock_guard<std::mutex> lock(metrics.mutex);
+
+	for( size_t n=0; n < metrics.values.size(); n++ )
+	{
+		if( metrics.values[n]->GetName() == name )
+			return metrics.values[n];
+	}
+
+	metrics.values.push_back(new MetricsValue(name, help, gauge));
+	return metrics.values.back();
+}
+
+
+// GetCounter
+MetricsValue* Metrics::GetCounter( const char* name, const char* help )
+{
+	return findValue(name, help, false);
+}
+
+
+// GetGauge
+MetricsValue* Metrics::GetGauge( const char* name, const char* help )
+{
+	return findValue(name, help, true);
+}
+
+
+// Format
+std::string Metrics::Format()
+{
+	// the buckets exported (in seconds), the histograms are summed into them
+	static const double bounds[] = { 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025,
+							   0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0 };
+
+	std::vector<MetricsHistogram*> histogramList;
+	std::vector<MetricsValue*> valueList;
+
+	{
+		MetricsRegistry& metrics = registry();
+		std::lock_guard<std::mutex> lock(metrics.mutex);
+
+		histogramList = metrics.histograms;
+		valueList = metrics.values;
+	}
+
+	std::string text;
+	char line[512];
+
+	for( size_t n=0; n < histogramList.size(); n++ )
+	{
+		const std::string name = "camera_capture_" + histogramList[n]->GetName() + "_seconds";
+
+		MetricsHistogram::Snapshot snapshot;
+		histogramList[n]->Read(snapshot);
+
+		snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s histogram\n", name.c_str(), histogramList[n]->GetHelp().c_str(), name.c_str());
+		text += line;
+
+		uint64_t cumulative = 0;
+		int bucket = 0;
+
+		for( size_t b=0; b < sizeof(bounds) / sizeof(bounds[0]); b++ )
+		{
+			const uint64_t bound = bounds[b] * 1e9;
+
+			while( bucket < MetricsHistogram::NumBuckets && MetricsHistogram::BucketUpperBound(bucket) <= bound )
+				cumulative += snapshot.counts[bucket++];
+
+			snprintf(line, sizeof(line), "%s_bucket{le=\"%g\"} %llu\n", name.c_str(), bounds[b], (unsigned long long)cumulative);
+			text += line;
+		}
+
+		snprintf(line, sizeof(line), "%s_bucket{le=\"+Inf\"} %llu\n%s_sum %.9f\n%s_count %llu\n",
+			    name.c_str(), (unsigned long long)snapshot.count, name.c_str(), snapshot.sum * 1e-9,
+			    name.c_str(), (unsigned long long)snapshot.count);
+
+		text += line;
+	}
+
+	for( size_t n=0; n < valueList.size(); n++ )
+	{
+		const bool gauge = valueList[n]->IsGauge();
+		const std::string name = "camera_capture_" + valueList[n]->GetName() + (gauge ? "" : "_total");
+
+		snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n%s %lld\n", name.c_str(), valueList[n]->GetHelp().c_str(),
+			    name.c_str(), gauge ? "gauge" : "counter", name.c_str(), (long long)valueList[n]->Get());
+
+		text += line;
+	}
+
+	return text;
+}
+
+
+// Write
+bool Metrics::Write( const std::string& filename )
+{
+	const std::string text = Format();
+	const std::string tmpFilename = filename + ".tmp";
+
+	// the file is replaced in one step, so it's never read half-written
+	FILE* file = fopen(tmpFilename.c_str(), "w");
+
+	if( !file )
+	{
+		printf("camera-capture:  failed to write metrics to %s\n", tmpFilename.c_str());
+		return false;
+	}
+
+	const bool result = (fwrite(text.c_str(), 1, text.size(), file) == text.size());
+
+	if( fclose(file) != 0 || !result || rename(tmpFilename.c_str(), filename.c_str()) != 0 )
+	{
+		printf("camera-capture:  failed to write metrics to %s\n", filename.c_str());
+		remove(tmpFilename.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+
+// Dump
+void Metrics::Dump()
+{
+	std::vector<MetricsHistogram*> histogramList;
+	std::vector<MetricsValue*> valueList;
+
+	{
+		MetricsRegistry& metrics = registry();
+		std::lock_guard<std::mutex> lock(metrics.mutex);
+
+		histogramList = metrics.histograms;
+		valueList = metrics.values;
+	}
+
+	printf("\ncamera-capture:  metrics\n\n");
+	printf("  %-24s %10s %10s %10s %10s %10s %10s\n", "latency (ms)", "count", "mean", "p50", "p90", "p99", "max");
+
+	for( size_t n=0; n < histogramList.size(); n++ )
+	{
+		MetricsHistogram::Snapshot snapshot;
+		histogramList[n]->Read(snapshot);
+
+		printf("  %-24s %10llu %10.3f %10.3f %10.3f %10.3f %10.3f\n", histogramList[n]->GetName().c_str(),
+			  (unsigned long long)snapshot.count, (snapshot.count > 0) ? snapshot.sum * 1e-6 / snapshot.count : 0.0,
+			  snapshot.Quantile(0.5) * 1e-6, snapshot.Quantile(0.9) * 1e-6,
+			  snapshot.Quantile(0.99) * 1e-6, snapshot.max * 1e-6);
+	}
+
+	if( valueList.size() > 0 )
+		printf("\n");
+
+	for( size_t n=0; n < valueList.size(); n++ )
+		printf("  %-24s %10lld\n", valueList[n]->GetName().c_str(), (long long)valueList[n]->Get());
+
+	printf("\n");
+}
+
+
+// the metrics file writer
+static std::thread writerThread;
+static std::mutex writerMutex;
+static std::condition_variable writerCondition;
+static bool writerStopping = false;
+
+
+// writerRun
+static void writerRun( std::string filename, int interval )
+{
+	std::unique_lock<std::mutex> lock(writerMutex);
+
+	while( !writerStopping )
+	{
+		writerCondition.wait_for(lock, std::chrono::milliseconds(interval));
+
+		lock.unlock();
+		Metrics::Write(filename);
+		lock.lock();
+	}
+}
+
+
+// StartWriter
+bool Metrics::StartWriter( const std::string& filename, int interval )
+{
+	StopWriter();
+
+	if( filename.size() == 0 )
+		return false;
+
+	// check that the file can be written before going to the background
+	if( !Write(filename) )
+		return false;
+
+	writerStopping = false;
+
+	writerThread = std::thread(writerRun, filename, std::max(interval, 100));
+
+	printf("camera-capture:  writing metrics to %s every %ims\n", filename.c_str(), interval);
+	return true;
+}
+
+
+// StopWriter
+void Metrics::StopWriter()
+{
+	if( !writerThread.joinable() )
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(writerMutex);
+		writerStopping = true;
+	}
+
+	writerCondition.notify_all();
+	writerThread.join();
+}
+
+
+// Usage
+const char* Metrics::Usage()
+{
+	return "metrics arguments:\n"
+		  "  --metrics                  record the latency of each stage (capture, render,\n"
+		  "                             save, ...), send SIGUSR1 to print a summary\n"
+		  "  --metrics-file=FILE        also write them to FILE in the Prometheus text format\n"
+		  "  --metrics-interval=MS      interval between writes of the file (default 5000ms)\n\n";
+}
+
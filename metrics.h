@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_METRICS__
+#define __CAMERA_METRICS__
+
+#include "tracer.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <atomic>
+
+
+/*
+ * Latency histogram with log-linear buckets (HDR-style):  each power of two
+ * is split into SubBuckets linear buckets, so the values are kept to within
+ * about 6% from a microsecond up to many seconds, in a fixed amount of memory.
+ *
+ * Each thread records into its own shard of the buckets, so recording is a
+ * couple of uncontended atomic adds and never takes a lock.  The shards are
+ * summed when the histogram is read.
+ */
+class MetricsHistogram
+{
+public:
+	// constructor
+	MetricsHistogram( const char* name, const char* help );
+
+	// destructor
+	~MetricsHistogram();
+
+	// add a value (in nanoseconds)
+	void Record( uint64_t value );
+
+	// summed over the threads
+	struct Snapshot
+	{
+		std::vector<uint64_t> counts;	// per bucket
+		uint64_t count;
+		uint64_t sum;
+		uint64_t max;
+
+		// the value below which the given fraction of the values fall
+		uint64_t Quantile( double fraction ) const;
+	};
+
+	void Read( Snapshot& snapshot ) const;
+
+	// name and description
+	inline const std::string& GetName() const		{ return name; }
+	inline const std::string& GetHelp() const		{ return help; }
+
+	// bucket layout
+	static const int SubBucketBits = 3;
+	static const int SubBuckets    = 1 << SubBucketBits;
+	static const int Magnitudes    = 40;		// up to 2^40 ns (18 minutes)
+	static const int NumBuckets    = (Magnitudes - SubBucketBits + 1) * SubBuckets;
+
+	static int BucketIndex( uint64_t value );
+	static uint64_t BucketUpperBound( int index );
+
+	// number of shards (threads beyond this share them)
+	static const int MaxShards = 8;
+
+protected:
+	struct Shard
+	{
+		std::atomic<uint64_t> counts[NumBuckets];
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> sum;
+		std::atomic<uint64_t> max;
+	};
+
+	std::string name;
+	std::string help;
+
+	Shard* shards[MaxShards];
+};
+
+
+/*
+ * Counter (i.e. dropped frames) or gauge (i.e. queue depth)
+ */
+class MetricsValue
+{
+public:
+	// constructor
+	MetricsValue( const char* name, const char* help, bool gauge );
+
+	// update the value
+	inline void Add( int64_t delta=1 )			{ value.fetch_add(delta, std::memory_order_relaxed); }
+	inline void Set( int64_t newValue )			{ value.store(newValue, std::memory_order_relaxed); }
+
+	inline int64_t Get() const				{ return value.load(std::memory_order_relaxed); }
+
+	// name and description
+	inline const std::string& GetName() const		{ return name; }
+	inline const std::string& GetHelp() const		{ return help; }
+	inline bool IsGauge() const				{ return gauge; }
+
+protected:
+	std::string name;
+	std::string help;
+	bool gauge;
+
+	std::atomic<int64_t> value;
+};
+
+
+/*
+ * Runtime metrics of the capture pipeline (see --metrics).
+ *
+ * The metrics are registered once by name and kept for the life of the
+ * process, so the call sites hold on to them in static pointers (see the
+ * METRICS_SCOPE macro).  While the metrics and tracing are disabled, the
+ * timers don't read the clock, so the instrumentation costs one branch.
+ *
+ * The metrics can be written periodically to a file in the Prometheus text
+ * format (i.e. for the node_exporter textfile collector), and a summary of
+ * the latencies can be printed on demand (SIGUSR1).
+ */
+class Metrics
+{
+public:
+	// enable or disable recording
+	static void Enable( bool enabled=true );
+
+	// is recording enabled?
+	static inline bool IsEnabled()				{ return enabled.load(std::memory_order_relaxed); }
+
+	// find or register a metric
+	static MetricsHistogram* GetHistogram( const char* name, const char* help="" );
+	static MetricsValue* GetCounter( const char* name, const char* help="" );
+	static MetricsValue* GetGauge( const char* name, const char* help="" );
+
+	// the current time (in nanoseconds)
+	static uint64_t Now();
+
+	// format all the metrics in the Prometheus text format
+	static std::string Format();
+
+	// write the metrics to a file (replaced atomically)
+	static bool Write( const std::string& filename );
+
+	// print a summary of the latencies (count, percentiles, max)
+	static void Dump();
+
+	// write the metrics to a file every interval, from a background thread
+	static bool StartWriter( const std::string& filename, int interval=DefaultInterval );
+	static void StopWriter();
+
+	// usage string for the command line arguments
+	static const char* Usage();
+
+	// default interval of the metrics file (in milliseconds)
+	static const int DefaultInterval = 5000;
+
+protected:
+	static std::atomic<bool> enabled;
+};
+
+
+/*
+ * Times the enclosing scope into a histogram (and the trace, if it's enabled)
+ */
+class MetricsTimer
+{
+public:
+	inline MetricsTimer( MetricsHistogram* _histogram )	{ histogram = _histogram; start = (Metrics::IsEnabled() || Tracer::IsEnabled()) ? Metrics::Now() : 0; }
+	inline ~MetricsTimer()					{ if( start != 0 ) record(); }
+
+protected:
+	void record();
+
+	MetricsHistogram* histogram;
+	uint64_t start;
+};
+
+
+#define METRICS_CONCAT_(a, b) a##b
+#define METRICS_CONCAT(a, b) METRICS_CONCAT_(a, b)
+
+/*
+ * Time the rest of the scope, i.e. METRICS_SCOPE("save_image", "time to encode and write an image")
+ */
+#define METRICS_SCOPE(name, help) \
+	static MetricsHistogram* METRICS_CONCAT(metricsHistogram, __LINE__) = Metrics::GetHistogram(name, help); \
+	MetricsTimer METRICS_CONCAT(metricsTimer, __LINE__)(METRICS_CONCAT(metricsHistogram, __LINE__))
+
+#endif
+
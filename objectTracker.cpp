@@ -0,0 +1,603 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "objectTracker.h"
+#include "tracer.h"
+
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TRACKER_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TRACKER_SSE2
+#endif
+
+
+const float ObjectTracker::MinScore = 0.5f;
+
+
+// constructor
+ObjectTracker::ObjectTracker()
+{
+	stopping       = false;
+	frameReady     = false;
+	resultsReady   = false;
+	generation     = 0;
+	processingTime = 0.0f;
+
+	thread = std::thread(&ObjectTracker::run, this);
+}
+
+
+// destructor
+ObjectTracker::~ObjectTracker()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	condition.notify_all();
+
+	if( thread.joinable() )
+		thread.join();
+}
+
+
+// rgbToGray
+static inline int rgbToGray( const uchar3& px )
+{
+	return (px.x * 77 + px.y * 150 + px.z * 29) >> 8;
+}
+
+
+// BuildPyramid
+void ObjectTracker::BuildPyramid( const uchar3* image, int width, int height, Pyramid& pyramid )
+{
+	const int scale = (width > DownsampleWidth) ? (width / DownsampleWidth) : 1;
+
+	pyramid.scale = scale;
+
+	// the first level averages a 2x2 block at each sample, so that only
+	// a fraction of the camera image has to be read
+	Image& base = pyramid.levels[0];
+
+	base.width  = width / scale;
+	base.height = height / scale;
+	base.pixels.resize(base.width * base.height);
+
+	const int nextPixel = (scale > 1) ? 1 : 0;
+	const int nextRow   = (scale > 1) ? width : 0;
+
+	for( int y=0; y < base.height; y++ )
+	{
+		const uchar3* row = image + (y * scale) * width;
+		uint8_t* out = &base.pixels[y * base.width];
+
+		for( int x=0; x < base.width; x++ )
+		{
+			const uchar3* px = row + x * scale;
+
+			out[x] = (rgbToGray(px[0]) + rgbToGray(px[nextPixel]) +
+					rgbToGray(px[nextRow]) + rgbToGray(px[nextRow + nextPixel]) + 2) >> 2;
+		}
+	}
+
+	// each following level is half the size of the previous
+	for( int n=1; n < NumLevels; n++ )
+	{
+		const Image& prev = pyramid.levels[n-1];
+		Image& level = pyramid.levels[n];
+
+		level.width  = prev.width / 2;
+		level.height = prev.height / 2;
+		level.pixels.resize(level.width * level.height);
+
+		for( int y=0; y < level.height; y++ )
+		{
+			const uint8_t* row0 = &prev.pixels[(y * 2) * prev.width];
+			const uint8_t* row1 = row0 + prev.width;
+			uint8_t* out = &level.pixels[y * level.width];
+
+			for( int x=0; x < level.width; x++ )
+				out[x] = (row0[x*2] + row0[x*2+1] + row1[x*2] + row1[x*2+1] + 2) >> 2;
+		}
+	}
+}
+
+
+// correlateRow
+static inline void correlateRow( const uint8_t* img, const uint8_t* tmpl, int n, uint32_t* sumI, uint32_t* sumII, uint32_t* sumIT )
+{
+	int j = 0;
+
+	uint32_t si  = 0;
+	uint32_t sii = 0;
+	uint32_t sit = 0;
+
+#if defined(TRACKER_NEON)
+	uint32x4_t accI  = vdupq_n_u32(0);
+	uint32x4_t accII = vdupq_n_u32(0);
+	uint32x4_t accIT = vdupq_n_u32(0);
+
+	for( ; j + 16 <= n; j += 16 )
+	{
+		const uint8x16_t a = vld1q_u8(img + j);
+		const uint8x16_t b = vld1q_u8(tmpl + j);
+
+		accI  = vpadalq_u16(accI, vpaddlq_u8(a));
+		accII = vpadalq_u16(accII, vmull_u8(vget_low_u8(a), vget_low_u8(a)));
+		accII = vpadalq_u16(accII, vmull_u8(vget_high_u8(a), vget_high_u8(a)));
+		accIT = vpadalq_u16(accIT, vmull_u8(vget_low_u8(a), vget_low_u8(b)));
+		accIT = vpadalq_u16(accIT, vmull_u8(vget_high_u8(a), vget_high_u8(b)));
+	}
+
+	si  = vgetq_lane_u32(accI, 0) + vgetq_lane_u32(accI, 1) + vgetq_lane_u32(accI, 2) + vgetq_lane_u32(accI, 3);
+	sii = vgetq_lane_u32(accII, 0) + vgetq_lane_u32(accII, 1) + vgetq_lane_u32(accII, 2) + vgetq_lane_u32(accII, 3);
+	sit = vgetq_lane_u32(accIT, 0) + vgetq_lane_u32(accIT, 1) + vgetq_lane_u32(accIT, 2) + vgetq_lane_u32(accIT, 3);
+
+#elif defined(TRACKER_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+
+	__m128i accI  = zero;
+	__m128i accII = zero;
+	__m128i accIT = zero;
+
+	for( ; j + 16 <= n; j += 16 )
+	{
+		const __m128i a = _mm_loadu_si128((const __m128i*)(img + j));
+		const __m128i b = _mm_loadu_si128((const __m128i*)(tmpl + j));
+
+		const __m128i aLow  = _mm_unpacklo_epi8(a, zero);
+		const __m128i aHigh = _mm_unpackhi_epi8(a, zero);
+		const __m128i bLow  = _mm_unpacklo_epi8(b, zero);
+		const __m128i bHigh = _mm_unpackhi_epi8(b, zero);
+
+		accI  = _mm_add_epi64(accI, _mm_sad_epu8(a, zero));
+		accII = _mm_add_epi32(accII, _mm_add_epi32(_mm_madd_epi16(aLow, aLow), _mm_madd_epi16(aHigh, aHigh)));
+		accIT = _mm_add_epi32(accIT, _mm_add_epi32(_mm_madd_epi16(aLow, bLow), _mm_madd_epi16(aHigh, bHigh)));
+	}
+
+	uint32_t lanes[4];
+
+	_mm_storeu_si128((__m128i*)lanes, accI);
+	si = lanes[0] + lanes[2];
+
+	_mm_storeu_si128((__m128i*)lanes, accII);
+	sii = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+	_mm_storeu_si128((__m128i*)lanes, accIT);
+	sit = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+	for( ; j < n; j++ )
+	{
+		const uint32_t a = img[j];
+		const uint32_t b = tmpl[j];
+
+		si  += a;
+		sii += a * a;
+		sit += a * b;
+	}
+
+	*sumI  = si;
+	*sumII = sii;
+	*sumIT = sit;
+}
+
+
+// Correlate
+float ObjectTracker::Correlate( const Image& image, int x, int y, const Image& tmpl, double sumT, double normT )
+{
+	if( x < 0 || y < 0 || x + tmpl.width > image.width || y + tmpl.height > image.height )
+		return -1.0f;
+
+	double sumI  = 0.0;
+	double sumII = 0.0;
+	double sumIT = 0.0;
+
+	for( int row=0; row < tmpl.height; row++ )
+	{
+		uint32_t si, sii, sit;
+
+		correlateRow(&image.pixels[(y + row) * image.width + x], &tmpl.pixels[row * tmpl.width], tmpl.width, &si, &sii, &sit);
+
+		sumI  += si;
+		sumII += sii;
+		sumIT += sit;
+	}
+
+	const double n = tmpl.width * tmpl.height;
+	const double normI = n * sumII - sumI * sumI;
+
+	if( normI <= 0.0 || normT <= 0.0 )
+		return 0.0f;
+
+	return (n * sumIT - sumI * sumT) / (sqrt(normI) * normT);
+}
+
+
+// SetTargets
+void ObjectTracker::SetTargets( uchar3* image, int width, int height, const std::vector<BoundingBox>& boxes )
+{
+	if( !image || width <= 0 || height <= 0 )
+		return;
+
+	Pyramid frame;
+	BuildPyramid(image, width, height, frame);
+
+	std::shared_ptr<TargetList> list(new TargetList());
+	list->reserve(boxes.size());
+
+	for( size_t n=0; n < boxes.size(); n++ )
+	{
+		const BoundingBox& box = boxes[n];
+
+		Target target;
+
+		target.id = box.id;
+		target.x  = box.x;
+		target.y  = box.y;
+		target.searchLevel = -1;
+
+		// extract the templates, from the first level up to the one the box fits in
+		for( int level=0; level < NumLevels; level++ )
+		{
+			const Image& img = frame.levels[level];
+			const float  f   = frame.scale * (1 << level);
+
+			const int x0 = (int)floorf(box.x / f);
+			const int y0 = (int)floorf(box.y / f);
+
+			// clip the template to the image
+			const int tx0 = (x0 < 0) ? 0 : x0;
+			const int ty0 = (y0 < 0) ? 0 : y0;
+			const int tx1 = std::min(img.width, x0 + (int)(box.width / f + 0.5f));
+			const int ty1 = std::min(img.height, y0 + (int)(box.height / f + 0.5f));
+
+			if( tx1 - tx0 < MinTemplateSize || ty1 - ty0 < MinTemplateSize )
+				break;
+
+			Template& tmpl = target.templates[level];
+
+			tmpl.offsetX      = tx0 - x0;
+			tmpl.offsetY      = ty0 - y0;
+			tmpl.image.width  = tx1 - tx0;
+			tmpl.image.height = ty1 - ty0;
+			tmpl.image.pixels.resize(tmpl.image.width * tmpl.image.height);
+
+			double sum = 0.0;
+			double sumSq = 0.0;
+
+			for( int y=0; y < tmpl.image.height; y++ )
+			{
+				for( int x=0; x < tmpl.image.width; x++ )
+				{
+					const uint8_t v = img.pixels[(ty0 + y) * img.width + tx0 + x];
+
+					tmpl.image.pixels[y * tmpl.image.width + x] = v;
+					sum   += v;
+					sumSq += v * v;
+				}
+			}
+
+			const double count = tmpl.image.width * tmpl.image.height;
+			const double var   = count * sumSq - sum * sum;
+
+			tmpl.sum  = sum;
+			tmpl.norm = (var > 0.0) ? sqrt(var) : 0.0;
+
+			target.searchLevel = level;
+
+			if( tmpl.image.width <= MaxTemplateSize && tmpl.image.height <= MaxTemplateSize )
+				break;
+		}
+
+		// boxes too small (or flat) to track are left in place
+		if( target.searchLevel < 0 || target.templates[target.searchLevel].norm <= 0.0 )
+			continue;
+
+		list->push_back(target);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	targets = list;
+	generation++;
+	frameReady   = false;
+	resultsReady = false;
+}
+
+
+// ClearTargets
+void ObjectTracker::ClearTargets()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	targets.reset();
+	generation++;
+	frameReady   = false;
+	resultsReady = false;
+}
+
+
+// IsTracking
+bool ObjectTracker::IsTracking() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return targets && targets->size() > 0;
+}
+
+
+// Process
+void ObjectTracker::Process( uchar3* image, int width, int height )
+{
+	if( !image || !IsTracking() )
+		return;
+
+	BuildPyramid(image, width, height, captureFrame);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		// replaces the pending frame if the worker hasn't gotten to it yet
+		std::swap(captureFrame, pendingFrame);
+		frameReady = true;
+	}
+
+	condition.notify_one();
+}
+
+
+// GetResults
+bool ObjectTracker::GetResults( std::vector<TrackerResult>& out )
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if( !resultsReady )
+		return false;
+
+	out = results;
+	resultsReady = false;
+
+	return true;
+}
+
+
+// GetProcessingTime
+float ObjectTracker::GetProcessingTime() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return processingTime;
+}
+
+
+// run
+void ObjectTracker::run()
+{
+	Tracer::SetThreadName("tracker");
+
+	std::shared_ptr<const TargetList> list;
+	std::vector<TrackerResult> tracked;
+
+	uint32_t trackedGeneration = 0;
+
+	// current and previous positions of the targets (for motion prediction)
+	std::vector<float> posX, posY;
+	std::vector<float> prevX, prevY;
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while( true )
+	{
+		while( !stopping && !frameReady )
+			condition.wait(lock);
+
+		if( stopping )
+			break;
+
+		std::swap(pendingFrame, workFrame);
+		frameReady = false;
+
+		// restart from the initial positions when the targets change
+		if( list != targets || trackedGeneration != generation )
+		{
+			list = targets;
+			trackedGeneration = generation;
+
+			const size_t numTargets = list ? list->size() : 0;
+
+			posX.resize(numTargets);
+			posY.resize(numTargets);
+
+			for( size_t n=0; n < numTargets; n++ )
+			{
+				posX[n] = (*list)[n].x;
+				posY[n] = (*list)[n].y;
+			}
+
+			prevX = posX;
+			prevY = posY;
+		}
+
+		const uint32_t frameGeneration = trackedGeneration;
+
+		lock.unlock();
+
+		// track each target in the new frame
+		const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		const size_t numTargets = list ? list->size() : 0;
+
+		tracked.resize(numTargets);
+
+		for( size_t n=0; n < numTargets; n++ )
+		{
+			const Target& target = (*list)[n];
+
+			// constant-velocity prediction of where the box will be
+			const float predX = posX[n] + (posX[n] - prevX[n]);
+			const float predY = posY[n] + (posY[n] - prevY[n]);
+
+			TrackerResult& result = tracked[n];
+
+			result.id    = target.id;
+			result.found = track(workFrame, target, predX, predY, &result.x, &result.y, &result.score);
+
+			prevX[n] = posX[n];
+			prevY[n] = posY[n];
+
+			if( result.found )
+			{
+				posX[n] = result.x;
+				posY[n] = result.y;
+			}
+			else
+			{
+				result.x = posX[n];
+				result.y = posY[n];
+			}
+		}
+
+		const float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+		lock.lock();
+
+		// drop the results if the targets changed while tracking
+		if( frameGeneration == generation )
+		{
+			std::swap(results, tracked);
+			resultsReady   = true;
+			processingTime = elapsed;
+		}
+	}
+}
+
+
+// track
+bool ObjectTracker::track( const Pyramid& frame, const Target& target, float predX, float predY, float* x, float* y, float* score ) const
+{
+	const int level = target.searchLevel;
+	const Template& coarse = target.templates[level];
+
+	// exhaustive search around the predicted position on the coarsest level
+	const float coarseScale = frame.scale * (1 << level);
+
+	const int startX = (int)floorf(predX / coarseScale + 0.5f) + coarse.offsetX;
+	const int startY = (int)floorf(predY / coarseScale + 0.5f) + coarse.offsetY;
+
+	int   bestX = startX;
+	int   bestY = startY;
+	float bestScore = -1.0f;
+
+	for( int dy=-SearchRadius; dy <= SearchRadius; dy++ )
+	{
+		for( int dx=-SearchRadius; dx <= SearchRadius; dx++ )
+		{
+			const float s = Correlate(frame.levels[level], startX + dx, startY + dy, coarse.image, coarse.sum, coarse.norm);
+
+			if( s > bestScore )
+			{
+				bestScore = s;
+				bestX = startX + dx;
+				bestY = startY + dy;
+			}
+		}
+	}
+
+	if( bestScore < MinScore )
+	{
+		*score = bestScore;
+		return false;
+	}
+
+	// refine the position on each finer level (the finest level is
+	// always visited, so the sub-pixel peak can be found on it)
+	float subX = 0.0f;
+	float subY = 0.0f;
+
+	int boxX = bestX - coarse.offsetX;
+	int boxY = bestY - coarse.offsetY;
+
+	for( int l=(level > 0) ? level-1 : 0; l >= 0; l-- )
+	{
+		const Template& tmpl = target.templates[l];
+		const int upscale = (l < level) ? 2 : 1;
+
+		const int cx = boxX * upscale + tmpl.offsetX;
+		const int cy = boxY * upscale + tmpl.offsetY;
+
+		float scores[3][3];
+
+		bestScore = -1.0f;
+		bestX = cx;
+		bestY = cy;
+
+		for( int dy=-1; dy <= 1; dy++ )
+		{
+			for( int dx=-1; dx <= 1; dx++ )
+			{
+				const float s = Correlate(frame.levels[l], cx + dx, cy + dy, tmpl.image, tmpl.sum, tmpl.norm);
+
+				scores[dy+1][dx+1] = s;
+
+				if( s > bestScore )
+				{
+					bestScore = s;
+					bestX = cx + dx;
+					bestY = cy + dy;
+				}
+			}
+		}
+
+		boxX = bestX - tmpl.offsetX;
+		boxY = bestY - tmpl.offsetY;
+
+		// sub-pixel peak on the finest level (parabola through the neighbors)
+		if( l == 0 && bestX == cx && bestY == cy )
+		{
+			const float denomX = scores[1][0] - 2.0f * scores[1][1] + scores[1][2];
+			const float denomY = scores[0][1] - 2.0f * scores[1][1] + scores[2][1];
+
+			if( denomX < 0.0f )
+				subX = 0.5f * (scores[1][0] - scores[1][2]) / denomX;
+
+			if( denomY < 0.0f )
+				subY = 0.5f * (scores[0][1] - scores[2][1]) / denomY;
+		}
+	}
+
+	*score = bestScore;
+
+	if( bestScore < MinScore )
+		return false;
+
+	// the search ended on the finest level, which is the downsampled camera image
+	*x = (boxX + subX) * frame.scale;
+	*y = (boxY + subY) * frame.scale;
+
+	return true;
+}
+
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_OBJECT_TRACKER__
+#define __CAMERA_OBJECT_TRACKER__
+
+#include "cudaUtility.h"
+#include "annotationModel.h"
+
+#include <stdint.h>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+/*
+ * Tracking result for one box
+ */
+struct TrackerResult
+{
+	uint32_t id;		// box ID from the AnnotationModel
+	float    x;		// new position of the box
+	float    y;
+	float    score;	// normalized cross-correlation score [-1,1]
+	bool     found;	// false if the object was lost (the box isn't moved)
+};
+
+
+/*
+ * CPU object tracker that carries boxes forward across frames.
+ *
+ * The frames are converted to a small grayscale pyramid on the caller's
+ * thread (only a few pixels per output are read), and the boxes are found
+ * in each new frame on a worker thread with SIMD normalized cross-correlation,
+ * starting at the coarsest pyramid level the box fits in and refining down.
+ * Only the latest frame is kept, so the tracker never falls behind the camera.
+ */
+class ObjectTracker
+{
+public:
+	// constructor
+	ObjectTracker();
+
+	// destructor
+	~ObjectTracker();
+
+	// start tracking boxes from a frame
+	void SetTargets( uchar3* image, int width, int height, const std::vector<BoundingBox>& boxes );
+
+	// stop tracking
+	void ClearTargets();
+
+	// returns true if there are boxes being tracked
+	bool IsTracking() const;
+
+	// queue the next frame to be tracked
+	void Process( uchar3* image, int width, int height );
+
+	// get the latest positions (returns false if there aren't new ones)
+	bool GetResults( std::vector<TrackerResult>& results );
+
+	// time taken to track the last frame (in milliseconds)
+	float GetProcessingTime() const;
+
+	// tracker settings
+	static const int NumLevels       = 3;		// pyramid levels
+	static const int DownsampleWidth = 320;	// approx width of the first level
+	static const int MaxTemplateSize = 32;	// size of the templates on the search level
+	static const int SearchRadius    = 8;		// search radius on the search level (in pixels)
+	static const int MinTemplateSize = 4;
+
+	static const float MinScore;			// minimum score for a box to be considered found
+
+	// grayscale image
+	struct Image
+	{
+		int width;
+		int height;
+		std::vector<uint8_t> pixels;
+	};
+
+	// grayscale pyramid
+	struct Pyramid
+	{
+		int   scale;				// downsampling of the first level
+		Image levels[NumLevels];
+	};
+
+	// build the pyramid from an RGB image
+	static void BuildPyramid( const uchar3* image, int width, int height, Pyramid& pyramid );
+
+	// compute the normalized cross-correlation of a template at (x,y)
+	static float Correlate( const Image& image, int x, int y, const Image& tmpl, double sumT, double normT );
+
+protected:
+	// template of one box on one pyramid level
+	struct Template
+	{
+		Image  image;
+		int    offsetX;		// template origin relative to the box (in level pixels)
+		int    offsetY;
+		double sum;
+		double norm;
+	};
+
+	// tracked box
+	struct Target
+	{
+		uint32_t id;
+		int      searchLevel;
+		float    x;
+		float    y;
+
+		Template templates[NumLevels];
+	};
+
+	typedef std::vector<Target> TargetList;
+
+	void run();
+	bool track( const Pyramid& frame, const Target& target, float predX, float predY, float* x, float* y, float* score ) const;
+
+	std::thread thread;
+	mutable std::mutex mutex;
+	std::condition_variable condition;
+
+	bool stopping;
+	bool frameReady;
+	bool resultsReady;
+
+	std::shared_ptr<const TargetList> targets;
+	uint32_t generation;		// incremented when the targets change
+
+	Pyramid captureFrame;	// used by Process() on the caller's thread
+	Pyramid pendingFrame;	// waiting for the worker
+	Pyramid workFrame;		// being tracked by the worker
+
+	std::vector<TrackerResult> results;
+	float processingTime;
+};
+
+#endif
+
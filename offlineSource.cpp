@@ -0,0 +1,518 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "offlineSource.h"
+#include "frameRecorder.h"
+#include "tracer.h"
+
+#include "videoSource.h"
+#include "cudaMappedMemory.h"
+#include "imageIO.h"
+
+#include <algorithm>
+#include <dirent.h>
+#include <strings.h>
+#include <string.h>
+#include <sys/stat.h>
+
+
+// constructor
+OfflineFrame::OfflineFrame()
+{
+	index  = 0;
+	image  = NULL;
+	width  = 0;
+	height = 0;
+}
+
+
+// destructor
+OfflineFrame::~OfflineFrame()
+{
+	if( image != NULL )
+		CUDA(cudaFreeHost(image));
+}
+
+
+//-----------------------------------------------------------------------------------------
+// constructor
+OfflineSource::OfflineSource()
+{
+	stride    = 1;
+	readAhead = DefaultReadAhead;
+	current   = 0;
+	count     = -1;
+	recording = NULL;
+	stopping  = false;
+	failed    = false;
+}
+
+
+// destructor
+OfflineSource::~OfflineSource()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	condition.notify_all();
+
+	for( size_t n=0; n < threads.size(); n++ )
+		threads[n].join();
+
+	SAFE_DELETE(recording);
+}
+
+
+// Create
+OfflineSource* OfflineSource::Create( const char* path, int stride, int readAhead )
+{
+	if( !path )
+		return NULL;
+
+	OfflineSource* source = new OfflineSource();
+
+	if( !source->init(path, stride, readAhead) )
+	{
+		printf("camera-capture:  failed to open offline source %s\n", path);
+		delete source;
+		return NULL;
+	}
+
+	return source;
+}
+
+
+// IsDirectory
+bool OfflineSource::IsDirectory( const char* path )
+{
+	struct stat info;
+
+	if( !path || stat(path, &info) != 0 )
+		return false;
+
+	return S_ISDIR(info.st_mode);
+}
+
+
+// isImageFile
+static bool isImageFile( const char* filename )
+{
+	static const char* extensions[] = { ".jpg", ".jpeg", ".png", ".bmp", ".tga", ".gif" };
+
+	const char* ext = strrchr(filename, '.');
+
+	if( !ext )
+		return false;
+
+	for( size_t n=0; n < sizeof(extensions) / sizeof(extensions[0]); n++ )
+	{
+		if( strcasecmp(ext, extensions[n]) == 0 )
+			return true;
+	}
+
+	return false;
+}
+
+
+// init
+bool OfflineSource::init( const char* _path, int _stride, int _readAhead )
+{
+	path      = _path;
+	stride    = std::max(_stride, 1);
+	readAhead = std::max(_readAhead, 1);
+
+	// the frames of a recording are read by index, like images
+	if( RecordingReader::IsRecording(_path) )
+	{
+		recording = RecordingReader::Open(path);
+
+		if( !recording || recording->GetCount() == 0 )
+			return false;
+
+		count = (recording->GetCount() + stride - 1) / stride;
+
+		printf("camera-capture:  labeling %i of %i frames from recording %s\n", count, recording->GetCount(), _path);
+
+		for( int n=0; n < NumThreads; n++ )
+			threads.push_back(std::thread(&OfflineSource::runImages, this));
+
+		std::lock_guard<std::mutex> lock(mutex);
+		updateWindow();
+
+		return true;
+	}
+
+	if( !IsDirectory(_path) )
+	{
+		// the frames of a video are decoded in order by one thread
+		threads.push_back(std::thread(&OfflineSource::runVideo, this));
+
+		printf("camera-capture:  labeling frames from video %s (stride %i)\n", _path, stride);
+		return true;
+	}
+
+	// list the images in the directory
+	DIR* dir = opendir(_path);
+
+	if( !dir )
+		return false;
+
+	std::vector<std::string> images;
+	struct dirent* entry = NULL;
+
+	while( (entry = readdir(dir)) != NULL )
+	{
+		if( isImageFile(entry->d_name) )
+			images.push_back(entry->d_name);
+	}
+
+	closedir(dir);
+
+	if( images.size() == 0 )
+	{
+		printf("camera-capture:  no images found in %s\n", _path);
+		return false;
+	}
+
+	std::sort(images.begin(), images.end());
+
+	for( size_t n=0; n < images.size(); n += stride )
+		files.push_back(path + "/" + images[n]);
+
+	count = files.size();
+
+	printf("camera-capture:  labeling %i of %zu images from %s\n", count, images.size(), _path);
+
+	for( int n=0; n < NumThreads; n++ )
+		threads.push_back(std::thread(&OfflineSource::runImages, this));
+
+	std::lock_guard<std::mutex> lock(mutex);
+	updateWindow();
+
+	return true;
+}
+
+
+// GetCount
+int OfflineSource::GetCount() const
+{
+	return count;
+}
+
+
+// Capture
+std::shared_ptr<OfflineFrame> OfflineSource::Capture()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while( true )
+	{
+		std::map<int, std::shared_ptr<OfflineFrame> >::iterator iter = frames.find(current);
+
+		if( iter != frames.end() )
+			return iter->second;
+
+		if( failed || (count >= 0 && current >= count) )
+			return std::shared_ptr<OfflineFrame>();
+
+		if( IsVideo() || loading.count(current) > 0 )
+		{
+			// wait for the decoder
+			condition.wait(lock);
+			continue;
+		}
+
+		// the image wasn't read ahead, so load it now
+		const int index = current;
+
+		loading.insert(index);
+		lock.unlock();
+
+		std::shared_ptr<OfflineFrame> frame = loadFrame(index);
+
+		lock.lock();
+		loading.erase(index);
+
+		if( frame == NULL )
+		{
+			condition.notify_all();
+			return frame;
+		}
+
+		frames[index] = frame;
+		condition.notify_all();
+	}
+}
+
+
+// Seek
+bool OfflineSource::Seek( int index )
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if( index < 0 || (count >= 0 && index >= count) )
+		return false;
+
+	current = index;
+	updateWindow();
+
+	return true;
+}
+
+
+// Step
+bool OfflineSource::Step( int frameCount )
+{
+	return Seek(current + frameCount);
+}
+
+
+// updateWindow
+void OfflineSource::updateWindow()
+{
+	// only keep the frames around the current one
+	const int first = std::max(current - 1, 0);
+	const int last  = current + readAhead;
+
+	for( std::map<int, std::shared_ptr<OfflineFrame> >::iterator iter = frames.begin(); iter != frames.end(); )
+	{
+		if( iter->first < first || iter->first > last )
+			frames.erase(iter++);
+		else
+			iter++;
+	}
+
+	// decode the frames ahead of the current one (and the previous one, for stepping back)
+	if( !IsVideo() )
+	{
+		queue.clear();
+
+		for( int n=current; n <= last && n < count; n++ )
+			queue.push_back(n);
+
+		if( current > 0 )
+			queue.push_back(current - 1);
+	}
+
+	condition.notify_all();
+}
+
+
+// runImages
+void OfflineSource::runImages()
+{
+	Tracer::SetThreadName("offline loader");
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while( true )
+	{
+		while( !stopping && queue.size() == 0 )
+			condition.wait(lock);
+
+		if( stopping )
+			break;
+
+		const int index = queue.front();
+		queue.pop_front();
+
+		if( frames.count(index) > 0 || loading.count(index) > 0 )
+			continue;
+
+		loading.insert(index);
+		lock.unlock();
+
+		std::shared_ptr<OfflineFrame> frame = loadFrame(index);
+
+		lock.lock();
+		loading.erase(index);
+
+		// the current frame may have moved on while it was loading
+		if( frame != NULL && index >= current - 1 && index <= current + readAhead )
+			frames[index] = frame;
+
+		condition.notify_all();		// Capture() may be waiting for it
+	}
+}
+
+
+// loadFrame
+std::shared_ptr<OfflineFrame> OfflineSource::loadFrame( int index ) const
+{
+	TRACE_SCOPE("offline_load");
+
+	std::shared_ptr<OfflineFrame> frame(new OfflineFrame());
+
+	frame->index = index;
+
+	if( recording != NULL )
+	{
+		frame->width  = recording->GetWidth();
+		frame->height = recording->GetHeight();
+
+		if( !cudaAllocMapped((void**)&frame->image, frame->width * frame->height * sizeof(uchar3))
+		 || !recording->Read(index * stride, frame->image) )
+		{
+			printf("camera-capture:  failed to read frame %i of %s\n", index * stride, path.c_str());
+			return std::shared_ptr<OfflineFrame>();
+		}
+
+		return frame;
+	}
+
+	if( !loadImage(files[index].c_str(), &frame->image, &frame->width, &frame->height) )
+	{
+		printf("camera-capture:  failed to load %s\n", files[index].c_str());
+		return std::shared_ptr<OfflineFrame>();
+	}
+
+	return frame;
+}
+
+
+// runVideo
+void OfflineSource::runVideo()
+{
+	Tracer::SetThreadName("offline decoder");
+
+	videoSource* video = NULL;
+
+	int raw  = 0;	// frames decoded since the video was opened
+	int next = 0;	// index of the next frame that's kept (after the stride)
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while( !stopping )
+	{
+		const int first = std::max(current - 1, 0);
+		const int last  = current + readAhead;
+
+		// the decoder is already past the current frame, so start over
+		if( video != NULL && next > current && frames.count(current) == 0 )
+		{
+			lock.unlock();
+			SAFE_DELETE(video);
+			lock.lock();
+			continue;
+		}
+
+		if( video == NULL )
+		{
+			lock.unlock();
+			video = videoSource::Create(path.c_str());
+			lock.lock();
+
+			raw  = 0;
+			next = 0;
+
+			if( !video )
+			{
+				failed = true;
+				condition.notify_all();
+				break;
+			}
+
+			continue;
+		}
+
+		// wait until more frames are needed
+		if( next > last || (count >= 0 && next >= count) )
+		{
+			condition.wait(lock);
+			continue;
+		}
+
+		lock.unlock();
+
+		uchar3* image = NULL;
+		std::shared_ptr<OfflineFrame> frame;
+
+		bool captured = false;
+
+		{
+			TRACE_SCOPE("offline_decode");
+			captured = video->Capture(&image, 1000);
+		}
+
+		const bool keep = captured && (raw % stride == 0) && (next >= first);
+
+		// the decoder reuses its buffers, so the frames that are kept are copied
+		if( keep )
+		{
+			const size_t size = video->GetWidth() * video->GetHeight() * sizeof(uchar3);
+
+			frame.reset(new OfflineFrame());
+
+			frame->index  = next;
+			frame->width  = video->GetWidth();
+			frame->height = video->GetHeight();
+
+			if( !cudaAllocMapped((void**)&frame->image, size) || CUDA_FAILED(cudaMemcpy(frame->image, image, size, cudaMemcpyDefault)) )
+				frame.reset();
+		}
+
+		lock.lock();
+
+		if( !captured )
+		{
+			// the end of the video
+			if( !video->IsStreaming() )
+			{
+				count = next;
+				condition.notify_all();
+			}
+
+			continue;
+		}
+
+		if( raw % stride == 0 )
+		{
+			if( frame != NULL && next >= current - 1 && next <= current + readAhead )
+				frames[next] = frame;
+
+			next++;
+			condition.notify_all();
+		}
+
+		raw++;
+	}
+
+	lock.unlock();
+	SAFE_DELETE(video);
+}
+
+
+// Usage
+const char* OfflineSource::Usage()
+{
+	return "offline arguments:\n"
+		  "  --offline                  label recorded footage (a directory of images, a\n"
+		  "                             video file, or a .ccr recording) by stepping\n"
+		  "                             through its frames\n"
+		  "  --stride=N                 only use every N-th frame (default 1)\n"
+		  "  --read-ahead=N             number of frames decoded ahead (default 8)\n"
+		  "  --rate=FPS                 play the frames at this rate while not frozen\n"
+		  "                             (default 0, only step through them)\n\n";
+}
+
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_OFFLINE_SOURCE__
+#define __CAMERA_OFFLINE_SOURCE__
+
+#include "cudaUtility.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// forward declarations
+class videoSource;
+class RecordingReader;
+
+
+/*
+ * Decoded frame of an offline source
+ */
+struct OfflineFrame
+{
+	OfflineFrame();
+	~OfflineFrame();
+
+	int index;		// frame number (after the stride)
+
+	uchar3* image;		// mapped memory, so it can be rendered directly
+	int     width;
+	int     height;
+};
+
+
+/*
+ * Recorded footage to label, from a directory of images, a video file,
+ * or a recording made by FrameRecorder.
+ *
+ * Unlike a live camera, the frames are stepped through by index.  The
+ * frames after the current one are decoded ahead on worker threads, so
+ * stepping to the next frame doesn't wait on the decoder.  Images are
+ * decoded in parallel (as are the frames of a recording, which can be read
+ * at any index), videos are decoded in order by a single thread
+ * (stepping back more than one frame in a video re-decodes it from the
+ * start, so it's much slower than stepping forward).
+ */
+class OfflineSource
+{
+public:
+	// open a directory of images, a video file, or a recording
+	static OfflineSource* Create( const char* path, int stride=1, int readAhead=DefaultReadAhead );
+
+	// destructor
+	~OfflineSource();
+
+	// get the current frame (waits for it if it isn't decoded yet)
+	std::shared_ptr<OfflineFrame> Capture();
+
+	// move to another frame, returns false if it's past the end
+	bool Seek( int index );
+	bool Step( int count );
+
+	// the current frame number
+	inline int GetIndex() const				{ return current; }
+
+	// the number of frames, or -1 until the end of a video was reached
+	int GetCount() const;
+
+	// is the source a video file?
+	inline bool IsVideo() const				{ return files.size() == 0 && recording == NULL; }
+
+	// is the path a directory?
+	static bool IsDirectory( const char* path );
+
+	// usage string for the command line arguments
+	static const char* Usage();
+
+	// default number of frames decoded ahead
+	static const int DefaultReadAhead = 8;
+
+	// number of threads decoding images
+	static const int NumThreads = 2;
+
+protected:
+	OfflineSource();
+	bool init( const char* path, int stride, int readAhead );
+
+	void runImages();
+	void runVideo();
+	void updateWindow();
+
+	std::shared_ptr<OfflineFrame> loadFrame( int index ) const;
+
+	std::string path;
+	std::vector<std::string> files;	// image files (after the stride), empty for a video
+	RecordingReader* recording;		// non-NULL for a recording
+
+	int stride;
+	int readAhead;
+	int current;
+	int count;
+
+	std::map<int, std::shared_ptr<OfflineFrame> > frames;	// decoded frames around the current one
+	std::set<int> loading;
+	std::deque<int> queue;
+
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable condition;
+
+	bool stopping;
+	bool failed;	// the video couldn't be opened or decoded
+};
+
+#endif
+
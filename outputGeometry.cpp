@@ -0,0 +1,666 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "outputGeometry.h"
+#include "annotationModel.h"
+
+#include "commandLine.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <math.h>
+#include <sstream>
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define GEOMETRY_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define GEOMETRY_SSE2
+#endif
+
+
+// the filter weights sum to 1 << WEIGHT_BITS
+#define WEIGHT_BITS 14
+
+// the horizontal pass keeps ROW_BITS of fraction in the intermediate rows
+#define ROW_BITS 8
+
+// the geometry file in the dataset root
+#define GEOMETRY_FILE "/.capture-geometry"
+
+
+// constructor
+OutputGeometry::OutputGeometry()
+{
+	width  = 0;
+	height = 0;
+	fit    = Letterbox;
+
+	roi[0] = 0.0f;
+	roi[1] = 0.0f;
+	roi[2] = 0.0f;
+	roi[3] = 0.0f;
+
+	keepOriginal = false;
+}
+
+
+// GetRegion
+bool OutputGeometry::GetRegion( int srcWidth, int srcHeight, int region[4] ) const
+{
+	if( !HasROI() )
+	{
+		region[0] = 0;
+		region[1] = 0;
+		region[2] = srcWidth;
+		region[3] = srcHeight;
+
+		return srcWidth > 0 && srcHeight > 0;
+	}
+
+	const int x0 = std::max((int)roundf(roi[0]), 0);
+	const int y0 = std::max((int)roundf(roi[1]), 0);
+	const int x1 = std::min((int)roundf(roi[0] + roi[2]), srcWidth);
+	const int y1 = std::min((int)roundf(roi[1] + roi[3]), srcHeight);
+
+	region[0] = x0;
+	region[1] = y0;
+	region[2] = x1 - x0;
+	region[3] = y1 - y0;
+
+	return x1 > x0 && y1 > y0;
+}
+
+
+// Format
+std::string OutputGeometry::Format() const
+{
+	char str[256];
+
+	snprintf(str, sizeof(str), "size=%ix%i fit=%s roi=%g,%g,%g,%g original=%i",
+		    width, height, FitToStr(fit), roi[0], roi[1], roi[2], roi[3], (int)keepOriginal);
+
+	return str;
+}
+
+
+// Parse
+bool OutputGeometry::Parse( const std::string& str )
+{
+	std::istringstream stream(str);
+	std::string pair;
+
+	while( stream >> pair )
+	{
+		const size_t equals = pair.find('=');
+
+		if( equals == std::string::npos )
+			return false;
+
+		const std::string key   = pair.substr(0, equals);
+		const std::string value = pair.substr(equals + 1);
+
+		if( key == "size" )
+		{
+			int w = 0;
+			int h = 0;
+
+			if( sscanf(value.c_str(), "%dx%d", &w, &h) != 2 || w < 0 || h < 0 || (w == 0) != (h == 0) )
+				return false;
+
+			width  = w;
+			height = h;
+		}
+		else if( key == "fit" )
+		{
+			if( !ParseFit(value.c_str(), fit) )
+				return false;
+		}
+		else if( key == "roi" )
+		{
+			float r[4];
+
+			if( sscanf(value.c_str(), "%f,%f,%f,%f", &r[0], &r[1], &r[2], &r[3]) != 4 || r[2] < 0.0f || r[3] < 0.0f )
+				return false;
+
+			memcpy(roi, r, sizeof(roi));
+		}
+		else if( key == "original" )
+		{
+			keepOriginal = (atoi(value.c_str()) != 0);
+		}
+	}
+
+	return true;
+}
+
+
+// Parse
+void OutputGeometry::Parse( const commandLine& cmdLine )
+{
+	const char* size = cmdLine.GetString("output-size");
+	const char* fitStr = cmdLine.GetString("output-fit");
+	const char* roiStr = cmdLine.GetString("output-roi");
+
+	if( size != NULL && !Parse(std::string("size=") + size) )
+		printf("camera-capture:  invalid --output-size=%s (expected WxH)\n", size);
+
+	if( fitStr != NULL && !ParseFit(fitStr, fit) )
+		printf("camera-capture:  invalid --output-fit=%s (expected stretch, letterbox, or crop)\n", fitStr);
+
+	if( roiStr != NULL && !Parse(std::string("roi=") + roiStr) )
+		printf("camera-capture:  invalid --output-roi=%s (expected x,y,width,height)\n", roiStr);
+
+	if( cmdLine.GetFlag("keep-originals") )
+		keepOriginal = true;
+}
+
+
+// Load
+bool OutputGeometry::Load( const std::string& root )
+{
+	FILE* file = fopen((root + GEOMETRY_FILE).c_str(), "r");
+
+	if( !file )
+		return false;
+
+	char line[512];
+	OutputGeometry loaded = *this;
+
+	const bool valid = (fgets(line, sizeof(line), file) != NULL) && loaded.Parse(line);
+
+	fclose(file);
+
+	if( !valid )
+	{
+		printf("camera-capture:  invalid output geometry in %s%s\n", root.c_str(), GEOMETRY_FILE);
+		return false;
+	}
+
+	*this = loaded;
+	return true;
+}
+
+
+// Save
+bool OutputGeometry::Save( const std::string& root ) const
+{
+	const std::string filename = root + GEOMETRY_FILE;
+	const std::string tmpFilename = filename + ".tmp";
+	const std::string line = Format() + "\n";
+
+	// written to a temporary file and renamed, like the annotations
+	FILE* file = fopen(tmpFilename.c_str(), "w");
+
+	if( !file )
+	{
+		printf("camera-capture:  failed to open %s\n", tmpFilename.c_str());
+		return false;
+	}
+
+	const bool saved = (fwrite(line.data(), 1, line.size(), file) == line.size()) && (fflush(file) == 0) && (fsync(fileno(file)) == 0);
+
+	fclose(file);
+
+	if( !saved || rename(tmpFilename.c_str(), filename.c_str()) != 0 )
+	{
+		printf("camera-capture:  failed to save %s\n", filename.c_str());
+		remove(tmpFilename.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+
+// operator ==
+bool OutputGeometry::operator == ( const OutputGeometry& other ) const
+{
+	return width == other.width && height == other.height && fit == other.fit && keepOriginal == other.keepOriginal &&
+		  memcmp(roi, other.roi, sizeof(roi)) == 0;
+}
+
+
+// FitToStr
+const char* OutputGeometry::FitToStr( Fit fit )
+{
+	switch(fit)
+	{
+		case Stretch:	 return "stretch";
+		case Letterbox:  return "letterbox";
+		case CenterCrop: return "crop";
+	}
+
+	return "letterbox";
+}
+
+
+// ParseFit
+bool OutputGeometry::ParseFit( const char* str, Fit& fit )
+{
+	if( !str )
+		return false;
+
+	if( strcasecmp(str, "stretch") == 0 )
+		fit = Stretch;
+	else if( strcasecmp(str, "letterbox") == 0 )
+		fit = Letterbox;
+	else if( strcasecmp(str, "crop") == 0 || strcasecmp(str, "center-crop") == 0 )
+		fit = CenterCrop;
+	else
+		return false;
+
+	return true;
+}
+
+
+// Usage
+const char* OutputGeometry::Usage()
+{
+	return "output geometry arguments (the defaults for datasets that don't have their own):\n"
+		  "  --output-size=WxH          resolution the images are saved at (default is the\n"
+		  "                             resolution of the camera or the region)\n"
+		  "  --output-fit=FIT           how the images are fit to the size when the aspect\n"
+		  "                             ratios differ:  stretch, letterbox, or crop\n"
+		  "                             (default letterbox)\n"
+		  "  --output-roi=X,Y,W,H       region of the camera frame that's saved\n"
+		  "  --keep-originals           also keep the full-resolution frames (in the\n"
+		  "                             originals/ directory of the dataset)\n\n";
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+// constructor
+OutputTransform::OutputTransform()
+{
+	srcWidth  = 0;
+	srcHeight = 0;
+	dstWidth  = 0;
+	dstHeight = 0;
+
+	cropX      = 0;
+	cropY      = 0;
+	cropWidth  = 0;
+	cropHeight = 0;
+
+	contentX      = 0;
+	contentY      = 0;
+	contentWidth  = 0;
+	contentHeight = 0;
+
+	identity = true;
+	resample = false;
+}
+
+
+// Configure
+bool OutputTransform::Configure( const OutputGeometry& _geometry, int _srcWidth, int _srcHeight )
+{
+	if( _srcWidth <= 0 || _srcHeight <= 0 )
+		return false;
+
+	// nothing changes if it's the same geometry and frame size
+	if( _geometry == geometry && _srcWidth == srcWidth && _srcHeight == srcHeight )
+		return true;
+
+	geometry  = _geometry;
+	srcWidth  = _srcWidth;
+	srcHeight = _srcHeight;
+
+	// the region (rounded to whole pixels and clipped to the frame)
+	int region[4];
+
+	if( !geometry.GetRegion(srcWidth, srcHeight, region) )
+	{
+		printf("camera-capture:  the output region (%s) is outside of the %ix%i frame\n", geometry.Format().c_str(), srcWidth, srcHeight);
+		srcWidth = 0;	// configure again next time
+		return false;
+	}
+
+	const int regionX = region[0];
+	const int regionY = region[1];
+	const int regionWidth = region[2];
+	const int regionHeight = region[3];
+
+	cropX = regionX;
+	cropY = regionY;
+	cropWidth = regionWidth;
+	cropHeight = regionHeight;
+
+	// fit the region to the output size
+	if( geometry.width <= 0 || geometry.height <= 0 )
+	{
+		dstWidth  = regionWidth;
+		dstHeight = regionHeight;
+	}
+	else
+	{
+		dstWidth  = geometry.width;
+		dstHeight = geometry.height;
+	}
+
+	contentX = 0;
+	contentY = 0;
+	contentWidth = dstWidth;
+	contentHeight = dstHeight;
+
+	const float scaleX = float(dstWidth) / float(regionWidth);
+	const float scaleY = float(dstHeight) / float(regionHeight);
+
+	if( geometry.fit == OutputGeometry::Letterbox && scaleX != scaleY )
+	{
+		const float scale = std::min(scaleX, scaleY);
+
+		contentWidth  = std::min(std::max((int)roundf(regionWidth * scale), 1), dstWidth);
+		contentHeight = std::min(std::max((int)roundf(regionHeight * scale), 1), dstHeight);
+
+		contentX = (dstWidth - contentWidth) / 2;
+		contentY = (dstHeight - contentHeight) / 2;
+	}
+	else if( geometry.fit == OutputGeometry::CenterCrop && scaleX != scaleY )
+	{
+		const float scale = std::max(scaleX, scaleY);
+
+		cropWidth  = std::min(std::max((int)roundf(dstWidth / scale), 1), regionWidth);
+		cropHeight = std::min(std::max((int)roundf(dstHeight / scale), 1), regionHeight);
+
+		cropX = regionX + (regionWidth - cropWidth) / 2;
+		cropY = regionY + (regionHeight - cropHeight) / 2;
+	}
+
+	resample = (contentWidth != cropWidth || contentHeight != cropHeight);
+
+	// the output is the frame itself only if the whole frame is copied without padding
+	// (a letterboxed region can be the size of the frame without being resized)
+	identity = !resample && dstWidth == srcWidth && dstHeight == srcHeight &&
+			 cropX == 0 && cropY == 0 && cropWidth == srcWidth && cropHeight == srcHeight &&
+			 contentX == 0 && contentY == 0;
+
+	if( resample )
+	{
+		buildTaps(cropX, cropWidth, contentWidth, tapsX, weightsX);
+		buildTaps(cropY, cropHeight, contentHeight, tapsY, weightsY);
+
+		rows.resize((size_t)cropHeight * contentWidth * 3);
+		accum.resize((size_t)contentWidth * 3);
+	}
+
+	// the letterbox padding stays black
+	output.assign(identity ? 0 : (size_t)dstWidth * dstHeight, make_uchar3(0,0,0));
+
+	return true;
+}
+
+
+// buildTaps
+void OutputTransform::buildTaps( int srcStart, int srcLength, int dstLength, std::vector<Taps>& taps, std::vector<int16_t>& weights )
+{
+	const double scale = double(srcLength) / double(dstLength);
+
+	taps.resize(dstLength);
+	weights.clear();
+
+	std::vector<double> w;
+
+	for( int i=0; i < dstLength; i++ )
+	{
+		int first = 0;
+		w.clear();
+
+		if( scale > 1.0 )
+		{
+			// area filter:  the source pixels are weighted by how much of them the output pixel covers
+			const double begin = i * scale;
+			const double end   = std::min((i + 1) * scale, (double)srcLength);
+
+			first = (int)begin;
+
+			for( int j=first; j < end; j++ )
+				w.push_back((std::min(end, j + 1.0) - std::max(begin, (double)j)) / scale);
+		}
+		else
+		{
+			// bilinear between the two nearest source pixels (clamped to the edges of the region)
+			const double center = std::min(std::max((i + 0.5) * scale - 0.5, 0.0), srcLength - 1.0);
+
+			first = (int)center;
+
+			const double frac = center - first;
+
+			w.push_back(1.0 - frac);
+
+			if( first + 1 < srcLength && frac > 0.0 )
+				w.push_back(frac);
+		}
+
+		// quantize the weights, and give the rounding error to the largest one so they still sum to one
+		const int offset = weights.size();
+		int sum = 0;
+		int largest = 0;
+
+		for( size_t k=0; k < w.size(); k++ )
+		{
+			const int16_t q = (int16_t)lround(w[k] * (1 << WEIGHT_BITS));
+
+			weights.push_back(q);
+			sum += q;
+
+			if( q > weights[offset + largest] )
+				largest = k;
+		}
+
+		weights[offset + largest] += (1 << WEIGHT_BITS) - sum;
+
+		taps[i].first  = srcStart + first;
+		taps[i].count  = w.size();
+		taps[i].offset = offset;
+	}
+}
+
+
+// resizeRow
+void OutputTransform::resizeRow( const uchar3* src, uint16_t* dst ) const
+{
+	const int16_t* w = weightsX.data();
+
+	for( int x=0; x < contentWidth; x++ )
+	{
+		const Taps& t = tapsX[x];
+		const uchar3* px = src + t.first;
+
+		uint32_t r = 0;
+		uint32_t g = 0;
+		uint32_t b = 0;
+
+		for( int k=0; k < t.count; k++ )
+		{
+			const uint32_t weight = w[t.offset + k];
+
+			r += weight * px[k].x;
+			g += weight * px[k].y;
+			b += weight * px[k].z;
+		}
+
+		const int shift = WEIGHT_BITS - ROW_BITS;
+		const uint32_t round = 1 << (shift - 1);
+
+		dst[x * 3 + 0] = (r + round) >> shift;
+		dst[x * 3 + 1] = (g + round) >> shift;
+		dst[x * 3 + 2] = (b + round) >> shift;
+	}
+}
+
+
+// accumulateRow
+static inline void accumulateRow( uint32_t* acc, const uint16_t* row, uint16_t weight, int size )
+{
+	int n = 0;
+
+#if defined(GEOMETRY_NEON)
+	for( ; n + 8 <= size; n += 8 )
+	{
+		const uint16x8_t px = vld1q_u16(row + n);
+
+		vst1q_u32(acc + n, vmlal_n_u16(vld1q_u32(acc + n), vget_low_u16(px), weight));
+		vst1q_u32(acc + n + 4, vmlal_n_u16(vld1q_u32(acc + n + 4), vget_high_u16(px), weight));
+	}
+
+#elif defined(GEOMETRY_SSE2)
+	const __m128i w = _mm_set1_epi16(weight);
+
+	for( ; n + 8 <= size; n += 8 )
+	{
+		// the 32-bit products are interleaved from their low and high halves
+		const __m128i px = _mm_loadu_si128((const __m128i*)(row + n));
+		const __m128i lo = _mm_mullo_epi16(px, w);
+		const __m128i hi = _mm_mulhi_epu16(px, w);
+
+		__m128i* dst = (__m128i*)(acc + n);
+
+		_mm_storeu_si128(dst, _mm_add_epi32(_mm_loadu_si128(dst), _mm_unpacklo_epi16(lo, hi)));
+		_mm_storeu_si128(dst + 1, _mm_add_epi32(_mm_loadu_si128(dst + 1), _mm_unpackhi_epi16(lo, hi)));
+	}
+#endif
+
+	for( ; n < size; n++ )
+		acc[n] += (uint32_t)weight * row[n];
+}
+
+
+// Apply
+const uchar3* OutputTransform::Apply( const uchar3* image )
+{
+	if( !image || srcWidth <= 0 )
+		return NULL;
+
+	if( identity )
+		return image;
+
+	// a region that isn't resized is only copied
+	if( !resample )
+	{
+		for( int y=0; y < cropHeight; y++ )
+			memcpy(output.data() + (size_t)(contentY + y) * dstWidth + contentX, image + (size_t)(cropY + y) * srcWidth + cropX, cropWidth * sizeof(uchar3));
+
+		return output.data();
+	}
+
+	// horizontal pass over the rows of the region
+	const int rowSize = contentWidth * 3;
+
+	for( int y=0; y < cropHeight; y++ )
+		resizeRow(image + (size_t)(cropY + y) * srcWidth, rows.data() + (size_t)y * rowSize);
+
+	// vertical pass
+	const int shift = WEIGHT_BITS + ROW_BITS;
+	const uint32_t round = 1 << (shift - 1);
+
+	for( int y=0; y < contentHeight; y++ )
+	{
+		const Taps& t = tapsY[y];
+
+		memset(accum.data(), 0, rowSize * sizeof(uint32_t));
+
+		for( int k=0; k < t.count; k++ )
+			accumulateRow(accum.data(), rows.data() + (size_t)(t.first - cropY + k) * rowSize, weightsY[t.offset + k], rowSize);
+
+		uint8_t* dst = (uint8_t*)(output.data() + (size_t)(contentY + y) * dstWidth + contentX);
+
+		for( int n=0; n < rowSize; n++ )
+			dst[n] = std::min((accum[n] + round) >> shift, 255u);
+	}
+
+	return output.data();
+}
+
+
+// MapBox
+bool OutputTransform::MapBox( BoundingBox& box ) const
+{
+	if( identity )
+		return true;
+
+	const float scaleX = float(contentWidth) / float(cropWidth);
+	const float scaleY = float(contentHeight) / float(cropHeight);
+
+	float x0 = (box.x - cropX) * scaleX + contentX;
+	float y0 = (box.y - cropY) * scaleY + contentY;
+	float x1 = (box.x + box.width - cropX) * scaleX + contentX;
+	float y1 = (box.y + box.height - cropY) * scaleY + contentY;
+
+	// clip to the image (leaving out the letterbox padding)
+	const float minX = contentX;
+	const float minY = contentY;
+	const float maxX = contentX + contentWidth;
+	const float maxY = contentY + contentHeight;
+
+	// allow for the region being rounded to whole pixels
+	const float margin = 0.5f;
+
+	const bool truncated = (x0 < minX - margin || y0 < minY - margin || x1 > maxX + margin || y1 > maxY + margin);
+
+	x0 = std::max(x0, minX);
+	y0 = std::max(y0, minY);
+	x1 = std::min(x1, maxX);
+	y1 = std::min(y1, maxY);
+
+	if( x1 - x0 < 1.0f || y1 - y0 < 1.0f )
+		return false;
+
+	if( truncated )
+		box.flags |= BOX_TRUNCATED;
+
+	box.x = x0;
+	box.y = y0;
+	box.width = x1 - x0;
+	box.height = y1 - y0;
+
+	return true;
+}
+
+
+// MapBoxes
+void OutputTransform::MapBoxes( const AnnotationModel& annotations, AnnotationModel& output ) const
+{
+	const int numBoxes = annotations.GetCount();
+
+	std::vector<BoundingBox> boxes;
+	boxes.reserve(numBoxes);
+
+	for( int n=0; n < numBoxes; n++ )
+	{
+		BoundingBox box = annotations.GetAt(n);
+
+		if( MapBox(box) )
+			boxes.push_back(box);
+	}
+
+	output.Load(boxes);
+}
+
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_OUTPUT_GEOMETRY__
+#define __CAMERA_OUTPUT_GEOMETRY__
+
+#include "cudaUtility.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// forward declarations
+class commandLine;
+class AnnotationModel;
+struct BoundingBox;
+
+
+/*
+ * Geometry of the saved images (per dataset), so that they're saved at the
+ * resolution they're trained at instead of being resized later:
+ *
+ *   size      the output resolution (0x0 saves the region at its own size)
+ *   fit       how the region is fit to the size when the aspect ratios differ
+ *               stretch    - the region is scaled to the size
+ *               letterbox  - the whole region is scaled to fit and padded with black
+ *               crop       - the region is scaled to fill and the edges are cropped
+ *   roi       the region of the camera frame that's saved (x,y,width,height
+ *             in camera pixels, a width of 0 is the whole frame)
+ *   original  the full-resolution frame is also kept (under <root>/originals/)
+ *
+ * The geometry is saved to <root>/.capture-geometry as one line of the
+ * same key=value pairs that Format() returns.
+ */
+struct OutputGeometry
+{
+	enum Fit
+	{
+		Stretch = 0,
+		Letterbox,
+		CenterCrop
+	};
+
+	int   width;
+	int   height;
+	Fit   fit;
+	float roi[4];
+	bool  keepOriginal;
+
+	// constructor (the full frame at its own size)
+	OutputGeometry();
+
+	// the geometry doesn't change the frame
+	inline bool IsFullFrame() const				{ return width <= 0 && !HasROI(); }
+
+	// a region of the frame is selected
+	inline bool HasROI() const					{ return roi[2] > 0.0f && roi[3] > 0.0f; }
+
+	// the region in whole pixels, clipped to a frame (x, y, width, height),
+	// returns false if none of it is inside the frame
+	bool GetRegion( int srcWidth, int srcHeight, int region[4] ) const;
+
+	// key=value pairs (i.e. "size=224x224 fit=letterbox roi=0,0,0,0 original=0")
+	std::string Format() const;
+
+	// parse the pairs from Format() (the keys that are missing keep their value)
+	bool Parse( const std::string& str );
+
+	// parse the command line (--output-size, --output-fit, --output-roi, --keep-originals)
+	void Parse( const commandLine& cmdLine );
+
+	// load/save the geometry of a dataset (loading a dataset without one leaves it unchanged)
+	bool Load( const std::string& root );
+	bool Save( const std::string& root ) const;
+
+	bool operator == ( const OutputGeometry& other ) const;
+	inline bool operator != ( const OutputGeometry& other ) const	{ return !(*this == other); }
+
+	// fit names ("stretch", "letterbox", "crop")
+	static const char* FitToStr( Fit fit );
+	static bool ParseFit( const char* str, Fit& fit );
+
+	// usage string for the command line arguments
+	static const char* Usage();
+};
+
+
+/*
+ * Maps the frames and their boxes to an OutputGeometry.
+ *
+ * The region is cropped from the frame, and resampled with a separable
+ * fixed-point filter:  an area filter when it's downscaled (each output pixel
+ * is the average of the source pixels it covers, so there's no aliasing),
+ * and bilinear when it's upscaled.  The filter taps are computed once in
+ * Configure(), and the vertical pass runs on 8 channels at a time with
+ * SIMD (SSE2/NEON), so downscaling a 1080p frame to 224x224 takes a few
+ * milliseconds on the CPU.  A region that isn't resized is only copied.
+ */
+class OutputTransform
+{
+public:
+	// constructor
+	OutputTransform();
+
+	// set up the transform for frames of a size (returns false if the region is empty)
+	bool Configure( const OutputGeometry& geometry, int srcWidth, int srcHeight );
+
+	// the frames are saved as they are
+	inline bool IsIdentity() const				{ return identity; }
+
+	// output dimensions
+	inline int GetWidth() const					{ return dstWidth; }
+	inline int GetHeight() const					{ return dstHeight; }
+
+	// the geometry it was configured with
+	inline const OutputGeometry& GetGeometry() const	{ return geometry; }
+
+	// transform a frame (the result is kept until the next call, and is NULL on failure)
+	const uchar3* Apply( const uchar3* image );
+
+	// map a box to the output, returns false if less than a pixel of it is left
+	// (boxes that are cut off by the edges of the region are marked BOX_TRUNCATED)
+	bool MapBox( BoundingBox& box ) const;
+
+	// map the boxes of a model, and load the ones that are left into another model
+	void MapBoxes( const AnnotationModel& annotations, AnnotationModel& output ) const;
+
+protected:
+	// the taps of an output pixel along one axis
+	struct Taps
+	{
+		int first;	// first source pixel
+		int count;	// number of source pixels
+		int offset;	// index of the first weight
+	};
+
+	static void buildTaps( int srcStart, int srcLength, int dstLength, std::vector<Taps>& taps, std::vector<int16_t>& weights );
+
+	void resizeRow( const uchar3* src, uint16_t* dst ) const;
+
+	OutputGeometry geometry;
+
+	int srcWidth;
+	int srcHeight;
+	int dstWidth;
+	int dstHeight;
+
+	int cropX;		// the region of the frame that's resampled
+	int cropY;
+	int cropWidth;
+	int cropHeight;
+
+	int contentX;	// where it goes in the output (inside the letterbox padding)
+	int contentY;
+	int contentWidth;
+	int contentHeight;
+
+	bool identity;
+	bool resample;
+
+	std::vector<Taps>    tapsX;
+	std::vector<Taps>    tapsY;
+	std::vector<int16_t> weightsX;
+	std::vector<int16_t> weightsY;
+
+	std::vector<uint16_t> rows;		// the horizontally-resampled rows of the region
+	std::vector<uint32_t> accum;		// one row of the vertical pass
+	std::vector<uchar3>   output;
+};
+
+#endif
+
@@ -0,0 +1,914 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "prelabelProvider.h"
+#include "metrics.h"
+#include "tracer.h"
+
+#include "detectNet.h"
+#include "imageNet.h"
+#include "cudaMappedMemory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <map>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+
+//-----------------------------------------------------------------------------------------
+// replay provider (precomputed results, keyed by the frame hash)
+class ReplayPrelabelProvider : public PrelabelProvider
+{
+public:
+	static ReplayPrelabelProvider* Create( const char* filename )
+	{
+		FILE* file = fopen(filename, "r");
+
+		if( !file )
+		{
+			printf("camera-capture:  failed to open pre-label replay file %s\n", filename);
+			return NULL;
+		}
+
+		ReplayPrelabelProvider* provider = new ReplayPrelabelProvider();
+
+		char line[1024];
+		char key[64];
+		int  numLines = 0;
+
+		while( fgets(line, sizeof(line), file) != NULL )
+		{
+			int offset = 0;
+
+			if( line[0] == '#' || sscanf(line, "%63s %n", key, &offset) != 1 )
+				continue;
+
+			PrelabelResult* result = &provider->anyFrame;
+
+			if( strcmp(key, "*") != 0 )
+			{
+				const uint64_t hash = strtoull(key, NULL, 16);
+				std::map<uint64_t, PrelabelResult>::iterator iter = provider->frames.find(hash);
+
+				if( iter == provider->frames.end() )
+				{
+					iter = provider->frames.insert(std::make_pair(hash, PrelabelResult())).first;
+
+					iter->second.frameHash  = hash;
+					iter->second.classID    = -1;
+					iter->second.classScore = 0.0f;
+				}
+
+				result = &iter->second;
+			}
+
+			if( PrelabelProvider::ParseLine(line + offset, *result) )
+				numLines++;
+		}
+
+		fclose(file);
+
+		printf("camera-capture:  loaded %i pre-label results from %s\n", numLines, filename);
+		return provider;
+	}
+
+	virtual bool Process( const uchar3* image, int width, int height, uint64_t frameHash,
+					  const PrelabelRequest& request, PrelabelResult& result )
+	{
+		std::map<uint64_t, PrelabelResult>::const_iterator iter = frames.find(frameHash);
+		const PrelabelResult& replay = (iter != frames.end()) ? iter->second : anyFrame;
+
+		result.boxes      = replay.boxes;
+		result.classID    = replay.classID;
+		result.classLabel = replay.classLabel;
+		result.classScore = replay.classScore;
+
+		return true;
+	}
+
+protected:
+	ReplayPrelabelProvider()
+	{
+		anyFrame.classID    = -1;
+		anyFrame.classScore = 0.0f;
+	}
+
+	std::map<uint64_t, PrelabelResult> frames;
+	PrelabelResult anyFrame;
+};
+
+
+//-----------------------------------------------------------------------------------------
+// pipe provider (subprocess that reads frames on stdin and replies on stdout)
+class PipePrelabelProvider : public PrelabelProvider
+{
+public:
+	PipePrelabelProvider( const char* cmd )
+	{
+		command   = cmd;
+		pid       = -1;
+		fdIn      = -1;
+		fdOut     = -1;
+		abandoned = 0;
+		ready     = false;
+		failed    = false;
+
+		// a subprocess that exits would otherwise terminate the app on the next write
+		signal(SIGPIPE, SIG_IGN);
+	}
+
+	virtual ~PipePrelabelProvider()
+	{
+		terminate();
+	}
+
+	virtual bool Process( const uchar3* image, int width, int height, uint64_t frameHash,
+					  const PrelabelRequest& request, PrelabelResult& result )
+	{
+		if( pid <= 0 && !spawn() )
+			return false;
+
+		// the frames that missed the deadline are abandoned instead of restarting the
+		// command (which may take a while to load), so finish them before the next one
+		if( !finish(request) )
+			return stop();
+
+		char header[128];
+		snprintf(header, sizeof(header), "frame %i %i %016llx\n", width, height, (unsigned long long)frameHash);
+
+		abandoned++;	// until its reply is read
+
+		send(header, strlen(header), request);
+		send(image, width * height * sizeof(uchar3), request);
+
+		if( unsent.size() > 0 )
+			return stop();
+
+		std::string line;
+
+		while( readLine(line, request) )
+		{
+			if( strncmp(line.c_str(), "end", 3) == 0 )
+			{
+				abandoned--;
+				return true;
+			}
+
+			PrelabelProvider::ParseLine(line.c_str(), result);
+		}
+
+		return stop();
+	}
+
+protected:
+	// the frame was abandoned (the command is only restarted if the protocol is out of sync)
+	bool stop()
+	{
+		if( failed )
+			terminate();
+
+		return false;
+	}
+
+	// send the rest of the abandoned frames, and skip their replies
+	bool finish( const PrelabelRequest& request )
+	{
+		if( unsent.size() > 0 )
+		{
+			std::vector<uint8_t> data;
+			data.swap(unsent);
+
+			send(data.data(), data.size(), request);
+
+			if( unsent.size() > 0 )
+				return false;
+		}
+
+		std::string line;
+
+		while( abandoned > 0 )
+		{
+			if( !readLine(line, request) )
+				return false;
+
+			if( strncmp(line.c_str(), "end", 3) == 0 )
+				abandoned--;
+		}
+
+		return true;
+	}
+
+	bool spawn()
+	{
+		int pipeIn[2];	// parent -> child
+		int pipeOut[2];	// child -> parent
+
+		if( pipe(pipeIn) != 0 )
+			return false;
+
+		if( pipe(pipeOut) != 0 )
+		{
+			close(pipeIn[0]);
+			close(pipeIn[1]);
+			return false;
+		}
+
+		pid = fork();
+
+		if( pid == 0 )
+		{
+			dup2(pipeIn[0], STDIN_FILENO);
+			dup2(pipeOut[1], STDOUT_FILENO);
+
+			close(pipeIn[0]);
+			close(pipeIn[1]);
+			close(pipeOut[0]);
+			close(pipeOut[1]);
+
+			execl("/bin/sh", "sh", "-c", command.c_str(), (char*)NULL);
+			_exit(127);
+		}
+
+		close(pipeIn[0]);
+		close(pipeOut[1]);
+
+		if( pid < 0 )
+		{
+			printf("camera-capture:  failed to start pre-label command '%s'\n", command.c_str());
+			close(pipeIn[1]);
+			close(pipeOut[0]);
+			return false;
+		}
+
+		fdIn  = pipeIn[1];
+		fdOut = pipeOut[0];
+
+		// non-blocking, so the deadline can be kept
+		fcntl(fdIn, F_SETFL, fcntl(fdIn, F_GETFL) | O_NONBLOCK);
+		fcntl(fdOut, F_SETFL, fcntl(fdOut, F_GETFL) | O_NONBLOCK);
+
+		buffer.clear();
+
+		printf("camera-capture:  started pre-label command '%s' (pid %i)\n", command.c_str(), (int)pid);
+		return true;
+	}
+
+	void terminate()
+	{
+		if( fdIn >= 0 )
+			close(fdIn);
+
+		if( fdOut >= 0 )
+			close(fdOut);
+
+		if( pid > 0 )
+		{
+			kill(pid, SIGKILL);
+			waitpid(pid, NULL, 0);
+		}
+
+		pid   = -1;
+		fdIn  = -1;
+		fdOut = -1;
+
+		unsent.clear();
+
+		abandoned = 0;
+		ready     = false;
+		failed    = false;
+	}
+
+	bool wait( int fd, short events, const PrelabelRequest& request )
+	{
+		// until the command first replies, it's still starting up and only a new frame stops the wait
+		while( ready ? !request.IsCancelled() : !request.IsFrameChanged() )
+		{
+			struct pollfd pfd;
+
+			pfd.fd      = fd;
+			pfd.events  = events;
+			pfd.revents = 0;
+
+			// wake up periodically to check for cancellation
+			const int result = poll(&pfd, 1, ready ? std::min(request.GetTimeRemaining(), 20) : 20);
+
+			if( result > 0 )
+				return true;
+			else if( result < 0 && errno != EINTR )
+			{
+				failed = true;
+				return false;
+			}
+		}
+
+		return false;
+	}
+
+	// write the data, or queue the rest of it if the frame is abandoned
+	void send( const void* data, size_t size, const PrelabelRequest& request )
+	{
+		const uint8_t* ptr = (const uint8_t*)data;
+
+		while( size > 0 && unsent.size() == 0 && !failed )
+		{
+			if( !wait(fdIn, POLLOUT, request) )
+				break;
+
+			const ssize_t written = ::write(fdIn, ptr, size);
+
+			if( written < 0 )
+			{
+				if( errno == EAGAIN || errno == EINTR )
+					continue;
+
+				failed = true;
+				return;
+			}
+
+			ptr  += written;
+			size -= written;
+		}
+
+		if( size > 0 && !failed )
+			unsent.insert(unsent.end(), ptr, ptr + size);
+	}
+
+	bool readLine( std::string& line, const PrelabelRequest& request )
+	{
+		while( true )
+		{
+			const size_t end = buffer.find('\n');
+
+			if( end != std::string::npos )
+			{
+				line = buffer.substr(0, end);
+				buffer.erase(0, end + 1);
+				ready = true;
+				return true;
+			}
+
+			if( !wait(fdOut, POLLIN, request) )
+				return false;
+
+			char chunk[4096];
+			const ssize_t count = ::read(fdOut, chunk, sizeof(chunk));
+
+			if( count < 0 && (errno == EAGAIN || errno == EINTR) )
+				continue;
+
+			if( count <= 0 )
+			{
+				failed = true;	// the subprocess exited
+				return false;
+			}
+
+			buffer.append(chunk, count);
+		}
+	}
+
+	std::string command;
+	std::string buffer;
+
+	std::vector<uint8_t> unsent;	// the rest of an abandoned frame
+
+	pid_t pid;
+	int   fdIn;
+	int   fdOut;
+	int   abandoned;	// frames whose replies are still to be read
+	bool  ready;		// the command replied, so it's done starting up
+	bool  failed;		// the protocol is out of sync
+};
+
+
+//-----------------------------------------------------------------------------------------
+// detection network provider
+class DetectNetPrelabelProvider : public PrelabelProvider
+{
+public:
+	static DetectNetPrelabelProvider* Create( const char* model )
+	{
+		detectNet* net = (model != NULL && strlen(model) > 0) ? detectNet::Create(model) : detectNet::Create();
+
+		if( !net )
+		{
+			printf("camera-capture:  failed to load pre-label detection network\n");
+			return NULL;
+		}
+
+		return new DetectNetPrelabelProvider(net);
+	}
+
+	virtual ~DetectNetPrelabelProvider()
+	{
+		SAFE_DELETE(net);
+		CUDA(cudaFreeHost(image));
+	}
+
+	virtual bool Process( const uchar3* frame, int width, int height, uint64_t frameHash,
+					  const PrelabelRequest& request, PrelabelResult& result )
+	{
+		if( !allocImage(width, height) )
+			return false;
+
+		memcpy(image, frame, width * height * sizeof(uchar3));
+
+		detectNet::Detection* detections = NULL;
+		const int numDetections = net->Detect(image, width, height, &detections, detectNet::OVERLAY_NONE);
+
+		if( numDetections < 0 )
+			return false;
+
+		for( int n=0; n < numDetections; n++ )
+		{
+			PrelabelBox box;
+
+			box.x       = detections[n].Left;
+			box.y       = detections[n].Top;
+			box.width   = detections[n].Width();
+			box.height  = detections[n].Height();
+			box.score   = detections[n].Confidence;
+			box.classID = detections[n].ClassID;
+			box.label   = net->GetClassDesc(detections[n].ClassID);
+
+			result.boxes.push_back(box);
+		}
+
+		return true;
+	}
+
+protected:
+	DetectNetPrelabelProvider( detectNet* network )
+	{
+		net         = network;
+		image       = NULL;
+		imageWidth  = 0;
+		imageHeight = 0;
+	}
+
+	bool allocImage( int width, int height )
+	{
+		if( image != NULL && width == imageWidth && height == imageHeight )
+			return true;
+
+		CUDA(cudaFreeHost(image));
+		image = NULL;
+
+		if( !cudaAllocMapped((void**)&image, width * height * sizeof(uchar3)) )
+			return false;
+
+		imageWidth  = width;
+		imageHeight = height;
+
+		return true;
+	}
+
+	detectNet* net;
+	uchar3*    image;	// the network needs the frame in mapped memory
+	int        imageWidth;
+	int        imageHeight;
+};
+
+
+//-----------------------------------------------------------------------------------------
+// classification network provider
+class ImageNetPrelabelProvider : public PrelabelProvider
+{
+public:
+	static ImageNetPrelabelProvider* Create( const char* model )
+	{
+		imageNet* net = (model != NULL && strlen(model) > 0) ? imageNet::Create(model) : imageNet::Create();
+
+		if( !net )
+		{
+			printf("camera-capture:  failed to load pre-label classification network\n");
+			return NULL;
+		}
+
+		return new ImageNetPrelabelProvider(net);
+	}
+
+	virtual ~ImageNetPrelabelProvider()
+	{
+		SAFE_DELETE(net);
+		CUDA(cudaFreeHost(image));
+	}
+
+	virtual bool Process( const uchar3* frame, int width, int height, uint64_t frameHash,
+					  const PrelabelRequest& request, PrelabelResult& result )
+	{
+		if( !allocImage(width, height) )
+			return false;
+
+		memcpy(image, frame, width * height * sizeof(uchar3));
+
+		float confidence = 0.0f;
+		const int classID = net->Classify(image, width, height, &confidence);
+
+		if( classID < 0 )
+			return false;
+
+		result.classID    = classID;
+		result.classLabel = net->GetClassDesc(classID);
+		result.classScore = confidence;
+
+		return true;
+	}
+
+protected:
+	ImageNetPrelabelProvider( imageNet* network )
+	{
+		net         = network;
+		image       = NULL;
+		imageWidth  = 0;
+		imageHeight = 0;
+	}
+
+	bool allocImage( int width, int height )
+	{
+		if( image != NULL && width == imageWidth && height == imageHeight )
+			return true;
+
+		CUDA(cudaFreeHost(image));
+		image = NULL;
+
+		if( !cudaAllocMapped((void**)&image, width * height * sizeof(uchar3)) )
+			return false;
+
+		imageWidth  = width;
+		imageHeight = height;
+
+		return true;
+	}
+
+	imageNet* net;
+	uchar3*   image;
+	int       imageWidth;
+	int       imageHeight;
+};
+
+
+//-----------------------------------------------------------------------------------------
+// Create
+PrelabelProvider* PrelabelProvider::Create( const char* uri )
+{
+	if( !uri || strlen(uri) == 0 )
+		return NULL;
+
+	const char* separator = strchr(uri, ':');
+
+	const std::string scheme = separator ? std::string(uri, separator - uri) : std::string(uri);
+	const char* location = separator ? separator + 1 : "";
+
+	PrelabelProvider* provider = NULL;
+
+	if( scheme == "replay" )
+		provider = ReplayPrelabelProvider::Create(location);
+	else if( scheme == "pipe" )
+		provider = new PipePrelabelProvider(location);
+	else if( scheme == "detectnet" )
+		provider = DetectNetPrelabelProvider::Create(location);
+	else if( scheme == "imagenet" )
+		provider = ImageNetPrelabelProvider::Create(location);
+	else
+		printf("camera-capture:  invalid pre-label provider '%s'\n", uri);
+
+	return provider;
+}
+
+
+// MapClass
+int PrelabelProvider::MapClass( int classID, const std::string& label, const std::vector<std::string>& classLabels )
+{
+	const int numClasses = classLabels.size();
+
+	// match the class name if there is one
+	if( label.size() > 0 )
+	{
+		for( int n=0; n < numClasses; n++ )
+		{
+			if( strcasecmp(classLabels[n].c_str(), label.c_str()) == 0 )
+				return n;
+		}
+
+		return -1;
+	}
+
+	if( classID < 0 || classID >= numClasses )
+		return -1;
+
+	return classID;
+}
+
+
+// ParseLine
+bool PrelabelProvider::ParseLine( const char* line, PrelabelResult& result )
+{
+	char type[16];
+	char name[256];
+	int  offset = 0;
+
+	if( !line || sscanf(line, "%15s %255s %n", type, name, &offset) != 2 )
+		return false;
+
+	// the class is either an index or a name
+	char* end = NULL;
+	const long index = strtol(name, &end, 10);
+	const bool isIndex = (end != name && *end == '\0');
+
+	if( strcasecmp(type, "box") == 0 )
+	{
+		PrelabelBox box;
+
+		if( sscanf(line + offset, "%f %f %f %f %f", &box.score, &box.x, &box.y, &box.width, &box.height) != 5 )
+			return false;
+
+		box.classID = isIndex ? index : -1;
+
+		if( !isIndex )
+			box.label = name;
+
+		result.boxes.push_back(box);
+		return true;
+	}
+	else if( strcasecmp(type, "class") == 0 )
+	{
+		if( sscanf(line + offset, "%f", &result.classScore) != 1 )
+			return false;
+
+		result.classID    = isIndex ? index : -1;
+		result.classLabel = isIndex ? std::string() : std::string(name);
+		return true;
+	}
+
+	return false;
+}
+
+
+// Usage
+const char* PrelabelProvider::Usage()
+{
+	return "pre-labeling arguments:\n"
+		  "  --prelabel-detection=URI   propose boxes on freeze in detection mode\n"
+		  "  --prelabel-classify=URI    suggest the class in classification mode\n"
+		  "  --prelabel-timeout=MS      deadline for each frame (default 500ms)\n"
+		  "                             the URI is one of:  replay:<file>, pipe:<command>,\n"
+		  "                             detectnet[:<model>], imagenet[:<model>]\n\n";
+}
+
+
+//-----------------------------------------------------------------------------------------
+// constructor
+PrelabelWorker::PrelabelWorker( PrelabelProvider* _provider, int _timeout )
+{
+	provider    = _provider;
+	timeout     = (_timeout > 0) ? _timeout : DefaultTimeout;
+	stopping    = false;
+	pending     = false;
+	processing  = false;
+	resultReady = false;
+	frameWidth  = 0;
+	frameHeight = 0;
+	frameHash   = 0;
+
+	thread = std::thread(&PrelabelWorker::run, this);
+}
+
+
+// destructor
+PrelabelWorker::~PrelabelWorker()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		stopping = true;
+
+		if( request != NULL )
+			request->cancelled = true;
+	}
+
+	condition.notify_all();
+
+	if( thread.joinable() )
+		thread.join();
+
+	SAFE_DELETE(provider);
+}
+
+
+// HashFrame
+uint64_t PrelabelWorker::HashFrame( const uchar3* image, int width, int height )
+{
+	const size_t size = width * height * sizeof(uchar3);
+	const uint8_t* bytes = (const uint8_t*)image;
+
+	uint64_t hash = 0xcbf29ce484222325ULL ^ ((uint64_t)width << 32) ^ height;
+	size_t n = 0;
+
+	// mix 8 bytes at a time
+	for( ; n + 8 <= size; n += 8 )
+	{
+		uint64_t word;
+		memcpy(&word, bytes + n, 8);
+
+		hash = (hash ^ word) * 0x9e3779b97f4a7c15ULL;
+		hash ^= hash >> 29;
+	}
+
+	for( ; n < size; n++ )
+		hash = (hash ^ bytes[n]) * 0x100000001b3ULL;
+
+	return hash;
+}
+
+
+// findCached
+const PrelabelResult* PrelabelWorker::findCached( uint64_t hash ) const
+{
+	for( std::list<PrelabelResult>::const_iterator iter = cache.begin(); iter != cache.end(); iter++ )
+	{
+		if( iter->frameHash == hash )
+			return &(*iter);
+	}
+
+	return NULL;
+}
+
+
+// Submit
+void PrelabelWorker::Submit( const uchar3* image, int width, int height )
+{
+	if( !image || width <= 0 || height <= 0 )
+		return;
+
+	const uint64_t hash = HashFrame(image, width, height);
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	if( request != NULL )
+		request->cancelled = true;
+
+	request.reset();
+
+	// frames that were already processed don't have to be sent again
+	const PrelabelResult* cached = findCached(hash);
+
+	if( cached != NULL )
+	{
+		result      = *cached;
+		resultReady = true;
+		pending     = false;
+		return;
+	}
+
+	frame.assign(image, image + width * height);
+
+	frameWidth  = width;
+	frameHeight = height;
+	frameHash   = hash;
+
+	request.reset(new PrelabelRequest());
+
+	request->cancelled = false;
+	request->deadline  = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+	pending     = true;
+	resultReady = false;
+
+	lock.unlock();
+	condition.notify_one();
+}
+
+
+// Cancel
+void PrelabelWorker::Cancel()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if( request != NULL )
+		request->cancelled = true;
+
+	request.reset();
+
+	pending     = false;
+	resultReady = false;
+}
+
+
+// GetResult
+bool PrelabelWorker::GetResult( PrelabelResult& out )
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if( !resultReady )
+		return false;
+
+	out = result;
+	resultReady = false;
+
+	return true;
+}
+
+
+// IsBusy
+bool PrelabelWorker::IsBusy() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return pending || (processing && request != NULL);
+}
+
+
+// run
+void PrelabelWorker::run()
+{
+	Tracer::SetThreadName("prelabel");
+
+	std::vector<uchar3> workFrame;
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while( true )
+	{
+		while( !stopping && !pending )
+			condition.wait(lock);
+
+		if( stopping )
+			break;
+
+		std::swap(frame, workFrame);
+
+		std::shared_ptr<PrelabelRequest> workRequest = request;
+
+		PrelabelResult work;
+
+		work.frameHash  = frameHash;
+		work.completed  = false;
+		work.classID    = -1;
+		work.classScore = 0.0f;
+
+		const int width  = frameWidth;
+		const int height = frameHeight;
+
+		pending    = false;
+		processing = true;
+
+		lock.unlock();
+
+		{
+			TRACE_SCOPE("prelabel");
+			work.completed = provider->Process(&workFrame[0], width, height, work.frameHash, *workRequest, work);
+		}
+
+		lock.lock();
+
+		processing = false;
+
+		// drop the results if the frame changed in the meantime
+		if( workRequest->cancelled || workRequest != request )
+			continue;
+
+		request.reset();
+
+		result      = work;
+		resultReady = true;
+
+		if( !work.completed )
+		{
+			static MetricsValue* missed = Metrics::GetCounter("prelabel_missed", "pre-labeled frames that missed the deadline or failed");
+			missed->Add();
+			continue;
+		}
+
+		cache.push_front(work);
+
+		if( cache.size() > CacheSize )
+			cache.pop_back();
+	}
+}
+
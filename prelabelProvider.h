@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_PRELABEL_PROVIDER__
+#define __CAMERA_PRELABEL_PROVIDER__
+
+#include "cudaUtility.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <list>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+/*
+ * Box proposed by a pre-label provider
+ */
+struct PrelabelBox
+{
+	float x;
+	float y;
+	float width;
+	float height;
+	float score;
+
+	int         classID;	// class index of the provider (-1 if unknown)
+	std::string label;		// class name (optional, preferred over the index)
+};
+
+
+/*
+ * Pre-labeling results of one frame
+ */
+struct PrelabelResult
+{
+	uint64_t frameHash;
+	bool     completed;		// false if the provider failed or missed the deadline
+
+	std::vector<PrelabelBox> boxes;	// for detection
+
+	int         classID;		// for classification (-1 if none)
+	std::string classLabel;
+	float       classScore;
+};
+
+
+/*
+ * Pre-label request (passed to the provider so it can stop early)
+ */
+class PrelabelRequest
+{
+public:
+	// returns true if the frame changed or the deadline passed
+	inline bool IsCancelled() const		{ return cancelled || std::chrono::steady_clock::now() >= deadline; }
+
+	// returns true if the frame changed (regardless of the deadline)
+	inline bool IsFrameChanged() const	{ return cancelled; }
+
+	// milliseconds until the deadline
+	inline int GetTimeRemaining() const	{ return std::max(0, (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count()); }
+
+protected:
+	friend class PrelabelWorker;
+
+	std::atomic<bool> cancelled;
+	std::chrono::steady_clock::time_point deadline;
+};
+
+
+/*
+ * Pre-label provider interface, takes a frame and proposes boxes or
+ * class scores for it.  Process() is called from the worker thread.
+ *
+ * The provider is selected with a URI on the command line:
+ *
+ *    replay:<file>         precomputed results, one per line:
+ *                          <frame hash|*> box <class> <score> <x> <y> <width> <height>
+ *                          <frame hash|*> class <class> <score>
+ *    pipe:<command>        subprocess that reads 'frame <width> <height> <hash>\n'
+ *                          followed by the RGB pixels on stdin, and replies with
+ *                          lines in the replay format (without the hash) ending in 'end'
+ *                          (it keeps running, the reply to a frame that missed the
+ *                          deadline is skipped, and its first frame has no deadline
+ *                          so it can load a model)
+ *    detectnet[:<model>]   in-process detection network
+ *    imagenet[:<model>]    in-process classification network
+ */
+class PrelabelProvider
+{
+public:
+	// create a provider from a URI
+	static PrelabelProvider* Create( const char* uri );
+
+	// destructor
+	virtual ~PrelabelProvider()	{}
+
+	// process a frame (returns false if it failed or gave up at the deadline)
+	virtual bool Process( const uchar3* image, int width, int height, uint64_t frameHash,
+					  const PrelabelRequest& request, PrelabelResult& result ) = 0;
+
+	// map a provider class to an index in the dataset's labels (returns -1 if it isn't in the dataset)
+	static int MapClass( int classID, const std::string& label, const std::vector<std::string>& classLabels );
+
+	// parse a result line in the replay/pipe format
+	static bool ParseLine( const char* line, PrelabelResult& result );
+
+	// command-line usage string
+	static const char* Usage();
+};
+
+
+/*
+ * Runs a pre-label provider asynchronously off the UI thread.
+ *
+ * Submitting a new frame cancels the one in progress, and the results
+ * are cached by the hash of the frame, so re-submitting a frame that
+ * was already processed returns the same results immediately.
+ */
+class PrelabelWorker
+{
+public:
+	// constructor (takes ownership of the provider)
+	PrelabelWorker( PrelabelProvider* provider, int timeout=DefaultTimeout );
+
+	// destructor
+	~PrelabelWorker();
+
+	// queue a frame (cancels the previous one)
+	void Submit( const uchar3* image, int width, int height );
+
+	// cancel the current frame
+	void Cancel();
+
+	// get the results of the last frame (returns false if they aren't ready)
+	bool GetResult( PrelabelResult& result );
+
+	// returns true if a frame is queued or being processed
+	bool IsBusy() const;
+
+	// hash the contents of a frame
+	static uint64_t HashFrame( const uchar3* image, int width, int height );
+
+	// default deadline (in milliseconds)
+	static const int DefaultTimeout = 500;
+
+	// number of frames kept in the cache
+	static const size_t CacheSize = 32;
+
+protected:
+	void run();
+
+	const PrelabelResult* findCached( uint64_t frameHash ) const;
+
+	PrelabelProvider* provider;
+	int timeout;
+
+	std::thread thread;
+	mutable std::mutex mutex;
+	std::condition_variable condition;
+
+	bool stopping;
+	bool pending;		// a frame is waiting for the worker
+	bool processing;	// the worker is processing a frame
+	bool resultReady;
+
+	std::vector<uchar3> frame;
+	int      frameWidth;
+	int      frameHeight;
+	uint64_t frameHash;
+
+	std::shared_ptr<PrelabelRequest> request;
+
+	PrelabelResult result;
+	std::list<PrelabelResult> cache;	// most recent first
+};
+
+#endif
+
@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "sampleLoader.h"
+#include "datasetStaging.h"
+#include "tracer.h"
+
+#include "imageIO.h"
+
+#include <algorithm>
+#include <dirent.h>
+#include <string.h>
+
+
+// constructor
+Sample::Sample()
+{
+	image  = NULL;
+	width  = 0;
+	height = 0;
+}
+
+
+// destructor
+Sample::~Sample()
+{
+	if( image != NULL )
+		CUDA(cudaFreeHost(image));
+}
+
+
+//-----------------------------------------------------------------------------------------
+// constructor
+SampleLoader::SampleLoader()
+{
+	stopping = false;
+	thread   = std::thread(&SampleLoader::run, this);
+}
+
+
+// destructor
+SampleLoader::~SampleLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	condition.notify_all();
+	thread.join();
+}
+
+
+// Open
+void SampleLoader::Open( const std::string& path )
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	// wait for the samples being read from the previous dataset
+	queue.clear();
+
+	while( loading.size() > 0 )
+		condition.wait(lock);
+
+	loaded.clear();
+	names.clear();
+
+	datasetPath = path;
+
+	const std::string dirPath = datasetPath + "/Annotations";
+	DIR* dir = opendir(dirPath.c_str());
+
+	if( !dir )
+		return;
+
+	struct dirent* entry = NULL;
+
+	while( (entry = readdir(dir)) != NULL )
+	{
+		const size_t length = strlen(entry->d_name);
+
+		if( length > 4 && strcmp(entry->d_name + length - 4, ".xml") == 0 )
+			names.push_back(std::string(entry->d_name, length - 4));
+	}
+
+	closedir(dir);
+
+	// the names are timestamps, so this is the order they were captured in
+	std::sort(names.begin(), names.end());
+
+	printf("camera-capture:  found %zu annotated samples in %s\n", names.size(), dirPath.c_str());
+}
+
+
+// Append
+void SampleLoader::Append( const std::string& name )
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::vector<std::string>::iterator iter = std::lower_bound(names.begin(), names.end(), name);
+
+	if( iter == names.end() || *iter != name )
+		names.insert(iter, name);
+}
+
+
+// Invalidate
+void SampleLoader::Invalidate( const std::string& name )
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	loaded.erase(name);
+}
+
+
+// Find
+int SampleLoader::Find( const std::string& name ) const
+{
+	std::vector<std::string>::const_iterator iter = std::lower_bound(names.begin(), names.end(), name);
+
+	if( iter == names.end() || *iter != name )
+		return -1;
+
+	return iter - names.begin();
+}
+
+
+// Load
+std::shared_ptr<Sample> SampleLoader::Load( int index )
+{
+	if( index < 0 || index >= (int)names.size() )
+		return std::shared_ptr<Sample>();
+
+	const std::string name = names[index];
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	// wait if it's being read ahead
+	while( loading.count(name) > 0 )
+		condition.wait(lock);
+
+	std::shared_ptr<Sample> sample;
+	std::map<std::string, std::shared_ptr<Sample> >::iterator iter = loaded.find(name);
+
+	if( iter != loaded.end() )
+	{
+		sample = iter->second;
+	}
+	else
+	{
+		loading.insert(name);	// so the read-ahead doesn't load it again
+		lock.unlock();
+
+		sample = loadSample(name);
+
+		lock.lock();
+		loading.erase(name);
+
+		if( sample != NULL )
+			loaded[name] = sample;
+
+		condition.notify_all();
+	}
+
+	// only keep the samples around the current one
+	const int first = std::max(index - 1, 0);
+	const int last  = std::min(index + ReadAhead, (int)names.size() - 1);
+
+	for( iter = loaded.begin(); iter != loaded.end(); )
+	{
+		const int n = Find(iter->first);
+
+		if( n < first || n > last )
+			loaded.erase(iter++);
+		else
+			iter++;
+	}
+
+	// read ahead of the current one (and the previous one, for stepping back)
+	queue.clear();
+
+	for( int n=index+1; n <= last; n++ )
+		queue.push_back(names[n]);
+
+	if( index > 0 )
+		queue.push_back(names[index-1]);
+
+	lock.unlock();
+	condition.notify_one();
+
+	return sample;
+}
+
+
+// run
+void SampleLoader::run()
+{
+	Tracer::SetThreadName("sample loader");
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while( true )
+	{
+		while( !stopping && queue.size() == 0 )
+			condition.wait(lock);
+
+		if( stopping )
+			break;
+
+		const std::string name = queue.front();
+		queue.pop_front();
+
+		if( loaded.count(name) > 0 || loading.count(name) > 0 )
+			continue;
+
+		loading.insert(name);
+		lock.unlock();
+
+		std::shared_ptr<Sample> sample = loadSample(name);
+
+		lock.lock();
+
+		if( sample != NULL )
+			loaded[name] = sample;
+
+		loading.erase(name);
+		condition.notify_all();		// Load() or Open() may be waiting for it
+	}
+}
+
+
+// loadSample
+std::shared_ptr<Sample> SampleLoader::loadSample( const std::string& name ) const
+{
+	std::shared_ptr<Sample> sample(new Sample());
+
+	sample->name = name;
+
+	const std::string xmlPath = datasetPath + "/Annotations/" + name + ".xml";
+
+	// the samples that were just saved may still be in the staging area
+	if( !AnnotationModel::ParseVOC(DatasetStaging::Locate(xmlPath).c_str(), sample->annotation) )
+		return std::shared_ptr<Sample>();
+
+	const std::string imgFilename = (sample->annotation.filename.size() > 0) ? sample->annotation.filename : name + ".jpg";
+	const std::string imgPath = datasetPath + "/JPEGImages/" + imgFilename;
+
+	if( !loadImage(DatasetStaging::Locate(imgPath).c_str(), &sample->image, &sample->width, &sample->height) )
+	{
+		printf("camera-capture:  failed to load %s\n", imgPath.c_str());
+		return std::shared_ptr<Sample>();
+	}
+
+	return sample;
+}
+
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_SAMPLE_LOADER__
+#define __CAMERA_SAMPLE_LOADER__
+
+#include "cudaUtility.h"
+#include "annotationModel.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+/*
+ * Saved detection sample (the image and its annotations)
+ */
+struct Sample
+{
+	Sample();
+	~Sample();
+
+	std::string   name;		// filename without extension (i.e. the timestamp)
+	VOCAnnotation annotation;
+
+	uchar3* image;		// mapped memory, so it can be rendered directly
+	int     width;
+	int     height;
+};
+
+
+/*
+ * Loads the saved samples of a detection dataset for editing.
+ *
+ * The annotations are listed from the Annotations/ directory, and the
+ * next few samples after the one being edited are read ahead in a
+ * background thread, so stepping through them doesn't wait on the disk.
+ */
+class SampleLoader
+{
+public:
+	// constructor
+	SampleLoader();
+
+	// destructor
+	~SampleLoader();
+
+	// list the samples of a dataset
+	void Open( const std::string& datasetPath );
+
+	// add a sample that was just saved
+	void Append( const std::string& name );
+
+	// drop a sample from memory after it was modified
+	void Invalidate( const std::string& name );
+
+	// sample list
+	inline int GetCount() const					{ return names.size(); }
+	inline const std::string& GetName( int index ) const	{ return names[index]; }
+
+	int Find( const std::string& name ) const;
+
+	// load a sample (waits for it if it isn't read ahead yet)
+	std::shared_ptr<Sample> Load( int index );
+
+	// number of samples read ahead of the current one
+	static const int ReadAhead = 3;
+
+protected:
+	void run();
+	std::shared_ptr<Sample> loadSample( const std::string& name ) const;
+
+	std::string datasetPath;
+	std::vector<std::string> names;	// sorted
+
+	std::map<std::string, std::shared_ptr<Sample> > loaded;
+	std::set<std::string> loading;
+	std::deque<std::string> queue;
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable condition;
+
+	bool stopping;
+};
+
+#endif
+
@@ -0,0 +1,465 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "saveQueue.h"
+#include "datasetStaging.h"
+#include "metrics.h"
+#include "tracer.h"
+
+#include "cudaMappedMemory.h"
+#include "imageIO.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+
+// constructor
+SaveController::SaveController()
+{
+	enabled    = true;
+	adjustTime = 0.0;
+	idleTime   = 0.0;
+
+	settings.level = 0;
+
+	Configure(95, DefaultMinQuality, 0.5, 2.0);
+}
+
+
+// Configure
+void SaveController::Configure( int quality, int _minQuality, double interval, double _maxInterval )
+{
+	baseQuality  = quality;
+	minQuality   = std::min(_minQuality, quality);
+	baseInterval = interval;
+	maxInterval  = std::max(_maxInterval, interval);
+
+	apply();
+}
+
+
+// apply
+void SaveController::apply()
+{
+	if( !enabled )
+		settings.level = 0;
+
+	// the quality is lowered first, then the capture rate
+	const int qualityLevels = (baseQuality - minQuality + QualityStep - 1) / QualityStep;
+
+	settings.quality  = std::max(baseQuality - settings.level * QualityStep, minQuality);
+	settings.interval = baseInterval;
+
+	for( int n=qualityLevels; n < settings.level; n++ )
+		settings.interval = std::min(std::max(settings.interval * 2.0, 0.001), maxInterval);
+}
+
+
+// Update
+bool SaveController::Update( int depth, int capacity, double time )
+{
+	if( !enabled )
+		return false;
+
+	const int level = settings.level;
+
+	if( depth * 2 > capacity )
+	{
+		idleTime = 0.0;
+
+		// lower the settings until the queue drains (or they reach their bounds)
+		if( time - adjustTime >= AdjustPeriod && (settings.quality > minQuality || settings.interval < maxInterval) )
+		{
+			settings.level++;
+			adjustTime = time;
+		}
+	}
+	else if( depth <= 1 )
+	{
+		if( idleTime == 0.0 )
+			idleTime = time;
+
+		// restore them once the disk has kept up for a while
+		if( settings.level > 0 && time - idleTime >= RestorePeriod && time - adjustTime >= RestorePeriod )
+		{
+			settings.level--;
+			adjustTime = time;
+		}
+	}
+	else
+	{
+		idleTime = 0.0;
+	}
+
+	if( settings.level == level )
+		return false;
+
+	apply();
+	return true;
+}
+
+
+// Chroma
+const char* SaveController::Chroma( int quality )
+{
+	return (quality <= 90) ? "4:2:0" : "4:4:4";
+}
+
+
+// Usage
+const char* SaveController::Usage()
+{
+	return "save queue arguments (classification):\n"
+		  "  --save-queue=N             frames queued to be written (default 8)\n"
+		  "  --save-threads=N           frames encoded and written at once (default 4,\n"
+		  "                             at most the number of CPUs)\n"
+		  "  --min-quality=Q            lowest JPEG quality when the disk can't keep up\n"
+		  "                             (default 70)\n"
+		  "  --max-auto-interval=MS     longest time between auto-captures when the disk\n"
+		  "                             can't keep up (default 4x --auto-interval)\n"
+		  "  --fixed-quality            don't adjust the settings to the disk\n"
+		  "  --min-free-space=MB        stop capturing when the free space of the dataset's\n"
+		  "                             disk drops below this (default 512)\n\n";
+}
+
+
+//-----------------------------------------------------------------------------------------
+// constructor
+SaveQueue::SaveQueue( int _capacity, int numThreads )
+{
+	capacity   = std::max(_capacity, 1);
+	busy       = 0;
+	stopping   = false;
+	throughput = 0.0;
+	frameBytes = 0.0;
+	freeSpace  = UINT64_MAX;
+	written    = 0;
+	failed     = 0;
+
+	const int numCPUs = std::thread::hardware_concurrency();
+
+	if( numCPUs > 0 )
+		numThreads = std::min(numThreads, numCPUs);
+
+	for( int n=0; n < std::max(numThreads, 1); n++ )
+		threads.push_back(std::thread(&SaveQueue::run, this));
+}
+
+
+// destructor
+SaveQueue::~SaveQueue()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	// the queued frames are written before exiting
+	condition.notify_all();
+
+	for( size_t n=0; n < threads.size(); n++ )
+		threads[n].join();
+
+	for( std::multimap<size_t, uchar3*>::iterator n=buffers.begin(); n != buffers.end(); n++ )
+		CUDA(cudaFreeHost(n->second));
+}
+
+
+// Open
+void SaveQueue::Open( const std::string& path )
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		datasetPath = path;
+	}
+
+	freeSpace = FreeSpace(path);
+}
+
+
+// GetDepth
+int SaveQueue::GetDepth() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return queue.size() + busy;
+}
+
+
+// GetPendingBytes
+uint64_t SaveQueue::GetPendingBytes() const
+{
+	return GetDepth() * frameBytes.load();
+}
+
+
+// Submit
+bool SaveQueue::Submit( const uchar3* image, int width, int height, const std::string& filename, int quality, const std::string& metadata )
+{
+	if( !image || width <= 0 || height <= 0 )
+		return false;
+
+	Job job;
+
+	job.width    = width;
+	job.height   = height;
+	job.quality  = quality;
+	job.filename = filename;
+	job.metadata = metadata;
+
+	return submit(job, image, width, 0, 0);
+}
+
+
+// Submit
+bool SaveQueue::Submit( const uchar3* image, int width, int height, const OutputGeometry& geometry,
+				    const std::string& filename, int quality, const std::string& metadata )
+{
+	int region[4];
+
+	if( !image || !geometry.GetRegion(width, height, region) )
+		return false;
+
+	// the region is cropped now, and resized by the writer
+	Job job;
+
+	job.width    = region[2];
+	job.height   = region[3];
+	job.quality  = quality;
+	job.filename = filename;
+	job.metadata = metadata;
+	job.geometry = geometry;
+
+	memset(job.geometry.roi, 0, sizeof(job.geometry.roi));
+
+	return submit(job, image, width, region[0], region[1]);
+}
+
+
+// submit
+bool SaveQueue::submit( Job& job, const uchar3* image, int stride, int x, int y )
+{
+	const size_t size = job.width * job.height * sizeof(uchar3);
+	uchar3* buffer = NULL;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if( (int)queue.size() + busy >= capacity )
+			return false;
+
+		// reuse a buffer of the same size, or replace one of another size (the frame
+		// size can change, and the regions and originals are queued at other sizes)
+		std::multimap<size_t, uchar3*>::iterator match = buffers.find(size);
+
+		if( match != buffers.end() )
+		{
+			buffer = match->second;
+			buffers.erase(match);
+		}
+		else if( buffers.size() > 0 )
+		{
+			CUDA(cudaFreeHost(buffers.begin()->second));
+			buffers.erase(buffers.begin());
+		}
+	}
+
+	if( !buffer && !cudaAllocMapped((void**)&buffer, size) )
+		return false;
+
+	if( x == 0 && job.width == stride )
+	{
+		memcpy(buffer, image + (size_t)y * stride, size);
+	}
+	else
+	{
+		for( int row=0; row < job.height; row++ )
+			memcpy(buffer + (size_t)row * job.width, image + (size_t)(y + row) * stride + x, job.width * sizeof(uchar3));
+	}
+
+	job.image = buffer;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		job.dataset = datasetPath;
+		queue.push_back(job);
+	}
+
+	condition.notify_one();
+	return true;
+}
+
+
+// Flush
+void SaveQueue::Flush()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	idle.wait(lock, [this]{ return queue.size() == 0 && busy == 0; });
+}
+
+
+// run
+void SaveQueue::run()
+{
+	Tracer::SetThreadName("save queue");
+
+	static MetricsValue* depthGauge = Metrics::GetGauge("save_queue_depth", "frames waiting to be written");
+	static MetricsValue* failures = Metrics::GetCounter("save_failures", "frames that failed to be written");
+
+	// the regions are resized by each writer
+	OutputTransform transform;
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while( true )
+	{
+		while( !stopping && queue.size() == 0 )
+			condition.wait(lock);
+
+		if( queue.size() == 0 )
+			break;	// stopping, and everything was written
+
+		const Job job = queue.front();
+
+		queue.pop_front();
+		busy++;
+		depthGauge->Set(queue.size() + busy);
+
+		lock.unlock();
+
+		// encode and write the image (to the staging area, if there is one)
+		StagedSample sample = DatasetStaging::Begin();
+
+		const std::string path = sample.Path(job.filename);
+		const uint64_t start = Metrics::Now();
+		bool saved = false;
+
+		{
+			METRICS_SCOPE("save_image", "time to encode and write an image");
+			TRACE_SCOPE("save_write");
+
+			uchar3* image = job.image;
+
+			int width  = job.width;
+			int height = job.height;
+
+			if( !job.geometry.IsFullFrame() && transform.Configure(job.geometry, width, height) && !transform.IsIdentity() )
+			{
+				METRICS_SCOPE("save_transform", "time to crop and resize a frame to the output geometry");
+
+				image  = const_cast<uchar3*>(transform.Apply(job.image));
+				width  = transform.GetWidth();
+				height = transform.GetHeight();
+			}
+
+			saved = (image != NULL) && saveImage(path.c_str(), image, width, height, job.quality);
+		}
+
+		const double seconds = (Metrics::Now() - start) * 1e-9;
+		off_t fileSize = 0;
+
+		if( saved )
+		{
+			struct stat info;
+
+			if( stat(path.c_str(), &info) == 0 )
+				fileSize = info.st_size;
+
+			appendMetadata(job, sample);
+
+			if( !DatasetStaging::Commit(sample) )
+				saved = false;
+		}
+
+		if( saved )
+		{
+			written++;
+
+			printf("camera-capture:  saved %s\n", job.filename.c_str());
+		}
+		else
+		{
+			printf("camera-capture:  failed to save %s\n", job.filename.c_str());
+			DatasetStaging::Discard(sample);
+			failures->Add();
+			failed++;
+		}
+
+		if( job.dataset.size() > 0 )
+			freeSpace = FreeSpace(job.dataset);
+
+		lock.lock();
+
+		// average over the recent frames (of all the writers)
+		if( fileSize > 0 && seconds > 0.0 )
+		{
+			const double alpha = (written.load() <= 1) ? 1.0 : 0.25;
+
+			throughput = throughput.load() * (1.0 - alpha) + (fileSize / seconds) * alpha;
+			frameBytes = frameBytes.load() * (1.0 - alpha) + fileSize * alpha;
+		}
+
+		// return the buffer to the pool
+		buffers.insert(std::make_pair(job.width * job.height * sizeof(uchar3), job.image));
+
+		busy--;
+		depthGauge->Set(queue.size() + busy);
+		idle.notify_all();
+	}
+
+	idle.notify_all();
+}
+
+
+// appendMetadata
+void SaveQueue::appendMetadata( const Job& job, StagedSample& sample )
+{
+	const std::string& path = job.dataset;
+
+	if( path.size() == 0 || job.metadata.size() == 0 )
+		return;
+
+	std::string name = job.filename;
+
+	if( name.compare(0, path.size() + 1, path + "/") == 0 )
+		name = name.substr(path.size() + 1);
+
+	// appended with the sample (once it's migrated, if it's staged)
+	sample.Append(path + "/.capture-metadata", name + "\t" + job.metadata);
+}
+
+
+// FreeSpace
+uint64_t SaveQueue::FreeSpace( const std::string& path )
+{
+	struct statvfs info;
+
+	if( path.size() == 0 || statvfs(path.c_str(), &info) != 0 )
+		return UINT64_MAX;
+
+	return (uint64_t)info.f_bavail * info.f_frsize;
+}
+
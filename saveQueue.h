@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_SAVE_QUEUE__
+#define __CAMERA_SAVE_QUEUE__
+
+#include "cudaUtility.h"
+#include "datasetStaging.h"
+#include "outputGeometry.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+/*
+ * Capture settings chosen by the SaveController
+ */
+struct SaveSettings
+{
+	int    level;		// how far the settings were lowered (0 = the configured settings)
+	int    quality;		// JPEG quality
+	double interval;		// minimum seconds between auto-captures
+};
+
+
+/*
+ * Lowers the capture settings when the disk can't keep up with the saves,
+ * and restores them when it does.
+ *
+ * The controller watches the depth of the SaveQueue.  While the queue is
+ * more than half full, the settings are lowered one level per AdjustPeriod:
+ * first the JPEG quality drops by QualityStep down to the minimum quality,
+ * then the interval between auto-captures doubles up to the maximum interval.
+ * Once the queue has stayed nearly empty for RestorePeriod, the settings are
+ * raised one level at a time.
+ *
+ * The chroma subsampling follows the quality (the JPEG encoder subsamples
+ * the chroma to 4:2:0 at a quality of 90 or less, and keeps it at 4:4:4
+ * above), so lowering the quality past 90 also halves the chroma data.
+ */
+class SaveController
+{
+public:
+	// constructor
+	SaveController();
+
+	// set the bounds of the settings (the quality and interval are the settings at level 0)
+	void Configure( int quality, int minQuality, double interval, double maxInterval );
+
+	// update the settings from the queue depth, returns true if they changed
+	bool Update( int depth, int capacity, double time );
+
+	// enable/disable the adjustments (the configured settings are used when disabled)
+	inline void Enable( bool _enabled )			{ enabled = _enabled; apply(); }
+	inline bool IsEnabled() const				{ return enabled; }
+
+	// current settings
+	inline const SaveSettings& GetSettings() const	{ return settings; }
+
+	// the chroma subsampling of a JPEG quality ("4:4:4" or "4:2:0")
+	static const char* Chroma( int quality );
+
+	// usage string for the command line arguments
+	static const char* Usage();
+
+	// adjustment parameters
+	static const int QualityStep = 5;
+	static const int DefaultMinQuality = 70;
+
+	static constexpr double AdjustPeriod  = 1.0;	// seconds between lowering the settings
+	static constexpr double RestorePeriod = 5.0;	// seconds the queue is nearly empty before restoring them
+
+protected:
+	void apply();
+
+	SaveSettings settings;
+
+	int    baseQuality;
+	int    minQuality;
+	double baseInterval;
+	double maxInterval;
+
+	double adjustTime;	// time of the last adjustment
+	double idleTime;	// time the queue became nearly empty (or 0)
+
+	bool enabled;
+};
+
+
+/*
+ * Writes the captured frames to disk on a background thread, so that
+ * a burst or a run of auto-captures doesn't stall the camera.
+ *
+ * The frames are copied into a pool of Capacity buffers when they're
+ * submitted, and a frame is dropped if the queue is full.  A region of a
+ * frame can be submitted instead (only the region is copied), and it's
+ * resized to an output geometry by the writer.  Several writer threads
+ * encode and write the frames at once.  The writers measure the throughput
+ * of the disk (in bytes written per second of encoding and writing), and
+ * the free space of the dataset's filesystem after each write.
+ *
+ * For each frame written, a line of metadata is appended to the dataset's
+ * .capture-metadata file (tab-separated:  the image path, relative to the
+ * dataset, followed by the metadata of the frame, i.e. its settings).
+ */
+class SaveQueue
+{
+public:
+	// constructor
+	SaveQueue( int capacity=DefaultCapacity, int threads=DefaultThreads );
+
+	// destructor (the queued frames are written before it returns)
+	~SaveQueue();
+
+	// set the dataset the frames are saved to (for the metadata and the free space)
+	void Open( const std::string& datasetPath );
+
+	// queue a frame to be saved, returns false if the queue is full
+	bool Submit( const uchar3* image, int width, int height, const std::string& filename, int quality, const std::string& metadata="" );
+
+	// queue the region of a frame that's selected by an output geometry (the whole frame if it
+	// doesn't have one), to be resized to the geometry by the writer, returns false if the queue
+	// is full or the region is outside of the frame
+	bool Submit( const uchar3* image, int width, int height, const OutputGeometry& geometry,
+			   const std::string& filename, int quality, const std::string& metadata="" );
+
+	// wait for the queued frames to be written
+	void Flush();
+
+	// queue status
+	int GetDepth() const;
+	inline int GetCapacity() const			{ return capacity; }
+
+	// write throughput (in bytes per second, averaged over the recent frames)
+	inline double GetThroughput() const		{ return throughput.load(); }
+
+	// free space of the dataset's filesystem (in bytes, updated after each write)
+	inline uint64_t GetFreeSpace() const		{ return freeSpace.load(); }
+
+	// bytes queued but not written yet (estimated from the recent frames)
+	uint64_t GetPendingBytes() const;
+
+	// number of frames written, or that failed to be written
+	inline uint32_t GetWriteCount() const		{ return written.load(); }
+	inline uint32_t GetFailCount() const		{ return failed.load(); }
+
+	// free space of a filesystem (in bytes, or UINT64_MAX if it's unknown)
+	static uint64_t FreeSpace( const std::string& path );
+
+	// default number of frames queued
+	static const int DefaultCapacity = 8;
+
+	// default number of writer threads (limited to the number of CPUs)
+	static const int DefaultThreads = 4;
+
+protected:
+	struct Job
+	{
+		uchar3*     image;	// buffer from the pool
+		int         width;
+		int         height;
+		int         quality;
+		std::string filename;
+		std::string metadata;
+		std::string dataset;	// at the time the frame was queued
+
+		OutputGeometry geometry;	// resized by the writer (without a region, it was cropped when queued)
+	};
+
+	bool submit( Job& job, const uchar3* image, int stride, int x, int y );
+
+	void run();
+	void appendMetadata( const Job& job, StagedSample& sample );
+
+	int capacity;
+
+	std::string datasetPath;
+
+	std::deque<Job> queue;
+	std::multimap<size_t, uchar3*> buffers;	// free buffers of the pool (by size)
+
+	int  busy;			// frames being written
+	bool stopping;
+
+	std::atomic<double>   throughput;
+	std::atomic<double>   frameBytes;	// average size of the frames written
+	std::atomic<uint64_t> freeSpace;
+	std::atomic<uint32_t> written;
+	std::atomic<uint32_t> failed;
+
+	std::vector<std::thread> threads;
+	mutable std::mutex mutex;
+	std::condition_variable condition;
+	std::condition_variable idle;
+};
+
+#endif
+
@@ -0,0 +1,379 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "sessionLog.h"
+
+#include "cudaMappedMemory.h"
+
+#include <chrono>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// Get
+int SessionEvent::GetInt( size_t n ) const
+{
+	return (n < args.size()) ? atoi(args[n].c_str()) : 0;
+}
+
+uint64_t SessionEvent::GetUInt( size_t n ) const
+{
+	return (n < args.size()) ? strtoull(args[n].c_str(), NULL, 10) : 0;
+}
+
+float SessionEvent::GetFloat( size_t n ) const
+{
+	return (n < args.size()) ? strtof(args[n].c_str(), NULL) : 0.0f;
+}
+
+
+//-----------------------------------------------------------------------------------------
+// constructor
+SessionRecorder::SessionRecorder()
+{
+	file        = NULL;
+	frames      = NULL;
+	frameOffset = 0;
+	startTime   = 0;
+}
+
+
+// destructor
+SessionRecorder::~SessionRecorder()
+{
+	if( file != NULL )
+	{
+		Record("end");
+		fclose(file);
+	}
+
+	if( frames != NULL )
+		fclose(frames);
+}
+
+
+// Create
+SessionRecorder* SessionRecorder::Create( const char* filename )
+{
+	if( !filename )
+		return NULL;
+
+	SessionRecorder* recorder = new SessionRecorder();
+
+	recorder->filename = filename;
+	recorder->file = fopen(filename, "w");
+
+	if( !recorder->file )
+	{
+		printf("camera-capture:  failed to create session log %s\n", filename);
+		delete recorder;
+		return NULL;
+	}
+
+	recorder->startTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	recorder->Record("session %i", Version);
+
+	printf("camera-capture:  recording the session to %s\n", filename);
+	return recorder;
+}
+
+
+// elapsed
+uint64_t SessionRecorder::elapsed() const
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() - startTime;
+}
+
+
+// Record
+void SessionRecorder::Record( const char* format, ... )
+{
+	if( !file || !format )
+		return;
+
+	fprintf(file, "%llu ", (unsigned long long)elapsed());
+
+	va_list args;
+	va_start(args, format);
+	vfprintf(file, format, args);
+	va_end(args);
+
+	fputc('\n', file);
+}
+
+
+// Input
+void SessionRecorder::Input( const char* kind, const std::string& detail )
+{
+	if( !kind )
+		return;
+
+	if( detail.size() > 0 )
+		Record("input %s %s", kind, Escape(detail).c_str());
+	else
+		Record("input %s", kind);
+
+	// the actions are flushed as they happen, so a crash keeps the session up to it
+	if( file != NULL )
+		fflush(file);
+}
+
+
+// Frame
+bool SessionRecorder::Frame( const uchar3* image, int width, int height )
+{
+	if( !image || width <= 0 || height <= 0 )
+		return false;
+
+	if( !frames )
+	{
+		const std::string path = FramesPath(filename);
+		frames = fopen(path.c_str(), "wb");
+
+		if( !frames )
+		{
+			printf("camera-capture:  failed to create %s\n", path.c_str());
+			return false;
+		}
+	}
+
+	const size_t size = width * height * sizeof(uchar3);
+
+	if( fwrite(image, size, 1, frames) != 1 )
+	{
+		printf("camera-capture:  failed to write %s\n", FramesPath(filename).c_str());
+		return false;
+	}
+
+	fflush(frames);
+
+	Record("frame %llu %i %i", (unsigned long long)frameOffset, width, height);
+	frameOffset += size;
+
+	return true;
+}
+
+
+// FramesPath
+std::string SessionRecorder::FramesPath( const std::string& filename )
+{
+	return filename + ".frames";
+}
+
+
+// Escape
+std::string SessionRecorder::Escape( const std::string& str )
+{
+	// an empty string still has to be one argument
+	if( str.size() == 0 )
+		return "%";
+
+	std::string escaped;
+	escaped.reserve(str.size());
+
+	for( size_t n=0; n < str.size(); n++ )
+	{
+		const unsigned char c = str[n];
+
+		if( c == '%' || c <= ' ' || c == 0x7F )
+		{
+			char hex[4];
+			sprintf(hex, "%%%02X", c);
+			escaped += hex;
+		}
+		else
+		{
+			escaped += c;
+		}
+	}
+
+	return escaped;
+}
+
+
+// Unescape
+std::string SessionRecorder::Unescape( const std::string& str )
+{
+	if( str == "%" )
+		return "";
+
+	std::string unescaped;
+	unescaped.reserve(str.size());
+
+	for( size_t n=0; n < str.size(); n++ )
+	{
+		if( str[n] == '%' && n + 2 < str.size() )
+		{
+			unescaped += (char)strtol(str.substr(n + 1, 2).c_str(), NULL, 16);
+			n += 2;
+		}
+		else
+		{
+			unescaped += str[n];
+		}
+	}
+
+	return unescaped;
+}
+
+
+// Usage
+const char* SessionRecorder::Usage()
+{
+	return "session arguments:\n"
+		  "  --session-record=FILE      record the detection session (the inputs, the edits,\n"
+		  "                             and the frozen frames) to a file, which camera-replay\n"
+		  "                             runs headlessly to compare builds on the same workload\n\n";
+}
+
+
+//-----------------------------------------------------------------------------------------
+// constructor
+SessionReader::SessionReader()
+{
+	file   = NULL;
+	frames = NULL;
+	line   = 0;
+}
+
+
+// destructor
+SessionReader::~SessionReader()
+{
+	if( file != NULL )
+		fclose(file);
+
+	if( frames != NULL )
+		fclose(frames);
+}
+
+
+// Open
+SessionReader* SessionReader::Open( const char* filename )
+{
+	if( !filename )
+		return NULL;
+
+	SessionReader* reader = new SessionReader();
+
+	reader->filename = filename;
+	reader->file = fopen(filename, "r");
+
+	if( !reader->file )
+	{
+		printf("camera-capture:  failed to open session log %s\n", filename);
+		delete reader;
+		return NULL;
+	}
+
+	SessionEvent event;
+
+	if( !reader->Next(event) || event.name != "session" || event.GetInt(0) != SessionRecorder::Version )
+	{
+		printf("camera-capture:  %s isn't a session log (or it's from another version)\n", filename);
+		delete reader;
+		return NULL;
+	}
+
+	return reader;
+}
+
+
+// Next
+bool SessionReader::Next( SessionEvent& event )
+{
+	if( !file )
+		return false;
+
+	char*  str  = NULL;
+	size_t size = 0;
+
+	// the lines aren't limited in length (i.e. a long list of labels)
+	while( getline(&str, &size, file) > 0 )
+	{
+		line++;
+
+		event.time = 0;
+		event.name.clear();
+		event.args.clear();
+
+		char* saveptr = NULL;
+		char* token = strtok_r(str, " \r\n", &saveptr);
+
+		if( !token )
+			continue;	// blank line
+
+		event.time = strtoull(token, NULL, 10);
+		token = strtok_r(NULL, " \r\n", &saveptr);
+
+		if( !token )
+			continue;
+
+		event.name = token;
+
+		while( (token = strtok_r(NULL, " \r\n", &saveptr)) != NULL )
+			event.args.push_back(SessionRecorder::Unescape(token));
+
+		free(str);
+		return true;
+	}
+
+	free(str);
+	return false;
+}
+
+
+// ReadFrame
+bool SessionReader::ReadFrame( uint64_t offset, int width, int height, uchar3** image )
+{
+	if( !image || width <= 0 || height <= 0 )
+		return false;
+
+	if( !frames )
+	{
+		const std::string path = SessionRecorder::FramesPath(filename);
+		frames = fopen(path.c_str(), "rb");
+
+		if( !frames )
+		{
+			printf("camera-capture:  failed to open %s\n", path.c_str());
+			return false;
+		}
+	}
+
+	const size_t size = width * height * sizeof(uchar3);
+
+	if( !cudaAllocMapped((void**)image, size) )
+		return false;
+
+	if( fseeko(frames, offset, SEEK_SET) != 0 || fread(*image, size, 1, frames) != 1 )
+	{
+		printf("camera-capture:  failed to read the frame at %llu of %s\n", (unsigned long long)offset, SessionRecorder::FramesPath(filename).c_str());
+		CUDA(cudaFreeHost(*image));
+		*image = NULL;
+		return false;
+	}
+
+	return true;
+}
+
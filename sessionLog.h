@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_SESSION_LOG__
+#define __CAMERA_SESSION_LOG__
+
+#include "cudaUtility.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+/*
+ * Event read back from a session log
+ */
+struct SessionEvent
+{
+	uint64_t time;				// microseconds since the start of the session
+	std::string name;
+	std::vector<std::string> args;	// unescaped
+
+	// parse the arguments
+	int      GetInt( size_t n ) const;
+	uint64_t GetUInt( size_t n ) const;
+	float    GetFloat( size_t n ) const;
+};
+
+
+/*
+ * Records an editing session to a text file, so it can be replayed
+ * headlessly (see tools/camera-replay.cpp) to compare builds on the
+ * same workload.
+ *
+ * Each line is one event:  the time in microseconds, the event name,
+ * and its arguments separated by spaces (strings are escaped, so that
+ * labels and paths can contain spaces).  There are three kinds of events:
+ *
+ *   - input markers from the operator (key presses, drawing and dragging
+ *     boxes on the canvas, table edits), which divide the session into
+ *     the actions that are timed by the replay
+ *
+ *   - calls to the AnnotationModel, recorded by the model itself (see
+ *     AnnotationModel::SetRecorder()), so that the edits made by the
+ *     tracker, the proposals, and the pre-labeler are replayed as well
+ *
+ *   - the frames that were frozen, the dataset, the class labels, and
+ *     the samples that were saved
+ *
+ * Frames from a synthetic source are recorded by their index, since they
+ * can be generated again.  Other frames are appended to a sidecar file
+ * (the log's filename + ".frames") and recorded by their offset in it.
+ * Floats are written with 9 significant digits, so they're read back
+ * exactly and the replayed annotations match byte for byte.
+ */
+class SessionRecorder
+{
+public:
+	// create a session log (replacing an existing one)
+	static SessionRecorder* Create( const char* filename );
+
+	// destructor
+	~SessionRecorder();
+
+	// record an event (the format starts with the event name, i.e. "remove %u")
+	void Record( const char* format, ... );
+
+	// record an operator input that starts a new action (the log is flushed)
+	void Input( const char* kind, const std::string& detail="" );
+
+	// append a frame to the sidecar file and record its offset
+	bool Frame( const uchar3* image, int width, int height );
+
+	// the filename of the log
+	inline const std::string& GetFilename() const		{ return filename; }
+
+	// escape a string argument (spaces, newlines, and '%' are percent-encoded)
+	static std::string Escape( const std::string& str );
+	static std::string Unescape( const std::string& str );
+
+	// the sidecar file of the frames
+	static std::string FramesPath( const std::string& filename );
+
+	// usage string for the command line arguments
+	static const char* Usage();
+
+	// version of the log format
+	static const int Version = 1;
+
+protected:
+	SessionRecorder();
+
+	uint64_t elapsed() const;
+
+	std::string filename;
+
+	FILE* file;
+	FILE* frames;
+
+	uint64_t frameOffset;
+	uint64_t startTime;
+};
+
+
+/*
+ * Reads a session log back one event at a time
+ */
+class SessionReader
+{
+public:
+	// open a session log
+	static SessionReader* Open( const char* filename );
+
+	// destructor
+	~SessionReader();
+
+	// read the next event, returns false at the end of the log
+	bool Next( SessionEvent& event );
+
+	// read a frame from the sidecar file into mapped memory (which the caller frees)
+	bool ReadFrame( uint64_t offset, int width, int height, uchar3** image );
+
+	// the line number of the last event (for error messages)
+	inline int GetLine() const					{ return line; }
+
+protected:
+	SessionReader();
+
+	std::string filename;
+
+	FILE* file;
+	FILE* frames;
+
+	int line;
+};
+
+#endif
+
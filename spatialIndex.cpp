@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "spatialIndex.h"
+
+#include <math.h>
+#include <algorithm>
+
+
+// constructor
+SpatialIndex::SpatialIndex( float size )
+{
+	cellSize   = (size > 0.0f) ? size : 64.0f;
+	queryCount = 0;
+}
+
+
+// cellCoord
+inline int SpatialIndex::cellCoord( float v ) const
+{
+	return (int)floorf(v / cellSize);
+}
+
+
+// cellKey
+inline uint64_t SpatialIndex::cellKey( int x, int y ) const
+{
+	return ((uint64_t)(uint32_t)x << 32) | (uint64_t)(uint32_t)y;
+}
+
+
+// Insert
+void SpatialIndex::Insert( uint32_t id, float x, float y, float width, float height )
+{
+	// boxes can be dragged with a negative size
+	if( width < 0.0f )
+	{
+		x += width;
+		width = -width;
+	}
+
+	if( height < 0.0f )
+	{
+		y += height;
+		height = -height;
+	}
+
+	Entry entry;
+
+	entry.x      = x;
+	entry.y      = y;
+	entry.width  = width;
+	entry.height = height;
+	entry.cellX0 = cellCoord(x);
+	entry.cellY0 = cellCoord(y);
+	entry.cellX1 = cellCoord(x + width);
+	entry.cellY1 = cellCoord(y + height);
+	entry.query  = 0;
+
+	std::unordered_map<uint32_t, Entry>::iterator iter = entries.find(id);
+
+	if( iter != entries.end() )
+	{
+		Entry& prev = iter->second;
+
+		// while a box is dragged it usually stays in the same cells
+		if( prev.cellX0 != entry.cellX0 || prev.cellY0 != entry.cellY0 ||
+		    prev.cellX1 != entry.cellX1 || prev.cellY1 != entry.cellY1 )
+		{
+			removeFromCells(id, prev);
+			addToCells(id, entry);
+		}
+
+		prev = entry;
+		return;
+	}
+
+	entries[id] = entry;
+	addToCells(id, entry);
+}
+
+
+// Remove
+bool SpatialIndex::Remove( uint32_t id )
+{
+	std::unordered_map<uint32_t, Entry>::iterator iter = entries.find(id);
+
+	if( iter == entries.end() )
+		return false;
+
+	removeFromCells(id, iter->second);
+	entries.erase(iter);
+
+	return true;
+}
+
+
+// Clear
+void SpatialIndex::Clear()
+{
+	cells.clear();
+	entries.clear();
+}
+
+
+// addToCells
+void SpatialIndex::addToCells( uint32_t id, const Entry& entry )
+{
+	for( int y=entry.cellY0; y <= entry.cellY1; y++ )
+		for( int x=entry.cellX0; x <= entry.cellX1; x++ )
+			cells[cellKey(x,y)].push_back(id);
+}
+
+
+// removeFromCells
+void SpatialIndex::removeFromCells( uint32_t id, const Entry& entry )
+{
+	for( int y=entry.cellY0; y <= entry.cellY1; y++ )
+	{
+		for( int x=entry.cellX0; x <= entry.cellX1; x++ )
+		{
+			std::unordered_map<uint64_t, Cell>::iterator iter = cells.find(cellKey(x,y));
+
+			if( iter == cells.end() )
+				continue;
+
+			Cell& cell = iter->second;
+			Cell::iterator item = std::find(cell.begin(), cell.end(), id);
+
+			if( item != cell.end() )
+			{
+				*item = cell.back();	// order within a cell doesn't matter
+				cell.pop_back();
+			}
+
+			if( cell.size() == 0 )
+				cells.erase(iter);
+		}
+	}
+}
+
+
+// Query (point)
+size_t SpatialIndex::Query( float x, float y, std::vector<uint32_t>& ids ) const
+{
+	ids.clear();
+
+	std::unordered_map<uint64_t, Cell>::const_iterator iter = cells.find(cellKey(cellCoord(x), cellCoord(y)));
+
+	if( iter == cells.end() )
+		return 0;
+
+	const Cell& cell = iter->second;
+	const size_t numItems = cell.size();
+
+	for( size_t n=0; n < numItems; n++ )
+	{
+		const Entry& entry = entries.find(cell[n])->second;
+
+		if( x >= entry.x && y >= entry.y && x <= entry.x + entry.width && y <= entry.y + entry.height )
+			ids.push_back(cell[n]);
+	}
+
+	return ids.size();
+}
+
+
+// Query (rect)
+size_t SpatialIndex::Query( float x, float y, float width, float height, std::vector<uint32_t>& ids, bool contained ) const
+{
+	ids.clear();
+
+	if( width < 0.0f )
+	{
+		x += width;
+		width = -width;
+	}
+
+	if( height < 0.0f )
+	{
+		y += height;
+		height = -height;
+	}
+
+	const float x2 = x + width;
+	const float y2 = y + height;
+
+	const int cellX0 = cellCoord(x);
+	const int cellY0 = cellCoord(y);
+	const int cellX1 = cellCoord(x2);
+	const int cellY1 = cellCoord(y2);
+
+	// boxes spanning several cells are only reported once per query
+	const uint32_t query = ++queryCount;
+
+	for( int cy=cellY0; cy <= cellY1; cy++ )
+	{
+		for( int cx=cellX0; cx <= cellX1; cx++ )
+		{
+			std::unordered_map<uint64_t, Cell>::const_iterator iter = cells.find(cellKey(cx,cy));
+
+			if( iter == cells.end() )
+				continue;
+
+			const Cell& cell = iter->second;
+			const size_t numItems = cell.size();
+
+			for( size_t n=0; n < numItems; n++ )
+			{
+				const Entry& entry = entries.find(cell[n])->second;
+
+				if( entry.query == query )
+					continue;
+
+				entry.query = query;
+
+				const float ex2 = entry.x + entry.width;
+				const float ey2 = entry.y + entry.height;
+
+				if( contained )
+				{
+					if( entry.x >= x && entry.y >= y && ex2 <= x2 && ey2 <= y2 )
+						ids.push_back(cell[n]);
+				}
+				else
+				{
+					if( entry.x <= x2 && entry.y <= y2 && ex2 >= x && ey2 >= y )
+						ids.push_back(cell[n]);
+				}
+			}
+		}
+	}
+
+	return ids.size();
+}
+
+
+// Pick
+bool SpatialIndex::Pick( float x, float y, uint32_t* id ) const
+{
+	std::vector<uint32_t> ids;
+
+	if( Query(x, y, ids) == 0 )
+		return false;
+
+	// in crowded frames the smallest box under the cursor is most likely the intended one
+	float minArea = 0.0f;
+
+	for( size_t n=0; n < ids.size(); n++ )
+	{
+		const Entry& entry = entries.find(ids[n])->second;
+		const float area = entry.width * entry.height;
+
+		if( n == 0 || area < minArea )
+		{
+			minArea = area;
+
+			if( id != NULL )
+				*id = ids[n];
+		}
+	}
+
+	return true;
+}
+
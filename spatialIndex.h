@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_SPATIAL_INDEX__
+#define __CAMERA_SPATIAL_INDEX__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <unordered_map>
+
+
+/*
+ * Uniform grid index of boxes, for point and rectangle queries.
+ * Each box is stored in every grid cell it overlaps, so a query only
+ * visits the boxes in the cells it touches instead of every box.
+ */
+class SpatialIndex
+{
+public:
+	// constructor
+	SpatialIndex( float cellSize=64.0f );
+
+	// add or move a box
+	void Insert( uint32_t id, float x, float y, float width, float height );
+
+	// remove a box
+	bool Remove( uint32_t id );
+
+	// remove all boxes
+	void Clear();
+
+	// find the boxes containing a point (returns the number found)
+	size_t Query( float x, float y, std::vector<uint32_t>& ids ) const;
+
+	// find the boxes overlapping a rectangle (or fully inside it, if contained is true)
+	size_t Query( float x, float y, float width, float height, std::vector<uint32_t>& ids, bool contained=false ) const;
+
+	// find the smallest box containing a point (returns false if there isn't one)
+	bool Pick( float x, float y, uint32_t* id ) const;
+
+	// number of boxes
+	inline size_t GetCount() const	{ return entries.size(); }
+
+protected:
+	struct Entry
+	{
+		float x;
+		float y;
+		float width;
+		float height;
+
+		// range of cells the box is stored in
+		int cellX0;
+		int cellY0;
+		int cellX1;
+		int cellY1;
+
+		// last query that visited the box (so it's only reported once)
+		mutable uint32_t query;
+	};
+
+	typedef std::vector<uint32_t> Cell;
+
+	inline int cellCoord( float v ) const;
+	inline uint64_t cellKey( int x, int y ) const;
+
+	void addToCells( uint32_t id, const Entry& entry );
+	void removeFromCells( uint32_t id, const Entry& entry );
+
+	std::unordered_map<uint64_t, Cell>  cells;
+	std::unordered_map<uint32_t, Entry> entries;
+
+	float cellSize;
+	mutable uint32_t queryCount;
+};
+
+#endif
+
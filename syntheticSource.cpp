@@ -0,0 +1,456 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "syntheticSource.h"
+
+#include "cudaMappedMemory.h"
+#include "cudaYUV.h"
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+
+// rgbToYUV (BT.601, limited range)
+static void rgbToYUV( const uint8_t* rgb, uint8_t* yuv )
+{
+	const float r = rgb[0];
+	const float g = rgb[1];
+	const float b = rgb[2];
+
+	yuv[0] = (uint8_t)(16.0f  + ( 65.738f * r + 129.057f * g +  25.064f * b) / 256.0f);
+	yuv[1] = (uint8_t)(128.0f + (-37.945f * r -  74.494f * g + 112.439f * b) / 256.0f);
+	yuv[2] = (uint8_t)(128.0f + (112.439f * r -  94.154f * g -  18.285f * b) / 256.0f);
+}
+
+
+// backgroundColor (a gradient with some noise, so the frames don't compress unrealistically well)
+static void backgroundColor( int x, int y, int width, int height, uint32_t seed, uint8_t* rgb )
+{
+	uint32_t hash = (x * 73856093u) ^ (y * 19349663u) ^ (seed * 83492791u);
+
+	hash ^= hash >> 13;
+	hash *= 0x5bd1e995u;
+	hash ^= hash >> 15;
+
+	const int noise = (int)(hash & 15) - 8;
+
+	rgb[0] = 40 + 120 * x / width + noise;
+	rgb[1] = 60 + 100 * y / height + noise;
+	rgb[2] = 110 + noise;
+}
+
+
+// fillShape (into one plane, scaled to the plane's resolution)
+static void fillShape( uint8_t* plane, int planeWidth, int planeHeight, int channels, float scale,
+				   int classID, float cx, float cy, float size, const uint8_t* color )
+{
+	cx   *= scale;
+	cy   *= scale;
+	size *= scale;
+
+	const int y0 = std::max((int)(cy - size), 0);
+	const int y1 = std::min((int)(cy + size), planeHeight - 1);
+
+	for( int y=y0; y <= y1; y++ )
+	{
+		// the half-width of the row
+		float span = size;
+
+		if( classID == 1 )
+		{
+			const float dy = y + 0.5f - cy;
+			span = sqrtf(std::max(size * size - dy * dy, 0.0f));
+		}
+
+		const int x0 = std::max((int)(cx - span), 0);
+		const int x1 = std::min((int)(cx + span), planeWidth - 1);
+
+		uint8_t* row = plane + (y * planeWidth + x0) * channels;
+
+		for( int x=x0; x <= x1; x++, row += channels )
+			memcpy(row, color, channels);
+	}
+}
+
+
+// constructor
+SyntheticSource::SyntheticSource()
+{
+	width      = 0;
+	height     = 0;
+	frameRate  = 0.0f;
+	format     = RGB8;
+	yuv        = NULL;
+	frameCount = 0;
+
+	for( int n=0; n < NumBuffers; n++ )
+		buffers[n] = NULL;
+}
+
+
+// destructor
+SyntheticSource::~SyntheticSource()
+{
+	for( int n=0; n < NumBuffers; n++ )
+	{
+		if( buffers[n] != NULL )
+			CUDA(cudaFreeHost(buffers[n]));
+	}
+
+	if( yuv != NULL )
+		CUDA(cudaFreeHost(yuv));
+}
+
+
+// IsSynthetic
+bool SyntheticSource::IsSynthetic( const char* uri )
+{
+	return uri != NULL && strncasecmp(uri, "synthetic://", 12) == 0;
+}
+
+
+// Create
+SyntheticSource* SyntheticSource::Create( const char* uri, Format format, int numShapes, uint32_t seed )
+{
+	if( !IsSynthetic(uri) )
+		return NULL;
+
+	int width  = 1280;
+	int height = 720;
+	float frameRate = 30.0f;
+
+	// synthetic://WIDTHxHEIGHT@FPS (each part is optional)
+	const char* str = uri + 12;
+
+	if( *str != '\0' && *str != '@' && sscanf(str, "%ix%i", &width, &height) != 2 )
+	{
+		printf("camera-capture:  invalid synthetic source %s (should be synthetic://WIDTHxHEIGHT@FPS)\n", uri);
+		return NULL;
+	}
+
+	const char* rate = strchr(str, '@');
+
+	if( rate != NULL )
+		frameRate = atof(rate + 1);
+
+	return Create(width, height, frameRate, format, numShapes, seed);
+}
+
+
+// Create
+SyntheticSource* SyntheticSource::Create( int width, int height, float frameRate, Format format, int numShapes, uint32_t seed )
+{
+	SyntheticSource* source = new SyntheticSource();
+
+	if( !source->init(width, height, frameRate, format, numShapes, seed) )
+	{
+		printf("camera-capture:  failed to create synthetic source (%ix%i, %s)\n", width, height, FormatToStr(format));
+		delete source;
+		return NULL;
+	}
+
+	return source;
+}
+
+
+// init
+bool SyntheticSource::init( int _width, int _height, float _frameRate, Format _format, int numShapes, uint32_t seed )
+{
+	// the chroma planes of I420 are half the size
+	if( _width < 16 || _height < 16 || (_format == I420 && (_width % 2 != 0 || _height % 2 != 0)) )
+		return false;
+
+	width     = _width;
+	height    = _height;
+	frameRate = std::max(_frameRate, 0.0f);
+	format    = _format;
+
+	for( int n=0; n < NumBuffers; n++ )
+	{
+		if( !cudaAllocMapped((void**)&buffers[n], width * height * sizeof(uchar3)) )
+			return false;
+	}
+
+	if( format == I420 && !cudaAllocMapped((void**)&yuv, width * height * 3 / 2) )
+		return false;
+
+	// place the shapes
+	std::mt19937 rng(seed);
+
+	const float minSize = std::min(width, height) / 20.0f;
+	const float maxSize = std::min(width, height) / 8.0f;
+	const float speed   = width / 640.0f;
+
+	for( int n=0; n < numShapes; n++ )
+	{
+		Shape shape;
+
+		shape.classID = n % 2;
+		shape.size    = minSize + (maxSize - minSize) * (rng() % 1000) / 1000.0f;
+		shape.x       = shape.size + (width - 2.0f * shape.size) * (rng() % 1000) / 1000.0f;
+		shape.y       = shape.size + (height - 2.0f * shape.size) * (rng() % 1000) / 1000.0f;
+		shape.vx      = speed * (1.0f + (rng() % 500) / 100.0f) * ((rng() % 2) ? 1.0f : -1.0f);
+		shape.vy      = speed * (1.0f + (rng() % 500) / 100.0f) * ((rng() % 2) ? 1.0f : -1.0f);
+
+		// saturated colors, so the shapes stand out from the background
+		uint8_t rgb[3];
+
+		for( int c=0; c < 3; c++ )
+			rgb[c] = (rng() % 2) ? 255 - rng() % 40 : rng() % 40;
+
+		if( format == I420 )
+			rgbToYUV(rgb, shape.color);
+		else
+			memcpy(shape.color, rgb, 3);
+
+		shapes.push_back(shape);
+	}
+
+	// draw the background once, it's copied into each frame
+	if( format == I420 )
+	{
+		background.resize(width * height * 3 / 2);
+
+		uint8_t* planeY = background.data();
+		uint8_t* planeU = planeY + width * height;
+		uint8_t* planeV = planeU + width * height / 4;
+
+		for( int y=0; y < height; y++ )
+		{
+			for( int x=0; x < width; x++ )
+			{
+				uint8_t rgb[3];
+				uint8_t pixel[3];
+
+				backgroundColor(x, y, width, height, seed, rgb);
+				rgbToYUV(rgb, pixel);
+
+				planeY[y * width + x] = pixel[0];
+
+				if( x % 2 == 0 && y % 2 == 0 )
+				{
+					planeU[(y / 2) * (width / 2) + x / 2] = pixel[1];
+					planeV[(y / 2) * (width / 2) + x / 2] = pixel[2];
+				}
+			}
+		}
+	}
+	else
+	{
+		background.resize(width * height * 3);
+
+		for( int y=0; y < height; y++ )
+		{
+			for( int x=0; x < width; x++ )
+				backgroundColor(x, y, width, height, seed, &background[(y * width + x) * 3]);
+		}
+	}
+
+	return true;
+}
+
+
+// position
+void SyntheticSource::position( const Shape& shape, uint64_t frame, float& x, float& y ) const
+{
+	// the number of frames that the shapes have moved for
+	const uint64_t cycle = MoveFrames + StillFrames;
+	const uint64_t moved = (frame / cycle) * MoveFrames + std::min(frame % cycle, (uint64_t)MoveFrames);
+
+	// bounce off the edges (a triangle wave over the free space)
+	const float coords[] = { shape.x + shape.vx * moved, shape.y + shape.vy * moved };
+	const float limits[] = { width - 2.0f * shape.size, height - 2.0f * shape.size };
+
+	float results[2];
+
+	for( int n=0; n < 2; n++ )
+	{
+		const float range = std::max(limits[n], 1.0f);
+		float t = fmodf(coords[n] - shape.size, 2.0f * range);
+
+		if( t < 0.0f )
+			t += 2.0f * range;
+
+		if( t > range )
+			t = 2.0f * range - t;
+
+		results[n] = shape.size + t;
+	}
+
+	x = results[0];
+	y = results[1];
+}
+
+
+// render
+void SyntheticSource::render( uint64_t frame, uint8_t* pixels )
+{
+	memcpy(pixels, background.data(), background.size());
+
+	for( size_t n=0; n < shapes.size(); n++ )
+	{
+		const Shape& shape = shapes[n];
+
+		float x = 0.0f;
+		float y = 0.0f;
+
+		position(shape, frame, x, y);
+
+		if( format == I420 )
+		{
+			uint8_t* planeU = pixels + width * height;
+			uint8_t* planeV = planeU + width * height / 4;
+
+			fillShape(pixels, width, height, 1, 1.0f, shape.classID, x, y, shape.size, &shape.color[0]);
+			fillShape(planeU, width / 2, height / 2, 1, 0.5f, shape.classID, x, y, shape.size, &shape.color[1]);
+			fillShape(planeV, width / 2, height / 2, 1, 0.5f, shape.classID, x, y, shape.size, &shape.color[2]);
+		}
+		else
+		{
+			fillShape(pixels, width, height, 3, 1.0f, shape.classID, x, y, shape.size, shape.color);
+		}
+	}
+}
+
+
+// Capture
+bool SyntheticSource::Capture( uchar3** image )
+{
+	if( !image )
+		return false;
+
+	// pace the frames at the frame rate
+	if( frameCount == 0 )
+		startTime = std::chrono::steady_clock::now();
+	else if( frameRate > 0.0f )
+		std::this_thread::sleep_until(startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(frameCount / frameRate)));
+
+	uchar3* output = buffers[frameCount % NumBuffers];
+
+	if( format == I420 )
+	{
+		render(frameCount, yuv);
+
+		if( CUDA_FAILED(cudaI420ToRGB(yuv, output, width, height)) )
+			return false;
+	}
+	else
+	{
+		render(frameCount, (uint8_t*)output);
+	}
+
+	frameCount++;
+	*image = output;
+
+	return true;
+}
+
+
+// Seek
+void SyntheticSource::Seek( uint64_t frame )
+{
+	// keep pacing the frames from the new one
+	if( frameRate > 0.0f )
+		startTime = std::chrono::steady_clock::now() - std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(frame / frameRate));
+
+	frameCount = frame;
+}
+
+
+// GetBoxes
+void SyntheticSource::GetBoxes( std::vector<BoundingBox>& boxes ) const
+{
+	boxes.clear();
+
+	if( frameCount == 0 )
+		return;
+
+	for( size_t n=0; n < shapes.size(); n++ )
+	{
+		float x = 0.0f;
+		float y = 0.0f;
+
+		position(shapes[n], frameCount - 1, x, y);
+
+		BoundingBox box;
+		memset(&box, 0, sizeof(box));
+
+		box.id      = n + 1;
+		box.classID = shapes[n].classID;
+		box.x       = x - shapes[n].size;
+		box.y       = y - shapes[n].size;
+		box.width   = shapes[n].size * 2.0f;
+		box.height  = shapes[n].size * 2.0f;
+
+		boxes.push_back(box);
+	}
+}
+
+
+// ClassLabels
+const std::vector<std::string>& SyntheticSource::ClassLabels()
+{
+	static const std::vector<std::string> labels = { "box", "disc" };
+	return labels;
+}
+
+
+// ParseFormat
+bool SyntheticSource::ParseFormat( const char* str, Format& format )
+{
+	if( !str )
+		return false;
+
+	if( strcasecmp(str, "rgb8") == 0 || strcasecmp(str, "rgb") == 0 )
+		format = RGB8;
+	else if( strcasecmp(str, "i420") == 0 || strcasecmp(str, "yuv") == 0 )
+		format = I420;
+	else
+		return false;
+
+	return true;
+}
+
+
+// FormatToStr
+const char* SyntheticSource::FormatToStr( Format format )
+{
+	return (format == I420) ? "i420" : "rgb8";
+}
+
+
+// Usage
+const char* SyntheticSource::Usage()
+{
+	return "synthetic source arguments:\n"
+		  "  synthetic://WxH@FPS        generate frames of moving shapes instead of using\n"
+		  "                             a camera (default synthetic://1280x720@30)\n"
+		  "  --synthetic-format=FMT     rgb8 or i420 (converted to RGB on the GPU)\n"
+		  "  --synthetic-shapes=N       number of shapes (default 6)\n"
+		  "  --synthetic-seed=N         seed of the shapes and background (default 0)\n\n";
+}
+
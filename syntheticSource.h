@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_SYNTHETIC_SOURCE__
+#define __CAMERA_SYNTHETIC_SOURCE__
+
+#include "annotationModel.h"
+#include "cudaUtility.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <chrono>
+
+
+/*
+ * Source of generated frames, for benchmarking and testing without a camera
+ * (the input URI is synthetic://WIDTHxHEIGHT@FPS, i.e. synthetic://1280x720@30).
+ *
+ * The frames are a textured background with shapes that bounce around it.
+ * The shapes move for MoveFrames and then hold still for StillFrames, so
+ * that both the motion and the duplicate frames are exercised.  A frame only
+ * depends on its index and the seed, so every run produces the same frames,
+ * and the boxes of the shapes are known (see GetBoxes()).
+ *
+ * In the I420 format, the frames are drawn in YUV and converted to RGB on
+ * the GPU, like a camera that outputs YUV.  The frames are paced at the
+ * frame rate, or produced as fast as possible if it's zero.
+ */
+class SyntheticSource
+{
+public:
+	// pixel format that the frames are generated in
+	enum Format
+	{
+		RGB8 = 0,
+		I420
+	};
+
+	// create a source from a synthetic:// URI
+	static SyntheticSource* Create( const char* uri, Format format=RGB8, int numShapes=DefaultShapes, uint32_t seed=0 );
+
+	// create a source with the given dimensions and rate (0 is unthrottled)
+	static SyntheticSource* Create( int width, int height, float frameRate, Format format=RGB8, int numShapes=DefaultShapes, uint32_t seed=0 );
+
+	// destructor
+	~SyntheticSource();
+
+	// generate the next frame (the image stays valid for the next NumBuffers-1 captures)
+	bool Capture( uchar3** image );
+
+	// jump to a frame, so that the next Capture() generates it again
+	void Seek( uint64_t frame );
+
+	// the boxes of the shapes in the last frame (the class IDs index ClassLabels())
+	void GetBoxes( std::vector<BoundingBox>& boxes ) const;
+
+	// the labels of the shape classes
+	static const std::vector<std::string>& ClassLabels();
+
+	// frame dimensions and rate
+	inline int GetWidth() const				{ return width; }
+	inline int GetHeight() const				{ return height; }
+	inline float GetFrameRate() const			{ return frameRate; }
+	inline Format GetFormat() const			{ return format; }
+
+	// number of frames generated
+	inline uint64_t GetFrameCount() const			{ return frameCount; }
+
+	// is the URI a synthetic source?
+	static bool IsSynthetic( const char* uri );
+
+	// parse a format string (rgb8 or i420), returns false if it's invalid
+	static bool ParseFormat( const char* str, Format& format );
+	static const char* FormatToStr( Format format );
+
+	// usage string for the command line arguments
+	static const char* Usage();
+
+	// default number of shapes
+	static const int DefaultShapes = 6;
+
+	// motion cycle of the shapes (in frames)
+	static const int MoveFrames  = 60;
+	static const int StillFrames = 30;
+
+	// number of frames in flight
+	static const int NumBuffers = 4;
+
+protected:
+	SyntheticSource();
+	bool init( int width, int height, float frameRate, Format format, int numShapes, uint32_t seed );
+
+	void render( uint64_t frame, uint8_t* pixels );
+
+	struct Shape
+	{
+		int   classID;		// 0 = box, 1 = disc
+		float x;			// initial center
+		float y;
+		float vx;			// pixels per frame
+		float vy;
+		float size;		// half the width/height (or the radius)
+		uint8_t color[3];	// RGB or YUV, depending on the format
+	};
+
+	// center of a shape in a frame
+	void position( const Shape& shape, uint64_t frame, float& x, float& y ) const;
+
+	int width;
+	int height;
+	float frameRate;
+	Format format;
+
+	std::vector<Shape> shapes;
+	std::vector<uint8_t> background;	// in the format of the frames
+
+	uchar3*  buffers[NumBuffers];		// RGB output (mapped memory)
+	uint8_t* yuv;				// I420 frame before the conversion
+
+	uint64_t frameCount;
+	std::chrono::steady_clock::time_point startTime;
+};
+
+#endif
+
@@ -0,0 +1,419 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "thumbnailCache.h"
+#include "tracer.h"
+
+#include <algorithm>
+#include <utime.h>
+
+#ifdef HAS_LIBJPEG
+#include <stdio.h>
+#include <setjmp.h>
+#include <jpeglib.h>
+#endif
+
+
+// thumbnail dimensions of each level
+static const int levelSizes[ThumbnailCache::NumLevels] = { 128, 640 };
+
+
+// constructor
+ThumbnailCache::ThumbnailCache( int memoryBudgetMB, int diskBudgetMB, QObject* parent ) : QObject(parent)
+{
+	stopping = false;
+
+	memory.setMaxCost(qMax(memoryBudgetMB, 1) * 1024);
+
+	cacheDir = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/camera-capture/thumbnails";
+
+	for( int n=0; n < NumLevels; n++ )
+		QDir().mkpath(cacheDir + QString("/%1").arg(levelSizes[n]));
+
+	connect(this, SIGNAL(decoded(const QString&, const QImage&, const QImage&)),
+		   this, SLOT(onDecoded(const QString&, const QImage&, const QImage&)), Qt::QueuedConnection);
+
+	// leave a core for the UI and the camera
+	const int numThreads = qBound(1, QThread::idealThreadCount() - 1, 4);
+
+	for( int n=0; n < numThreads; n++ )
+		threads.push_back(std::thread(&ThumbnailCache::run, this));
+
+	// the thumbnails of old datasets (or of images that were modified) would otherwise stay forever
+	threads.push_back(std::thread(&ThumbnailCache::prune, this, (qint64)qMax(diskBudgetMB, 0) * 1024 * 1024));
+}
+
+
+// destructor
+ThumbnailCache::~ThumbnailCache()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		pending.clear();
+	}
+
+	condition.notify_all();
+
+	for( size_t n=0; n < threads.size(); n++ )
+		threads[n].join();
+}
+
+
+// GetLevelSize
+int ThumbnailCache::GetLevelSize( int level )
+{
+	return levelSizes[qBound(0, level, (int)NumLevels - 1)];
+}
+
+
+// cacheKey
+QString ThumbnailCache::cacheKey( const QString& path, int level ) const
+{
+	return QString::number(level) + path;
+}
+
+
+// diskPath
+QString ThumbnailCache::diskPath( const QString& path, int level ) const
+{
+	// the thumbnails are regenerated if the image is modified
+	const QFileInfo info(path);
+
+	const QByteArray key = (info.absoluteFilePath() + QString::number(info.lastModified().toMSecsSinceEpoch()) +
+					    QString::number(info.size())).toUtf8();
+
+	return cacheDir + QString("/%1/").arg(levelSizes[level]) + QCryptographicHash::hash(key, QCryptographicHash::Md5).toHex() + ".jpg";
+}
+
+
+// Get
+bool ThumbnailCache::Get( const QString& path, int level, QImage& image )
+{
+	const QImage* cached = memory.object(cacheKey(path, level));
+
+	if( cached != NULL )
+	{
+		image = *cached;
+		return true;
+	}
+
+	request(path, level, false);
+	return false;
+}
+
+
+// Prefetch
+void ThumbnailCache::Prefetch( const QString& path, int level )
+{
+	if( memory.contains(cacheKey(path, level)) )
+		return;
+
+	request(path, level, true);
+}
+
+
+// request
+void ThumbnailCache::request( const QString& path, int level, bool prefetch )
+{
+	const QString key = cacheKey(path, level);
+
+	if( requested.contains(key) )
+		return;
+
+	requested.insert(key);
+
+	Request req;
+
+	req.path  = path;
+	req.level = level;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		// the visible thumbnails are loaded first, newest first
+		if( prefetch )
+			pending.push_back(req);
+		else
+			pending.push_front(req);
+
+		// drop the oldest prefetches when scrolling quickly
+		while( pending.size() > MaxPending )
+		{
+			requested.remove(cacheKey(pending.back().path, pending.back().level));
+			pending.pop_back();
+		}
+	}
+
+	condition.notify_one();
+}
+
+
+// CancelAll
+void ThumbnailCache::CancelAll()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for( size_t n=0; n < pending.size(); n++ )
+		requested.remove(cacheKey(pending[n].path, pending[n].level));
+
+	pending.clear();
+}
+
+
+// onDecoded
+void ThumbnailCache::onDecoded( const QString& path, const QImage& small, const QImage& large )
+{
+	const QImage* images[NumLevels] = { &small, &large };
+	const bool failed = small.isNull() && large.isNull();
+
+	for( int n=0; n < NumLevels; n++ )
+	{
+		const QString key = cacheKey(path, n);
+		requested.remove(key);
+
+		// remember the images that failed to decode, so they aren't retried on every repaint
+		if( failed )
+			memory.insert(key, new QImage(), 1);
+
+		if( images[n]->isNull() )
+			continue;
+
+		memory.insert(key, new QImage(*images[n]), qMax(1, images[n]->byteCount() / 1024));
+		emit thumbnailReady(path, n);
+	}
+}
+
+
+// run
+void ThumbnailCache::run()
+{
+	Tracer::SetThreadName("thumbnails");
+
+	while( true )
+	{
+		Request req;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+
+			while( !stopping && pending.size() == 0 )
+				condition.wait(lock);
+
+			if( stopping )
+				return;
+
+			req = pending.front();
+			pending.pop_front();
+		}
+
+		load(req);
+	}
+}
+
+
+// load
+void ThumbnailCache::load( const Request& req )
+{
+	// check the disk cache first
+	const QString thumbnailPath = diskPath(req.path, req.level);
+
+	QImage image;
+
+	if( image.load(thumbnailPath, "JPG") )
+	{
+		// the modification time orders the thumbnails for pruning, so it's updated when they're used
+		utime(thumbnailPath.toUtf8().constData(), NULL);
+
+		emit decoded(req.path, (req.level == Small) ? image : QImage(), (req.level == Large) ? image : QImage());
+		return;
+	}
+
+	// decode the image once at the largest size, and generate all the levels from it
+	const QImage fullImage = DecodeJPEG(req.path, levelSizes[Large]);
+
+	if( fullImage.isNull() )
+	{
+		printf("camera-capture:  failed to decode %s\n", req.path.toUtf8().constData());
+		emit decoded(req.path, QImage(), QImage());
+		return;
+	}
+
+	QImage thumbnails[NumLevels];
+
+	for( int n=NumLevels-1; n >= 0; n-- )
+	{
+		const QImage& source = (n == NumLevels-1) ? fullImage : thumbnails[n+1];
+
+		if( source.width() > levelSizes[n] || source.height() > levelSizes[n] )
+			thumbnails[n] = source.scaled(levelSizes[n], levelSizes[n], Qt::KeepAspectRatio, Qt::SmoothTransformation);
+		else
+			thumbnails[n] = source;
+
+		thumbnails[n].save(diskPath(req.path, n), "JPG", 85);
+	}
+
+	emit decoded(req.path, thumbnails[Small], thumbnails[Large]);
+}
+
+
+// prune
+void ThumbnailCache::prune( qint64 budget )
+{
+	Tracer::SetThreadName("thumbnails");
+
+	// the destructor waits for this thread, so it stops early when the app is closed
+	auto isStopping = [this]()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return stopping;
+	};
+
+	QFileInfoList files;
+
+	for( int n=0; n < NumLevels; n++ )
+	{
+		QDirIterator iter(cacheDir + QString("/%1").arg(levelSizes[n]), QStringList("*.jpg"), QDir::Files);
+
+		while( iter.hasNext() )
+		{
+			iter.next();
+			files.append(iter.fileInfo());
+
+			if( (files.size() % 256) == 0 && isStopping() )
+				return;
+		}
+	}
+
+	if( isStopping() )
+		return;
+
+	// keep the most recently used thumbnails that fit in the budget
+	std::sort(files.begin(), files.end(), [](const QFileInfo& a, const QFileInfo& b) { return a.lastModified() > b.lastModified(); });
+
+	const QDateTime oldest = QDateTime::currentDateTime().addDays(-MaxDiskAge);
+
+	qint64 size = 0;
+	int removed = 0;
+
+	for( int n=0; n < files.size(); n++ )
+	{
+		if( (n % 256) == 0 && isStopping() )
+			break;
+
+		size += files[n].size();
+
+		if( size <= budget && files[n].lastModified() >= oldest )
+			continue;
+
+		if( QFile::remove(files[n].filePath()) )
+			removed++;
+	}
+
+	if( removed > 0 )
+		printf("camera-capture:  removed %i of %i thumbnails from %s\n", removed, files.size(), cacheDir.toUtf8().constData());
+}
+
+
+#ifdef HAS_LIBJPEG
+// libjpeg error handler
+struct jpegErrorManager
+{
+	struct jpeg_error_mgr pub;
+	jmp_buf jump;
+};
+
+static void jpegErrorExit( j_common_ptr cinfo )
+{
+	longjmp(((jpegErrorManager*)cinfo->err)->jump, 1);
+}
+#endif
+
+
+// DecodeJPEG
+QImage ThumbnailCache::DecodeJPEG( const QString& path, int minSize )
+{
+#ifdef HAS_LIBJPEG
+	FILE* file = fopen(path.toUtf8().constData(), "rb");
+
+	if( !file )
+		return QImage();
+
+	struct jpeg_decompress_struct cinfo;
+	jpegErrorManager jerr;
+
+	cinfo.err = jpeg_std_error(&jerr.pub);
+	jerr.pub.error_exit = jpegErrorExit;
+
+	QImage image;
+
+	if( setjmp(jerr.jump) )
+	{
+		jpeg_destroy_decompress(&cinfo);
+		fclose(file);
+		return QImage();
+	}
+
+	jpeg_create_decompress(&cinfo);
+	jpeg_stdio_src(&cinfo, file);
+	jpeg_read_header(&cinfo, TRUE);
+
+	// let the IDCT do the downscaling (1/2, 1/4 or 1/8)
+	const unsigned int maxDim = qMax(cinfo.image_width, cinfo.image_height);
+
+	cinfo.scale_num   = 1;
+	cinfo.scale_denom = 1;
+
+	while( cinfo.scale_denom < 8 && maxDim / (cinfo.scale_denom * 2) >= (unsigned int)minSize )
+		cinfo.scale_denom *= 2;
+
+	cinfo.out_color_space     = JCS_RGB;
+	cinfo.dct_method          = JDCT_IFAST;
+	cinfo.do_fancy_upsampling = FALSE;
+
+	jpeg_start_decompress(&cinfo);
+
+	image = QImage(cinfo.output_width, cinfo.output_height, QImage::Format_RGB888);
+
+	while( cinfo.output_scanline < cinfo.output_height )
+	{
+		JSAMPROW row = image.scanLine(cinfo.output_scanline);
+		jpeg_read_scanlines(&cinfo, &row, 1);
+	}
+
+	jpeg_finish_decompress(&cinfo);
+	jpeg_destroy_decompress(&cinfo);
+	fclose(file);
+
+	return image;
+#else
+	// Qt's JPEG plugin also uses DCT scaling when a scaled size is set
+	QImageReader reader(path);
+	const QSize size = reader.size();
+
+	if( size.isValid() && (size.width() > minSize || size.height() > minSize) )
+		reader.setScaledSize(size.scaled(minSize, minSize, Qt::KeepAspectRatio));
+
+	return reader.read();
+#endif
+}
+
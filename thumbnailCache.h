@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_THUMBNAIL_CACHE__
+#define __CAMERA_THUMBNAIL_CACHE__
+
+#include <QtWidgets>
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+/*
+ * Thumbnail cache of the images in a dataset.
+ *
+ * The thumbnails are decoded in background threads, kept in memory up to
+ * a fixed budget (least recently used are evicted first), and stored on
+ * disk under ~/.cache/camera-capture/thumbnails so they only have to be
+ * decoded from the full images once.  Each image has a small and a large
+ * thumbnail, which are generated together from one reduced-scale decode.
+ * The disk cache is pruned when it's opened, least recently used first.
+ */
+class ThumbnailCache : public QObject
+{
+	Q_OBJECT
+
+public:
+	// thumbnail sizes
+	enum Level
+	{
+		Small = 0,	// for the grid
+		Large,		// for the preview
+		NumLevels
+	};
+
+	// constructor
+	ThumbnailCache( int memoryBudgetMB=DefaultMemoryBudget, int diskBudgetMB=DefaultDiskBudget, QObject* parent=NULL );
+
+	// destructor
+	~ThumbnailCache();
+
+	// get a thumbnail if it's in memory, otherwise it gets queued (returns false)
+	bool Get( const QString& path, int level, QImage& image );
+
+	// queue a thumbnail to be loaded ahead of time (at a lower priority)
+	void Prefetch( const QString& path, int level );
+
+	// drop the queued requests (i.e. when changing datasets)
+	void CancelAll();
+
+	// maximum dimension of each level (in pixels)
+	static int GetLevelSize( int level );
+
+	// decode a JPEG at a reduced scale that is at least minSize on its longest side
+	static QImage DecodeJPEG( const QString& path, int minSize );
+
+	// default memory budget (in MB)
+	static const int DefaultMemoryBudget = 64;
+
+	// default disk budget (in MB)
+	static const int DefaultDiskBudget = 256;
+
+	// the thumbnails on disk that weren't used for this many days are removed
+	static const int MaxDiskAge = 30;
+
+	// maximum number of requests in the queue (the oldest prefetches are dropped)
+	static const size_t MaxPending = 256;
+
+signals:
+	// a requested thumbnail is ready
+	void thumbnailReady( const QString& path, int level );
+
+	// used internally to pass the thumbnails from the worker threads
+	void decoded( const QString& path, const QImage& small, const QImage& large );
+
+protected slots:
+	void onDecoded( const QString& path, const QImage& small, const QImage& large );
+
+protected:
+	struct Request
+	{
+		QString path;
+		int     level;
+	};
+
+	void request( const QString& path, int level, bool prefetch );
+	void run();
+	void load( const Request& req );
+	void prune( qint64 budget );
+
+	QString diskPath( const QString& path, int level ) const;
+	QString cacheKey( const QString& path, int level ) const;
+
+	QCache<QString, QImage> memory;	// cost is in KB
+	QSet<QString> requested;			// queued or being loaded (by cache key)
+	QString cacheDir;
+
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<Request> pending;		// requests from the views are at the front
+	bool stopping;
+};
+
+#endif
+
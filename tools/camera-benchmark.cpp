@@ -0,0 +1,498 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "syntheticSource.h"
+#include "datasetWriter.h"
+#include "diversityIndex.h"
+#include "frameSignature.h"
+#include "metrics.h"
+
+#include "cudaMappedMemory.h"
+#include "imageIO.h"
+#include "commandLine.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+
+int usage()
+{
+	printf("usage: camera-benchmark [-h] [output]\n\n");
+	printf("Measure the throughput of the capture pipeline (capture, snapshot, encode,\n");
+	printf("annotate, and write) on synthetic frames, without a camera or a display\n\n");
+	printf("positional arguments:\n");
+	printf("  output             directory of the datasets (default /tmp/camera-benchmark)\n\n");
+	printf("optional arguments:\n");
+	printf("  --help             show this help message and exit\n");
+	printf("  --sizes=LIST       frame sizes (default 640x480,1280x720,1920x1080)\n");
+	printf("  --formats=LIST     formats of the synthetic frames, rgb8 and/or i420 (default rgb8)\n");
+	printf("  --quality=LIST     JPEG qualities (default 95)\n");
+	printf("  --frames=N         frames per configuration (default 300)\n");
+	printf("  --warmup=N         frames run before the measurements (default 10)\n");
+	printf("  --rate=FPS         rate of the synthetic frames (default 0, unthrottled)\n");
+	printf("  --shapes=N         number of moving shapes (default 6)\n");
+	printf("  --novelty=DIST     skip the frames closer than this to the dataset (default 0, off)\n");
+	printf("  --stages           print the latency of each stage\n");
+	printf("  --label=NAME       name of the run in the CSV file (i.e. the release)\n");
+	printf("  --csv=FILE         append the results to a CSV file\n\n");
+
+	return 0;
+}
+
+
+// splitList (comma-separated)
+static std::vector<std::string> splitList( const char* str )
+{
+	std::vector<std::string> items;
+	std::string item;
+
+	for( const char* c=str; ; c++ )
+	{
+		if( *c == ',' || *c == '\0' )
+		{
+			if( item.size() > 0 )
+				items.push_back(item);
+
+			item.clear();
+
+			if( *c == '\0' )
+				break;
+		}
+		else
+		{
+			item += *c;
+		}
+	}
+
+	return items;
+}
+
+
+// directorySize (in bytes, recursive)
+static uint64_t directorySize( const std::string& path )
+{
+	DIR* dir = opendir(path.c_str());
+
+	if( !dir )
+		return 0;
+
+	uint64_t size = 0;
+	struct dirent* entry = NULL;
+
+	while( (entry = readdir(dir)) != NULL )
+	{
+		if( strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0 )
+			continue;
+
+		const std::string entryPath = path + "/" + entry->d_name;
+		struct stat info;
+
+		if( stat(entryPath.c_str(), &info) != 0 )
+			continue;
+
+		if( S_ISDIR(info.st_mode) )
+			size += directorySize(entryPath);
+		else
+			size += info.st_size;
+	}
+
+	closedir(dir);
+	return size;
+}
+
+
+/*
+ * Configuration of a benchmark run, and its results
+ */
+struct BenchConfig
+{
+	int width;
+	int height;
+	int quality;
+
+	SyntheticSource::Format format;
+
+	std::string Name() const
+	{
+		char str[64];
+		sprintf(str, "%ix%i-%s-q%i", width, height, SyntheticSource::FormatToStr(format), quality);
+		return str;
+	}
+};
+
+enum BenchStage
+{
+	STAGE_CAPTURE = 0,
+	STAGE_SNAPSHOT,
+	STAGE_DEDUPE,
+	STAGE_ENCODE,		// encodes and writes the image
+	STAGE_ANNOTATE,
+	STAGE_WRITE,		// appends to the image sets (and the index)
+	STAGE_TOTAL,
+	NUM_STAGES
+};
+
+static const char* stageNames[] = { "capture", "snapshot", "dedupe", "encode", "annotate", "write", "total" };
+
+struct BenchResult
+{
+	int saved;
+	int skipped;
+	double seconds;
+	uint64_t bytes;
+
+	std::vector<uint64_t> latencies[NUM_STAGES];	// nanoseconds, per saved frame
+
+	// the latency below which the given fraction of the frames fall (in milliseconds)
+	double Quantile( int stage, double fraction ) const
+	{
+		const std::vector<uint64_t>& values = latencies[stage];
+
+		if( values.size() == 0 )
+			return 0.0;
+
+		std::vector<uint64_t> sorted(values);
+		std::sort(sorted.begin(), sorted.end());
+
+		const size_t rank = std::min((size_t)(fraction * sorted.size()), sorted.size() - 1);
+		return sorted[rank] * 1e-6;
+	}
+
+	// frames processed per second (saved or skipped)
+	double FrameRate() const			{ return (seconds > 0.0) ? (saved + skipped) / seconds : 0.0; }
+};
+
+
+// runConfig
+static bool runConfig( const BenchConfig& config, const std::string& dataset, commandLine& cmdLine, BenchResult& result )
+{
+	const int numFrames = std::max(cmdLine.GetInt("frames", 300), 1);
+	const int warmup    = std::max(cmdLine.GetInt("warmup", 10), 0);
+	const float novelty = cmdLine.GetFloat("novelty", 0.0f);
+
+	SyntheticSource* source = SyntheticSource::Create(config.width, config.height, cmdLine.GetFloat("rate", 0.0f), config.format,
+										    cmdLine.GetInt("shapes", SyntheticSource::DefaultShapes));
+
+	if( !source )
+		return false;
+
+	if( !DatasetWriter::CreateDetectionDirectories(dataset) )
+	{
+		delete source;
+		return false;
+	}
+
+	DiversityIndex index;
+
+	if( novelty > 0.0f && !index.Open(dataset) )
+	{
+		delete source;
+		return false;
+	}
+
+	// the frame is copied when it's frozen, so the camera can keep going
+	const size_t imageSize = config.width * config.height * sizeof(uchar3);
+	uchar3* snapshot = NULL;
+
+	if( !cudaAllocMapped((void**)&snapshot, imageSize) )
+	{
+		delete source;
+		return false;
+	}
+
+	const std::vector<std::string>& classLabels = SyntheticSource::ClassLabels();
+
+	AnnotationModel annotations;
+	std::vector<BoundingBox> boxes;
+	FrameSignature signature;
+
+	result.saved   = 0;
+	result.skipped = 0;
+	result.bytes   = 0;
+	result.seconds = 0.0;
+
+	uint64_t start = 0;
+	bool success = true;
+
+	for( int n=0; n < warmup + numFrames; n++ )
+	{
+		if( n == warmup )
+		{
+			result.bytes = directorySize(dataset);
+			start = Metrics::Now();
+		}
+
+		uint64_t times[NUM_STAGES + 1];
+
+		// capture
+		times[STAGE_CAPTURE] = Metrics::Now();
+		uchar3* image = NULL;
+
+		if( !source->Capture(&image) )
+		{
+			success = false;
+			break;
+		}
+
+		CUDA(cudaDeviceSynchronize());
+
+		// snapshot
+		times[STAGE_SNAPSHOT] = Metrics::Now();
+
+		memcpy(snapshot, image, imageSize);
+		source->GetBoxes(boxes);
+
+		// dedupe
+		times[STAGE_DEDUPE] = Metrics::Now();
+
+		if( novelty > 0.0f )
+		{
+			signature.Compute(snapshot, config.width, config.height);
+
+			if( index.Nearest(signature) < novelty )
+			{
+				if( n >= warmup )
+					result.skipped++;
+
+				continue;
+			}
+		}
+
+		// encode
+		times[STAGE_ENCODE] = Metrics::Now();
+
+		const std::string name = DatasetWriter::SampleName();
+		const std::string imgPath = DatasetWriter::ImagePath(dataset, name);
+
+		if( !saveImage(imgPath.c_str(), snapshot, config.width, config.height, config.quality) )
+		{
+			success = false;
+			break;
+		}
+
+		// annotate
+		times[STAGE_ANNOTATE] = Metrics::Now();
+
+		annotations.Load(boxes);
+
+		if( !DatasetWriter::SaveAnnotations(dataset, name, config.width, config.height, annotations, classLabels) )
+		{
+			success = false;
+			break;
+		}
+
+		// write
+		times[STAGE_WRITE] = Metrics::Now();
+
+		if( !DatasetWriter::AddToImageSets(dataset, "train", name) )
+		{
+			success = false;
+			break;
+		}
+
+		if( novelty > 0.0f )
+			index.Add(imgPath, signature);
+
+		times[STAGE_TOTAL] = Metrics::Now();
+
+		if( n < warmup )
+			continue;
+
+		for( int s=0; s < STAGE_TOTAL; s++ )
+			result.latencies[s].push_back(times[s+1] - times[s]);
+
+		result.latencies[STAGE_TOTAL].push_back(times[STAGE_TOTAL] - times[STAGE_CAPTURE]);
+		result.saved++;
+	}
+
+	result.seconds = (Metrics::Now() - start) * 1e-9;
+	result.bytes   = directorySize(dataset) - result.bytes;
+
+	CUDA(cudaFreeHost(snapshot));
+	delete source;
+
+	return success;
+}
+
+
+int main( int argc, char** argv )
+{
+	/*
+	 * parse command line
+	 */
+	commandLine cmdLine(argc, argv);
+
+	if( cmdLine.GetFlag("help") )
+		return usage();
+
+	const std::string output = (cmdLine.GetPositionArgs() > 0) ? cmdLine.GetPosition(0) : "/tmp/camera-benchmark";
+	const char* csvPath = cmdLine.GetString("csv");
+
+	const std::vector<std::string> sizes     = splitList(cmdLine.GetString("sizes", "640x480,1280x720,1920x1080"));
+	const std::vector<std::string> formats   = splitList(cmdLine.GetString("formats", "rgb8"));
+	const std::vector<std::string> qualities = splitList(cmdLine.GetString("quality", "95"));
+
+	std::vector<BenchConfig> configs;
+
+	for( size_t s=0; s < sizes.size(); s++ )
+	{
+		for( size_t f=0; f < formats.size(); f++ )
+		{
+			for( size_t q=0; q < qualities.size(); q++ )
+			{
+				BenchConfig config;
+
+				if( sscanf(sizes[s].c_str(), "%ix%i", &config.width, &config.height) != 2 )
+				{
+					printf("camera-benchmark:  invalid size %s (should be WIDTHxHEIGHT)\n", sizes[s].c_str());
+					return 1;
+				}
+
+				if( !SyntheticSource::ParseFormat(formats[f].c_str(), config.format) )
+				{
+					printf("camera-benchmark:  invalid format %s (should be rgb8 or i420)\n", formats[f].c_str());
+					return 1;
+				}
+
+				config.quality = atoi(qualities[q].c_str());
+				configs.push_back(config);
+			}
+		}
+	}
+
+	// each run gets its own datasets, so the results don't depend on earlier runs
+	const std::string runPath = output + "/" + DatasetWriter::Timestamp();
+
+
+	/*
+	 * run each configuration
+	 */
+	std::vector<BenchResult> results(configs.size());
+
+	for( size_t n=0; n < configs.size(); n++ )
+	{
+		printf("camera-benchmark:  running %s...\n", configs[n].Name().c_str());
+
+		if( !runConfig(configs[n], runPath + "/" + configs[n].Name(), cmdLine, results[n]) )
+		{
+			printf("camera-benchmark:  failed to run %s\n", configs[n].Name().c_str());
+			return 1;
+		}
+	}
+
+
+	/*
+	 * print the results
+	 */
+	printf("\n%-24s %10s %9s %9s %12s %7s %8s\n", "configuration", "frames/s", "p50 ms", "p99 ms", "MB written", "saved", "skipped");
+
+	for( size_t n=0; n < configs.size(); n++ )
+	{
+		const BenchResult& result = results[n];
+
+		printf("%-24s %10.1f %9.2f %9.2f %12.1f %7i %8i\n", configs[n].Name().c_str(), result.FrameRate(),
+			  result.Quantile(STAGE_TOTAL, 0.5), result.Quantile(STAGE_TOTAL, 0.99),
+			  result.bytes / (1024.0 * 1024.0), result.saved, result.skipped);
+	}
+
+	if( cmdLine.GetFlag("stages") )
+	{
+		printf("\n%-24s", "p50/p99 ms");
+
+		for( int s=0; s < STAGE_TOTAL; s++ )
+			printf(" %15s", stageNames[s]);
+
+		printf("\n");
+
+		for( size_t n=0; n < configs.size(); n++ )
+		{
+			printf("%-24s", configs[n].Name().c_str());
+
+			for( int s=0; s < STAGE_TOTAL; s++ )
+			{
+				char str[32];
+				sprintf(str, "%.2f/%.2f", results[n].Quantile(s, 0.5), results[n].Quantile(s, 0.99));
+				printf(" %15s", str);
+			}
+
+			printf("\n");
+		}
+	}
+
+	printf("\ncamera-benchmark:  the datasets were written to %s\n", runPath.c_str());
+
+
+	/*
+	 * append the results to the CSV file
+	 */
+	if( csvPath != NULL )
+	{
+		struct stat info;
+		const bool exists = (stat(csvPath, &info) == 0 && info.st_size > 0);
+
+		FILE* file = fopen(csvPath, "a");
+
+		if( !file )
+		{
+			printf("camera-benchmark:  failed to open %s\n", csvPath);
+			return 1;
+		}
+
+		if( !exists )
+		{
+			fprintf(file, "label,timestamp,width,height,format,quality,frames_per_sec,p50_ms,p99_ms,bytes_written,saved,skipped");
+
+			for( int s=0; s < STAGE_TOTAL; s++ )
+				fprintf(file, ",%s_p50_ms,%s_p99_ms", stageNames[s], stageNames[s]);
+
+			fprintf(file, "\n");
+		}
+
+		for( size_t n=0; n < configs.size(); n++ )
+		{
+			const BenchConfig& config = configs[n];
+			const BenchResult& result = results[n];
+
+			fprintf(file, "%s,%s,%i,%i,%s,%i,%.2f,%.3f,%.3f,%llu,%i,%i", cmdLine.GetString("label", ""), DatasetWriter::Timestamp().c_str(),
+				   config.width, config.height, SyntheticSource::FormatToStr(config.format), config.quality,
+				   result.FrameRate(), result.Quantile(STAGE_TOTAL, 0.5), result.Quantile(STAGE_TOTAL, 0.99),
+				   (unsigned long long)result.bytes, result.saved, result.skipped);
+
+			for( int s=0; s < STAGE_TOTAL; s++ )
+				fprintf(file, ",%.3f,%.3f", result.Quantile(s, 0.5), result.Quantile(s, 0.99));
+
+			fprintf(file, "\n");
+		}
+
+		fclose(file);
+		printf("camera-benchmark:  appended the results to %s\n", csvPath);
+	}
+
+	return 0;
+}
+
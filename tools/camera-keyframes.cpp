@@ -0,0 +1,582 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "datasetWriter.h"
+#include "frameSignature.h"
+
+#include "videoSource.h"
+#include "cudaMappedMemory.h"
+#include "imageIO.h"
+#include "commandLine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <iterator>
+
+#include <dirent.h>
+#include <strings.h>
+#include <string.h>
+#include <sys/stat.h>
+
+
+int usage()
+{
+	printf("usage: camera-keyframes [-h] input output\n\n");
+	printf("Extract the visually distinct frames of a recording into a dataset\n\n");
+	printf("positional arguments:\n");
+	printf("  input              video file or directory of images\n");
+	printf("  output             path to the dataset\n\n");
+	printf("optional arguments:\n");
+	printf("  --help             show this help message and exit\n");
+	printf("  --type=TYPE        detection or classification (default detection)\n");
+	printf("  --class=LABEL      class of the frames (required for classification)\n");
+	printf("  --set=SET          train, val, or test (default train)\n");
+	printf("  --merge-sets       add the frames to all of the sets (detection only)\n");
+	printf("  --threshold=X      minimum change score of a keyframe, 0 to 1 (default 0.1)\n");
+	printf("  --min-gap=N        minimum number of frames between keyframes (default 30)\n");
+	printf("  --max-count=N      maximum number of keyframes (default unlimited)\n");
+	printf("  --threads=N        number of worker threads (default all cores)\n");
+	printf("  --quality=N        JPEG quality of the saved frames (default 95)\n\n");
+
+	return 0;
+}
+
+
+// elapsed seconds
+static double elapsed( const std::chrono::steady_clock::time_point& start )
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+// isImageFile
+static bool isImageFile( const char* filename )
+{
+	static const char* extensions[] = { ".jpg", ".jpeg", ".png", ".bmp", ".tga", ".gif" };
+
+	const char* ext = strrchr(filename, '.');
+
+	if( !ext )
+		return false;
+
+	for( size_t n=0; n < sizeof(extensions) / sizeof(extensions[0]); n++ )
+	{
+		if( strcasecmp(ext, extensions[n]) == 0 )
+			return true;
+	}
+
+	return false;
+}
+
+
+// listImages
+static bool listImages( const std::string& path, std::vector<std::string>& files )
+{
+	DIR* dir = opendir(path.c_str());
+
+	if( !dir )
+		return false;
+
+	struct dirent* entry = NULL;
+
+	while( (entry = readdir(dir)) != NULL )
+	{
+		if( isImageFile(entry->d_name) )
+			files.push_back(path + "/" + entry->d_name);
+	}
+
+	closedir(dir);
+
+	std::sort(files.begin(), files.end());
+	return true;
+}
+
+
+// runSegments (split [0, count) into contiguous segments, one per thread)
+static void runSegments( int count, int numThreads, const std::function<void(int)>& func )
+{
+	std::vector<std::thread> threads;
+
+	for( int t=0; t < numThreads; t++ )
+	{
+		const int first = (int64_t)count * t / numThreads;
+		const int last  = (int64_t)count * (t + 1) / numThreads;
+
+		threads.push_back(std::thread([first, last, &func]()
+		{
+			for( int n=first; n < last; n++ )
+				func(n);
+		}));
+	}
+
+	for( size_t t=0; t < threads.size(); t++ )
+		threads[t].join();
+}
+
+
+/*
+ * Work queue of the frames decoded from a video, which are processed
+ * by a pool of threads (the decoder only runs on the main thread).
+ */
+struct FrameJob
+{
+	int index;
+	int width;
+	int height;
+
+	std::vector<uchar3> pixels;
+};
+
+class FrameQueue
+{
+public:
+	FrameQueue( int numThreads, const std::function<void(FrameJob&)>& func ) : process(func)
+	{
+		stopping = false;
+		maxPending = numThreads * 2;
+
+		for( int n=0; n < numThreads; n++ )
+			threads.push_back(std::thread(&FrameQueue::run, this));
+	}
+
+	~FrameQueue()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+
+		condition.notify_all();
+
+		for( size_t n=0; n < threads.size(); n++ )
+			threads[n].join();
+
+		for( size_t n=0; n < unused.size(); n++ )
+			delete unused[n];
+	}
+
+	// get an unused job (the buffers are recycled, so they aren't reallocated for each frame)
+	FrameJob* Acquire()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		// the decoder waits when the workers fall behind
+		while( pending.size() >= maxPending )
+			condition.wait(lock);
+
+		if( unused.size() == 0 )
+			return new FrameJob();
+
+		FrameJob* job = unused.back();
+		unused.pop_back();
+		return job;
+	}
+
+	void Submit( FrameJob* job )
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pending.push_back(job);
+		}
+
+		condition.notify_all();
+	}
+
+protected:
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while( true )
+		{
+			while( !stopping && pending.size() == 0 )
+				condition.wait(lock);
+
+			// the remaining jobs are finished before stopping
+			if( pending.size() == 0 )
+				break;
+
+			FrameJob* job = pending.front();
+			pending.pop_front();
+
+			condition.notify_all();
+			lock.unlock();
+
+			process(*job);
+
+			lock.lock();
+			unused.push_back(job);
+		}
+	}
+
+	std::function<void(FrameJob&)> process;
+
+	std::deque<FrameJob*> pending;
+	std::vector<FrameJob*> unused;
+
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable condition;
+
+	size_t maxPending;
+	bool stopping;
+};
+
+
+// decodeVideo (calls func on the main thread with each decoded frame, until it returns false)
+static int decodeVideo( const std::string& path, const std::function<bool(int, uchar3*, int, int)>& func, float* frameRate=NULL )
+{
+	videoSource* video = videoSource::Create(path.c_str());
+
+	if( !video )
+	{
+		printf("camera-keyframes:  failed to open %s\n", path.c_str());
+		return -1;
+	}
+
+	if( frameRate != NULL )
+		*frameRate = video->GetFrameRate();
+
+	int index = 0;
+
+	while( true )
+	{
+		uchar3* image = NULL;
+
+		if( !video->Capture(&image, 1000) )
+		{
+			if( !video->IsStreaming() )
+				break;
+
+			continue;
+		}
+
+		// the frame is read from the CPU
+		CUDA(cudaDeviceSynchronize());
+
+		if( !func(index++, image, video->GetWidth(), video->GetHeight()) )
+			break;
+	}
+
+	delete video;
+	return index;
+}
+
+
+int main( int argc, char** argv )
+{
+	/*
+	 * parse command line
+	 */
+	commandLine cmdLine(argc, argv);
+
+	if( cmdLine.GetFlag("help") || cmdLine.GetPositionArgs() < 2 )
+		return usage();
+
+	const std::string input  = cmdLine.GetPosition(0);
+	const std::string output = cmdLine.GetPosition(1);
+
+	const std::string type = cmdLine.GetString("type", "detection");
+	const std::string set  = cmdLine.GetString("set", "train");
+	const std::string classLabel = cmdLine.GetString("class", "");
+
+	const bool  mergeSets = cmdLine.GetFlag("merge-sets");
+	const float threshold = cmdLine.GetFloat("threshold", 0.1f);
+	const int   minGap    = std::max(cmdLine.GetInt("min-gap", 30), 1);
+	const int   maxCount  = cmdLine.GetInt("max-count", 0);
+	const int   quality   = cmdLine.GetInt("quality", 95);
+	const int   threads   = std::max(cmdLine.GetInt("threads", std::thread::hardware_concurrency()), 1);
+
+	const bool classify = (type == "classification" || type == "classify");
+
+	if( !classify && type != "detection" )
+	{
+		printf("camera-keyframes:  invalid --type=%s (should be detection or classification)\n", type.c_str());
+		return 1;
+	}
+
+	if( classify && classLabel.size() == 0 )
+	{
+		printf("camera-keyframes:  --class is required for classification datasets\n");
+		return 1;
+	}
+
+	struct stat info;
+	const bool isDirectory = (stat(input.c_str(), &info) == 0 && S_ISDIR(info.st_mode));
+
+	std::vector<std::string> files;
+
+	if( isDirectory && (!listImages(input, files) || files.size() == 0) )
+	{
+		printf("camera-keyframes:  no images found in %s\n", input.c_str());
+		return 1;
+	}
+
+
+	/*
+	 * compute the signature of each frame
+	 */
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::vector<FrameSignature> signatures;
+	std::mutex signatureMutex;
+	float frameRate = 0.0f;
+
+	if( isDirectory )
+	{
+		// the images are decoded in parallel, in contiguous segments per thread
+		signatures.resize(files.size());
+
+		runSegments(files.size(), threads, [&](int n)
+		{
+			uchar3* image = NULL;
+			int width = 0;
+			int height = 0;
+
+			if( !loadImage(files[n].c_str(), &image, &width, &height) )
+			{
+				memset(&signatures[n], 0, sizeof(FrameSignature));
+				return;
+			}
+
+			signatures[n].Compute(image, width, height);
+			CUDA(cudaFreeHost(image));
+		});
+	}
+	else
+	{
+		// the video is decoded in order, and only the sampled rows are copied to the workers
+		FrameQueue queue(threads, [&](FrameJob& job)
+		{
+			FrameSignature signature;
+			signature.Compute(job.pixels.data(), job.width, job.height, 1);
+
+			std::lock_guard<std::mutex> lock(signatureMutex);
+
+			if( (int)signatures.size() <= job.index )
+				signatures.resize(job.index + 1);
+
+			signatures[job.index] = signature;
+		});
+
+		const int numFrames = decodeVideo(input, [&](int index, uchar3* image, int width, int height)
+		{
+			const int rowStep = FrameSignature::DefaultRowStep;
+			const int rows = (height + rowStep - 1) / rowStep;
+
+			FrameJob* job = queue.Acquire();
+
+			job->index  = index;
+			job->width  = width;
+			job->height = rows;
+
+			job->pixels.resize(width * rows);
+
+			for( int y=0; y < rows; y++ )
+				memcpy(&job->pixels[y * width], image + y * rowStep * width, width * sizeof(uchar3));
+
+			queue.Submit(job);
+
+			if( index > 0 && index % 1000 == 0 )
+				printf("camera-keyframes:  %i frames (%.0f FPS)\n", index, index / elapsed(start));
+
+			return true;
+		}, &frameRate);
+
+		if( numFrames < 0 )
+			return 1;
+	}
+
+	const int numFrames = signatures.size();
+	const double signatureTime = elapsed(start);
+
+	printf("camera-keyframes:  computed %i signatures in %.1f seconds (%.0f FPS", numFrames, signatureTime, numFrames / signatureTime);
+
+	if( frameRate > 0.0f && signatureTime > 0.0 )
+		printf(", %.1fx real time", numFrames / frameRate / signatureTime);
+
+	printf(")\n");
+
+	if( numFrames == 0 )
+		return 1;
+
+
+	/*
+	 * select the keyframes
+	 */
+	std::vector<float> scores(numFrames);
+
+	scores[0] = 1.0f;	// the first frame is always a candidate
+
+	for( int n=1; n < numFrames; n++ )
+		scores[n] = signatures[n].Distance(signatures[n-1]);
+
+	std::vector<int> candidates;
+
+	for( int n=0; n < numFrames; n++ )
+	{
+		if( scores[n] >= threshold )
+			candidates.push_back(n);
+	}
+
+	// the biggest changes are kept first, as long as they're far enough from the others
+	std::stable_sort(candidates.begin(), candidates.end(), [&](int a, int b) { return scores[a] > scores[b]; });
+
+	std::set<int> selected;
+
+	for( size_t n=0; n < candidates.size(); n++ )
+	{
+		if( maxCount > 0 && (int)selected.size() >= maxCount )
+			break;
+
+		const int index = candidates[n];
+		std::set<int>::iterator next = selected.lower_bound(index);
+
+		if( next != selected.end() && *next - index < minGap )
+			continue;
+
+		if( next != selected.begin() && index - *std::prev(next) < minGap )
+			continue;
+
+		selected.insert(index);
+	}
+
+	printf("camera-keyframes:  selected %zu keyframes from %zu candidates\n", selected.size(), candidates.size());
+
+
+	/*
+	 * save the keyframes to the dataset
+	 */
+	if( classify ? !DatasetWriter::CreateClassifyDirectories(output, std::vector<std::string>(1, set), std::vector<std::string>(1, classLabel))
+			   : !DatasetWriter::CreateDetectionDirectories(output) )
+	{
+		return 1;
+	}
+
+	// the frames are named after the recording and their frame number
+	std::string baseName = input.substr(input.find_last_of('/') + 1);
+
+	if( !isDirectory && baseName.find_last_of('.') != std::string::npos )
+		baseName = baseName.substr(0, baseName.find_last_of('.'));
+
+	const std::vector<int> keyframes(selected.begin(), selected.end());
+	std::vector<uint8_t> saved(keyframes.size(), 0);	// written by the workers
+
+	const AnnotationModel noBoxes;
+	const std::vector<std::string> noLabels;
+
+	std::function<std::string(int)> frameName = [&](int index)
+	{
+		char str[32];
+		sprintf(str, "-%06d", index);
+		return baseName + str;
+	};
+
+	std::function<bool(int, uchar3*, int, int)> saveFrame = [&](int index, uchar3* image, int width, int height)
+	{
+		const std::string name = frameName(index);
+
+		const std::string imgPath = classify ? DatasetWriter::ClassifyDirectory(output, set, classLabel) + "/" + name + ".jpg"
+									  : DatasetWriter::ImagePath(output, name);
+
+		if( !saveImage(imgPath.c_str(), image, width, height, quality) )
+			return false;
+
+		// the frames are labeled later, so their annotations start out empty
+		if( !classify && !DatasetWriter::SaveAnnotations(output, name, width, height, noBoxes, noLabels) )
+			return false;
+
+		return true;
+	};
+
+	start = std::chrono::steady_clock::now();
+
+	if( isDirectory )
+	{
+		runSegments(keyframes.size(), threads, [&](int n)
+		{
+			uchar3* image = NULL;
+			int width = 0;
+			int height = 0;
+
+			if( !loadImage(files[keyframes[n]].c_str(), &image, &width, &height) )
+				return;
+
+			saved[n] = saveFrame(keyframes[n], image, width, height);
+			CUDA(cudaFreeHost(image));
+		});
+	}
+	else if( keyframes.size() > 0 )
+	{
+		// decode the video again, and encode the keyframes on the workers
+		size_t next = 0;
+
+		FrameQueue queue(threads, [&](FrameJob& job)
+		{
+			saved[job.index] = saveFrame(keyframes[job.index], job.pixels.data(), job.width, job.height);
+		});
+
+		decodeVideo(input, [&](int index, uchar3* image, int width, int height)
+		{
+			if( index != keyframes[next] )
+				return true;
+
+			FrameJob* job = queue.Acquire();
+
+			job->index  = next;
+			job->width  = width;
+			job->height = height;
+
+			job->pixels.assign(image, image + width * height);
+			queue.Submit(job);
+
+			return ++next < keyframes.size();
+		});
+	}
+
+	// the image sets are updated in order once the frames are saved
+	int numSaved = 0;
+
+	for( size_t n=0; n < keyframes.size(); n++ )
+	{
+		if( !saved[n] )
+		{
+			printf("camera-keyframes:  failed to save frame %i\n", keyframes[n]);
+			continue;
+		}
+
+		if( !classify )
+			DatasetWriter::AddToImageSets(output, set, frameName(keyframes[n]), mergeSets);
+
+		numSaved++;
+	}
+
+	printf("camera-keyframes:  saved %i keyframes to %s in %.1f seconds\n", numSaved, output.c_str(), elapsed(start));
+	return (numSaved == (int)keyframes.size()) ? 0 : 1;
+}
+
@@ -0,0 +1,675 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "syntheticSource.h"
+#include "datasetWriter.h"
+#include "datasetStaging.h"
+#include "ioBatch.h"
+#include "annotationModel.h"
+#include "metrics.h"
+
+#include "cudaMappedMemory.h"
+#include "imageIO.h"
+#include "commandLine.h"
+
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+
+int usage()
+{
+	printf("usage: camera-microbench [-h] [workdir]\n\n");
+	printf("Time the dataset-writing paths in isolation (JPEG encoding, VOC XML,\n");
+	printf("image set appends, batched sample writes, directory creation, image counting,\n");
+	printf("and box edits)\n\n");
+	printf("positional arguments:\n");
+	printf("  workdir            scratch directory, removed afterwards (default /dev/shm,\n");
+	printf("                     or /tmp if it doesn't exist)\n\n");
+	printf("optional arguments:\n");
+	printf("  --help             show this help message and exit\n");
+	printf("  --filter=STR       only run the benchmarks whose name contains STR\n");
+	printf("  --time=SEC         minimum time of each benchmark (default 0.5)\n");
+	printf("  --json=FILE        write the results to a JSON file\n");
+	printf("  --label=NAME       name of the run in the JSON file (i.e. the release)\n");
+	printf("  --baseline=FILE    compare the medians to the results of an earlier run\n");
+	printf("  --tolerance=X      slowdown reported as a regression (default 0.2, 20%%)\n");
+	printf("  --keep             keep the scratch directory\n\n");
+
+	return 0;
+}
+
+
+/*
+ * Timing of one benchmark (per operation, in nanoseconds)
+ */
+struct BenchResult
+{
+	std::string name;
+
+	int iterations;
+	int ops;		// operations per iteration
+
+	double mean;
+	double p50;
+	double p99;
+	double min;
+};
+
+
+/*
+ * Runs each benchmark until it's taken the minimum time
+ */
+class BenchRunner
+{
+public:
+	BenchRunner( commandLine& cmdLine )
+	{
+		filter  = cmdLine.GetString("filter", "");
+		minTime = std::max(cmdLine.GetFloat("time", 0.5f), 0.01f) * 1e9;
+	}
+
+	// func runs one iteration of ops operations, and returns false on failure
+	bool Run( const std::string& name, int ops, const std::function<bool(int)>& func )
+	{
+		if( name.find(filter) == std::string::npos )
+			return true;
+
+		// the first iteration is a warmup (i.e. the allocations and the page cache)
+		if( !func(0) )
+		{
+			printf("camera-microbench:  %s failed\n", name.c_str());
+			return false;
+		}
+
+		std::vector<uint64_t> samples;
+		const uint64_t start = Metrics::Now();
+
+		while( samples.size() < MinIterations || (Metrics::Now() - start < minTime && samples.size() < MaxIterations) )
+		{
+			const uint64_t begin = Metrics::Now();
+
+			if( !func(samples.size() + 1) )
+			{
+				printf("camera-microbench:  %s failed\n", name.c_str());
+				return false;
+			}
+
+			samples.push_back(Metrics::Now() - begin);
+		}
+
+		std::sort(samples.begin(), samples.end());
+
+		BenchResult result;
+
+		result.name       = name;
+		result.iterations = samples.size();
+		result.ops        = ops;
+		result.min        = (double)samples.front() / ops;
+		result.p50        = (double)samples[samples.size() / 2] / ops;
+		result.p99        = (double)samples[std::min((size_t)(samples.size() * 0.99), samples.size() - 1)] / ops;
+		result.mean       = 0.0;
+
+		for( size_t n=0; n < samples.size(); n++ )
+			result.mean += samples[n];
+
+		result.mean /= (double)samples.size() * ops;
+
+		printf("%-40s %9i %12.3f %12.3f %12.3f\n", name.c_str(), result.iterations, result.p50 * 1e-3, result.p99 * 1e-3, result.mean * 1e-3);
+
+		results.push_back(result);
+		return true;
+	}
+
+	std::vector<BenchResult> results;
+
+	static const size_t MinIterations = 5;
+	static const size_t MaxIterations = 100000;
+
+protected:
+	std::string filter;
+	uint64_t minTime;
+};
+
+
+// xmlText (escaped like tinyxml2 escapes text)
+static void xmlText( std::string& xml, const char* text )
+{
+	for( const char* c=text; *c != '\0'; c++ )
+	{
+		if( *c == '&' )
+			xml += "&amp;";
+		else if( *c == '<' )
+			xml += "&lt;";
+		else if( *c == '>' )
+			xml += "&gt;";
+		else
+			xml += *c;
+	}
+}
+
+// xmlElement
+static void xmlElement( std::string& xml, int depth, const char* name, const char* text )
+{
+	xml.append(depth * 4, ' ');
+	xml += '<';
+	xml += name;
+	xml += '>';
+	xmlText(xml, text);
+	xml += "</";
+	xml += name;
+	xml += ">\n";
+}
+
+static void xmlElement( std::string& xml, int depth, const char* name, int value )
+{
+	char str[16];
+	sprintf(str, "%d", value);
+	xmlElement(xml, depth, name, str);
+}
+
+// xmlOpen (or close)
+static void xmlOpen( std::string& xml, int depth, const char* name, bool close=false )
+{
+	xml.append(depth * 4, ' ');
+	xml += close ? "</" : "<";
+	xml += name;
+	xml += ">\n";
+}
+
+// formatVOCStreaming (writes the same text as FormatVOC(), without building a document)
+static void formatVOCStreaming( std::string& xml, const AnnotationModel& model, const char* imgFilename, const char* folder,
+						  int imgWidth, int imgHeight, const std::vector<std::string>& classLabels )
+{
+	xml.clear();
+	xml.reserve(512 + model.GetCount() * 320);
+
+	xmlOpen(xml, 0, "annotation");
+	xmlElement(xml, 1, "filename", imgFilename);
+	xmlElement(xml, 1, "folder", folder);
+	xmlOpen(xml, 1, "source");
+	xmlElement(xml, 2, "database", folder);
+	xmlElement(xml, 2, "annotation", "custom");
+	xmlElement(xml, 2, "image", "custom");
+	xmlOpen(xml, 1, "source", true);
+	xmlOpen(xml, 1, "size");
+	xmlElement(xml, 2, "width", imgWidth);
+	xmlElement(xml, 2, "height", imgHeight);
+	xmlElement(xml, 2, "depth", 3);
+	xmlOpen(xml, 1, "size", true);
+	xmlElement(xml, 1, "segmented", 0);
+
+	for( int n=0; n < model.GetCount(); n++ )
+	{
+		const BoundingBox& box = model.GetAt(n);
+
+		if( box.flags & BOX_PROPOSED )
+			continue;
+
+		xmlOpen(xml, 1, "object");
+		xmlElement(xml, 2, "name", (box.classID < classLabels.size()) ? classLabels[box.classID].c_str() : "");
+		xmlElement(xml, 2, "pose", "unspecified");
+		xmlElement(xml, 2, "truncated", (box.flags & BOX_TRUNCATED) ? "1" : "0");
+		xmlElement(xml, 2, "difficult", (box.flags & BOX_DIFFICULT) ? "1" : "0");
+		xmlOpen(xml, 2, "bndbox");
+		xmlElement(xml, 3, "xmin", (int)box.x);
+		xmlElement(xml, 3, "ymin", (int)box.y);
+		xmlElement(xml, 3, "xmax", (int)(box.x + box.width));
+		xmlElement(xml, 3, "ymax", (int)(box.y + box.height));
+		xmlOpen(xml, 2, "bndbox", true);
+		xmlOpen(xml, 1, "object", true);
+	}
+
+	xmlOpen(xml, 0, "annotation", true);
+}
+
+
+// fillModel (with boxes spread over a 1280x720 frame)
+static void fillModel( AnnotationModel& model, int count, int numClasses )
+{
+	std::mt19937 rng(count);
+
+	model.Clear();
+
+	for( int n=0; n < count; n++ )
+		model.Create(rng() % 1200, rng() % 640, 16 + rng() % 64, 16 + rng() % 64, n % numClasses);
+
+	model.ClearHistory();
+}
+
+
+// onAnnotationEvent (stands in for the box table, which handles each event)
+static void onAnnotationEvent( uint16_t event, uint32_t id, int row, void* user )
+{
+	(*(int*)user)++;
+}
+
+
+// removeFile
+static int removeFile( const char* path, const struct stat* info, int flag, struct FTW* ftw )
+{
+	return remove(path);
+}
+
+
+// readBaseline (the results are written one per line, see writeJSON())
+static bool readBaseline( const char* filename, std::vector<std::pair<std::string, double> >& baseline )
+{
+	FILE* file = fopen(filename, "r");
+
+	if( !file )
+	{
+		printf("camera-microbench:  failed to open baseline %s\n", filename);
+		return false;
+	}
+
+	char line[1024];
+
+	while( fgets(line, sizeof(line), file) != NULL )
+	{
+		char name[256];
+		const char* p50 = strstr(line, "\"p50_ns\":");
+
+		if( sscanf(line, " {\"name\":\"%255[^\"]\"", name) == 1 && p50 != NULL )
+			baseline.push_back(std::make_pair(std::string(name), atof(p50 + 9)));
+	}
+
+	fclose(file);
+	return true;
+}
+
+
+// writeJSON
+static bool writeJSON( const char* filename, const char* label, const std::vector<BenchResult>& results )
+{
+	FILE* file = fopen(filename, "w");
+
+	if( !file )
+	{
+		printf("camera-microbench:  failed to write %s\n", filename);
+		return false;
+	}
+
+	// the label is written as a JSON string, so the characters that need escaping are dropped
+	std::string name = label;
+	name.erase(std::remove_if(name.begin(), name.end(), [](char c) { return c == '"' || c == '\\' || (unsigned char)c < 0x20; }), name.end());
+
+	fprintf(file, "{\n  \"label\":\"%s\",\n  \"timestamp\":\"%s\",\n  \"results\":[\n", name.c_str(), DatasetWriter::Timestamp().c_str());
+
+	for( size_t n=0; n < results.size(); n++ )
+	{
+		const BenchResult& result = results[n];
+
+		fprintf(file, "    {\"name\":\"%s\",\"iterations\":%i,\"ops\":%i,\"mean_ns\":%.1f,\"p50_ns\":%.1f,\"p99_ns\":%.1f,\"min_ns\":%.1f}%s\n",
+			   result.name.c_str(), result.iterations, result.ops, result.mean, result.p50, result.p99, result.min,
+			   (n + 1 < results.size()) ? "," : "");
+	}
+
+	fprintf(file, "  ]\n}\n");
+
+	if( fclose(file) != 0 )
+	{
+		printf("camera-microbench:  failed to write %s\n", filename);
+		return false;
+	}
+
+	printf("camera-microbench:  wrote the results to %s\n", filename);
+	return true;
+}
+
+
+int main( int argc, char** argv )
+{
+	/*
+	 * parse command line
+	 */
+	commandLine cmdLine(argc, argv);
+
+	if( cmdLine.GetFlag("help") )
+		return usage();
+
+	struct stat info;
+
+	const std::string scratch = (cmdLine.GetPositionArgs() > 0) ? cmdLine.GetPosition(0) : (stat("/dev/shm", &info) == 0) ? "/dev/shm" : "/tmp";
+	const std::string workdir = scratch + "/camera-microbench-" + std::to_string(getpid());
+
+	if( !DatasetWriter::MakeDirectory(workdir) )
+		return 1;
+
+	BenchRunner bench(cmdLine);
+	bool success = true;
+
+	printf("%-40s %9s %12s %12s %12s\n", "benchmark (per operation)", "iters", "p50 us", "p99 us", "mean us");
+
+
+	/*
+	 * JPEG encoding at various sizes and qualities
+	 */
+	const int sizes[][2] = { {640, 480}, {1280, 720}, {1920, 1080} };
+	const int qualities[] = { 50, 75, 95 };
+
+	for( size_t s=0; s < sizeof(sizes) / sizeof(sizes[0]); s++ )
+	{
+		const int width  = sizes[s][0];
+		const int height = sizes[s][1];
+
+		SyntheticSource* source = SyntheticSource::Create(width, height, 0.0f);
+		uchar3* image = NULL;
+
+		if( !source || !source->Capture(&image) )
+		{
+			SAFE_DELETE(source);
+			success = false;
+			break;
+		}
+
+		CUDA(cudaDeviceSynchronize());
+
+		const std::string filename = workdir + "/encode.jpg";
+
+		for( size_t q=0; q < sizeof(qualities) / sizeof(qualities[0]); q++ )
+		{
+			char name[64];
+			sprintf(name, "jpeg_encode/%ix%i/q%i", width, height, qualities[q]);
+
+			success &= bench.Run(name, 1, [&](int iteration)
+			{
+				return saveImage(filename.c_str(), image, width, height, qualities[q]);
+			});
+		}
+
+		delete source;
+	}
+
+
+	/*
+	 * VOC XML generation (tinyxml2 as saved by SaveVOC(), and a streaming writer)
+	 */
+	const std::vector<std::string> classLabels = { "person", "car", "bicycle", "dog", "cat", "sign" };
+	const int boxCounts[] = { 10, 100, 1000 };
+
+	for( size_t b=0; b < sizeof(boxCounts) / sizeof(boxCounts[0]); b++ )
+	{
+		AnnotationModel model;
+		fillModel(model, boxCounts[b], classLabels.size());
+
+		std::string xml;
+		std::string streamed;
+
+		success &= bench.Run("voc_xml/tinyxml2/" + std::to_string(boxCounts[b]) + "boxes", 1, [&](int iteration)
+		{
+			return model.FormatVOC(xml, "20200101-000000.jpg", "dataset", 1280, 720, classLabels);
+		});
+
+		success &= bench.Run("voc_xml/streaming/" + std::to_string(boxCounts[b]) + "boxes", 1, [&](int iteration)
+		{
+			formatVOCStreaming(streamed, model, "20200101-000000.jpg", "dataset", 1280, 720, classLabels);
+			return true;
+		});
+
+		if( xml.size() > 0 && streamed.size() > 0 && xml != streamed )
+			printf("camera-microbench:  the streaming XML differs from tinyxml2's (%zu vs %zu bytes)\n", streamed.size(), xml.size());
+	}
+
+	// the complete annotation save (generate, write, fsync, and rename)
+	{
+		AnnotationModel model;
+		fillModel(model, 10, classLabels.size());
+
+		const std::string dataset = workdir + "/voc";
+		success &= DatasetWriter::CreateDetectionDirectories(dataset);
+
+		success &= bench.Run("voc_save/10boxes", 1, [&](int iteration)
+		{
+			return DatasetWriter::SaveAnnotations(dataset, "sample-" + std::to_string(iteration), 1280, 720, model, classLabels);
+		});
+	}
+
+
+	/*
+	 * image set appends
+	 */
+	{
+		const std::string dataset = workdir + "/sets";
+		success &= DatasetWriter::CreateDetectionDirectories(dataset);
+
+		success &= bench.Run("image_set_append/train", 1, [&](int iteration)
+		{
+			return DatasetWriter::AddToImageSets(dataset, "train", "sample-" + std::to_string(iteration));
+		});
+
+		success &= bench.Run("image_set_append/merged", 1, [&](int iteration)
+		{
+			return DatasetWriter::AddToImageSets(dataset, "train", "merged-" + std::to_string(iteration), true);
+		});
+	}
+
+
+	/*
+	 * the annotations and image sets of a sample, one file at a time and as one IOBatch
+	 */
+	{
+		AnnotationModel model;
+		fillModel(model, 10, classLabels.size());
+
+		const std::string dataset = workdir + "/samples";
+		success &= DatasetWriter::CreateDetectionDirectories(dataset);
+
+		success &= bench.Run("sample_write/sequential", 1, [&](int iteration)
+		{
+			const std::string name = "sequential-" + std::to_string(iteration);
+
+			return DatasetWriter::SaveAnnotations(dataset, name, 1280, 720, model, classLabels) &&
+				  DatasetWriter::AddToImageSets(dataset, "train", name, true);
+		});
+
+		const char* backends[] = { "io_uring", "threads" };
+
+		for( size_t b=0; b < sizeof(backends) / sizeof(backends[0]); b++ )
+		{
+			if( !IOBatch::SetBackend(backends[b]) )
+				continue;	// io_uring isn't available
+
+			success &= bench.Run(std::string("sample_write/batched/") + backends[b], 1, [&](int iteration)
+			{
+				const std::string name = std::string("batched-") + backends[b] + "-" + std::to_string(iteration);
+				StagedSample sample = DatasetStaging::Begin();
+
+				return DatasetWriter::SaveAnnotations(dataset, name, 1280, 720, model, classLabels, &sample) &&
+					  DatasetWriter::AddToImageSets(dataset, "train", name, true, &sample) &&
+					  DatasetStaging::Commit(sample);
+			});
+		}
+
+		IOBatch::Shutdown();
+	}
+
+
+	/*
+	 * directory creation for large label sets (a new dataset, and re-opening it)
+	 */
+	const std::vector<std::string> sets = { "train", "val", "test" };
+	const int labelCounts[] = { 10, 100, 1000 };
+
+	for( size_t l=0; l < sizeof(labelCounts) / sizeof(labelCounts[0]); l++ )
+	{
+		std::vector<std::string> labels;
+
+		for( int n=0; n < labelCounts[l]; n++ )
+			labels.push_back("class" + std::to_string(n));
+
+		const std::string prefix = workdir + "/dirs-" + std::to_string(labelCounts[l]);
+
+		success &= bench.Run("create_directories/new/" + std::to_string(labelCounts[l]) + "labels", 1, [&](int iteration)
+		{
+			return DatasetWriter::CreateClassifyDirectories(prefix + "-" + std::to_string(iteration), sets, labels);
+		});
+
+		success &= bench.Run("create_directories/existing/" + std::to_string(labelCounts[l]) + "labels", 1, [&](int iteration)
+		{
+			return DatasetWriter::CreateClassifyDirectories(prefix + "-0", sets, labels);
+		});
+	}
+
+
+	/*
+	 * image counting
+	 */
+	const int fileCounts[] = { 100, 1000, 10000 };
+
+	for( size_t f=0; f < sizeof(fileCounts) / sizeof(fileCounts[0]); f++ )
+	{
+		const std::string directory = workdir + "/count-" + std::to_string(fileCounts[f]);
+
+		if( !DatasetWriter::MakeDirectory(directory) )
+		{
+			success = false;
+			continue;
+		}
+
+		for( int n=0; n < fileCounts[f]; n++ )
+		{
+			FILE* file = fopen((directory + "/" + std::to_string(n) + ".jpg").c_str(), "w");
+
+			if( file != NULL )
+				fclose(file);
+		}
+
+		success &= bench.Run("count_images/" + std::to_string(fileCounts[f]) + "files", 1, [&](int iteration)
+		{
+			return DatasetWriter::CountFiles(directory) == fileCounts[f];
+		});
+	}
+
+
+	/*
+	 * box table edits (with an event handler attached, like the table)
+	 */
+	for( size_t b=0; b < sizeof(boxCounts) / sizeof(boxCounts[0]); b++ )
+	{
+		const int count = boxCounts[b];
+
+		AnnotationModel model;
+		int events = 0;
+
+		model.AddEventHandler(onAnnotationEvent, &events);
+
+		std::vector<uint32_t> ids(count);
+		std::mt19937 rng(count);
+
+		// insert the boxes, then delete them in a random order
+		success &= bench.Run("box_table/insert_delete/" + std::to_string(count) + "boxes", count * 2, [&](int iteration)
+		{
+			for( int n=0; n < count; n++ )
+				ids[n] = model.Create(n * 4, n * 2, 32, 32, n % classLabels.size());
+
+			std::shuffle(ids.begin(), ids.end(), rng);
+
+			for( int n=0; n < count; n++ )
+			{
+				if( !model.Remove(ids[n]) )
+					return false;
+			}
+
+			model.ClearHistory();
+			return true;
+		});
+
+		// dragging a box (onCaptureEvent moves it on each mouse event)
+		fillModel(model, count, classLabels.size());
+		const uint32_t dragID = model.GetAt(count / 2).id;
+
+		success &= bench.Run("box_table/drag/" + std::to_string(count) + "boxes", 100, [&](int iteration)
+		{
+			model.BeginStep();
+
+			for( int n=0; n < 100; n++ )
+			{
+				if( !model.SetCoords(dragID, n, n, 32, 32) )
+					return false;
+			}
+
+			model.EndStep();
+			model.ClearHistory();
+			return true;
+		});
+
+		model.RemoveEventHandler(onAnnotationEvent, &events);
+	}
+
+
+	/*
+	 * save the results, and compare them to the baseline
+	 */
+	const char* jsonPath = cmdLine.GetString("json");
+
+	if( jsonPath != NULL )
+		success &= writeJSON(jsonPath, cmdLine.GetString("label", ""), bench.results);
+
+	const char* baselinePath = cmdLine.GetString("baseline");
+	int regressions = 0;
+
+	if( baselinePath != NULL )
+	{
+		std::vector<std::pair<std::string, double> > baseline;
+
+		if( !readBaseline(baselinePath, baseline) )
+			return 1;
+
+		const float tolerance = cmdLine.GetFloat("tolerance", 0.2f);
+
+		for( size_t n=0; n < bench.results.size(); n++ )
+		{
+			for( size_t b=0; b < baseline.size(); b++ )
+			{
+				if( baseline[b].first != bench.results[n].name || baseline[b].second <= 0.0 )
+					continue;
+
+				const double ratio = bench.results[n].p50 / baseline[b].second;
+
+				if( ratio > 1.0 + tolerance )
+				{
+					printf("camera-microbench:  regression in %s (%.3f us, was %.3f us, %+.0f%%)\n", bench.results[n].name.c_str(),
+						  bench.results[n].p50 * 1e-3, baseline[b].second * 1e-3, (ratio - 1.0) * 100.0);
+					regressions++;
+				}
+			}
+		}
+
+		printf("camera-microbench:  %i regressions compared to %s\n", regressions, baselinePath);
+	}
+
+	if( !cmdLine.GetFlag("keep") )
+		nftw(workdir.c_str(), removeFile, 16, FTW_DEPTH | FTW_PHYS);
+
+	return (success && regressions == 0) ? 0 : 1;
+}
+
@@ -0,0 +1,634 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "sessionLog.h"
+#include "syntheticSource.h"
+#include "datasetWriter.h"
+#include "annotationModel.h"
+#include "outputGeometry.h"
+#include "metrics.h"
+
+#include "cudaMappedMemory.h"
+#include "imageIO.h"
+#include "commandLine.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+
+int usage()
+{
+	printf("usage: camera-replay [-h] session [output]\n\n");
+	printf("Replay a session recorded with camera-capture --session-record, without\n");
+	printf("a display, and report the time taken by each kind of action.  The edits\n");
+	printf("and saves are reproduced exactly, so two builds can be compared on the\n");
+	printf("same workload (and their datasets compared byte for byte)\n\n");
+	printf("positional arguments:\n");
+	printf("  session            session log to replay\n");
+	printf("  output             directory of the replayed datasets (default /tmp/camera-replay)\n\n");
+	printf("optional arguments:\n");
+	printf("  --help             show this help message and exit\n");
+	printf("  --compare=DIR      compare the replayed dataset with another dataset (i.e.\n");
+	printf("                     from another build), exits with 1 if they differ\n");
+	printf("  --label=NAME       name of the run in the CSV file (i.e. the release)\n");
+	printf("  --csv=FILE         append the results to a CSV file\n\n");
+	printf("The tracker, the proposals, and the pre-labeler aren't run again, their\n");
+	printf("edits are replayed from the session like the operator's.\n\n");
+
+	return 0;
+}
+
+
+/*
+ * Timings of one kind of action (i.e. drag, draw, key)
+ */
+struct ActionStats
+{
+	std::vector<uint64_t> times;	// nanoseconds, per action
+
+	// the time below which the given fraction of the actions fall (in milliseconds)
+	double Quantile( double fraction ) const
+	{
+		if( times.size() == 0 )
+			return 0.0;
+
+		std::vector<uint64_t> sorted(times);
+		std::sort(sorted.begin(), sorted.end());
+
+		const size_t rank = std::min((size_t)(fraction * sorted.size()), sorted.size() - 1);
+		return sorted[rank] * 1e-6;
+	}
+
+	double Total() const
+	{
+		uint64_t total = 0;
+
+		for( size_t n=0; n < times.size(); n++ )
+			total += times[n];
+
+		return total * 1e-6;
+	}
+};
+
+
+/*
+ * Replays the events of a session
+ */
+class SessionReplay
+{
+public:
+	SessionReplay( SessionReader* reader, const std::string& output );
+	~SessionReplay();
+
+	bool Run();
+
+	std::string dataset;				// path of the replayed dataset
+	std::map<std::string, ActionStats> actions;	// by kind
+
+	int numEvents;
+	int numMismatches;				// the replay diverged from the session
+
+protected:
+	bool replay( const SessionEvent& event );
+	bool setFrame( uchar3* image, int width, int height, bool owned );
+
+	SessionReader* reader;
+	std::string output;
+
+	AnnotationModel annotations;
+	std::vector<std::string> classLabels;
+
+	OutputGeometry  geometry;	// the geometry the samples are saved at
+	OutputTransform transform;
+
+	SyntheticSource* synthetic;
+
+	uchar3* frame;		// the frozen frame
+	int  frameWidth;
+	int  frameHeight;
+	bool frameOwned;	// read from the sidecar (synthetic frames belong to the source)
+
+	std::set<std::string> unknown;
+};
+
+
+// constructor
+SessionReplay::SessionReplay( SessionReader* _reader, const std::string& _output )
+{
+	reader        = _reader;
+	output        = _output;
+	synthetic     = NULL;
+	frame         = NULL;
+	frameWidth    = 0;
+	frameHeight   = 0;
+	frameOwned    = false;
+	numEvents     = 0;
+	numMismatches = 0;
+}
+
+
+// destructor
+SessionReplay::~SessionReplay()
+{
+	setFrame(NULL, 0, 0, false);
+	SAFE_DELETE(synthetic);
+}
+
+
+// setFrame
+bool SessionReplay::setFrame( uchar3* image, int width, int height, bool owned )
+{
+	if( frame != NULL && frameOwned )
+		CUDA(cudaFreeHost(frame));
+
+	frame       = image;
+	frameWidth  = width;
+	frameHeight = height;
+	frameOwned  = owned;
+
+	return (image != NULL);
+}
+
+
+// Run
+bool SessionReplay::Run()
+{
+	SessionEvent event;
+
+	std::string action = "setup";	// the events before the first input
+	uint64_t actionTime = 0;
+
+	while( reader->Next(event) )
+	{
+		numEvents++;
+
+		// an input starts the next action
+		if( event.name == "input" )
+		{
+			actions[action].times.push_back(actionTime);
+
+			action = (event.args.size() > 0) ? event.args[0] : "input";
+			actionTime = 0;
+			continue;
+		}
+
+		// the frames are read or generated again outside of the timing
+		if( event.name == "frame" )
+		{
+			uchar3* image = NULL;
+
+			if( !reader->ReadFrame(event.GetUInt(0), event.GetInt(1), event.GetInt(2), &image) )
+				return false;
+
+			setFrame(image, event.GetInt(1), event.GetInt(2), true);
+			continue;
+		}
+		else if( event.name == "synthetic" )
+		{
+			uchar3* image = NULL;
+
+			if( !synthetic )
+			{
+				printf("camera-replay:  line %i:  synthetic frame without a synthetic source\n", reader->GetLine());
+				return false;
+			}
+
+			synthetic->Seek(event.GetUInt(0));
+
+			if( !synthetic->Capture(&image) )
+				return false;
+
+			CUDA(cudaDeviceSynchronize());
+			setFrame(image, synthetic->GetWidth(), synthetic->GetHeight(), false);
+			continue;
+		}
+
+		const uint64_t start = Metrics::Now();
+
+		if( !replay(event) )
+		{
+			printf("camera-replay:  failed to replay line %i (%s)\n", reader->GetLine(), event.name.c_str());
+			return false;
+		}
+
+		actionTime += Metrics::Now() - start;
+	}
+
+	actions[action].times.push_back(actionTime);
+	return true;
+}
+
+
+// replay
+bool SessionReplay::replay( const SessionEvent& event )
+{
+	const std::string& name = event.name;
+
+	// edits of the boxes
+	if( name == "create" )
+	{
+		const uint32_t id = annotations.Create(event.GetFloat(1), event.GetFloat(2), event.GetFloat(3), event.GetFloat(4), event.GetInt(5), event.GetInt(6));
+
+		// later edits refer to the boxes by ID
+		if( id != event.GetUInt(0) )
+		{
+			printf("camera-replay:  line %i:  box %u was created as %u\n", reader->GetLine(), (uint32_t)event.GetUInt(0), id);
+			numMismatches++;
+		}
+	}
+	else if( name == "coords" )
+		annotations.SetCoords(event.GetUInt(0), event.GetFloat(1), event.GetFloat(2), event.GetFloat(3), event.GetFloat(4));
+	else if( name == "class" )
+		annotations.SetClass(event.GetUInt(0), event.GetInt(1));
+	else if( name == "flags" )
+		annotations.SetFlags(event.GetUInt(0), event.GetInt(1));
+	else if( name == "remove" )
+		annotations.Remove(event.GetUInt(0));
+	else if( name == "clear" )
+		annotations.Clear();
+	else if( name == "reset" )
+		annotations.Reset();
+	else if( name == "clear_history" )
+		annotations.ClearHistory();
+	else if( name == "undo" )
+		annotations.Undo();
+	else if( name == "redo" )
+		annotations.Redo();
+	else if( name == "begin_step" )
+		annotations.BeginStep();
+	else if( name == "end_step" )
+		annotations.EndStep();
+	else if( name == "seal" )
+		annotations.Seal();
+	else if( name == "load" )
+	{
+		const int numBoxes = event.GetInt(0);
+
+		std::vector<BoundingBox> boxes(numBoxes);
+		SessionEvent boxEvent;
+
+		// the boxes follow on their own lines
+		for( int n=0; n < numBoxes; n++ )
+		{
+			if( !reader->Next(boxEvent) || boxEvent.name != "box" )
+				return false;
+
+			BoundingBox& box = boxes[n];
+
+			box.id      = boxEvent.GetUInt(0);
+			box.classID = boxEvent.GetInt(1);
+			box.flags   = boxEvent.GetInt(2);
+			box.x       = boxEvent.GetFloat(3);
+			box.y       = boxEvent.GetFloat(4);
+			box.width   = boxEvent.GetFloat(5);
+			box.height  = boxEvent.GetFloat(6);
+
+			numEvents++;
+		}
+
+		annotations.Load(boxes);
+	}
+
+	// the dataset
+	else if( name == "dataset" )
+	{
+		if( event.args.size() < 1 )
+			return false;
+
+		dataset = output + "/" + event.args[0];
+		return DatasetWriter::CreateDetectionDirectories(dataset);
+	}
+	else if( name == "labels" )
+	{
+		if( event.args.size() < 1 )
+			return false;
+
+		classLabels.assign(event.args.begin() + 1, event.args.end());
+	}
+	else if( name == "save" || name == "resave" )
+	{
+		if( dataset.size() == 0 )
+		{
+			printf("camera-replay:  line %i:  a sample was saved before the dataset was selected\n", reader->GetLine());
+			return false;
+		}
+
+		if( event.args.size() < ((name == "save") ? 6 : 5) )
+			return false;
+
+		const std::string& sample = event.args[0];
+
+		if( name == "resave" )
+			return annotations.SaveVOC(DatasetWriter::AnnotationPath(dataset, sample).c_str(), event.args[1].c_str(), event.args[2].c_str(),
+								  event.GetInt(3), event.GetInt(4), classLabels);
+
+		if( !frame )
+		{
+			printf("camera-replay:  line %i:  %s was saved without a frame\n", reader->GetLine(), sample.c_str());
+			return false;
+		}
+
+		const std::string imgPath = DatasetWriter::ImagePath(dataset, sample);
+
+		if( !transform.Configure(geometry, frameWidth, frameHeight) )
+			return false;
+
+		if( transform.IsIdentity() )
+			return saveImage(imgPath.c_str(), frame, frameWidth, frameHeight, event.GetInt(3))
+				&& DatasetWriter::SaveAnnotations(dataset, sample, event.GetInt(4), event.GetInt(5), annotations, classLabels)
+				&& DatasetWriter::AddToImageSets(dataset, event.args[1], sample, event.GetInt(2) != 0);
+
+		// the sample is cropped and resized to the output geometry
+		const uchar3* output = transform.Apply(frame);
+		AnnotationModel outputBoxes;
+
+		transform.MapBoxes(annotations, outputBoxes);
+
+		if( !saveImage(imgPath.c_str(), const_cast<uchar3*>(output), transform.GetWidth(), transform.GetHeight(), event.GetInt(3))
+		    || !DatasetWriter::SaveAnnotations(dataset, sample, transform.GetWidth(), transform.GetHeight(), outputBoxes, classLabels) )
+			return false;
+
+		if( geometry.keepOriginal )
+		{
+			const std::string originals = DatasetWriter::OriginalsDirectory(dataset);
+
+			if( !DatasetWriter::CreateDetectionDirectories(originals)
+			    || !saveImage(DatasetWriter::ImagePath(originals, sample).c_str(), frame, frameWidth, frameHeight, event.GetInt(3))
+			    || !DatasetWriter::SaveAnnotations(originals, sample, event.GetInt(4), event.GetInt(5), annotations, classLabels) )
+				return false;
+		}
+
+		return DatasetWriter::AddToImageSets(dataset, event.args[1], sample, event.GetInt(2) != 0);
+	}
+	else if( name == "geometry" )
+	{
+		if( event.args.size() < 1 )
+			return false;
+
+		geometry = OutputGeometry();
+		return geometry.Parse(event.args[0]);
+	}
+
+	// the source
+	else if( name == "source" )
+	{
+		if( event.args.size() > 0 && event.args[0] == "synthetic" )
+		{
+			SyntheticSource::Format format = SyntheticSource::RGB8;
+
+			if( event.args.size() < 6 || !SyntheticSource::ParseFormat(event.args[3].c_str(), format) )
+				return false;
+
+			// the frames are generated as they're needed, so they aren't paced
+			synthetic = SyntheticSource::Create(event.GetInt(1), event.GetInt(2), 0.0f, format, event.GetInt(4), event.GetUInt(5));
+
+			if( !synthetic )
+				return false;
+		}
+	}
+
+	// events that don't change the output
+	else if( name == "freeze" || name == "unfreeze" || name == "open" || name == "end" )
+	{
+		return true;
+	}
+	else if( unknown.insert(name).second )
+	{
+		printf("camera-replay:  skipping unknown events '%s' (line %i)\n", name.c_str(), reader->GetLine());
+	}
+
+	return true;
+}
+
+
+// compareFiles
+static bool compareFiles( const std::string& a, const std::string& b )
+{
+	FILE* fileA = fopen(a.c_str(), "rb");
+	FILE* fileB = fopen(b.c_str(), "rb");
+
+	bool equal = (fileA != NULL && fileB != NULL);
+
+	while( equal )
+	{
+		char bufferA[65536];
+		char bufferB[65536];
+
+		const size_t sizeA = fread(bufferA, 1, sizeof(bufferA), fileA);
+		const size_t sizeB = fread(bufferB, 1, sizeof(bufferB), fileB);
+
+		if( sizeA != sizeB || memcmp(bufferA, bufferB, sizeA) != 0 )
+			equal = false;
+		else if( sizeA == 0 )
+			break;
+	}
+
+	if( fileA != NULL )
+		fclose(fileA);
+
+	if( fileB != NULL )
+		fclose(fileB);
+
+	return equal;
+}
+
+
+// listFiles (recursive, relative to the root)
+static void listFiles( const std::string& root, const std::string& path, std::set<std::string>& files )
+{
+	DIR* dir = opendir((root + "/" + path).c_str());
+
+	if( !dir )
+		return;
+
+	struct dirent* entry = NULL;
+
+	while( (entry = readdir(dir)) != NULL )
+	{
+		// hidden files (i.e. the journal and the lock) aren't part of the dataset
+		if( entry->d_name[0] == '.' )
+			continue;
+
+		const std::string entryPath = (path.size() > 0) ? path + "/" + entry->d_name : entry->d_name;
+		struct stat info;
+
+		if( stat((root + "/" + entryPath).c_str(), &info) != 0 )
+			continue;
+
+		if( S_ISDIR(info.st_mode) )
+			listFiles(root, entryPath, files);
+		else
+			files.insert(entryPath);
+	}
+
+	closedir(dir);
+}
+
+
+// compareDatasets
+static int compareDatasets( const std::string& a, const std::string& b )
+{
+	std::set<std::string> files;
+
+	listFiles(a, "", files);
+	listFiles(b, "", files);
+
+	int numDifferent = 0;
+
+	for( std::set<std::string>::const_iterator iter = files.begin(); iter != files.end(); iter++ )
+	{
+		if( compareFiles(a + "/" + *iter, b + "/" + *iter) )
+			continue;
+
+		printf("camera-replay:  %s differs\n", iter->c_str());
+		numDifferent++;
+	}
+
+	printf("camera-replay:  %zu files compared, %i differ\n", files.size(), numDifferent);
+	return numDifferent;
+}
+
+
+int main( int argc, char** argv )
+{
+	/*
+	 * parse command line
+	 */
+	commandLine cmdLine(argc, argv);
+
+	if( cmdLine.GetFlag("help") || cmdLine.GetPositionArgs() < 1 )
+		return usage();
+
+	const char* sessionPath = cmdLine.GetPosition(0);
+	const char* comparePath = cmdLine.GetString("compare");
+	const char* csvPath = cmdLine.GetString("csv");
+
+	const std::string output = (cmdLine.GetPositionArgs() > 1) ? cmdLine.GetPosition(1) : "/tmp/camera-replay";
+
+	SessionReader* reader = SessionReader::Open(sessionPath);
+
+	if( !reader )
+		return 1;
+
+	// each run gets its own directory, since the image sets are appended to
+	std::string runPath = output + "/" + DatasetWriter::Timestamp();
+	struct stat info;
+
+	for( int n=2; stat(runPath.c_str(), &info) == 0; n++ )
+		runPath = output + "/" + DatasetWriter::Timestamp() + "-" + std::to_string(n);
+
+
+	/*
+	 * replay the session
+	 */
+	SessionReplay replay(reader, runPath);
+
+	printf("camera-replay:  replaying %s...\n", sessionPath);
+
+	const uint64_t start = Metrics::Now();
+	const bool success = replay.Run();
+	const double seconds = (Metrics::Now() - start) * 1e-9;
+
+	delete reader;
+
+	if( !success )
+		return 1;
+
+	if( replay.numMismatches > 0 )
+		printf("camera-replay:  the replay diverged from the session (%i mismatches)\n", replay.numMismatches);
+
+
+	/*
+	 * print the results
+	 */
+	printf("\n%-16s %8s %11s %9s %9s %9s\n", "action", "count", "total ms", "mean ms", "p50 ms", "p99 ms");
+
+	for( std::map<std::string, ActionStats>::const_iterator iter = replay.actions.begin(); iter != replay.actions.end(); iter++ )
+	{
+		const ActionStats& stats = iter->second;
+
+		printf("%-16s %8zu %11.2f %9.3f %9.3f %9.3f\n", iter->first.c_str(), stats.times.size(), stats.Total(),
+			  stats.Total() / stats.times.size(), stats.Quantile(0.5), stats.Quantile(0.99));
+	}
+
+	printf("\ncamera-replay:  replayed %i events in %.2f seconds\n", replay.numEvents, seconds);
+
+	if( replay.dataset.size() > 0 )
+		printf("camera-replay:  the dataset was written to %s\n", replay.dataset.c_str());
+
+
+	/*
+	 * append the results to the CSV file
+	 */
+	if( csvPath != NULL )
+	{
+		const bool exists = (stat(csvPath, &info) == 0 && info.st_size > 0);
+
+		FILE* file = fopen(csvPath, "a");
+
+		if( !file )
+		{
+			printf("camera-replay:  failed to open %s\n", csvPath);
+			return 1;
+		}
+
+		if( !exists )
+			fprintf(file, "label,timestamp,session,action,count,total_ms,p50_ms,p99_ms\n");
+
+		for( std::map<std::string, ActionStats>::const_iterator iter = replay.actions.begin(); iter != replay.actions.end(); iter++ )
+		{
+			fprintf(file, "%s,%s,%s,%s,%zu,%.3f,%.4f,%.4f\n", cmdLine.GetString("label", ""), DatasetWriter::Timestamp().c_str(),
+				   sessionPath, iter->first.c_str(), iter->second.times.size(), iter->second.Total(),
+				   iter->second.Quantile(0.5), iter->second.Quantile(0.99));
+		}
+
+		fclose(file);
+		printf("camera-replay:  appended the results to %s\n", csvPath);
+	}
+
+
+	/*
+	 * compare the output with another dataset
+	 */
+	if( comparePath != NULL )
+	{
+		if( replay.dataset.size() == 0 )
+		{
+			printf("camera-replay:  the session didn't write a dataset to compare\n");
+			return 1;
+		}
+
+		if( compareDatasets(replay.dataset, comparePath) > 0 )
+			return 1;
+	}
+
+	return (replay.numMismatches > 0) ? 1 : 0;
+}
+
@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "tracer.h"
+#include "metrics.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include <stdio.h>
+#include <unistd.h>
+
+
+std::atomic<bool> Tracer::enabled(false);
+
+
+/*
+ * Ring buffer of the events of one thread
+ */
+struct TraceEvent
+{
+	const char* name;
+	uint64_t    begin;
+	uint64_t    end;
+};
+
+struct TraceBuffer
+{
+	TraceBuffer( int capacity, int id ) : events(capacity)	{ head = 0; threadID = id; }
+
+	std::vector<TraceEvent> events;
+	std::atomic<uint64_t> head;	// number of events ever recorded
+
+	int threadID;
+	std::string threadName;
+	std::mutex nameMutex;
+};
+
+
+// the buffers of all the threads (they're never freed, so the events of
+// threads that exited are still written)
+struct TraceRegistry
+{
+	TraceRegistry()					{ capacity = Tracer::DefaultCapacity; }
+
+	std::mutex mutex;
+	std::vector<TraceBuffer*> buffers;
+	int capacity;
+};
+
+static TraceRegistry& registry()
+{
+	static TraceRegistry* instance = new TraceRegistry();
+	return *instance;
+}
+
+
+// the buffer of the calling thread
+static thread_local TraceBuffer* threadBuffer = NULL;
+static thread_local const char* threadName = NULL;
+
+
+// getBuffer
+static TraceBuffer* getBuffer()
+{
+	if( threadBuffer != NULL )
+		return threadBuffer;
+
+	TraceRegistry& traces = registry();
+	std::lock_guard<std::mutex> lock(traces.mutex);
+
+	threadBuffer = new TraceBuffer(traces.capacity, traces.buffers.size() + 1);
+
+	if( threadName != NULL )
+		threadBuffer->threadName = threadName;
+	else
+		threadBuffer->threadName = "thread " + std::to_string(threadBuffer->threadID);
+
+	traces.buffers.push_back(threadBuffer);
+	return threadBuffer;
+}
+
+
+// now
+uint64_t TraceScope::now()
+{
+	return Metrics::Now();
+}
+
+
+// Enable
+void Tracer::Enable( int capacity )
+{
+	TraceRegistry& traces = registry();
+
+	{
+		std::lock_guard<std::mutex> lock(traces.mutex);
+		traces.capacity = (capacity > 0) ? capacity : DefaultCapacity;
+	}
+
+	enabled = true;
+}
+
+
+// Record
+void Tracer::Record( const char* name, uint64_t begin, uint64_t end )
+{
+	TraceBuffer* buffer = getBuffer();
+
+	const uint64_t head = buffer->head.load(std::memory_order_relaxed);
+	TraceEvent& event = buffer->events[head % buffer->events.size()];
+
+	event.name  = name;
+	event.begin = begin;
+	event.end   = end;
+
+	// publish the event to Write()
+	buffer->head.store(head + 1, std::memory_order_release);
+}
+
+
+// SetThreadName
+void Tracer::SetThreadName( const char* name )
+{
+	threadName = name;
+
+	if( threadBuffer != NULL )
+	{
+		std::lock_guard<std::mutex> lock(threadBuffer->nameMutex);
+		threadBuffer->threadName = name;
+	}
+}
+
+
+// writeString (JSON-escaped)
+static void writeString( FILE* file, const char* str )
+{
+	fputc('"', file);
+
+	for( const char* c=str; *c != '\0'; c++ )
+	{
+		if( *c == '"' || *c == '\\' )
+			fputc('\\', file);
+
+		if( (unsigned char)*c >= 0x20 )
+			fputc(*c, file);
+	}
+
+	fputc('"', file);
+}
+
+
+// Write
+bool Tracer::Write( const std::string& filename )
+{
+	std::vector<TraceBuffer*> buffers;
+
+	{
+		TraceRegistry& traces = registry();
+		std::lock_guard<std::mutex> lock(traces.mutex);
+		buffers = traces.buffers;
+	}
+
+	FILE* file = fopen(filename.c_str(), "w");
+
+	if( !file )
+	{
+		printf("camera-capture:  failed to write trace %s\n", filename.c_str());
+		return false;
+	}
+
+	const int pid = getpid();
+	size_t numEvents = 0;
+	bool first = true;
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	for( size_t n=0; n < buffers.size(); n++ )
+	{
+		TraceBuffer* buffer = buffers[n];
+
+		std::string name;
+
+		{
+			std::lock_guard<std::mutex> lock(buffer->nameMutex);
+			name = buffer->threadName;
+		}
+
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%i,\"tid\":%i,\"args\":{\"name\":", first ? "" : ",\n", pid, buffer->threadID);
+		writeString(file, name.c_str());
+		fprintf(file, "}}");
+
+		first = false;
+
+		// copy the events, the thread keeps recording while they're written
+		const uint64_t capacity = buffer->events.size();
+		const uint64_t head = buffer->head.load(std::memory_order_acquire);
+		const uint64_t tail = (head > capacity) ? head - capacity : 0;
+
+		std::vector<TraceEvent> events(head - tail);
+
+		for( uint64_t e=tail; e < head; e++ )
+			events[e - tail] = buffer->events[e % capacity];
+
+		// drop the events that were overwritten during the copy, and the one the
+		// thread may be writing now (event newHead, in the slot of newHead - capacity)
+		const uint64_t newHead = buffer->head.load(std::memory_order_acquire);
+		const uint64_t overwritten = (newHead + 1 > capacity + tail) ? std::min(newHead + 1 - capacity - tail, (uint64_t)events.size()) : 0;
+
+		for( size_t e=overwritten; e < events.size(); e++ )
+		{
+			fprintf(file, ",\n{\"name\":");
+			writeString(file, events[e].name);
+			fprintf(file, ",\"ph\":\"X\",\"pid\":%i,\"tid\":%i,\"ts\":%.3f,\"dur\":%.3f}", pid, buffer->threadID,
+				   events[e].begin * 1e-3, (events[e].end - events[e].begin) * 1e-3);
+		}
+
+		numEvents += events.size() - overwritten;
+	}
+
+	fprintf(file, "\n]}\n");
+
+	if( fclose(file) != 0 )
+	{
+		printf("camera-capture:  failed to write trace %s\n", filename.c_str());
+		return false;
+	}
+
+	printf("camera-capture:  wrote %zu trace events from %zu threads to %s\n", numEvents, buffers.size(), filename.c_str());
+	return true;
+}
+
+
+// Usage
+const char* Tracer::Usage()
+{
+	return "tracing arguments:\n"
+		  "  --trace=FILE               record a timeline of the capture and saves, written\n"
+		  "                             to FILE in the Chrome trace format on exit or SIGUSR2\n"
+		  "  --trace-events=N           events kept per thread (default 100000)\n\n";
+}
+
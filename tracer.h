@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CAMERA_TRACER__
+#define __CAMERA_TRACER__
+
+#include <stdint.h>
+#include <string>
+#include <atomic>
+
+
+/*
+ * Timeline of the scopes executed by each thread, saved in the Chrome trace
+ * format (open it with chrome://tracing or https://ui.perfetto.dev).
+ *
+ * Each thread records its scopes into its own ring buffer, without locking,
+ * and only the latest events are kept once a buffer wraps around.  While
+ * tracing is disabled, a scope costs one branch.  The scopes timed with
+ * METRICS_SCOPE (see metrics.h) are traced too.
+ */
+class Tracer
+{
+public:
+	// enable tracing (the capacity is the number of events kept per thread)
+	static void Enable( int capacity=DefaultCapacity );
+
+	// is tracing enabled?
+	static inline bool IsEnabled()				{ return enabled.load(std::memory_order_relaxed); }
+
+	// record a scope that ran from begin to end (in nanoseconds, from Metrics::Now())
+	// the name has to stay valid (i.e. a string literal)
+	static void Record( const char* name, uint64_t begin, uint64_t end );
+
+	// name the calling thread in the trace
+	static void SetThreadName( const char* name );
+
+	// write the events recorded so far to a trace file
+	static bool Write( const std::string& filename );
+
+	// usage string for the command line arguments
+	static const char* Usage();
+
+	// default number of events kept per thread
+	static const int DefaultCapacity = 100000;
+
+protected:
+	static std::atomic<bool> enabled;
+};
+
+
+/*
+ * Traces the enclosing scope
+ */
+class TraceScope
+{
+public:
+	inline TraceScope( const char* _name )			{ name = _name; begin = Tracer::IsEnabled() ? now() : 0; }
+	inline ~TraceScope()					{ if( begin != 0 ) Tracer::Record(name, begin, now()); }
+
+protected:
+	static uint64_t now();
+
+	const char* name;
+	uint64_t begin;
+};
+
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+/*
+ * Trace the rest of the scope, i.e. TRACE_SCOPE("process_events")
+ */
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#endif
+